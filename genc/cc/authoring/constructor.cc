@@ -217,6 +217,22 @@ absl::StatusOr<v0::Value> CreateRegexPartialMatch(
   return value_pb;
 }
 
+absl::StatusOr<v0::Value> CreateRegexSetMatch(
+    std::vector<absl::string_view> patterns) {
+  if (patterns.empty()) {
+    return absl::InvalidArgumentError("Expected at least one pattern.");
+  }
+  v0::Value value_pb;
+  v0::Intrinsic* const intrinsic_pb = value_pb.mutable_intrinsic();
+  intrinsic_pb->set_uri(std::string(intrinsics::kRegexSetMatch));
+  v0::Struct* const patterns_pb =
+      intrinsic_pb->mutable_static_parameter()->mutable_struct_();
+  for (absl::string_view pattern : patterns) {
+    patterns_pb->add_element()->set_str(std::string(pattern));
+  }
+  return value_pb;
+}
+
 absl::StatusOr<v0::Value> CreateLogicalNot() {
   v0::Value value_pb;
   v0::Intrinsic* const intrinsic_pb = value_pb.mutable_intrinsic();
@@ -290,6 +306,31 @@ absl::StatusOr<v0::Value> CreateParallelMap(v0::Value map_fn) {
   return map_pb;
 }
 
+absl::StatusOr<v0::Value> CreateParallelMapWithOptions(v0::Value map_fn,
+                                                       int max_in_flight,
+                                                       bool ordered,
+                                                       bool fail_fast) {
+  if (max_in_flight < 0) {
+    return absl::InvalidArgumentError("max_in_flight must not be negative.");
+  }
+  v0::Value map_pb;
+  v0::Intrinsic* const intrinsic_pb = map_pb.mutable_intrinsic();
+  intrinsic_pb->set_uri(std::string(intrinsics::kParallelMap));
+  v0::Struct* args =
+      intrinsic_pb->mutable_static_parameter()->mutable_struct_();
+  *args->add_element() = CreateLabeledValue("map_fn", map_fn);
+  v0::Value* max_in_flight_pb = args->add_element();
+  max_in_flight_pb->set_label("max_in_flight");
+  max_in_flight_pb->set_int_32(max_in_flight);
+  v0::Value* ordered_pb = args->add_element();
+  ordered_pb->set_label("ordered");
+  ordered_pb->set_boolean(ordered);
+  v0::Value* fail_fast_pb = args->add_element();
+  fail_fast_pb->set_label("fail_fast");
+  fail_fast_pb->set_boolean(fail_fast);
+  return map_pb;
+}
+
 absl::StatusOr<v0::Value> CreateLogger() {
   v0::Value logger_pb;
   v0::Intrinsic* const intrinsic_pb = logger_pb.mutable_intrinsic();
@@ -333,6 +374,31 @@ absl::StatusOr<v0::Value> CreateFallback(std::vector<v0::Value> function_list) {
   return fallback_pb;
 }
 
+absl::StatusOr<v0::Value> CreateFallbackWithOptions(
+    std::vector<v0::Value> function_list, absl::string_view mode,
+    int hedge_delay_ms) {
+  if (mode != "sequential" && mode != "hedged" && mode != "race") {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unrecognized fallback mode: \"", mode, "\"."));
+  }
+  if (hedge_delay_ms < 0) {
+    return absl::InvalidArgumentError("hedge_delay_ms must not be negative.");
+  }
+  v0::Value fallback_pb = GENC_TRY(CreateFallback(std::move(function_list)));
+  v0::Struct* args = fallback_pb.mutable_intrinsic()
+                         ->mutable_static_parameter()
+                         ->mutable_struct_();
+  v0::Value* mode_pb = args->add_element();
+  mode_pb->set_label("mode");
+  mode_pb->set_str(std::string(mode));
+  if (mode == "hedged") {
+    v0::Value* hedge_delay_pb = args->add_element();
+    hedge_delay_pb->set_label("hedge_delay_ms");
+    hedge_delay_pb->set_int_32(hedge_delay_ms);
+  }
+  return fallback_pb;
+}
+
 absl::StatusOr<v0::Value> CreateConditional(v0::Value condition,
                                             v0::Value positive_branch,
                                             v0::Value negative_branch) {
@@ -51,6 +51,14 @@ absl::StatusOr<v0::Value> CreateCustomFunction(absl::string_view fn_uri);
 // successful one is the result; if failed, keep going down the list.
 absl::StatusOr<v0::Value> CreateFallback(std::vector<v0::Value> function_list);
 
+// Like `CreateFallback`, but with the candidates attempted as per `mode`:
+// "sequential" as above, "hedged" to also start the next candidate whenever
+// those in progress have taken `hedge_delay_ms` without failing, or "race" to
+// start all of them at once. The first successful one is the result.
+absl::StatusOr<v0::Value> CreateFallbackWithOptions(
+    std::vector<v0::Value> function_list, absl::string_view mode,
+    int hedge_delay_ms);
+
 // Creates an InjaTemplate.
 absl::StatusOr<v0::Value> CreateInjaTemplate(absl::string_view template_str);
 
@@ -89,6 +97,15 @@ absl::StatusOr<v0::Value> CreateModelInferenceWithConfig(
 // Creates a parallel map that applies map_fn to a all input values.
 absl::StatusOr<v0::Value> CreateParallelMap(v0::Value map_fn);
 
+// Like `CreateParallelMap`, but with at most `max_in_flight` calls in progress
+// at a time (0 for no limit), the results in the order of the inputs or else
+// in the order of completion, and a failed call either failing the map or
+// being reported in its result as a string labeled "error".
+absl::StatusOr<v0::Value> CreateParallelMapWithOptions(v0::Value map_fn,
+                                                       int max_in_flight,
+                                                       bool ordered,
+                                                       bool fail_fast);
+
 // Creates a prompt template computation with the given template string.
 // NOTE: Please use `CreatePromptTemplateWithParameters` instead for building
 /// multivariate prompt templates. The use of this function with multivariate
@@ -108,6 +125,11 @@ absl::StatusOr<v0::Value> CreateReference(absl::string_view arg_name);
 absl::StatusOr<v0::Value> CreateRegexPartialMatch(
     absl::string_view pattern_str);
 
+// Creates a matcher that partially matches its input against all of the given
+// patterns in a single scan, and returns a boolean for each of them.
+absl::StatusOr<v0::Value> CreateRegexSetMatch(
+    std::vector<absl::string_view> patterns);
+
 // Returns a repeat proto which will repeat body_fn for num_steps, sequentially,
 // the output of the current step is the input to next iteration.
 absl::StatusOr<v0::Value> CreateRepeat(int num_steps, v0::Value body_fn);
@@ -69,6 +69,9 @@ PYBIND11_MODULE(constructor_bindings, m) {
   m.def("create_regex_partial_match", &CreateRegexPartialMatch,
         "Creates a regular expression partial match with the given pattern.");
 
+  m.def("create_regex_set_match", &CreateRegexSetMatch,
+        "Creates a partial match against all of the given patterns at once.");
+
   m.def("create_reference", &CreateReference,
         "Constructs a reference to `name`.");
 
@@ -98,6 +101,10 @@ PYBIND11_MODULE(constructor_bindings, m) {
   m.def("create_parallel_map", &CreateParallelMap,
         "Creates a parallel map that applies map_fn to a all input values.");
 
+  m.def("create_parallel_map_with_options", &CreateParallelMapWithOptions,
+        "Creates a parallel map with a limit on the calls in progress, and "
+        "the order of the results and handling of failures as specified.");
+
   m.def(
       "create_repeated_conditional_chain", &CreateRepeatedConditionalChain,
       "Creates a chain that can repeat and break which is a typical construct "
@@ -128,6 +135,10 @@ PYBIND11_MODULE(constructor_bindings, m) {
   m.def("create_fallback", &CreateFallback,
         "Constructs a computation a fallback chain.");
 
+  m.def("create_fallback_with_options", &CreateFallbackWithOptions,
+        "Constructs a fallback chain whose candidates are hedged or raced "
+        "as per the mode.");
+
   m.def("create_inja_template", &CreateInjaTemplate,
         "Returns an inja template that encodes a template with input JSON "
         "string.");
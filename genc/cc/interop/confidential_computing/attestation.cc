@@ -17,15 +17,21 @@ limitations under the License
 #include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/const_init.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "genc/cc/interop/confidential_computing/attestation.h"
 #include "genc/cc/interop/networking/curl_based_http_client.h"
 #include "genc/cc/interop/networking/http_client_interface.h"
@@ -92,6 +98,25 @@ absl::StatusOr<std::string> GetStringAttributeFromJson(
   return it->get<std::string>();
 }
 
+// Returns the nonce that `token` claims to carry, i.e., the server public key,
+// without verifying the token.
+absl::StatusOr<std::string> GetUnverifiedNonce(const std::string& token) {
+  const std::vector<absl::string_view> parts = absl::StrSplit(token, '.');
+  std::string payload;
+  if (parts.size() != 3 || !absl::WebSafeBase64Unescape(parts[1], &payload)) {
+    return absl::InvalidArgumentError("Malformed token.");
+  }
+  auto json = nlohmann::json::parse(payload, nullptr, false);
+  if (json.is_discarded() || !json.is_object()) {
+    return absl::InvalidArgumentError("Malformed token payload.");
+  }
+  auto it = json.find(kJwtNonceAttributeName);
+  if (it == json.end() || !it->is_string()) {
+    return absl::InvalidArgumentError("The token carries no nonce.");
+  }
+  return it->get<std::string>();
+}
+
 }  // namespace
 
 absl::StatusOr<std::string> GetAttestationToken(
@@ -121,28 +146,54 @@ absl::StatusOr<crypto::tink::VerifiedJwt> DecodeAttestationToken(
     const std::string& audience,
     const std::string& issuer,
     std::shared_ptr<networking::HttpClientInterface> http_client) {
+  return AttestationCache::ForClient(std::move(http_client))
+      ->DecodeToken(token, audience, issuer);
+}
+
+std::shared_ptr<AttestationCache> AttestationCache::ForClient(
+    std::shared_ptr<networking::HttpClientInterface> http_client) {
+  static absl::Mutex mutex(absl::kConstInit);
+  static auto* default_cache = new std::shared_ptr<AttestationCache>(
+      std::make_shared<AttestationCache>());
+  // Each cache holds its client, so a client's address isn't reused while
+  // its cache is alive.
+  static auto* caches = new absl::flat_hash_map<
+      const networking::HttpClientInterface*, std::weak_ptr<AttestationCache>>;
   if (http_client == nullptr) {
-    http_client = GENC_TRY(networking::CreateCurlBasedHttpClient(false));
+    return *default_cache;
   }
-  const std::string well_known_payload =
-      GENC_TRY(http_client->GetFromUrl(kWellKnownFileURI));
-  auto well_known_json =
-      nlohmann::json::parse(well_known_payload, nullptr, false);
-  if (well_known_json.is_discarded()) {
-    return absl::InternalError(absl::StrCat(
-        "Couldn't parse the well-known payload: ", well_known_payload));
+  absl::MutexLock lock(&mutex);
+  auto it = caches->find(http_client.get());
+  if (it != caches->end()) {
+    if (std::shared_ptr<AttestationCache> cache = it->second.lock()) {
+      return cache;
+    }
   }
-  const std::string jwks_uri = well_known_json[kJwksUriFieldName];
-  const std::string jwks_payload =
-      GENC_TRY(http_client->GetFromUrl(jwks_uri));
-  absl::StatusOr<std::unique_ptr<crypto::tink::KeysetHandle>> keyset_handle =
-      crypto::tink::JwkSetToPublicKeysetHandle(jwks_payload);
-  if (!keyset_handle.ok()) {
-    return absl::InternalError(absl::StrCat(
-        "JwkSetToPublicKeysetHandle failed with errpr:\n",
-        keyset_handle.status().ToString(),
-        "\non payload:\n",
-        jwks_payload, "\n"));
+  for (auto expired = caches->begin(); expired != caches->end();) {
+    if (expired->second.expired()) {
+      caches->erase(expired++);
+    } else {
+      ++expired;
+    }
+  }
+  const networking::HttpClientInterface* key = http_client.get();
+  auto cache = std::make_shared<AttestationCache>(std::move(http_client));
+  (*caches)[key] = cache;
+  return cache;
+}
+
+absl::StatusOr<crypto::tink::VerifiedJwt> AttestationCache::DecodeToken(
+    const std::string& token,
+    const std::string& audience,
+    const std::string& issuer) {
+  const absl::Time now = absl::Now();
+  absl::StatusOr<std::string> claimed_key = GetUnverifiedNonce(token);
+  if (claimed_key.ok()) {
+    absl::MutexLock lock(&tokens_mutex_);
+    auto it = tokens_.find(TokenKey(*claimed_key, audience, issuer));
+    if (it != tokens_.end() && now < it->second.expiration) {
+      return it->second.jwt;
+    }
   }
   crypto::tink::JwtValidatorBuilder builder;
   if (!audience.empty()) {
@@ -157,12 +208,16 @@ absl::StatusOr<crypto::tink::VerifiedJwt> DecodeAttestationToken(
   }
   builder.IgnoreTypeHeader();
   crypto::tink::JwtValidator validator = GENC_TRY(builder.Build());
-  GENC_TRY(crypto::tink::JwtSignatureRegister());
-  std::unique_ptr<crypto::tink::JwtPublicKeyVerify> jwt_verifier = GENC_TRY(
-      keyset_handle.value()->GetPrimitive<crypto::tink::JwtPublicKeyVerify>(
-          crypto::tink::ConfigGlobalRegistry()));
+  absl::Time fetch_time;
+  std::shared_ptr<const crypto::tink::JwtPublicKeyVerify> keys =
+      GENC_TRY(GetKeys(now - options_.jwks_ttl, &fetch_time));
   absl::StatusOr<crypto::tink::VerifiedJwt> verified_token =
-      jwt_verifier->VerifyAndDecode(token, validator);
+      keys->VerifyAndDecode(token, validator);
+  if (!verified_token.ok() && now - fetch_time >= options_.min_jwks_refresh) {
+    // The token may have been signed with a key rotated in since the fetch.
+    keys = GENC_TRY(GetKeys(fetch_time, &fetch_time));
+    verified_token = keys->VerifyAndDecode(token, validator);
+  }
   if (!verified_token.ok()) {
     return absl::InternalError(absl::StrCat(
         "VerifyAndDecode failed with error:\n",
@@ -170,9 +225,87 @@ absl::StatusOr<crypto::tink::VerifiedJwt> DecodeAttestationToken(
         "\non token:\n",
         token, "\n"));
   }
+  // Remembered under the key the token was verified to carry.
+  absl::StatusOr<std::string> server_key =
+      verified_token->GetStringClaim(kJwtNonceAttributeName);
+  if (verified_token->HasExpiration() && server_key.ok()) {
+    AddVerifiedToken(TokenKey(*std::move(server_key), audience, issuer),
+                     *verified_token);
+  }
   return verified_token;
 }
 
+void AttestationCache::Clear() {
+  {
+    absl::MutexLock lock(&keys_mutex_);
+    keys_ = nullptr;
+  }
+  absl::MutexLock lock(&tokens_mutex_);
+  tokens_.clear();
+  insertion_order_.clear();
+}
+
+absl::StatusOr<std::shared_ptr<const crypto::tink::JwtPublicKeyVerify>>
+AttestationCache::GetKeys(absl::Time stale_at, absl::Time* fetch_time) {
+  // Held across the fetch so that concurrent callers wait for it rather than
+  // all fetching the same keys.
+  absl::MutexLock lock(&keys_mutex_);
+  if (keys_ != nullptr && keys_fetch_time_ > stale_at) {
+    *fetch_time = keys_fetch_time_;
+    return keys_;
+  }
+  if (http_client_ == nullptr) {
+    http_client_ = GENC_TRY(networking::CreateCurlBasedHttpClient(false));
+  }
+  const absl::Time now = absl::Now();
+  const std::string well_known_payload =
+      GENC_TRY(http_client_->GetFromUrl(kWellKnownFileURI));
+  auto well_known_json =
+      nlohmann::json::parse(well_known_payload, nullptr, false);
+  if (well_known_json.is_discarded()) {
+    return absl::InternalError(absl::StrCat(
+        "Couldn't parse the well-known payload: ", well_known_payload));
+  }
+  const std::string jwks_uri = well_known_json[kJwksUriFieldName];
+  const std::string jwks_payload =
+      GENC_TRY(http_client_->GetFromUrl(jwks_uri));
+  absl::StatusOr<std::unique_ptr<crypto::tink::KeysetHandle>> keyset_handle =
+      crypto::tink::JwkSetToPublicKeysetHandle(jwks_payload);
+  if (!keyset_handle.ok()) {
+    return absl::InternalError(absl::StrCat(
+        "JwkSetToPublicKeysetHandle failed with errpr:\n",
+        keyset_handle.status().ToString(),
+        "\non payload:\n",
+        jwks_payload, "\n"));
+  }
+  GENC_TRY(crypto::tink::JwtSignatureRegister());
+  keys_ = GENC_TRY(
+      keyset_handle.value()->GetPrimitive<crypto::tink::JwtPublicKeyVerify>(
+          crypto::tink::ConfigGlobalRegistry()));
+  keys_fetch_time_ = now;
+  *fetch_time = now;
+  return keys_;
+}
+
+void AttestationCache::AddVerifiedToken(
+    TokenKey key, const crypto::tink::VerifiedJwt& jwt) {
+  absl::StatusOr<absl::Time> expiration = jwt.GetExpiration();
+  if (!expiration.ok() || options_.max_verified_tokens == 0) {
+    return;
+  }
+  absl::MutexLock lock(&tokens_mutex_);
+  auto [it, inserted] =
+      tokens_.insert_or_assign(key, VerifiedToken{jwt, *expiration});
+  if (!inserted) {
+    return;
+  }
+  insertion_order_.push_back(std::move(key));
+  while (insertion_order_.size() > options_.max_verified_tokens) {
+    tokens_.erase(insertion_order_.front());
+    insertion_order_.pop_front();
+  }
+}
+
 namespace {
 
 class AttestationProviderImpl : public AttestationProvider {
@@ -236,10 +369,10 @@ class AttestationVerifierImpl : public AttestationVerifier {
   explicit AttestationVerifierImpl(
       WorkloadProvenance workload_provenance,
       bool debug,
-      std::shared_ptr<networking::HttpClientInterface> http_client)
+      std::shared_ptr<AttestationCache> cache)
       : workload_provenance_(workload_provenance),
         debug_(debug),
-        http_client_(http_client) {}
+        cache_(std::move(cache)) {}
 
   absl::StatusOr<::oak::attestation::v1::AttestationResults> Verify(
       std::chrono::time_point<std::chrono::system_clock> now,
@@ -249,8 +382,7 @@ class AttestationVerifierImpl : public AttestationVerifier {
     const std::string& token =
         evidence.application_keys().encryption_public_key_certificate();
     crypto::tink::VerifiedJwt verified_token =
-        GENC_TRY(DecodeAttestationToken(
-            token, kAudience, kIssuer, http_client_));
+        GENC_TRY(cache_->DecodeToken(token, kAudience, kIssuer));
     const std::string token_json_string =
         GENC_TRY(verified_token.GetJsonPayload());
     if (debug_) {
@@ -313,7 +445,7 @@ class AttestationVerifierImpl : public AttestationVerifier {
  private:
   const WorkloadProvenance workload_provenance_;
   const bool debug_;
-  const std::shared_ptr<networking::HttpClientInterface> http_client_;
+  const std::shared_ptr<AttestationCache> cache_;
 };
 
 }  // namespace
@@ -332,11 +464,10 @@ absl::StatusOr<std::shared_ptr<AttestationVerifier>> CreateAttestationVerifier(
     WorkloadProvenance workload_provenance,
     bool debug,
     std::shared_ptr<networking::HttpClientInterface> http_client) {
-  if (http_client == nullptr) {
-    http_client = GENC_TRY(networking::CreateCurlBasedHttpClient(debug));
-  }
+  // Without a client, shares the cache of the other verifiers given none.
   return std::make_shared<AttestationVerifierImpl>(
-      workload_provenance, debug, http_client);
+      workload_provenance, debug,
+      AttestationCache::ForClient(std::move(http_client)));
 }
 
 }  // namespace confidential_computing
@@ -16,13 +16,22 @@ limitations under the License
 #ifndef GENC_CC_INTEROP_CONFIDENTIAL_COMPUTING_ATTESTATION_H_
 #define GENC_CC_INTEROP_CONFIDENTIAL_COMPUTING_ATTESTATION_H_
 
+#include <cstddef>
+#include <deque>
 #include <memory>
 #include <string>
+#include <tuple>
+#include <utility>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "genc/cc/interop/networking/http_client_interface.h"
 #include "genc/cc/interop/oak/attestation_provider.h"
 #include "cc/attestation/verification/attestation_verifier.h"
+#include "tink/jwt/jwt_public_key_verify.h"
 #include "tink/jwt/verified_jwt.h"
 
 
@@ -38,12 +47,93 @@ absl::StatusOr<std::string> GetAttestationToken(
     const std::string& nonce,
     std::shared_ptr<networking::HttpClientInterface> http_client = nullptr);
 
+// Verifies and decodes `token` through `AttestationCache::ForClient()`.
 absl::StatusOr<crypto::tink::VerifiedJwt> DecodeAttestationToken(
     const std::string& token,
     const std::string& audience,
     const std::string& issuer,
     std::shared_ptr<networking::HttpClientInterface> http_client = nullptr);
 
+struct AttestationCacheOptions {
+  // How long keys fetched from the JWKS endpoint are used before they are
+  // fetched again.
+  absl::Duration jwks_ttl = absl::Hours(1);
+
+  // A token that fails to verify against keys at least this old makes the
+  // keys be fetched again early, in case they have been rotated.
+  absl::Duration min_jwks_refresh = absl::Minutes(1);
+
+  // The number of server keys whose verified tokens are remembered until they
+  // expire.
+  size_t max_verified_tokens = 256;
+};
+
+// A thread-safe cache of the JWKS keys used to verify attestation tokens, and
+// of the tokens verified with them, keyed by the server public key that each
+// token carries as its nonce. A session re-established with the same server
+// key skips both the network fetches and the signature verification until the
+// token verified for it expires, even though the server presents a new token.
+class AttestationCache {
+ public:
+  // Fetches the keys with `http_client`, or with a client of its own if null.
+  explicit AttestationCache(
+      std::shared_ptr<networking::HttpClientInterface> http_client = nullptr,
+      AttestationCacheOptions options = {})
+      : options_(options), http_client_(std::move(http_client)) {}
+
+  AttestationCache(const AttestationCache&) = delete;
+  AttestationCache& operator=(const AttestationCache&) = delete;
+
+  // The cache shared by the callers that fetch keys with `http_client`, for as
+  // long as any of them holds it. Callers passing no client share a cache kept
+  // for the lifetime of the process.
+  static std::shared_ptr<AttestationCache> ForClient(
+      std::shared_ptr<networking::HttpClientInterface> http_client);
+
+  // Verifies and decodes `token`, fetching the keys when they are missing or
+  // stale. Returns the token verified earlier for the same server key (and
+  // audience and issuer) if it hasn't expired. That is safe whatever `token`
+  // holds, since a session with the key can only be established by whoever
+  // holds its private half, which the earlier token showed to be attested.
+  absl::StatusOr<crypto::tink::VerifiedJwt> DecodeToken(
+      const std::string& token, const std::string& audience,
+      const std::string& issuer);
+
+  // Forgets all keys and verified tokens.
+  void Clear();
+
+ private:
+  // The server public key, audience and issuer.
+  using TokenKey = std::tuple<std::string, std::string, std::string>;
+
+  struct VerifiedToken {
+    crypto::tink::VerifiedJwt jwt;
+    absl::Time expiration;
+  };
+
+  // Returns the cached keys and sets `fetch_time` to when they were fetched,
+  // fetching them first if they are missing or were fetched at `stale_at` or
+  // earlier.
+  absl::StatusOr<std::shared_ptr<const crypto::tink::JwtPublicKeyVerify>>
+  GetKeys(absl::Time stale_at, absl::Time* fetch_time);
+
+  void AddVerifiedToken(TokenKey key, const crypto::tink::VerifiedJwt& jwt);
+
+  const AttestationCacheOptions options_;
+
+  absl::Mutex keys_mutex_;
+  std::shared_ptr<networking::HttpClientInterface> http_client_
+      ABSL_GUARDED_BY(keys_mutex_);
+  std::shared_ptr<const crypto::tink::JwtPublicKeyVerify> keys_
+      ABSL_GUARDED_BY(keys_mutex_);
+  absl::Time keys_fetch_time_ ABSL_GUARDED_BY(keys_mutex_);
+
+  absl::Mutex tokens_mutex_;
+  absl::flat_hash_map<TokenKey, VerifiedToken> tokens_
+      ABSL_GUARDED_BY(tokens_mutex_);
+  std::deque<TokenKey> insertion_order_ ABSL_GUARDED_BY(tokens_mutex_);
+};
+
 class AttestationProvider : public oak::AttestationProvider {};
 
 class AttestationVerifier
@@ -0,0 +1,194 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/interop/confidential_computing/attestation.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "genc/cc/interop/networking/http_client_interface.h"
+#include "tink/config/global_registry.h"
+#include "tink/jwt/jwk_set_converter.h"
+#include "tink/jwt/jwt_key_templates.h"
+#include "tink/jwt/jwt_public_key_sign.h"
+#include "tink/jwt/jwt_signature_config.h"
+#include "tink/jwt/raw_jwt.h"
+#include "tink/jwt/verified_jwt.h"
+#include "tink/keyset_handle.h"
+
+namespace genc {
+namespace interop {
+namespace confidential_computing {
+namespace {
+
+constexpr char kAudience[] = "GenC";
+constexpr char kIssuer[] = "https://issuer";
+constexpr char kJwksUri[] = "https://issuer/jwks";
+
+// Signs attestation tokens with a key of its own.
+class TokenIssuer {
+ public:
+  TokenIssuer() {
+    EXPECT_TRUE(crypto::tink::JwtSignatureRegister().ok());
+    std::unique_ptr<crypto::tink::KeysetHandle> handle =
+        crypto::tink::KeysetHandle::GenerateNew(
+            crypto::tink::JwtEs256Template(),
+            crypto::tink::KeyGenConfigGlobalRegistry())
+            .value();
+    sign_ = handle
+                ->GetPrimitive<crypto::tink::JwtPublicKeySign>(
+                    crypto::tink::ConfigGlobalRegistry())
+                .value();
+    jwks_ = crypto::tink::JwkSetFromPublicKeysetHandle(
+                *handle
+                     ->GetPublicKeysetHandle(
+                         crypto::tink::KeyGenConfigGlobalRegistry())
+                     .value())
+                .value();
+  }
+
+  // Returns a token for the server key `nonce`, told apart by `jwt_id`.
+  std::string Sign(const std::string& nonce, const std::string& jwt_id) {
+    crypto::tink::RawJwt raw_jwt =
+        crypto::tink::RawJwtBuilder()
+            .SetIssuer(kIssuer)
+            .SetAudience(kAudience)
+            .SetJwtId(jwt_id)
+            .SetExpiration(absl::Now() + absl::Hours(1))
+            .AddStringClaim("eat_nonce", nonce)
+            .Build()
+            .value();
+    return sign_->SignAndEncode(raw_jwt).value();
+  }
+
+  const std::string& jwks() const { return jwks_; }
+
+ private:
+  std::unique_ptr<crypto::tink::JwtPublicKeySign> sign_;
+  std::string jwks_;
+};
+
+// Serves the JWKS of an issuer, and counts the fetches.
+class FakeHttpClient : public networking::HttpClientInterface {
+ public:
+  explicit FakeHttpClient(std::string jwks) : jwks_(std::move(jwks)) {}
+
+  absl::StatusOr<std::string> GetFromUrl(const std::string& url) override {
+    ++num_fetches_;
+    if (url == kJwksUri) {
+      return jwks_;
+    }
+    return std::string(R"json({"jwks_uri": "https://issuer/jwks"})json");
+  }
+
+  absl::StatusOr<std::string> PostJsonToUrl(
+      const std::string& url, const std::string& json_request) override {
+    return absl::UnimplementedError("Not supported.");
+  }
+
+  absl::StatusOr<std::string> GetFromUrlAndSocket(
+      const std::string& url, const std::string& socket_path) override {
+    return absl::UnimplementedError("Not supported.");
+  }
+
+  absl::StatusOr<std::string> PostJsonToUrlAndSocket(
+      const std::string& url, const std::string& socket_path,
+      const std::string& json_request) override {
+    return absl::UnimplementedError("Not supported.");
+  }
+
+  int num_fetches() const { return num_fetches_; }
+
+ private:
+  const std::string jwks_;
+  int num_fetches_ = 0;
+};
+
+TEST(AttestationCacheTest, VerifiesToken) {
+  TokenIssuer issuer;
+  AttestationCache cache(std::make_shared<FakeHttpClient>(issuer.jwks()));
+  absl::StatusOr<crypto::tink::VerifiedJwt> jwt =
+      cache.DecodeToken(issuer.Sign("key", "first"), kAudience, kIssuer);
+  ASSERT_TRUE(jwt.ok()) << jwt.status();
+  EXPECT_EQ(jwt->GetStringClaim("eat_nonce").value(), "key");
+}
+
+TEST(AttestationCacheTest, RejectsTokenFromAnotherIssuer) {
+  TokenIssuer issuer;
+  TokenIssuer other_issuer;
+  AttestationCache cache(std::make_shared<FakeHttpClient>(issuer.jwks()));
+  EXPECT_FALSE(
+      cache.DecodeToken(other_issuer.Sign("key", "first"), kAudience, kIssuer)
+          .ok());
+}
+
+TEST(AttestationCacheTest, ReusesVerificationForSameServerKey) {
+  TokenIssuer issuer;
+  TokenIssuer other_issuer;
+  auto http_client = std::make_shared<FakeHttpClient>(issuer.jwks());
+  AttestationCache cache(http_client);
+  ASSERT_TRUE(
+      cache.DecodeToken(issuer.Sign("key", "first"), kAudience, kIssuer).ok());
+  const int num_fetches = http_client->num_fetches();
+
+  // A new token for the same server key isn't verified again, so the token
+  // verified first stands in for it, even if the new one is invalid.
+  absl::StatusOr<crypto::tink::VerifiedJwt> jwt = cache.DecodeToken(
+      other_issuer.Sign("key", "second"), kAudience, kIssuer);
+  ASSERT_TRUE(jwt.ok()) << jwt.status();
+  EXPECT_EQ(jwt->GetJwtId().value(), "first");
+  EXPECT_EQ(http_client->num_fetches(), num_fetches);
+
+  // Tokens for other server keys still are.
+  EXPECT_FALSE(
+      cache.DecodeToken(other_issuer.Sign("other key", "third"), kAudience,
+                        kIssuer)
+          .ok());
+  EXPECT_TRUE(
+      cache.DecodeToken(issuer.Sign("other key", "fourth"), kAudience, kIssuer)
+          .ok());
+}
+
+TEST(AttestationCacheTest, ScopesCachePerClient) {
+  TokenIssuer issuer;
+  TokenIssuer other_issuer;
+  auto http_client = std::make_shared<FakeHttpClient>(issuer.jwks());
+  auto other_http_client =
+      std::make_shared<FakeHttpClient>(other_issuer.jwks());
+  std::shared_ptr<AttestationCache> cache =
+      AttestationCache::ForClient(http_client);
+  EXPECT_EQ(AttestationCache::ForClient(http_client), cache);
+  std::shared_ptr<AttestationCache> other_cache =
+      AttestationCache::ForClient(other_http_client);
+  EXPECT_NE(other_cache, cache);
+
+  const std::string token = issuer.Sign("key", "first");
+  ASSERT_TRUE(cache->DecodeToken(token, kAudience, kIssuer).ok());
+  // Neither the keys nor the token verified through the first client are used
+  // for the second.
+  EXPECT_FALSE(other_cache->DecodeToken(token, kAudience, kIssuer).ok());
+  EXPECT_GT(other_http_client->num_fetches(), 0);
+}
+
+}  // namespace
+}  // namespace confidential_computing
+}  // namespace interop
+}  // namespace genc
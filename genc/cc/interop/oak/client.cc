@@ -13,14 +13,21 @@ See the License for the specific language governing permissions and
 limitations under the License
 ==============================================================================*/
 
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <utility>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
+#include "absl/random/random.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "genc/cc/base/to_from_grpc_status.h"
 #include "genc/cc/interop/oak/client.h"
 #include "genc/cc/runtime/status_macros.h"
@@ -31,10 +38,15 @@ limitations under the License
 #include "include/grpcpp/client_context.h"
 #include "include/grpcpp/support/async_unary_call.h"
 #include "include/grpcpp/support/status.h"
+#include "include/grpcpp/support/sync_stream.h"
 #include "cc/attestation/verification/attestation_verifier.h"
-#include "cc/client/client.h"
+#include "cc/crypto/client_encryptor.h"
+#include "cc/crypto/common.h"
 #include "cc/transport/grpc_unary_transport.h"
 #include "cc/transport/transport.h"
+#include "proto/attestation/verification.pb.h"
+#include "proto/crypto/crypto.pb.h"
+#include "proto/session/messages.pb.h"
 #include "proto/session/service_unary.grpc.pb.h"
 
 namespace genc {
@@ -54,12 +66,27 @@ class OakClient : public v0::Executor::StubInterface {
     std::unique_ptr<::oak::transport::TransportWrapper> transport_wrapper =
         std::make_unique<::oak::transport::GrpcUnaryTransport<
             ::oak::session::v1::UnarySession::StubInterface>>(stub.release());
-    std::unique_ptr<::oak::client::OakClient> oak_client = GENC_TRY(
-        ::oak::client::OakClient::Create(
-            std::move(transport_wrapper), *attestation_verifier));
+    ::oak::session::v1::EndorsedEvidence endorsed_evidence =
+        GENC_TRY(transport_wrapper->GetEndorsedEvidence());
+    ::oak::attestation::v1::AttestationResults attestation_results =
+        GENC_TRY(attestation_verifier->Verify(
+            std::chrono::system_clock::now(),
+            endorsed_evidence.evidence(),
+            endorsed_evidence.endorsements()));
+    if (attestation_results.status() !=
+        ::oak::attestation::v1::AttestationResults::STATUS_SUCCESS) {
+      return absl::FailedPreconditionError(absl::StrCat(
+          "Attestation verification failed: ", attestation_results.reason()));
+    }
+    // A single encryptor serves the whole session, so that only the first
+    // request pays for setting up its context.
+    std::unique_ptr<::oak::crypto::ClientEncryptor> encryptor =
+        GENC_TRY(::oak::crypto::ClientEncryptor::Create(
+            attestation_results.encryption_public_key()));
     return absl::WrapUnique(
         new OakClient(
-            std::move(attestation_verifier), std::move(oak_client), debug));
+            std::move(attestation_verifier), std::move(transport_wrapper),
+            std::move(encryptor), debug));
   }
 
   grpc::Status CreateValue(
@@ -254,17 +281,181 @@ class OakClient : public v0::Executor::StubInterface {
           const v0::DisposeRequest& request,
           grpc::CompletionQueue* cq) override { return nullptr; }
 
+  // Chunked materialization isn't supported through Oak, which forwards unary
+  // requests.
+  grpc::ClientReaderInterface<v0::MaterializeChunk>* MaterializeStreamRaw(
+      grpc::ClientContext* context,
+      const v0::MaterializeRequest& request) override { return nullptr; }
+
+  grpc::ClientAsyncReaderInterface<v0::MaterializeChunk>*
+      AsyncMaterializeStreamRaw(
+          grpc::ClientContext* context,
+          const v0::MaterializeRequest& request,
+          grpc::CompletionQueue* cq,
+          void* tag) override { return nullptr; }
+
+  grpc::ClientAsyncReaderInterface<v0::MaterializeChunk>*
+      PrepareAsyncMaterializeStreamRaw(
+          grpc::ClientContext* context,
+          const v0::MaterializeRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  // Emulated with a `batch` request per write. The server keeps a single set
+  // of values per session, so only one stream may be open at a time.
+  grpc::ClientReaderWriterInterface<v0::ExecuteRequest, v0::ExecuteResponse>*
+      ExecuteRaw(grpc::ClientContext* context) override {
+    absl::MutexLock lock(&mutex_);
+    if (stream_open_) {
+      return new BatchStream(nullptr);
+    }
+    stream_open_ = true;
+    return new BatchStream(this);
+  }
+
+  grpc::ClientAsyncReaderWriterInterface<v0::ExecuteRequest,
+                                         v0::ExecuteResponse>*
+      AsyncExecuteRaw(
+          grpc::ClientContext* context,
+          grpc::CompletionQueue* cq,
+          void* tag) override { return nullptr; }
+
+  grpc::ClientAsyncReaderWriterInterface<v0::ExecuteRequest,
+                                         v0::ExecuteResponse>*
+      PrepareAsyncExecuteRaw(
+          grpc::ClientContext* context,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  absl::Status session_status() {
+    absl::MutexLock lock(&mutex_);
+    return status_;
+  }
+
  protected:
   OakClient(
       std::shared_ptr<::oak::attestation::verification::AttestationVerifier>
           attestation_verifier,
-      std::unique_ptr<::oak::client::OakClient> oak_client,
+      std::unique_ptr<::oak::transport::TransportWrapper> transport,
+      std::unique_ptr<::oak::crypto::ClientEncryptor> encryptor,
       bool debug)
       : attestation_verifier_(std::move(attestation_verifier)),
-        oak_client_(std::move(oak_client)),
-        debug_(debug) {}
+        transport_(std::move(transport)),
+        session_id_(NewSessionId()),
+        debug_(debug),
+        encryptor_(std::move(encryptor)) {}
 
  private:
+  // Carries the batches of an `Execute` stream, each in a single encrypted
+  // round trip whose response holds the answers to its materializations.
+  // `Read` returns them in turn, and false once the stream is half-closed or a
+  // round trip fails.
+  class BatchStream : public grpc::ClientReaderWriterInterface<
+                          v0::ExecuteRequest, v0::ExecuteResponse> {
+   public:
+    // A null `client` makes a stream that fails right away.
+    explicit BatchStream(OakClient* client)
+        : client_(client),
+          done_(client == nullptr),
+          status_(client == nullptr
+                      ? absl::FailedPreconditionError(
+                            "Only one Execute stream at a time is supported "
+                            "through Oak.")
+                      : absl::OkStatus()) {}
+
+    ~BatchStream() override {
+      if (client_ != nullptr) {
+        absl::MutexLock lock(&client_->mutex_);
+        client_->stream_open_ = false;
+      }
+    }
+
+    void WaitForInitialMetadata() override {}
+
+    bool NextMessageSize(uint32_t* sz) override {
+      *sz = UINT32_MAX;
+      return true;
+    }
+
+    bool Write(const v0::ExecuteRequest& msg,
+               grpc::WriteOptions options) override {
+      {
+        absl::MutexLock lock(&mutex_);
+        if (done_) {
+          return false;
+        }
+      }
+      v0::ExecutorRequest request;
+      *request.mutable_batch() = msg;
+      v0::ExecutorResponse response;
+      absl::Status status = client_->Call(request, &response);
+      if (status.ok() && !response.has_batch()) {
+        status = absl::InternalError(
+            "Received a mismatching type of response.");
+      }
+      absl::MutexLock lock(&mutex_);
+      if (!status.ok()) {
+        status_ = status;
+        done_ = true;
+        return false;
+      }
+      for (v0::ExecuteResponse& execute_response :
+           *response.mutable_batch()->mutable_response()) {
+        responses_.push_back(std::move(execute_response));
+      }
+      return true;
+    }
+
+    // Ends the session on the server, which disposes of the values.
+    bool WritesDone() override {
+      {
+        absl::MutexLock lock(&mutex_);
+        if (done_) {
+          return false;
+        }
+        done_ = true;
+      }
+      v0::ExecutorRequest request;
+      request.mutable_batch()->set_end_session(true);
+      v0::ExecutorResponse response;
+      return client_->Call(request, &response).ok();
+    }
+
+    bool Read(v0::ExecuteResponse* msg) override {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &BatchStream::CanRead));
+      if (responses_.empty()) {
+        return false;
+      }
+      *msg = std::move(responses_.front());
+      responses_.pop_front();
+      return true;
+    }
+
+    grpc::Status Finish() override {
+      absl::MutexLock lock(&mutex_);
+      return AbslToGrpcStatus(status_);
+    }
+
+   private:
+    bool CanRead() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return done_ || !responses_.empty();
+    }
+
+    OakClient* const client_;
+    absl::Mutex mutex_;
+    std::deque<v0::ExecuteResponse> responses_ ABSL_GUARDED_BY(mutex_);
+    bool done_ ABSL_GUARDED_BY(mutex_);
+    absl::Status status_ ABSL_GUARDED_BY(mutex_);
+  };
+
+  // Names the session in the associated data of every request, so that the
+  // server can find the encryption context set up by the first one.
+  static std::string NewSessionId() {
+    absl::BitGen bitgen;
+    return absl::StrCat(
+        absl::Hex(absl::Uniform<uint64_t>(bitgen), absl::kZeroPad16),
+        absl::Hex(absl::Uniform<uint64_t>(bitgen), absl::kZeroPad16));
+  }
+
   absl::Status Call(
       const v0::ExecutorRequest& request,
       v0::ExecutorResponse* response) {
@@ -272,9 +463,22 @@ class OakClient : public v0::Executor::StubInterface {
       std::cout << "Request:\n" << request.DebugString() << "\n";
     }
     std::string serialized_request = request.SerializeAsString();
-    absl::StatusOr<std::string> serialized_response =
-        GENC_TRY(oak_client_.value()->Invoke(serialized_request));
-    if (!response->ParseFromString(serialized_response.value())) {
+    std::string serialized_response;
+    {
+      // Requests are encrypted, sent and their responses decrypted one at a
+      // time, since each message advances the encryption context.
+      absl::MutexLock lock(&mutex_);
+      GENC_TRY(status_);
+      absl::StatusOr<std::string> plaintext = RoundTrip(serialized_request);
+      if (!plaintext.ok()) {
+        // The encryption contexts may now be out of step, so the session can't
+        // be used any further.
+        status_ = plaintext.status();
+        return status_;
+      }
+      serialized_response = *std::move(plaintext);
+    }
+    if (!response->ParseFromString(serialized_response)) {
       return absl::InternalError("Failed to parse the serialized response.");
     }
     if (debug_) {
@@ -283,10 +487,29 @@ class OakClient : public v0::Executor::StubInterface {
     return absl::OkStatus();
   }
 
+  absl::StatusOr<std::string> RoundTrip(const std::string& plaintext)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    ::oak::crypto::v1::EncryptedRequest encrypted_request =
+        GENC_TRY(encryptor_->Encrypt(plaintext, session_id_));
+    ::oak::crypto::v1::EncryptedResponse encrypted_response =
+        GENC_TRY(transport_->Invoke(encrypted_request));
+    ::oak::crypto::DecryptionResult decryption_result =
+        GENC_TRY(encryptor_->Decrypt(encrypted_response));
+    return std::move(decryption_result.plaintext);
+  }
+
   const std::shared_ptr<::oak::attestation::verification::AttestationVerifier>
       attestation_verifier_;
-  const absl::StatusOr<std::unique_ptr<::oak::client::OakClient>> oak_client_;
+  const std::unique_ptr<::oak::transport::TransportWrapper> transport_;
+  const std::string session_id_;
   const bool debug_;
+
+  absl::Mutex mutex_;
+  const std::unique_ptr<::oak::crypto::ClientEncryptor> encryptor_
+      ABSL_PT_GUARDED_BY(mutex_);
+  // Set once a round trip has failed.
+  absl::Status status_ ABSL_GUARDED_BY(mutex_);
+  bool stream_open_ ABSL_GUARDED_BY(mutex_) = false;
 };
 
 }  // namespace
@@ -299,6 +522,14 @@ absl::StatusOr<std::unique_ptr<v0::Executor::StubInterface>> CreateClient(
   return OakClient::Create(channel, std::move(attestation_verifier), debug);
 }
 
+absl::Status GetSessionStatus(v0::Executor::StubInterface& client) {
+  OakClient* const oak_client = dynamic_cast<OakClient*>(&client);
+  if (oak_client == nullptr) {
+    return absl::InvalidArgumentError("Expected an Oak client.");
+  }
+  return oak_client->session_status();
+}
+
 }  // namespace oak
 }  // namespace interop
 }  // namespace genc
@@ -18,6 +18,7 @@ limitations under the License
 
 #include <memory>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "genc/proto/v0/executor.grpc.pb.h"
 #include "include/grpcpp/channel.h"
@@ -34,6 +35,13 @@ absl::StatusOr<std::unique_ptr<v0::Executor::StubInterface>> CreateClient(
         attestation_verifier,
     bool debug);
 
+// Returns the error that left the session of `client`, made by `CreateClient`,
+// unusable, e.g., a round trip that failed in transport or encryption, after
+// which the encryption contexts may be out of step with the server's. Errors
+// of the requests themselves come back in their responses, and don't affect
+// it. Fails as invalid for stubs that aren't Oak clients.
+absl::Status GetSessionStatus(v0::Executor::StubInterface& client);
+
 }  // namespace oak
 }  // namespace interop
 }  // namespace genc
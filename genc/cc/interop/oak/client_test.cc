@@ -0,0 +1,174 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/interop/oak/client.h"
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/cc/interop/oak/attestation_provider.h"
+#include "genc/cc/interop/oak/server.h"
+#include "genc/cc/intrinsics/handler_sets.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/inline_executor.h"
+#include "genc/cc/runtime/remote_executor.h"
+#include "genc/cc/runtime/status_macros.h"
+#include "genc/cc/runtime/threading.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "genc/proto/v0/executor.grpc.pb.h"
+#include "include/grpcpp/server.h"
+#include "include/grpcpp/server_builder.h"
+#include "include/grpcpp/support/channel_arguments.h"
+#include "cc/attestation/verification/attestation_verifier.h"
+#include "proto/attestation/evidence.pb.h"
+#include "proto/attestation/verification.pb.h"
+#include "proto/session/messages.pb.h"
+#include "proto/session/service_unary.grpc.pb.h"
+
+namespace genc {
+namespace interop {
+namespace oak {
+namespace {
+
+// Hands out no evidence, only remembering the server's public key.
+class FakeAttestationProvider : public AttestationProvider {
+ public:
+  absl::StatusOr<::oak::session::v1::EndorsedEvidence> GetEndorsedEvidence(
+      const std::string& serialized_public_key) override {
+    serialized_public_key_ = serialized_public_key;
+    return ::oak::session::v1::EndorsedEvidence();
+  }
+
+  const std::string& serialized_public_key() const {
+    return serialized_public_key_;
+  }
+
+ private:
+  std::string serialized_public_key_;
+};
+
+// Accepts any evidence, and hands the client the key that the server gave
+// `attestation_provider`.
+class FakeAttestationVerifier
+    : public ::oak::attestation::verification::AttestationVerifier {
+ public:
+  explicit FakeAttestationVerifier(
+      std::shared_ptr<FakeAttestationProvider> attestation_provider)
+      : attestation_provider_(std::move(attestation_provider)) {}
+
+  absl::StatusOr<::oak::attestation::v1::AttestationResults> Verify(
+      std::chrono::time_point<std::chrono::system_clock> now,
+      const ::oak::attestation::v1::Evidence& evidence,
+      const ::oak::attestation::v1::Endorsements& endorsements)
+      const override {
+    ::oak::attestation::v1::AttestationResults results;
+    results.set_status(
+        ::oak::attestation::v1::AttestationResults::STATUS_SUCCESS);
+    results.set_encryption_public_key(
+        attestation_provider_->serialized_public_key());
+    return results;
+  }
+
+ private:
+  const std::shared_ptr<FakeAttestationProvider> attestation_provider_;
+};
+
+v0::Value CreateStrValue(const std::string& str) {
+  v0::Value value;
+  value.set_str(str);
+  return value;
+}
+
+class ClientTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    intrinsics::HandlerSetConfig config;
+    config.custom_function_map["fail"] =
+        [](const v0::Value& arg) -> absl::StatusOr<v0::Value> {
+      return absl::InvalidArgumentError("Bad argument.");
+    };
+    config.custom_function_map["echo"] = [](v0::Value arg) { return arg; };
+    std::shared_ptr<Executor> executor =
+        CreateInlineExecutor(intrinsics::CreateCompleteHandlerSet(config),
+                             CreateThreadBasedConcurrencyManager())
+            .value();
+    auto attestation_provider = std::make_shared<FakeAttestationProvider>();
+    service_ = CreateService(executor, attestation_provider).value();
+    grpc::ServerBuilder builder;
+    builder.RegisterService(service_.get());
+    server_ = builder.BuildAndStart();
+    client_ = CreateClient(
+                  server_->InProcessChannel(grpc::ChannelArguments()),
+                  std::make_shared<FakeAttestationVerifier>(
+                      attestation_provider),
+                  /* debug */ false)
+                  .value();
+  }
+
+  void TearDown() override { server_->Shutdown(); }
+
+  // Runs `fn` on `arg` through the session, as confidential computations do.
+  absl::StatusOr<v0::Value> Run(const v0::Value& fn, const v0::Value& arg) {
+    RemoteExecutorOptions options;
+    options.use_execute_stream = true;
+    options.materialize_chunk_size = 0;
+    std::shared_ptr<Executor> executor =
+        CreateRemoteExecutor(client_, CreateThreadBasedConcurrencyManager(),
+                             options)
+            .value();
+    OwnedValueId embedded_fn = GENC_TRY(executor->CreateValue(fn));
+    OwnedValueId embedded_arg = GENC_TRY(executor->CreateValue(arg));
+    OwnedValueId embedded_result = GENC_TRY(
+        executor->CreateCall(embedded_fn.ref(), embedded_arg.ref()));
+    v0::Value result;
+    GENC_TRY(executor->Materialize(embedded_result.ref(), &result));
+    return result;
+  }
+
+  std::unique_ptr<::oak::session::v1::UnarySession::Service> service_;
+  std::unique_ptr<grpc::Server> server_;
+  std::shared_ptr<v0::Executor::StubInterface> client_;
+};
+
+TEST_F(ClientTest, KeepsSessionAfterApplicationError) {
+  absl::StatusOr<v0::Value> result =
+      Run(CreateCustomFunction("fail").value(), CreateStrValue("x"));
+  EXPECT_EQ(result.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_TRUE(GetSessionStatus(*client_).ok());
+
+  // The session carries on, with the same encryption context.
+  result = Run(CreateCustomFunction("echo").value(), CreateStrValue("y"));
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(result->str(), "y");
+  EXPECT_TRUE(GetSessionStatus(*client_).ok());
+}
+
+TEST_F(ClientTest, ReportsSessionBrokenByFailedRoundTrip) {
+  server_->Shutdown();
+  EXPECT_FALSE(
+      Run(CreateCustomFunction("echo").value(), CreateStrValue("x")).ok());
+  EXPECT_FALSE(GetSessionStatus(*client_).ok());
+}
+
+}  // namespace
+}  // namespace oak
+}  // namespace interop
+}  // namespace genc
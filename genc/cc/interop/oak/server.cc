@@ -17,13 +17,22 @@ limitations under the License
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "genc/cc/base/to_from_grpc_status.h"
 #include "genc/cc/interop/oak/attestation_provider.h"
 #include "genc/cc/interop/oak/server.h"
+#include "genc/cc/runtime/execute_session.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/executor_service.h"
 #include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/executor.grpc.pb.h"
 #include "genc/proto/v0/executor.pb.h"
@@ -32,6 +41,7 @@ limitations under the License
 #include "cc/crypto/common.h"
 #include "cc/crypto/encryption_key.h"
 #include "cc/crypto/server_encryptor.h"
+#include "proto/crypto/crypto.pb.h"
 #include "proto/session/service_unary.grpc.pb.h"
 
 namespace genc {
@@ -39,33 +49,122 @@ namespace interop {
 namespace oak {
 namespace {
 
-constexpr char kEmptyAssociatedData[] = "";
+// A client's session: the encryptor, whose context advances with every
+// message, and the values created by the batches sent through it since the
+// last one that ended the emulated `Execute` stream.
+class Session {
+ public:
+  Session(::oak::crypto::EncryptionKeyProvider& encryption_provider,
+          std::shared_ptr<Executor> executor)
+      : executor_(std::move(executor)),
+        encryptor_(encryption_provider),
+        execute_session_(NewExecuteSession()) {}
+
+  // Held while a request is handled, so that requests are decrypted and
+  // responses encrypted in the order the client sent them.
+  absl::Mutex& mutex() ABSL_LOCK_RETURNED(mutex_) { return mutex_; }
+
+  ::oak::crypto::ServerEncryptor& encryptor()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return encryptor_;
+  }
+
+  // Runs the requests in `batch`, and returns the responses to its
+  // materializations once they are all ready.
+  v0::ExecuteResponseBatch RunBatch(const v0::ExecuteRequest& batch)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    size_t num_materializations = 0;
+    for (const v0::ExecutorRequest& request : batch.request()) {
+      if (request.has_materialize()) {
+        ++num_materializations;
+      }
+    }
+    for (const v0::ExecutorRequest& request : batch.request()) {
+      execute_session_->Handle(request);
+    }
+    v0::ExecuteResponseBatch responses;
+    {
+      absl::MutexLock lock(&responses_mutex_);
+      num_expected_ = num_materializations;
+      responses_mutex_.Await(absl::Condition(this, &Session::HasResponses));
+      for (v0::ExecuteResponse& response : responses_) {
+        *responses.add_response() = std::move(response);
+      }
+      responses_.clear();
+    }
+    if (batch.end_session()) {
+      // The encryption context lives on, for the client's next requests.
+      execute_session_ = NewExecuteSession();
+    }
+    return responses;
+  }
+
+ private:
+  std::unique_ptr<ExecuteSession> NewExecuteSession() {
+    return std::make_unique<ExecuteSession>(
+        executor_, [this](const v0::ExecuteResponse& response) {
+          Collect(response);
+        });
+  }
+
+  void Collect(const v0::ExecuteResponse& response) {
+    absl::MutexLock lock(&responses_mutex_);
+    responses_.push_back(response);
+  }
+
+  bool HasResponses() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(responses_mutex_) {
+    return responses_.size() >= num_expected_;
+  }
+
+  const std::shared_ptr<Executor> executor_;
+
+  absl::Mutex mutex_;
+  ::oak::crypto::ServerEncryptor encryptor_ ABSL_GUARDED_BY(mutex_);
+
+  absl::Mutex responses_mutex_;
+  std::vector<v0::ExecuteResponse> responses_
+      ABSL_GUARDED_BY(responses_mutex_);
+  size_t num_expected_ ABSL_GUARDED_BY(responses_mutex_) = 0;
+
+  // Declared last, so that it is destroyed first: its destructor waits for the
+  // materializations still responding through this session.
+  std::unique_ptr<ExecuteSession> execute_session_ ABSL_GUARDED_BY(mutex_);
+};
 
 class OakService : public ::oak::session::v1::UnarySession::Service {
  public:
   static absl::StatusOr<std::unique_ptr<OakService>> Create(
-      std::shared_ptr<v0::Executor::Service> executor_service,
+      std::shared_ptr<Executor> executor,
       std::shared_ptr<AttestationProvider> attestation_provider,
-      bool debug) {
+      bool debug, const ServiceOptions& options) {
+    std::shared_ptr<v0::Executor::Service> executor_service =
+        GENC_TRY(CreateExecutorService(executor));
     ::oak::crypto::EncryptionKeyProvider encryption_provider =
         GENC_TRY(::oak::crypto::EncryptionKeyProvider::Create());
     return std::make_unique<OakService>(
-        executor_service,
+        std::move(executor),
+        std::move(executor_service),
         encryption_provider,
         std::move(attestation_provider),
-        debug);
+        debug,
+        options);
   }
 
   explicit OakService(
+      std::shared_ptr<Executor> executor,
       std::shared_ptr<v0::Executor::Service> executor_service,
       const ::oak::crypto::EncryptionKeyProvider& encryption_provider,
       std::shared_ptr<AttestationProvider> attestation_provider,
-      bool debug)
-      : executor_service_(executor_service),
+      bool debug,
+      const ServiceOptions& options)
+      : executor_(std::move(executor)),
+        executor_service_(std::move(executor_service)),
         encryption_provider_(encryption_provider),
         serialized_public_key_(encryption_provider_.GetSerializedPublicKey()),
         attestation_provider_(attestation_provider),
-        debug_(debug) {
+        debug_(debug),
+        options_(options),
+        next_sweep_(absl::Now() + options_.session_idle_timeout) {
     if (debug_) {
       std::cout << "OakService public key:\n" << serialized_public_key_ << "\n";
     }
@@ -101,57 +200,187 @@ class OakService : public ::oak::session::v1::UnarySession::Service {
     if (debug_) {
       std::cout << "OakService received the Invoke() call\n";
     }
-    ::oak::crypto::ServerEncryptor server_encryptor(encryption_provider_);
+    const ::oak::crypto::v1::EncryptedRequest& encrypted_request =
+        request->encrypted_request();
+    // Clients that keep their encryptor across requests name the session in
+    // the associated data, which is authenticated but not encrypted. Only the
+    // first request of a session carries the encapsulated public key.
+    const std::string& session_id =
+        encrypted_request.encrypted_message().associated_data();
+    const bool is_new =
+        !encrypted_request.serialized_encapsulated_public_key().empty();
+    absl::StatusOr<std::shared_ptr<Session>> session =
+        GetSession(session_id, is_new);
+    if (!session.ok()) {
+      return AbslToGrpcStatus(session.status());
+    }
+    absl::StatusOr<::oak::crypto::v1::EncryptedResponse> encrypted_response;
+    {
+      absl::MutexLock lock(&(*session)->mutex());
+      encrypted_response = Handle(**session, encrypted_request, session_id);
+    }
+    if (!encrypted_response.ok()) {
+      if (is_new) {
+        // Frees the name, e.g., if the first request failed to decrypt.
+        RemoveSession(session_id, *session);
+      }
+      return AbslToGrpcStatus(encrypted_response.status());
+    }
+    *response->mutable_encrypted_response() = *std::move(encrypted_response);
+    return grpc::Status::OK;
+  }
+
+ private:
+  struct SessionEntry {
+    std::shared_ptr<Session> session;
+    absl::Time last_used;
+  };
+
+  absl::StatusOr<::oak::crypto::v1::EncryptedResponse> Handle(
+      Session& session,
+      const ::oak::crypto::v1::EncryptedRequest& encrypted_request,
+      const std::string& session_id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(session.mutex()) {
     absl::StatusOr<::oak::crypto::DecryptionResult> decryption_result =
-        server_encryptor.Decrypt(request->encrypted_request());
+        session.encryptor().Decrypt(encrypted_request);
     if (!decryption_result.ok()) {
-      return AbslToGrpcStatus(
-          absl::InternalError(absl::StrCat(
-              "Request decryption failed with an error status: \"",
-              decryption_result.status().ToString(),
-              "\".")));
+      return absl::InternalError(absl::StrCat(
+          "Request decryption failed with an error status: \"",
+          decryption_result.status().ToString(),
+          "\"."));
     }
     const std::string& serialized_request = decryption_result->plaintext;
     v0::ExecutorRequest executor_request;
     if (!executor_request.ParseFromString(serialized_request)) {
-      return AbslToGrpcStatus(
-          absl::InternalError(absl::StrCat(
-              "Failed to parse the serialized request: \"",
-              serialized_request,
-              "\".")));
+      return absl::InternalError(absl::StrCat(
+          "Failed to parse the serialized request: \"",
+          serialized_request,
+          "\"."));
     }
     if (debug_) {
       std::cout << "OakService invoked with request:"
                 << executor_request.DebugString() << "\n";
     }
-    absl::StatusOr<v0::ExecutorResponse> executor_response =
-        GetExecutorResponse(executor_request);
+    absl::StatusOr<v0::ExecutorResponse> executor_response;
+    if (executor_request.has_batch()) {
+      executor_response.emplace();
+      *executor_response->mutable_batch() =
+          session.RunBatch(executor_request.batch());
+    } else {
+      executor_response = GetExecutorResponse(executor_request);
+    }
     if (!executor_response.ok()) {
-      return AbslToGrpcStatus(
-          absl::InternalError(absl::StrCat(
-              "Failed to get the executor response: \"",
-              executor_response.status().ToString(),
-              "\".")));
+      return absl::InternalError(absl::StrCat(
+          "Failed to get the executor response: \"",
+          executor_response.status().ToString(),
+          "\"."));
     }
     if (debug_) {
       std::cout << "OakService returning response:"
                 << executor_response->DebugString() << "\n";
     }
     absl::StatusOr<::oak::crypto::v1::EncryptedResponse> encrypted_response =
-        server_encryptor.Encrypt(
-            executor_response->SerializeAsString(), kEmptyAssociatedData);
+        session.encryptor().Encrypt(
+            executor_response->SerializeAsString(), session_id);
     if (!encrypted_response.ok()) {
-      return AbslToGrpcStatus(
-          absl::InternalError(absl::StrCat(
-              "Response encryption failed with an error status: \"",
-              encrypted_response.status().ToString(),
-              "\".")));
+      return absl::InternalError(absl::StrCat(
+          "Response encryption failed with an error status: \"",
+          encrypted_response.status().ToString(),
+          "\"."));
+    }
+    return encrypted_response;
+  }
+
+  // Returns the session named `session_id`, or starts a new one if `is_new`.
+  // The name is sent in the clear, so a new session never replaces a live one
+  // of the same name, which would let anyone who saw the name take over the
+  // session's values. Sessions left idle for too long are dropped, as is the
+  // least recently used one if a new one would exceed `max_sessions`.
+  absl::StatusOr<std::shared_ptr<Session>> GetSession(
+      const std::string& session_id, bool is_new) {
+    if (session_id.empty()) {
+      // A client that encrypts every request afresh, so the session lasts a
+      // single round trip.
+      if (!is_new) {
+        return absl::FailedPreconditionError(
+            "Oak requests without a session must set up their own context.");
+      }
+      return std::make_shared<Session>(encryption_provider_, executor_);
+    }
+    const absl::Time now = absl::Now();
+    // Declared before the lock, so that the values of the evicted sessions are
+    // disposed of after unlocking.
+    std::vector<std::shared_ptr<Session>> evicted;
+    absl::MutexLock lock(&sessions_mutex_);
+    if (now >= next_sweep_) {
+      EvictIdleSessions(now, &evicted);
+      next_sweep_ = now + options_.session_idle_timeout;
+    }
+    auto it = sessions_.find(session_id);
+    if (it != sessions_.end() && IsIdle(it->second, now)) {
+      evicted.push_back(std::move(it->second.session));
+      sessions_.erase(it);
+      it = sessions_.end();
+    }
+    if (!is_new) {
+      if (it == sessions_.end()) {
+        return absl::FailedPreconditionError(
+            "Unknown Oak session, which may have been idle for too long, or "
+            "made way for newer ones.");
+      }
+      it->second.last_used = now;
+      return it->second.session;
+    }
+    if (it != sessions_.end()) {
+      return absl::AlreadyExistsError(
+          "An Oak session of the same name is already in progress.");
+    }
+    if (!sessions_.empty() && sessions_.size() >= options_.max_sessions) {
+      auto oldest = sessions_.begin();
+      for (auto other = sessions_.begin(); other != sessions_.end(); ++other) {
+        if (other->second.last_used < oldest->second.last_used) {
+          oldest = other;
+        }
+      }
+      evicted.push_back(std::move(oldest->second.session));
+      sessions_.erase(oldest);
+    }
+    auto session = std::make_shared<Session>(encryption_provider_, executor_);
+    sessions_.emplace(session_id, SessionEntry{session, now});
+    return session;
+  }
+
+  bool IsIdle(const SessionEntry& entry, absl::Time now) const {
+    return now - entry.last_used > options_.session_idle_timeout;
+  }
+
+  // Moves the sessions left idle for too long out into `evicted`.
+  void EvictIdleSessions(absl::Time now,
+                         std::vector<std::shared_ptr<Session>>* evicted)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(sessions_mutex_) {
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+      if (IsIdle(it->second, now)) {
+        evicted->push_back(std::move(it->second.session));
+        sessions_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // Forgets the session named `session_id`, if it is still `session`.
+  void RemoveSession(const std::string& session_id,
+                     const std::shared_ptr<Session>& session) {
+    // Declared before the lock, as in `GetSession`.
+    std::shared_ptr<Session> removed;
+    absl::MutexLock lock(&sessions_mutex_);
+    auto it = sessions_.find(session_id);
+    if (it != sessions_.end() && it->second.session == session) {
+      removed = std::move(it->second.session);
+      sessions_.erase(it);
     }
-    *response->mutable_encrypted_response() = encrypted_response.value();
-    return grpc::Status::OK;
   }
 
- private:
   absl::StatusOr<v0::ExecutorResponse> GetExecutorResponse(
       const v0::ExecutorRequest& executor_request) {
     v0::ExecutorResponse executor_response;
@@ -199,21 +428,30 @@ class OakService : public ::oak::session::v1::UnarySession::Service {
     }
   }
 
+  const std::shared_ptr<Executor> executor_;
   const std::shared_ptr<v0::Executor::Service> executor_service_;
   ::oak::crypto::EncryptionKeyProvider encryption_provider_;
   const std::string serialized_public_key_;
   const std::shared_ptr<AttestationProvider> attestation_provider_;
   const bool debug_;
+  const ServiceOptions options_;
+
+  absl::Mutex sessions_mutex_;
+  absl::flat_hash_map<std::string, SessionEntry> sessions_
+      ABSL_GUARDED_BY(sessions_mutex_);
+  // When to next look through all the sessions for idle ones.
+  absl::Time next_sweep_ ABSL_GUARDED_BY(sessions_mutex_);
 };
 
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<::oak::session::v1::UnarySession::Service>>
 CreateService(
-    std::shared_ptr<v0::Executor::Service> executor_service,
+    std::shared_ptr<Executor> executor,
     std::shared_ptr<AttestationProvider> attestation_provider,
-    bool debug) {
-  return OakService::Create(executor_service, attestation_provider, debug);
+    bool debug, const ServiceOptions& options) {
+  return OakService::Create(
+      std::move(executor), std::move(attestation_provider), debug, options);
 }
 
 }  // namespace oak
@@ -16,23 +16,41 @@ limitations under the License
 #ifndef GENC_CC_INTEROP_OAK_SERVER_H_
 #define GENC_CC_INTEROP_OAK_SERVER_H_
 
+#include <cstddef>
 #include <memory>
 
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
 #include "genc/cc/interop/oak/attestation_provider.h"
-#include "genc/proto/v0/executor.grpc.pb.h"
+#include "genc/cc/runtime/executor.h"
 #include "proto/session/service_unary.grpc.pb.h"
 
 namespace genc {
 namespace interop {
 namespace oak {
 
-// Creates an Oak transport-compatible  service endpoint.
+struct ServiceOptions {
+  // Sessions left unused for this long are dropped, along with their values.
+  // Checked whenever a session is used, and for all of them about this often,
+  // so a session may stay in memory for up to twice as long.
+  absl::Duration session_idle_timeout = absl::Minutes(10);
+
+  // The maximum number of sessions kept at once. Starting another one drops
+  // the least recently used, whose client has to set up a new one.
+  size_t max_sessions = 1024;
+};
+
+// Creates an Oak transport-compatible service endpoint for `executor`.
+//
+// A client may keep its encryptor across requests by naming its session in
+// the associated data of each request, and may then emulate an `Execute` stream
+// with `batch` requests. The session lasts until it is left idle for too long,
+// or makes way for newer ones.
 absl::StatusOr<std::unique_ptr<::oak::session::v1::UnarySession::Service>>
 CreateService(
-    std::shared_ptr<v0::Executor::Service> executor_service,
+    std::shared_ptr<Executor> executor,
     std::shared_ptr<AttestationProvider> attestation_provider,
-    bool debug = false);
+    bool debug = false, const ServiceOptions& options = {});
 
 }  // namespace oak
 }  // namespace interop
@@ -0,0 +1,220 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/interop/oak/server.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "genc/cc/base/to_from_grpc_status.h"
+#include "genc/cc/interop/oak/attestation_provider.h"
+#include "genc/cc/intrinsics/handler_sets.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/inline_executor.h"
+#include "genc/cc/runtime/status_macros.h"
+#include "genc/cc/runtime/threading.h"
+#include "genc/proto/v0/executor.pb.h"
+#include "include/grpcpp/server_context.h"
+#include "include/grpcpp/support/status.h"
+#include "cc/crypto/client_encryptor.h"
+#include "proto/crypto/crypto.pb.h"
+#include "proto/session/messages.pb.h"
+#include "proto/session/service_unary.grpc.pb.h"
+#include "proto/session/service_unary.pb.h"
+
+namespace genc {
+namespace interop {
+namespace oak {
+namespace {
+
+// Hands out no evidence, only remembering the server's public key.
+class FakeAttestationProvider : public AttestationProvider {
+ public:
+  absl::StatusOr<::oak::session::v1::EndorsedEvidence> GetEndorsedEvidence(
+      const std::string& serialized_public_key) override {
+    serialized_public_key_ = serialized_public_key;
+    return ::oak::session::v1::EndorsedEvidence();
+  }
+
+  const std::string& serialized_public_key() const {
+    return serialized_public_key_;
+  }
+
+ private:
+  std::string serialized_public_key_;
+};
+
+class ServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { StartService(ServiceOptions()); }
+
+  void StartService(const ServiceOptions& options) {
+    std::shared_ptr<Executor> executor =
+        CreateInlineExecutor(intrinsics::CreateCompleteHandlerSet({}),
+                             CreateThreadBasedConcurrencyManager())
+            .value();
+    auto attestation_provider = std::make_shared<FakeAttestationProvider>();
+    service_ = CreateService(executor, attestation_provider, /* debug */ false,
+                             options)
+                   .value();
+    grpc::ServerContext context;
+    ::oak::session::v1::GetEndorsedEvidenceRequest request;
+    ::oak::session::v1::GetEndorsedEvidenceResponse response;
+    ASSERT_TRUE(
+        service_->GetEndorsedEvidence(&context, &request, &response).ok());
+    serialized_public_key_ = attestation_provider->serialized_public_key();
+  }
+
+  std::unique_ptr<::oak::crypto::ClientEncryptor> NewEncryptor() {
+    return ::oak::crypto::ClientEncryptor::Create(serialized_public_key_)
+        .value();
+  }
+
+  // Sends `batch` in the session named `session_id`, and returns the
+  // responses, or the error that the server returned.
+  absl::StatusOr<v0::ExecuteResponseBatch> RunBatch(
+      ::oak::crypto::ClientEncryptor& encryptor,
+      const std::string& session_id, const v0::ExecuteRequest& batch) {
+    v0::ExecutorRequest request;
+    *request.mutable_batch() = batch;
+    ::oak::session::v1::InvokeRequest invoke_request;
+    *invoke_request.mutable_encrypted_request() = GENC_TRY(
+        encryptor.Encrypt(request.SerializeAsString(), session_id));
+    ::oak::session::v1::InvokeResponse invoke_response;
+    grpc::ServerContext context;
+    GENC_TRY(GrpcToAbslStatus(
+        service_->Invoke(&context, &invoke_request, &invoke_response)));
+    ::oak::crypto::DecryptionResult decryption_result = GENC_TRY(
+        encryptor.Decrypt(invoke_response.encrypted_response()));
+    v0::ExecutorResponse response;
+    EXPECT_TRUE(response.ParseFromString(decryption_result.plaintext));
+    return response.batch();
+  }
+
+  std::unique_ptr<::oak::session::v1::UnarySession::Service> service_;
+  std::string serialized_public_key_;
+};
+
+// Materializes the value bound to reference 1.
+v0::ExecuteRequest Materialize() {
+  v0::ExecuteRequest batch;
+  v0::ExecutorRequest* request = batch.add_request();
+  request->mutable_materialize()->mutable_value_ref()->set_numeric_id(1);
+  return batch;
+}
+
+// Binds `str` to reference 1, and materializes it.
+v0::ExecuteRequest CreateAndMaterialize(const std::string& str) {
+  v0::ExecuteRequest batch;
+  v0::ExecutorRequest* create = batch.add_request();
+  create->mutable_result_ref()->set_numeric_id(1);
+  create->mutable_create_value()->mutable_value()->set_str(str);
+  batch.MergeFrom(Materialize());
+  return batch;
+}
+
+TEST_F(ServerTest, KeepsValuesWithinSession) {
+  std::unique_ptr<::oak::crypto::ClientEncryptor> encryptor = NewEncryptor();
+  absl::StatusOr<v0::ExecuteResponseBatch> responses =
+      RunBatch(*encryptor, "session", CreateAndMaterialize("x"));
+  ASSERT_TRUE(responses.ok()) << responses.status();
+  ASSERT_EQ(responses->response_size(), 1);
+  EXPECT_EQ(responses->response(0).value().str(), "x");
+  responses = RunBatch(*encryptor, "session", Materialize());
+  ASSERT_TRUE(responses.ok()) << responses.status();
+  ASSERT_EQ(responses->response_size(), 1);
+  EXPECT_EQ(responses->response(0).value().str(), "x");
+}
+
+TEST_F(ServerTest, DoesNotReplaceSessionOfSameName) {
+  std::unique_ptr<::oak::crypto::ClientEncryptor> encryptor = NewEncryptor();
+  ASSERT_TRUE(
+      RunBatch(*encryptor, "session", CreateAndMaterialize("x")).ok());
+
+  // Anyone can set up a context of their own, and the session's name is sent
+  // in the clear.
+  std::unique_ptr<::oak::crypto::ClientEncryptor> other_encryptor =
+      NewEncryptor();
+  absl::StatusOr<v0::ExecuteResponseBatch> other_responses =
+      RunBatch(*other_encryptor, "session", Materialize());
+  EXPECT_EQ(other_responses.status().code(),
+            absl::StatusCode::kAlreadyExists);
+
+  // The session carries on, with its context and values.
+  absl::StatusOr<v0::ExecuteResponseBatch> responses =
+      RunBatch(*encryptor, "session", Materialize());
+  ASSERT_TRUE(responses.ok()) << responses.status();
+  ASSERT_EQ(responses->response_size(), 1);
+  EXPECT_EQ(responses->response(0).value().str(), "x");
+}
+
+TEST_F(ServerTest, RejectsRequestsForUnknownSession) {
+  std::unique_ptr<::oak::crypto::ClientEncryptor> encryptor = NewEncryptor();
+  ASSERT_TRUE(RunBatch(*encryptor, "session", Materialize()).ok());
+  // Only the first request sets up the context, so the second names a session
+  // the server doesn't know.
+  EXPECT_EQ(RunBatch(*encryptor, "other session", Materialize())
+                .status()
+                .code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+TEST_F(ServerTest, DropsLeastRecentlyUsedSessionBeyondMax) {
+  ServiceOptions options;
+  options.max_sessions = 2;
+  StartService(options);
+  std::unique_ptr<::oak::crypto::ClientEncryptor> a = NewEncryptor();
+  std::unique_ptr<::oak::crypto::ClientEncryptor> b = NewEncryptor();
+  std::unique_ptr<::oak::crypto::ClientEncryptor> c = NewEncryptor();
+  ASSERT_TRUE(RunBatch(*a, "a", CreateAndMaterialize("a")).ok());
+  ASSERT_TRUE(RunBatch(*b, "b", CreateAndMaterialize("b")).ok());
+  ASSERT_TRUE(RunBatch(*a, "a", Materialize()).ok());
+
+  // Makes way for "c" by dropping "b", which was used the longest ago.
+  ASSERT_TRUE(RunBatch(*c, "c", CreateAndMaterialize("c")).ok());
+  EXPECT_EQ(RunBatch(*b, "b", Materialize()).status().code(),
+            absl::StatusCode::kFailedPrecondition);
+  for (const auto& [encryptor, name] :
+       {std::make_pair(a.get(), "a"), std::make_pair(c.get(), "c")}) {
+    absl::StatusOr<v0::ExecuteResponseBatch> responses =
+        RunBatch(*encryptor, name, Materialize());
+    ASSERT_TRUE(responses.ok()) << responses.status();
+    ASSERT_EQ(responses->response_size(), 1);
+    EXPECT_EQ(responses->response(0).value().str(), name);
+  }
+}
+
+TEST_F(ServerTest, DropsIdleSessionWhenUsed) {
+  ServiceOptions options;
+  options.session_idle_timeout = absl::Milliseconds(1);
+  StartService(options);
+  std::unique_ptr<::oak::crypto::ClientEncryptor> encryptor = NewEncryptor();
+  ASSERT_TRUE(
+      RunBatch(*encryptor, "session", CreateAndMaterialize("x")).ok());
+  absl::SleepFor(absl::Milliseconds(10));
+  EXPECT_EQ(RunBatch(*encryptor, "session", Materialize()).status().code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+}  // namespace
+}  // namespace oak
+}  // namespace interop
+}  // namespace genc
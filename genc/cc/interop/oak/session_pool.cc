@@ -0,0 +1,178 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/interop/oak/session_pool.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "genc/proto/v0/executor.grpc.pb.h"
+#include "include/grpc/grpc.h"
+#include "include/grpcpp/channel.h"
+#include "include/grpcpp/create_channel.h"
+#include "include/grpcpp/security/credentials.h"
+#include "include/grpcpp/support/channel_arguments.h"
+
+namespace genc {
+namespace interop {
+namespace oak {
+namespace {
+
+// Whether `channel` has failed, in which case its sessions are likely broken
+// too. Doesn't trigger a connection attempt.
+bool IsHealthy(grpc::Channel& channel) {
+  const grpc_connectivity_state state = channel.GetState(false);
+  return state != GRPC_CHANNEL_TRANSIENT_FAILURE &&
+         state != GRPC_CHANNEL_SHUTDOWN;
+}
+
+}  // namespace
+
+SessionPool::Lease::~Lease() {
+  if (session_ != nullptr) {
+    pool_->Release(key_, channel_, std::move(session_), reusable_);
+  }
+}
+
+SessionPool::SessionPool(SessionPoolOptions options)
+    : options_(std::move(options)),
+      evictor_([this]() { EvictPeriodically(); }) {}
+
+SessionPool::~SessionPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  evictor_.join();
+}
+
+SessionPool& SessionPool::Default() {
+  static SessionPool* pool = new SessionPool();
+  return *pool;
+}
+
+absl::StatusOr<SessionPool::Lease> SessionPool::Acquire(
+    absl::string_view server_address, absl::string_view image_digest,
+    const SessionFactory& create_session) {
+  Key key(server_address, image_digest);
+  std::shared_ptr<grpc::Channel> channel;
+  {
+    absl::MutexLock lock(&mutex_);
+    const absl::Time now = absl::Now();
+    EvictIdle(now);
+    Entry& entry = entries_[key];
+    if (entry.channel != nullptr && !IsHealthy(*entry.channel)) {
+      entry.channel = nullptr;
+      entry.idle_sessions.clear();
+    }
+    if (entry.channel == nullptr) {
+      entry.channel = CreateChannel(server_address);
+    }
+    channel = entry.channel;
+    entry.last_used = now;
+    ++entry.num_leased;
+    if (!entry.idle_sessions.empty()) {
+      // The most recently used session is the least likely to have expired.
+      std::shared_ptr<Session> session =
+          std::move(entry.idle_sessions.back().session);
+      entry.idle_sessions.pop_back();
+      return Lease(this, std::move(key), std::move(channel),
+                   std::move(session));
+    }
+  }
+  // Establishing a session takes round trips, so it's done without holding
+  // up other callers.
+  absl::StatusOr<std::unique_ptr<Session>> session = create_session(channel);
+  if (!session.ok()) {
+    Release(key, channel, nullptr, false);
+    return session.status();
+  }
+  return Lease(this, std::move(key), std::move(channel), *std::move(session));
+}
+
+std::shared_ptr<grpc::Channel> SessionPool::CreateChannel(
+    absl::string_view server_address) const {
+  grpc::ChannelArguments args;
+  args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS,
+              absl::ToInt64Milliseconds(options_.keepalive_time));
+  args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS,
+              absl::ToInt64Milliseconds(options_.keepalive_timeout));
+  // Keeps pooled connections alive between calls.
+  args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+  return grpc::CreateCustomChannel(std::string(server_address),
+                                   grpc::InsecureChannelCredentials(), args);
+}
+
+void SessionPool::Release(const Key& key,
+                          const std::shared_ptr<grpc::Channel>& channel,
+                          std::shared_ptr<Session> session, bool reusable) {
+  absl::MutexLock lock(&mutex_);
+  const absl::Time now = absl::Now();
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    Entry& entry = it->second;
+    --entry.num_leased;
+    entry.last_used = now;
+    // Sessions on a channel that has since been replaced are dropped.
+    if (reusable && session != nullptr && entry.channel == channel &&
+        entry.idle_sessions.size() <
+            static_cast<size_t>(options_.max_idle_sessions)) {
+      entry.idle_sessions.push_back(IdleSession{std::move(session), now});
+    }
+  }
+  EvictIdle(now);
+}
+
+void SessionPool::EvictPeriodically() {
+  // Bounded below, so that a zero timeout doesn't make this spin.
+  const absl::Duration interval =
+      std::max(options_.idle_timeout, absl::Milliseconds(10));
+  absl::MutexLock lock(&mutex_);
+  while (!mutex_.AwaitWithTimeout(absl::Condition(&stopping_), interval)) {
+    EvictIdle(absl::Now());
+  }
+}
+
+void SessionPool::EvictIdle(absl::Time now) {
+  const absl::Time cutoff = now - options_.idle_timeout;
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    Entry& entry = it->second;
+    std::vector<IdleSession>& idle = entry.idle_sessions;
+    // Sessions are returned in order, so the oldest ones come first.
+    auto first_kept = idle.begin();
+    while (first_kept != idle.end() && first_kept->idle_since < cutoff) {
+      ++first_kept;
+    }
+    idle.erase(idle.begin(), first_kept);
+    if (idle.empty() && entry.num_leased == 0 && entry.last_used < cutoff) {
+      entries_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace oak
+}  // namespace interop
+}  // namespace genc
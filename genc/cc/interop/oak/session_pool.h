@@ -0,0 +1,160 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_INTEROP_OAK_SESSION_POOL_H_
+#define GENC_CC_INTEROP_OAK_SESSION_POOL_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "genc/proto/v0/executor.grpc.pb.h"
+#include "include/grpcpp/channel.h"
+
+namespace genc {
+namespace interop {
+namespace oak {
+
+struct SessionPoolOptions {
+  // Idle sessions are closed after this long, along with their channel once
+  // it has no sessions left. Checked in the background about this often, so
+  // a session may stay open for up to twice as long.
+  absl::Duration idle_timeout = absl::Minutes(5);
+
+  // The maximum number of idle sessions kept per server.
+  int max_idle_sessions = 8;
+
+  // How often to ping the server over an otherwise idle connection, and how
+  // long to wait for a reply before considering the connection dead.
+  absl::Duration keepalive_time = absl::Minutes(5);
+  absl::Duration keepalive_timeout = absl::Seconds(20);
+};
+
+// A pool of established sessions with confidential servers, and of channels
+// to them, keyed by server address and image digest. Setting up a session
+// takes a connection and an attestation handshake, so sessions are reused
+// across calls rather than created for each. A session keeps per-session
+// encryption state, so it is leased to one caller at a time.
+class SessionPool {
+ public:
+  using Session = v0::Executor::StubInterface;
+
+  // The server address and image digest.
+  using Key = std::pair<std::string, std::string>;
+
+  // Establishes a session over `channel`.
+  using SessionFactory =
+      std::function<absl::StatusOr<std::unique_ptr<Session>>(
+          std::shared_ptr<grpc::Channel> channel)>;
+
+  // A session checked out of the pool. Returned to the pool on destruction,
+  // unless discarded.
+  class Lease {
+   public:
+    Lease(Lease&& other) = default;
+    Lease& operator=(Lease&& other) = delete;
+    ~Lease();
+
+    // Shared with the lease, to be used only until the lease is destroyed.
+    const std::shared_ptr<Session>& session() const { return session_; }
+
+    // Closes the session rather than returning it to the pool, e.g., if a
+    // call failed in a way that may have left it unusable.
+    void Discard() { reusable_ = false; }
+
+   private:
+    friend class SessionPool;
+
+    Lease(SessionPool* pool, Key key,
+          std::shared_ptr<grpc::Channel> channel,
+          std::shared_ptr<Session> session)
+        : pool_(pool),
+          key_(std::move(key)),
+          channel_(std::move(channel)),
+          session_(std::move(session)) {}
+
+    SessionPool* pool_;
+    Key key_;
+    std::shared_ptr<grpc::Channel> channel_;
+    std::shared_ptr<Session> session_;
+    bool reusable_ = true;
+  };
+
+  explicit SessionPool(SessionPoolOptions options = {});
+
+  // Closes the idle sessions. Must outlive the leases taken from it.
+  ~SessionPool();
+
+  // The pool shared by the whole process.
+  static SessionPool& Default();
+
+  // Leases an idle session with the server at `server_address` running
+  // `image_digest`, or establishes a new one with `create_session` if there
+  // is none. A channel that has failed is replaced, along with its sessions.
+  absl::StatusOr<Lease> Acquire(absl::string_view server_address,
+                                absl::string_view image_digest,
+                                const SessionFactory& create_session);
+
+ private:
+  struct IdleSession {
+    std::shared_ptr<Session> session;
+    absl::Time idle_since;
+  };
+
+  struct Entry {
+    std::shared_ptr<grpc::Channel> channel;
+    std::vector<IdleSession> idle_sessions;
+    int num_leased = 0;
+    absl::Time last_used;
+  };
+
+  std::shared_ptr<grpc::Channel> CreateChannel(
+      absl::string_view server_address) const;
+
+  void Release(const Key& key,
+               const std::shared_ptr<grpc::Channel>& channel,
+               std::shared_ptr<Session> session, bool reusable);
+
+  // Closes the sessions and channels that have been idle for too long.
+  void EvictIdle(absl::Time now) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Runs on `evictor_`, so that idle sessions are closed even once the pool
+  // is no longer used.
+  void EvictPeriodically();
+
+  const SessionPoolOptions options_;
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<Key, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // Declared last, so it starts once everything else is initialized.
+  std::thread evictor_;
+};
+
+}  // namespace oak
+}  // namespace interop
+}  // namespace genc
+
+#endif  // GENC_CC_INTEROP_OAK_SESSION_POOL_H_
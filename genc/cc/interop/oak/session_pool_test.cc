@@ -0,0 +1,179 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/interop/oak/session_pool.h"
+
+#include <memory>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "genc/proto/v0/executor.grpc.pb.h"
+#include "include/grpcpp/channel.h"
+
+namespace genc {
+namespace interop {
+namespace oak {
+namespace {
+
+constexpr char kServerAddress[] = "localhost:1";
+constexpr char kImageDigest[] = "sha256:0";
+
+// Creates plain stubs rather than attested sessions, which the pool can't
+// tell apart. Nothing is sent over the channel, so no server is needed.
+class FakeSessionFactory {
+ public:
+  SessionPool::SessionFactory AsFunction() {
+    return [this](std::shared_ptr<grpc::Channel> channel)
+               -> absl::StatusOr<std::unique_ptr<SessionPool::Session>> {
+      ++num_created_;
+      if (fail_) {
+        return absl::UnavailableError("Failed to attest the server.");
+      }
+      return v0::Executor::NewStub(channel);
+    };
+  }
+
+  int num_created() const { return num_created_; }
+  void set_fail(bool fail) { fail_ = fail; }
+
+ private:
+  int num_created_ = 0;
+  bool fail_ = false;
+};
+
+TEST(SessionPoolTest, ReusesReleasedSession) {
+  SessionPool pool;
+  FakeSessionFactory factory;
+  SessionPool::Session* first;
+  {
+    SessionPool::Lease lease =
+        pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction())
+            .value();
+    first = lease.session().get();
+  }
+  SessionPool::Lease lease =
+      pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction()).value();
+  EXPECT_EQ(lease.session().get(), first);
+  EXPECT_EQ(factory.num_created(), 1);
+}
+
+TEST(SessionPoolTest, LeasesSessionToOneCallerAtATime) {
+  SessionPool pool;
+  FakeSessionFactory factory;
+  SessionPool::Lease first =
+      pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction()).value();
+  SessionPool::Lease second =
+      pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction()).value();
+  EXPECT_NE(first.session(), second.session());
+  EXPECT_EQ(factory.num_created(), 2);
+}
+
+TEST(SessionPoolTest, KeysSessionsOnServerAndImage) {
+  SessionPool pool;
+  FakeSessionFactory factory;
+  {
+    SessionPool::Lease lease =
+        pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction())
+            .value();
+  }
+  SessionPool::Lease other_image =
+      pool.Acquire(kServerAddress, "sha256:1", factory.AsFunction()).value();
+  SessionPool::Lease other_server =
+      pool.Acquire("localhost:2", kImageDigest, factory.AsFunction()).value();
+  EXPECT_EQ(factory.num_created(), 3);
+}
+
+TEST(SessionPoolTest, DoesNotReuseDiscardedSession) {
+  SessionPool pool;
+  FakeSessionFactory factory;
+  {
+    SessionPool::Lease lease =
+        pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction())
+            .value();
+    lease.Discard();
+  }
+  SessionPool::Lease lease =
+      pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction()).value();
+  EXPECT_EQ(factory.num_created(), 2);
+}
+
+TEST(SessionPoolTest, ReportsFailureToCreateSession) {
+  SessionPool pool;
+  FakeSessionFactory factory;
+  factory.set_fail(true);
+  EXPECT_EQ(pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction())
+                .status()
+                .code(),
+            absl::StatusCode::kUnavailable);
+  factory.set_fail(false);
+  EXPECT_TRUE(
+      pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction()).ok());
+}
+
+TEST(SessionPoolTest, KeepsAtMostMaxIdleSessions) {
+  SessionPoolOptions options;
+  options.max_idle_sessions = 2;
+  SessionPool pool(options);
+  FakeSessionFactory factory;
+  {
+    std::vector<SessionPool::Lease> leases;
+    for (int i = 0; i < 3; ++i) {
+      leases.push_back(
+          pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction())
+              .value());
+    }
+  }
+  EXPECT_EQ(factory.num_created(), 3);
+  std::vector<SessionPool::Lease> leases;
+  for (int i = 0; i < 3; ++i) {
+    leases.push_back(
+        pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction())
+            .value());
+  }
+  // Only two came back from the pool.
+  EXPECT_EQ(factory.num_created(), 4);
+}
+
+TEST(SessionPoolTest, ClosesIdleSessionsWithoutFurtherCalls) {
+  SessionPoolOptions options;
+  options.idle_timeout = absl::Milliseconds(10);
+  SessionPool pool(options);
+  FakeSessionFactory factory;
+  std::weak_ptr<SessionPool::Session> session;
+  {
+    SessionPool::Lease lease =
+        pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction())
+            .value();
+    session = lease.session();
+  }
+  // Closed by the pool in the background, as nothing else uses it.
+  const absl::Time deadline = absl::Now() + absl::Seconds(30);
+  while (!session.expired() && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_TRUE(session.expired());
+  SessionPool::Lease lease =
+      pool.Acquire(kServerAddress, kImageDigest, factory.AsFunction()).value();
+  EXPECT_EQ(factory.num_created(), 2);
+}
+
+}  // namespace
+}  // namespace oak
+}  // namespace interop
+}  // namespace genc
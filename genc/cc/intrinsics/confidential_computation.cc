@@ -26,15 +26,15 @@ limitations under the License
 #include "genc/cc/interop/networking/curl_based_http_client.h"
 #include "genc/cc/interop/networking/http_client_interface.h"
 #include "genc/cc/interop/oak/client.h"
+#include "genc/cc/interop/oak/session_pool.h"
 #include "genc/cc/intrinsics/intrinsic_uris.h"
 #include "genc/cc/runtime/executor.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/cc/runtime/remote_executor.h"
 #include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/computation.pb.h"
+#include "genc/proto/v0/executor.grpc.pb.h"
 #include "include/grpcpp/channel.h"
-#include "include/grpcpp/create_channel.h"
-#include "include/grpcpp/security/credentials.h"
 
 namespace genc {
 namespace intrinsics {
@@ -53,6 +53,28 @@ PassOrCreateDefaultHttpClient(
   return interop::networking::CreateCurlBasedHttpClient(false);
 }
 
+// Runs `comp` on `arg` in the remote executor reached through `session`. The
+// executor may still be sending disposals after this returns, so `session`
+// has to keep the session leased until it is released.
+absl::Status RunRemotely(
+    std::shared_ptr<v0::Executor::StubInterface> session,
+    const v0::Value& comp, const v0::Value& arg, v0::Value* result,
+    InlineIntrinsicHandlerInterface::Context* context) {
+  // The Oak client emulates the `Execute` stream with batches, so the whole
+  // call costs one encrypted round trip, plus one to end the stream. It has no
+  // other streams, so values are materialized in one piece.
+  RemoteExecutorOptions options;
+  options.use_execute_stream = true;
+  options.materialize_chunk_size = 0;
+  std::shared_ptr<Executor> executor = GENC_TRY(CreateRemoteExecutor(
+      std::move(session), context->concurrency_interface(), options));
+  OwnedValueId embedded_comp = GENC_TRY(executor->CreateValue(comp));
+  OwnedValueId embedded_arg = GENC_TRY(executor->CreateValue(arg));
+  OwnedValueId embedded_result = GENC_TRY(
+      executor->CreateCall(embedded_comp.ref(), embedded_arg.ref()));
+  return executor->Materialize(embedded_result.ref(), result);
+}
+
 }  // namespace
 
 ConfidentialComputation::ConfidentialComputation(
@@ -123,27 +145,41 @@ absl::Status ConfidentialComputation::ExecuteCall(
     return absl::InvalidArgumentError(
         "Expected a non-empty server address.");
   }
-  std::shared_ptr<grpc::Channel> channel = grpc::CreateChannel(
-      server_address, grpc::InsecureChannelCredentials());
-  interop::confidential_computing::WorkloadProvenance provenance;
-  if (!image_digest.empty()) {
-    provenance.container_image_digest = image_digest;
-  }
-  auto verifier =
-      GENC_TRY(interop::confidential_computing::CreateAttestationVerifier(
-          provenance,
-          /* debug */ false,
-          http_client_interface_.value()));
-  auto executor_stub =
-      GENC_TRY(interop::oak::CreateClient(
-          channel, verifier, /* debug */ false));
-  std::shared_ptr<Executor> executor = GENC_TRY(CreateRemoteExecutor(
-      std::move(executor_stub), context->concurrency_interface()));
-  OwnedValueId embedded_comp = GENC_TRY(executor->CreateValue(comp));
-  OwnedValueId embedded_arg = GENC_TRY(executor->CreateValue(arg));
-  OwnedValueId embedded_result = GENC_TRY(
-      executor->CreateCall(embedded_comp.ref(), embedded_arg.ref()));
-  return executor->Materialize(embedded_result.ref(), result);
+  // Reuses an attested session with the server where possible, rather than
+  // connecting and attesting it anew for every call.
+  interop::oak::SessionPool::Lease acquired =
+      GENC_TRY(interop::oak::SessionPool::Default().Acquire(
+          server_address, image_digest,
+          [this, &image_digest](std::shared_ptr<grpc::Channel> channel)
+              -> absl::StatusOr<
+                  std::unique_ptr<v0::Executor::StubInterface>> {
+            interop::confidential_computing::WorkloadProvenance provenance;
+            if (!image_digest.empty()) {
+              provenance.container_image_digest = image_digest;
+            }
+            auto verifier = GENC_TRY(
+                interop::confidential_computing::CreateAttestationVerifier(
+                    provenance,
+                    /* debug */ false,
+                    http_client_interface_.value()));
+            return interop::oak::CreateClient(
+                channel, verifier, /* debug */ false);
+          }));
+  // Shares ownership of the lease, so that the session only goes back to the
+  // pool once the executor, and its batcher of disposals, are done with it.
+  // Errors of the computation leave the session usable, but not a failed
+  // round trip, which may have left it out of step with the server.
+  std::shared_ptr<interop::oak::SessionPool::Lease> lease(
+      new interop::oak::SessionPool::Lease(std::move(acquired)),
+      [](interop::oak::SessionPool::Lease* lease) {
+        if (!interop::oak::GetSessionStatus(*lease->session()).ok()) {
+          lease->Discard();
+        }
+        delete lease;
+      });
+  std::shared_ptr<v0::Executor::StubInterface> session(
+      lease, lease->session().get());
+  return RunRemotely(std::move(session), comp, arg, result, context);
 }
 
 }  // namespace intrinsics
@@ -15,33 +15,326 @@ limitations under the License
 
 #include "genc/cc/intrinsics/fallback.h"
 
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <queue>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
+#include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 namespace intrinsics {
+namespace {
+
+constexpr char kModeLabel[] = "mode";
+constexpr char kHedgeDelayMsLabel[] = "hedge_delay_ms";
+constexpr char kSequentialMode[] = "sequential";
+constexpr char kHedgedMode[] = "hedged";
+constexpr char kRaceMode[] = "race";
+
+struct FallbackConfig {
+  std::vector<const v0::Value*> candidates;
+  // How long to wait for the candidates in progress before starting the next
+  // one anyway: forever when sequential, and not at all when racing.
+  absl::Duration hedge_delay = absl::InfiniteDuration();
+};
+
+absl::StatusOr<FallbackConfig> ParseConfig(const v0::Intrinsic& intrinsic_pb) {
+  FallbackConfig config;
+  absl::string_view mode = kSequentialMode;
+  std::optional<absl::Duration> hedge_delay;
+  for (const v0::Value& element :
+       intrinsic_pb.static_parameter().struct_().element()) {
+    if (element.label() == kModeLabel) {
+      if (!element.has_str()) {
+        return absl::InvalidArgumentError("Expected a str for mode.");
+      }
+      mode = element.str();
+    } else if (element.label() == kHedgeDelayMsLabel) {
+      if (!element.has_int_32() || element.int_32() < 0) {
+        return absl::InvalidArgumentError(
+            "Expected a non-negative int_32 for hedge_delay_ms.");
+      }
+      hedge_delay = absl::Milliseconds(element.int_32());
+    } else {
+      config.candidates.push_back(&element);
+    }
+  }
+  if (mode == kHedgedMode) {
+    if (!hedge_delay.has_value()) {
+      return absl::InvalidArgumentError(
+          "Expected hedge_delay_ms for a hedged fallback.");
+    }
+    config.hedge_delay = *hedge_delay;
+  } else if (mode == kRaceMode) {
+    config.hedge_delay = absl::ZeroDuration();
+  } else if (mode != kSequentialMode) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unrecognized Fallback mode: \"", mode, "\"."));
+  } else if (hedge_delay.has_value()) {
+    return absl::InvalidArgumentError(
+        "Expected hedge_delay_ms only for a hedged fallback.");
+  }
+  return config;
+}
+
+// Runs callbacks once their delay has passed, on a thread of its own, so the
+// callbacks must be cheap.
+class Timer {
+ public:
+  static Timer& Get() {
+    static Timer* const timer = new Timer();
+    return *timer;
+  }
+
+  void RunAfter(absl::Duration delay, std::function<void()> callback) {
+    absl::MutexLock lock(&mutex_);
+    tasks_.push(Task{absl::Now() + delay, std::move(callback)});
+    wakeup_.Signal();
+  }
+
+ private:
+  struct Task {
+    absl::Time deadline;
+    std::function<void()> callback;
+
+    // Orders the earliest deadline first in the queue.
+    bool operator<(const Task& other) const {
+      return deadline > other.deadline;
+    }
+  };
+
+  Timer() { std::thread([this]() { Run(); }).detach(); }
+
+  void Run() {
+    while (true) {
+      NextDue()();
+    }
+  }
+
+  // Waits for the earliest deadline to pass, and returns its callback.
+  std::function<void()> NextDue() {
+    absl::MutexLock lock(&mutex_);
+    while (tasks_.empty() || absl::Now() < tasks_.top().deadline) {
+      if (tasks_.empty()) {
+        wakeup_.Wait(&mutex_);
+      } else {
+        wakeup_.WaitWithDeadline(&mutex_, tasks_.top().deadline);
+      }
+    }
+    std::function<void()> callback = tasks_.top().callback;
+    tasks_.pop();
+    return callback;
+  }
+
+  absl::Mutex mutex_;
+  absl::CondVar wakeup_;
+  std::priority_queue<Task> tasks_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Drives a single fallback without blocking. The candidates are started in
+// order, each one as soon as all of those started before it have failed, or
+// once the hedge delay has passed since the previous one started. The first
+// to succeed provides the result. The runtime can't cancel calls, so the
+// others are abandoned and their results dropped when they arrive.
+class AsyncFallback : public std::enable_shared_from_this<AsyncFallback> {
+ public:
+  using Context = ControlFlowIntrinsicHandlerInterface::Context;
+  using ValueRef = ControlFlowIntrinsicHandlerInterface::ValueRef;
+
+  AsyncFallback(FallbackConfig config, std::optional<ValueRef> arg,
+                std::shared_ptr<Context> context)
+      : candidates_(std::move(config.candidates)),
+        hedge_delay_(config.hedge_delay),
+        arg_(std::move(arg)),
+        context_(std::move(context)),
+        concurrency_interface_(context_->concurrency_interface()),
+        result_(std::make_shared<Promise<ValueRef>>()) {}
+
+  std::shared_ptr<FutureInterface<ValueRef>> result() const { return result_; }
+
+  // Starts the first candidate, or all of them when racing.
+  void Start() {
+    if (candidates_.empty()) {
+      result_->Set(
+          absl::UnavailableError("No candidate computations available."));
+      return;
+    }
+    if (hedge_delay_ == absl::ZeroDuration()) {
+      for (size_t index = 0; index < candidates_.size(); ++index) {
+        StartCandidate(index);
+      }
+    } else {
+      StartCandidate(0);
+    }
+  }
+
+  // Waits until the context is no longer used by the candidates being started
+  // or checked. No more are started once the result is set.
+  void AwaitIdle() {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](int* num_busy) { return *num_busy == 0; }, &num_busy_));
+  }
+
+ private:
+  // Starts the candidate at `index`, unless the result is known or it was
+  // already started.
+  void StartCandidate(size_t index) {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (decided_ || num_started_ != index) {
+        return;
+      }
+      ++num_started_;
+      ++num_in_flight_;
+      ++num_busy_;
+    }
+    if (hedge_delay_ > absl::ZeroDuration() &&
+        hedge_delay_ < absl::InfiniteDuration() &&
+        index + 1 < candidates_.size()) {
+      // Doesn't keep the fallback alive for the delay, as a candidate still
+      // in flight by then does.
+      Timer::Get().RunAfter(
+          hedge_delay_, [weak_self = weak_from_this(), index]() {
+            std::shared_ptr<AsyncFallback> self = weak_self.lock();
+            if (self == nullptr) {
+              return;
+            }
+            self->concurrency_interface_->RunAsync(
+                [self, index]() -> absl::Status {
+                  self->StartCandidate(index + 1);
+                  return absl::OkStatus();
+                });
+          });
+    }
+    absl::StatusOr<ValueRef> result = Call(index);
+    if (result.ok()) {
+      concurrency_interface_->Then(
+          context_->WhenReady(*result),
+          [self = shared_from_this(),
+           result = *result](absl::StatusOr<ValueRef>) -> absl::Status {
+            self->Check(result);
+            return absl::OkStatus();
+          });
+    } else {
+      Record(result.status());
+    }
+    absl::MutexLock lock(&mutex_);
+    --num_busy_;
+  }
+
+  absl::StatusOr<ValueRef> Call(size_t index) {
+    ValueRef fn = GENC_TRY(context_->CreateValue(*candidates_[index]));
+    return context_->CreateCall(fn, arg_);
+  }
+
+  // Learns whether the candidate that returned `result`, which is ready,
+  // succeeded, unless another one already has.
+  void Check(ValueRef result) {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (decided_) {
+        --num_in_flight_;
+        return;
+      }
+      ++num_busy_;
+    }
+    absl::Status status = context_->Materialize(result, nullptr);
+    if (status.ok()) {
+      Record(std::move(result));
+    } else {
+      Record(std::move(status));
+    }
+    absl::MutexLock lock(&mutex_);
+    --num_busy_;
+  }
+
+  // Records the outcome of a candidate. The first success to arrive is the
+  // result. A failure starts the next candidate if none are in flight, and is
+  // the result if it was the last.
+  void Record(absl::StatusOr<ValueRef> result) {
+    std::optional<size_t> next;
+    {
+      absl::MutexLock lock(&mutex_);
+      --num_in_flight_;
+      if (decided_) {
+        return;
+      }
+      if (!result.ok()) {
+        status_ = result.status();
+        if (num_in_flight_ > 0) {
+          return;
+        }
+        if (num_started_ < candidates_.size()) {
+          next = num_started_;
+        } else {
+          result = status_;
+        }
+      }
+      if (!next.has_value()) {
+        decided_ = true;
+      }
+    }
+    if (next.has_value()) {
+      StartCandidate(*next);
+    } else {
+      result_->Set(std::move(result));
+    }
+  }
+
+  const std::vector<const v0::Value*> candidates_;
+  const absl::Duration hedge_delay_;
+  const std::optional<ValueRef> arg_;
+  const std::shared_ptr<Context> context_;
+  const std::shared_ptr<ConcurrencyInterface> concurrency_interface_;
+  const std::shared_ptr<Promise<ValueRef>> result_;
+
+  absl::Mutex mutex_;
+  size_t num_started_ ABSL_GUARDED_BY(mutex_) = 0;
+  int num_in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  // The candidates being started or checked, which use the context.
+  int num_busy_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Whether the result is known, either from a success or from all failing.
+  bool decided_ ABSL_GUARDED_BY(mutex_) = false;
+  // The most recent failure.
+  absl::Status status_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace
 
 absl::Status Fallback::CheckWellFormed(
     const v0::Intrinsic& intrinsic_pb) const {
-  return absl::OkStatus();
+  return ParseConfig(intrinsic_pb).status();
 }
 
 absl::StatusOr<ControlFlowIntrinsicHandlerInterface::ValueRef>
 Fallback::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
                       std::optional<ValueRef> arg, Context* context) const {
-  absl::Status error_status =
-      absl::UnavailableError("No candidate computations available.");
-  for (const v0::Value& fn_pb :
-       intrinsic_pb.static_parameter().struct_().element()) {
-    absl::StatusOr<ValueRef> result =
-        context->CreateValue(fn_pb);
-    if (result.ok()) {
-      result = context->CreateCall(result.value(), arg);
+  FallbackConfig config = GENC_TRY(ParseConfig(intrinsic_pb));
+  if (config.hedge_delay == absl::InfiniteDuration()) {
+    // Sequential, so the candidates are simply tried in turn on this thread.
+    absl::Status error_status =
+        absl::UnavailableError("No candidate computations available.");
+    for (const v0::Value* fn_pb : config.candidates) {
+      absl::StatusOr<ValueRef> result = context->CreateValue(*fn_pb);
+      if (result.ok()) {
+        result = context->CreateCall(result.value(), arg);
+      }
       if (result.ok()) {
         error_status = context->Materialize(result.value(), nullptr);
         if (error_status.ok()) {
@@ -50,11 +343,32 @@ Fallback::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
       } else {
         error_status = result.status();
       }
-    } else {
-      error_status = result.status();
     }
+    return error_status;
+  }
+  // Doesn't own the context, which is only used until the candidates being
+  // started or checked are done, as this waits for them.
+  auto fallback = std::make_shared<AsyncFallback>(
+      std::move(config), std::move(arg),
+      std::shared_ptr<Context>(std::shared_ptr<Context>(), context));
+  fallback->Start();
+  absl::StatusOr<ValueRef> result = fallback->result()->Get();
+  fallback->AwaitIdle();
+  return result;
+}
+
+std::shared_ptr<FutureInterface<ControlFlowIntrinsicHandlerInterface::ValueRef>>
+Fallback::ExecuteCallAsync(const v0::Intrinsic& intrinsic_pb,
+                           std::optional<ValueRef> arg,
+                           std::shared_ptr<Context> context) const {
+  absl::StatusOr<FallbackConfig> config = ParseConfig(intrinsic_pb);
+  if (!config.ok()) {
+    return MakeReadyFuture<ValueRef>(config.status());
   }
-  return error_status;
+  auto fallback = std::make_shared<AsyncFallback>(
+      *std::move(config), std::move(arg), std::move(context));
+  fallback->Start();
+  return fallback->result();
 }
 
 }  // namespace intrinsics
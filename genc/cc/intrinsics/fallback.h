@@ -16,17 +16,31 @@ limitations under the License
 #ifndef GENC_CC_INTRINSICS_FALLBACK_H_
 #define GENC_CC_INTRINSICS_FALLBACK_H_
 
+#include <memory>
 #include <optional>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "genc/cc/intrinsics/intrinsic_uris.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 namespace intrinsics {
 
+// Calls candidate functions on the argument until one of them succeeds, and
+// returns its result. Elements of the static struct labeled as follows are
+// options rather than candidates:
+//
+//   "mode": "sequential" (the default) to call each candidate once the one
+//     before it has failed, "hedged" to also call the next candidate if the
+//     ones in progress haven't returned after "hedge_delay_ms", or "race" to
+//     call all of the candidates at once.
+//   "hedge_delay_ms": The delay between hedged calls.
+//
+// In the hedged and race modes, the first candidate to succeed wins, and the
+// others are left to complete with their results dropped.
 class Fallback : public ControlFlowIntrinsicHandlerBase {
  public:
   Fallback() : ControlFlowIntrinsicHandlerBase(kFallback) {}
@@ -38,6 +52,10 @@ class Fallback : public ControlFlowIntrinsicHandlerBase {
   absl::StatusOr<ValueRef> ExecuteCall(const v0::Intrinsic& intrinsic_pb,
                                        std::optional<ValueRef> arg,
                                        Context* context) const final;
+
+  std::shared_ptr<FutureInterface<ValueRef>> ExecuteCallAsync(
+      const v0::Intrinsic& intrinsic_pb, std::optional<ValueRef> arg,
+      std::shared_ptr<Context> context) const final;
 };
 
 }  // namespace intrinsics
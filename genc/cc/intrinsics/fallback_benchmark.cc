@@ -0,0 +1,140 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Measures the latency of a fallback from a primary model that now and then
+// fails slowly, as when a request times out, to a backup model, with the
+// candidates attempted in sequence, hedged, or raced. Both models are
+// simulated with sleeps, so only the tail latency, reported as the p50_ms and
+// p99_ms counters, is meaningful.
+//
+//   bazel run -c opt //genc/cc/intrinsics:fallback_benchmark
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/cc/intrinsics/handler_sets.h"
+#include "genc/cc/runtime/control_flow_executor.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/inline_executor.h"
+#include "genc/cc/runtime/intrinsic_handler.h"
+#include "genc/cc/runtime/runner.h"
+#include "genc/cc/runtime/threading.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace {
+
+constexpr absl::string_view kModes[] = {"sequential", "hedged", "race"};
+constexpr int kHedgeDelayMs = 25;
+// The share of the primary's calls that time out.
+constexpr double kTimeoutRate = 0.05;
+constexpr absl::Duration kTimeout = absl::Milliseconds(150);
+
+// Draws simulated latencies, from any thread.
+class Latencies {
+ public:
+  absl::Duration Uniform(int min_ms, int max_ms) {
+    absl::MutexLock lock(&mutex_);
+    return absl::Milliseconds(
+        std::uniform_int_distribution<int>(min_ms, max_ms)(rng_));
+  }
+
+  bool TimesOut() {
+    absl::MutexLock lock(&mutex_);
+    return std::bernoulli_distribution(kTimeoutRate)(rng_);
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::mt19937 rng_ ABSL_GUARDED_BY(mutex_){42};
+};
+
+std::shared_ptr<Executor> CreateBenchmarkExecutor(
+    std::shared_ptr<Latencies> latencies) {
+  intrinsics::HandlerSetConfig config;
+  config.model_inference_map["primary"] =
+      [latencies](const v0::Value& arg) -> absl::StatusOr<v0::Value> {
+    if (latencies->TimesOut()) {
+      absl::SleepFor(kTimeout);
+      return absl::DeadlineExceededError("primary timed out");
+    }
+    absl::SleepFor(latencies->Uniform(10, 30));
+    return arg;
+  };
+  config.model_inference_map["backup"] =
+      [latencies](const v0::Value& arg) -> absl::StatusOr<v0::Value> {
+    absl::SleepFor(latencies->Uniform(20, 40));
+    return arg;
+  };
+  std::shared_ptr<IntrinsicHandlerSet> handler_set =
+      intrinsics::CreateCompleteHandlerSet(config);
+  auto concurrency_interface = CreateWorkStealingConcurrencyManager();
+  return CreateControlFlowExecutor(
+             handler_set,
+             CreateInlineExecutor(handler_set, concurrency_interface).value(),
+             concurrency_interface)
+      .value();
+}
+
+double PercentileMs(std::vector<absl::Duration> samples, double percentile) {
+  std::sort(samples.begin(), samples.end());
+  size_t index = static_cast<size_t>(percentile * (samples.size() - 1));
+  return absl::ToDoubleMilliseconds(samples[index]);
+}
+
+void BM_Fallback(benchmark::State& state) {
+  const absl::string_view mode = kModes[state.range(0)];
+  state.SetLabel(std::string(mode));
+  Runner runner =
+      Runner::Create(CreateBenchmarkExecutor(std::make_shared<Latencies>()))
+          .value();
+  v0::Value fallback_pb =
+      CreateFallbackWithOptions({CreateModelInference("primary").value(),
+                                 CreateModelInference("backup").value()},
+                                mode, kHedgeDelayMs)
+          .value();
+  v0::Value arg;
+  arg.set_str("prompt");
+  std::vector<absl::Duration> samples;
+  for (auto _ : state) {
+    const absl::Time start = absl::Now();
+    benchmark::DoNotOptimize(runner.Run(fallback_pb, arg).value());
+    samples.push_back(absl::Now() - start);
+  }
+  state.counters["p50_ms"] = PercentileMs(samples, 0.5);
+  state.counters["p99_ms"] = PercentileMs(samples, 0.99);
+}
+
+BENCHMARK(BM_Fallback)
+    ->DenseRange(0, 2)
+    ->Iterations(400)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace genc
@@ -32,6 +32,7 @@ limitations under the License
 #include "genc/cc/intrinsics/parallel_map.h"
 #include "genc/cc/intrinsics/prompt_template.h"
 #include "genc/cc/intrinsics/regex_partial_match.h"
+#include "genc/cc/intrinsics/regex_set_match.h"
 #include "genc/cc/intrinsics/repeat.h"
 #include "genc/cc/intrinsics/repeated_conditional_chain.h"
 #include "genc/cc/intrinsics/rest_call.h"
@@ -67,6 +68,7 @@ std::shared_ptr<IntrinsicHandlerSet> CreateCompleteHandlerSet(
   handlers->AddHandler(new intrinsics::PromptTemplate());
   handlers->AddHandler(new intrinsics::PromptTemplateWithParameters());
   handlers->AddHandler(new intrinsics::RegexPartialMatch());
+  handlers->AddHandler(new intrinsics::RegexSetMatch());
   handlers->AddHandler(new intrinsics::Repeat());
   handlers->AddHandler(new intrinsics::RestCall());
   handlers->AddHandler(new intrinsics::While());
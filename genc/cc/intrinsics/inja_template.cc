@@ -18,6 +18,8 @@ limitations under the License
 #include <string>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "genc/cc/modules/templates/inja_status_or.h"
 #include "genc/cc/runtime/status_macros.h"
@@ -26,6 +28,51 @@ limitations under the License
 
 namespace genc {
 namespace intrinsics {
+namespace {
+
+// Converts a structured argument to the JSON data it stands for: a struct
+// with labeled elements to an object, one without labels to an array.
+absl::StatusOr<nlohmann::json> ToJson(const v0::Value& value) {
+  switch (value.value_case()) {
+    case v0::Value::kStr:
+      return nlohmann::json(value.str());
+    case v0::Value::kBoolean:
+      return nlohmann::json(value.boolean());
+    case v0::Value::kInt32:
+      return nlohmann::json(value.int_32());
+    case v0::Value::kFloat32:
+      return nlohmann::json(value.float_32());
+    case v0::Value::kStruct: {
+      const auto& elements = value.struct_().element();
+      if (!elements.empty() && !elements[0].label().empty()) {
+        nlohmann::json object = nlohmann::json::object();
+        for (const v0::Value& element : elements) {
+          if (element.label().empty()) {
+            return absl::InvalidArgumentError(
+                "Expected either all or none of the elements to have labels.");
+          }
+          object[element.label()] = GENC_TRY(ToJson(element));
+        }
+        return object;
+      }
+      nlohmann::json array = nlohmann::json::array();
+      for (const v0::Value& element : elements) {
+        if (!element.label().empty()) {
+          return absl::InvalidArgumentError(
+              "Expected either all or none of the elements to have labels.");
+        }
+        array.push_back(GENC_TRY(ToJson(element)));
+      }
+      return array;
+    }
+    default:
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unsupported value in the input to InjaTemplate: ",
+          value.DebugString()));
+  }
+}
+
+}  // namespace
 
 absl::Status InjaTemplate::CheckWellFormed(
     const v0::Intrinsic& intrinsic_pb) const {
@@ -38,17 +85,23 @@ absl::Status InjaTemplate::CheckWellFormed(
 absl::Status InjaTemplate::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
                                        const v0::Value& arg, v0::Value* result,
                                        Context* context) const {
-  const std::string template_str(intrinsic_pb.static_parameter().str());
-  auto parsed_json = nlohmann::json::parse(arg.str(), /*cb=*/nullptr,
-                                           /*allow_exceptions=*/false);
-  if (parsed_json.is_discarded()) {
-    return absl::InternalError(absl::Substitute(
-        "Failed parsing json input to InjaTemplate: $0", arg.DebugString()));
+  const std::string& template_str = intrinsic_pb.static_parameter().str();
+  nlohmann::json data;
+  if (arg.has_struct_()) {
+    // Structured input is used as it is, with no JSON text in between.
+    data = GENC_TRY(ToJson(arg));
+  } else {
+    data = nlohmann::json::parse(arg.str(), /*cb=*/nullptr,
+                                 /*allow_exceptions=*/false);
+    if (data.is_discarded()) {
+      return absl::InternalError(absl::Substitute(
+          "Failed parsing json input to InjaTemplate: $0", arg.DebugString()));
+    }
   }
 
-  // TODO(b/315223622): externalize env, and enable the custom callback fns.
-  inja_status_or::Environment env;
-  std::string result_str = GENC_TRY(env.render(template_str, parsed_json));
+  // TODO(b/315223622): enable the custom callback fns.
+  std::string result_str = GENC_TRY(
+      inja_status_or::SharedEnvironment::Default().render(template_str, data));
   result->set_str(result_str);
   return absl::OkStatus();
 }
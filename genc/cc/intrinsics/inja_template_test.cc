@@ -57,6 +57,40 @@ TEST(InjaTemplateTest, ProcessesInputTemplateSuccessfully) {
 
   v0::Value result = runner.Run(template_pb, arg_pb).value();
   EXPECT_EQ(result.str(), "SFO to LAX:1\nSFO to JFK:2\n");
+  EXPECT_EQ(runner.Run(template_pb, arg_pb).value().str(), result.str());
+}
+
+TEST(InjaTemplateTest, ProcessesStructuredInputSuccessfully) {
+  std::shared_ptr<Executor> executor =
+      CreateInlineExecutor(intrinsics::CreateCompleteHandlerSet({}),
+                           CreateThreadBasedConcurrencyManager())
+          .value();
+  Runner runner = Runner::Create(executor).value();
+
+  v0::Value template_pb =
+      CreateInjaTemplate(
+          "{{ user }} ({{ age }}): {% for t in tags %}{{ t }} {% endfor %}"
+          "{% if admin %}admin{% endif %}")
+          .value();
+
+  v0::Value arg_pb;
+  v0::Struct* arg = arg_pb.mutable_struct_();
+  v0::Value* user = arg->add_element();
+  user->set_label("user");
+  user->set_str("ada");
+  v0::Value* age = arg->add_element();
+  age->set_label("age");
+  age->set_int_32(36);
+  v0::Value* tags = arg->add_element();
+  tags->set_label("tags");
+  tags->mutable_struct_()->add_element()->set_str("math");
+  tags->mutable_struct_()->add_element()->set_str("engines");
+  v0::Value* admin = arg->add_element();
+  admin->set_label("admin");
+  admin->set_boolean(true);
+
+  v0::Value result = runner.Run(template_pb, arg_pb).value();
+  EXPECT_EQ(result.str(), "ada (36): math engines admin");
 }
 }  // namespace
 }  // namespace genc
@@ -66,6 +66,7 @@ PYBIND11_MODULE(intrinsic_bindings, m) {
   intrinsics.attr("PARALLEL_MAP") = py::str(intrinsics::kParallelMap);
   intrinsics.attr("REGEX_PARTIAL_MATCH") =
       py::str(intrinsics::kRegexPartialMatch);
+  intrinsics.attr("REGEX_SET_MATCH") = py::str(intrinsics::kRegexSetMatch);
   intrinsics.attr("REPEAT") = py::str(intrinsics::kRepeat);
   intrinsics.attr("REPEATED_CONDITIONAL_CHAIN") =
       py::str(intrinsics::kRepeatedConditionalChain);
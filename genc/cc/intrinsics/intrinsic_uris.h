@@ -52,6 +52,10 @@ inline constexpr absl::string_view kDelegate = "delegate";
 // that represent functions to attempt to invoke in the order listed.
 // Takes exactly one dynamic parameter, which serves as the input to each of
 // the candidate functions (all of which must have matching type signatures).
+// May also take a static parameter named "mode", with "hedged" to start the
+// next candidate after a delay given as "hedge_delay_ms" even if the previous
+// ones haven't failed yet, or "race" to start all of them at once. Either way,
+// the first candidate to succeed provides the result.
 inline constexpr absl::string_view kFallback = "fallback";
 
 // Represents a logical not.
@@ -100,6 +104,16 @@ inline constexpr absl::string_view kPromptTemplateWithParameters =
 // a match, False otherwise.
 inline constexpr absl::string_view kRegexPartialMatch = "regex_partial_match";
 
+// Represents a partial match against many patterns at once, in a single scan
+// of the input, e.g., for routing a model's output.
+// Takes one static struct parameter of string elements, the patterns, which
+// may be labeled.
+// Takes one dynamic string parameter, which is the input string matched against
+// all of the patterns.
+// Returns a struct with one boolean per pattern, in the same order and with the
+// same labels, which is True if that pattern partially matches the input.
+inline constexpr absl::string_view kRegexSetMatch = "regex_set_match";
+
 // Represents a loop that repeats its logic n times sequentially .
 // Takes one static parameter contains body_fn and num_steps.
 // Takes one dynamic Value parameter, which serves as the input to the loop.
@@ -15,18 +15,279 @@ limitations under the License
 
 #include "genc/cc/intrinsics/parallel_map.h"
 
+#include <cstddef>
+#include <memory>
 #include <optional>
+#include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 namespace intrinsics {
+namespace {
+
+constexpr char kMapFnLabel[] = "map_fn";
+constexpr char kMaxInFlightLabel[] = "max_in_flight";
+constexpr char kOrderedLabel[] = "ordered";
+constexpr char kFailFastLabel[] = "fail_fast";
+constexpr char kErrorLabel[] = "error";
+
+struct MapConfig {
+  const v0::Value* map_fn = nullptr;
+  int max_in_flight = 0;
+  bool ordered = true;
+  bool fail_fast = true;
+};
+
+absl::StatusOr<MapConfig> ParseConfig(const v0::Intrinsic& intrinsic_pb) {
+  const v0::Value& param = intrinsic_pb.static_parameter();
+  MapConfig config;
+  config.map_fn = &param;
+  if (!param.has_struct_()) {
+    return config;
+  }
+  bool has_map_fn = false;
+  for (const v0::Value& element : param.struct_().element()) {
+    has_map_fn = has_map_fn || element.label() == kMapFnLabel;
+  }
+  if (!has_map_fn) {
+    // A struct without options is taken to be the function itself.
+    return config;
+  }
+  for (const v0::Value& element : param.struct_().element()) {
+    if (element.label() == kMapFnLabel) {
+      config.map_fn = &element;
+    } else if (element.label() == kMaxInFlightLabel) {
+      if (!element.has_int_32() || element.int_32() < 0) {
+        return absl::InvalidArgumentError(
+            "Expected a non-negative int_32 for max_in_flight.");
+      }
+      config.max_in_flight = element.int_32();
+    } else if (element.label() == kOrderedLabel) {
+      if (!element.has_boolean()) {
+        return absl::InvalidArgumentError("Expected a boolean for ordered.");
+      }
+      config.ordered = element.boolean();
+    } else if (element.label() == kFailFastLabel) {
+      if (!element.has_boolean()) {
+        return absl::InvalidArgumentError(
+            "Expected a boolean for fail_fast.");
+      }
+      config.fail_fast = element.boolean();
+    } else {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unrecognized ParallelMap option: \"", element.label(), "\"."));
+    }
+  }
+  return config;
+}
+
+// Drives a single map. Calls are started as long as fewer than the maximum
+// are in progress, and each completed call makes room for the next one, so no
+// thread is held while waiting for the results.
+class AsyncParallelMap : public std::enable_shared_from_this<AsyncParallelMap> {
+ public:
+  using Context = ControlFlowIntrinsicHandlerInterface::Context;
+  using ValueRef = ControlFlowIntrinsicHandlerInterface::ValueRef;
+
+  AsyncParallelMap(ValueRef map_fn, const MapConfig& config,
+                   std::shared_ptr<Context> context)
+      : map_fn_(std::move(map_fn)),
+        max_in_flight_(config.max_in_flight),
+        ordered_(config.ordered),
+        fail_fast_(config.fail_fast),
+        context_(std::move(context)),
+        result_(std::make_shared<Promise<ValueRef>>()) {}
+
+  std::shared_ptr<FutureInterface<ValueRef>> result() const { return result_; }
+
+  // Maps `elements`, each once it is ready.
+  void Start(std::vector<ValueRef> elements) {
+    elements_ = std::move(elements);
+    Start(elements_.size());
+  }
+
+  // Maps the elements of the materialized struct `arg_pb`.
+  void Start(v0::Value arg_pb) {
+    arg_pb_ = std::move(arg_pb);
+    Start(arg_pb_.struct_().element_size());
+  }
+
+  // Fails the map before it has started.
+  void Fail(absl::Status status) { result_->Set(std::move(status)); }
+
+  // Blocks until no calls are in progress, and none will be started. A failed
+  // map sets its result before that, while calls may still use the context.
+  void AwaitIdle() {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(&finished_));
+  }
+
+ private:
+  void Start(size_t num_elements) {
+    num_elements_ = num_elements;
+    {
+      absl::MutexLock lock(&mutex_);
+      results_.resize(num_elements_);
+    }
+    Advance();
+  }
+
+  // Starts as many calls as allowed, or finishes the map once no calls are in
+  // progress and none are left to start.
+  void Advance() {
+    while (true) {
+      std::vector<size_t> indices;
+      bool finish = false;
+      {
+        absl::MutexLock lock(&mutex_);
+        while (status_.ok() && next_ < num_elements_ &&
+               (max_in_flight_ == 0 || num_in_flight_ < max_in_flight_)) {
+          indices.push_back(next_++);
+          ++num_in_flight_;
+        }
+        if (indices.empty() && num_in_flight_ == 0 && !finished_ &&
+            (next_ == num_elements_ || !status_.ok())) {
+          finished_ = true;
+          finish = true;
+        }
+      }
+      if (finish) {
+        Finish();
+        return;
+      }
+      // Calls that fail right away are recorded here rather than from a
+      // continuation, so the loop has to go round again to replace them.
+      bool failed = false;
+      for (size_t index : indices) {
+        absl::StatusOr<ValueRef> result = Call(index);
+        if (!result.ok()) {
+          Record(index, result.status());
+          failed = true;
+          continue;
+        }
+        // Materialized to learn whether the call succeeded.
+        context_->concurrency_interface()->Then(
+            context_->MaterializeAsync(*result),
+            [self = shared_from_this(), index, result = *result](
+                absl::StatusOr<v0::Value> result_pb) -> absl::Status {
+              if (result_pb.ok()) {
+                self->Record(index, result);
+              } else {
+                self->Record(index, result_pb.status());
+              }
+              self->Advance();
+              return absl::OkStatus();
+            });
+      }
+      if (!failed) {
+        return;
+      }
+    }
+  }
+
+  absl::StatusOr<ValueRef> Call(size_t index) {
+    if (!elements_.empty()) {
+      return context_->CreateCall(map_fn_, elements_[index]);
+    }
+    ValueRef element =
+        GENC_TRY(context_->CreateValue(arg_pb_.struct_().element(index)));
+    return context_->CreateCall(map_fn_, element);
+  }
+
+  void Record(size_t index, absl::StatusOr<ValueRef> result) {
+    {
+      absl::MutexLock lock(&mutex_);
+      --num_in_flight_;
+      if (result.ok() || !fail_fast_) {
+        results_[ordered_ ? index : num_recorded_] = std::move(result);
+        ++num_recorded_;
+        return;
+      }
+      if (!status_.ok()) {
+        return;
+      }
+      status_ = result.status();
+    }
+    // Fails the map right away rather than once the calls in progress are
+    // done. Those still hold on to the map, and their results are dropped.
+    result_->Set(result.status());
+  }
+
+  void Finish() {
+    std::vector<absl::StatusOr<ValueRef>> results;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (!status_.ok()) {
+        // Already failed by `Record`.
+        return;
+      }
+      results.swap(results_);
+    }
+    std::vector<ValueRef> values;
+    values.reserve(results.size());
+    for (absl::StatusOr<ValueRef>& result : results) {
+      if (result.ok()) {
+        values.push_back(*std::move(result));
+        continue;
+      }
+      v0::Value error_pb;
+      error_pb.set_label(kErrorLabel);
+      error_pb.set_str(result.status().ToString());
+      absl::StatusOr<ValueRef> error = context_->CreateValue(error_pb);
+      if (!error.ok()) {
+        result_->Set(error.status());
+        return;
+      }
+      values.push_back(*std::move(error));
+    }
+    result_->Set(context_->CreateStruct(absl::MakeSpan(values)));
+  }
+
+  const ValueRef map_fn_;
+  const int max_in_flight_;
+  const bool ordered_;
+  const bool fail_fast_;
+  const std::shared_ptr<Context> context_;
+  const std::shared_ptr<Promise<ValueRef>> result_;
+
+  // Set by `Start`, then only read.
+  std::vector<ValueRef> elements_;
+  v0::Value arg_pb_;
+  size_t num_elements_ = 0;
+
+  absl::Mutex mutex_;
+  size_t next_ ABSL_GUARDED_BY(mutex_) = 0;
+  int num_in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t num_recorded_ ABSL_GUARDED_BY(mutex_) = 0;
+  // The results of the calls, in the order of the elements or of completion.
+  std::vector<absl::StatusOr<ValueRef>> results_ ABSL_GUARDED_BY(mutex_);
+  // The first failure, if failing fast.
+  absl::Status status_ ABSL_GUARDED_BY(mutex_);
+  bool finished_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+absl::StatusOr<std::shared_ptr<AsyncParallelMap>> CreateMap(
+    const v0::Intrinsic& intrinsic_pb,
+    std::shared_ptr<ControlFlowIntrinsicHandlerInterface::Context> context) {
+  const MapConfig config = GENC_TRY(ParseConfig(intrinsic_pb));
+  ControlFlowIntrinsicHandlerInterface::ValueRef map_fn =
+      GENC_TRY(context->CreateValue(*config.map_fn));
+  return std::make_shared<AsyncParallelMap>(std::move(map_fn), config,
+                                            std::move(context));
+}
+
+}  // namespace
 
 absl::Status ParallelMap::CheckWellFormed(
     const v0::Intrinsic& intrinsic_pb) const {
@@ -34,25 +295,65 @@ absl::Status ParallelMap::CheckWellFormed(
     return absl::InvalidArgumentError(
         "Expect exactly one static_parameter for ParallelMap, got None.");
   }
-
-  return absl::OkStatus();
+  return ParseConfig(intrinsic_pb).status();
 }
 
 absl::StatusOr<ControlFlowIntrinsicHandlerInterface::ValueRef>
 ParallelMap::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
                          std::optional<ValueRef> arg, Context* context) const {
-  v0::Value args_pb;
-  // TODO(b/309696962): remove after type support.
-  GENC_TRY(context->Materialize(arg.value(), &args_pb));
-  std::vector<ValueRef> results;
-  results.reserve(args_pb.struct_().element_size());
-  ValueRef fn_val =
-      GENC_TRY(context->CreateValue(intrinsic_pb.static_parameter()));
-  for (const v0::Value& e : args_pb.struct_().element()) {
-    ValueRef arg_val = GENC_TRY(context->CreateValue(e));
-    results.push_back(GENC_TRY(context->CreateCall(fn_val, arg_val)));
-  }
-  return context->CreateStruct(absl::MakeSpan(results));
+  if (!arg.has_value()) {
+    return absl::InvalidArgumentError("Missing argument for ParallelMap.");
+  }
+  // Doesn't own the context, which outlives the map since this waits for it,
+  // including for the calls still in progress once the map has failed.
+  std::shared_ptr<AsyncParallelMap> map = GENC_TRY(CreateMap(
+      intrinsic_pb, std::shared_ptr<Context>(std::shared_ptr<Context>(),
+                                             context)));
+  std::optional<std::vector<ValueRef>> elements =
+      context->StructElements(*arg);
+  if (elements.has_value()) {
+    map->Start(*std::move(elements));
+  } else {
+    v0::Value arg_pb;
+    // TODO(b/309696962): remove after type support.
+    GENC_TRY(context->Materialize(*arg, &arg_pb));
+    map->Start(std::move(arg_pb));
+  }
+  absl::StatusOr<ValueRef> result = map->result()->Get();
+  map->AwaitIdle();
+  return result;
+}
+
+std::shared_ptr<FutureInterface<ControlFlowIntrinsicHandlerInterface::ValueRef>>
+ParallelMap::ExecuteCallAsync(const v0::Intrinsic& intrinsic_pb,
+                              std::optional<ValueRef> arg,
+                              std::shared_ptr<Context> context) const {
+  if (!arg.has_value()) {
+    return MakeReadyFuture<ValueRef>(
+        absl::InvalidArgumentError("Missing argument for ParallelMap."));
+  }
+  absl::StatusOr<std::shared_ptr<AsyncParallelMap>> map =
+      CreateMap(intrinsic_pb, context);
+  if (!map.ok()) {
+    return MakeReadyFuture<ValueRef>(map.status());
+  }
+  std::optional<std::vector<ValueRef>> elements =
+      context->StructElements(*arg);
+  if (elements.has_value()) {
+    (*map)->Start(*std::move(elements));
+    return (*map)->result();
+  }
+  context->concurrency_interface()->Then(
+      context->MaterializeAsync(*arg),
+      [map = *map](absl::StatusOr<v0::Value> arg_pb) -> absl::Status {
+        if (!arg_pb.ok()) {
+          map->Fail(arg_pb.status());
+          return arg_pb.status();
+        }
+        map->Start(*std::move(arg_pb));
+        return absl::OkStatus();
+      });
+  return (*map)->result();
 }
 
 }  // namespace intrinsics
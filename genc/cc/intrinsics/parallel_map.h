@@ -16,17 +16,35 @@ limitations under the License
 #ifndef GENC_CC_INTRINSICS_PARALLEL_MAP_H_
 #define GENC_CC_INTRINSICS_PARALLEL_MAP_H_
 
+#include <memory>
 #include <optional>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "genc/cc/intrinsics/intrinsic_uris.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 namespace intrinsics {
 
+// Calls a function on each element of a struct, and returns a struct with the
+// results. The static parameter is either the function, or a struct with the
+// function labeled "map_fn" and any of the following options:
+//
+//   "max_in_flight": The maximum number of calls in progress at a time, or 0
+//     (the default) for no limit.
+//   "ordered": Whether the results are in the order of the elements (the
+//     default), or in the order in which the calls complete.
+//   "fail_fast": Whether the first failed call fails the map (the default),
+//     without starting the calls still pending or, when run asynchronously,
+//     waiting for those in progress, or is reported in its result as a
+//     string labeled "error".
+//
+// Elements of a struct assembled from separate values are mapped as soon as
+// each is ready, rather than once all of them are.
 class ParallelMap : public ControlFlowIntrinsicHandlerBase {
  public:
   ParallelMap() : ControlFlowIntrinsicHandlerBase(kParallelMap) {}
@@ -38,6 +56,10 @@ class ParallelMap : public ControlFlowIntrinsicHandlerBase {
   absl::StatusOr<ValueRef> ExecuteCall(const v0::Intrinsic& intrinsic_pb,
                                        std::optional<ValueRef> arg,
                                        Context* context) const final;
+
+  std::shared_ptr<FutureInterface<ValueRef>> ExecuteCallAsync(
+      const v0::Intrinsic& intrinsic_pb, std::optional<ValueRef> arg,
+      std::shared_ptr<Context> context) const final;
 };
 }  // namespace intrinsics
 }  // namespace genc
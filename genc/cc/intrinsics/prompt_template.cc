@@ -15,22 +15,184 @@ limitations under the License
 
 #include "genc/cc/intrinsics/prompt_template.h"
 
+#include <cstddef>
+#include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
-#include "absl/container/flat_hash_set.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "genc/cc/runtime/bounded_cache.h"
+#include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/computation.pb.h"
-#include "re2/re2.h"
 
 namespace genc {
 namespace intrinsics {
-constexpr absl::string_view kParameterRe = "(\\{[a-zA-Z0-9_]*\\})";
+namespace {
+
+// The number of distinct templates kept compiled.
+constexpr size_t kTemplateCacheCapacity = 1024;
+
+bool IsParameterChar(char c) { return absl::ascii_isalnum(c) || c == '_'; }
+
+// Whether "{name}" is a placeholder, i.e., `name` matches [a-zA-Z0-9_]*.
+bool IsParameterName(absl::string_view name) {
+  for (char c : name) {
+    if (!IsParameterChar(c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// A template split into literal text and placeholders, so that it can be
+// rendered in a single pass.
+class CompiledTemplate {
+ public:
+  explicit CompiledTemplate(absl::string_view template_string)
+      : text_(template_string) {
+    size_t literal_begin = 0;
+    size_t i = 0;
+    while (i < text_.size()) {
+      if (text_[i] != '{') {
+        ++i;
+        continue;
+      }
+      size_t end = i + 1;
+      while (end < text_.size() && IsParameterChar(text_[end])) {
+        ++end;
+      }
+      if (end == text_.size() || text_[end] != '}') {
+        i = end;
+        continue;
+      }
+      AddLiteral(literal_begin, i);
+      const absl::string_view name =
+          absl::string_view(text_).substr(i + 1, end - i - 1);
+      auto [it, inserted] = parameters_.emplace(name, names_.size());
+      if (inserted) {
+        names_.emplace_back(name);
+        occurrences_.push_back(0);
+      }
+      ++occurrences_[it->second];
+      segments_.push_back({i, end + 1, it->second});
+      i = literal_begin = end + 1;
+    }
+    AddLiteral(literal_begin, text_.size());
+  }
+
+  // The distinct parameter names, in the order of first appearance.
+  absl::Span<const std::string> names() const { return names_; }
+
+  // Returns the index of parameter `name` in `names()`, if any.
+  std::optional<size_t> Find(absl::string_view name) const {
+    auto it = parameters_.find(name);
+    if (it == parameters_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  // Renders the template with the value at each index of `values` in place
+  // of the parameter at that index of `names()`, leaving the placeholders
+  // whose values are `std::nullopt` as they are.
+  std::string Render(
+      absl::Span<const std::optional<absl::string_view>> values) const {
+    size_t size = literal_size_;
+    for (size_t index = 0; index < names_.size(); ++index) {
+      size += occurrences_[index] * (values[index].has_value()
+                                         ? values[index]->size()
+                                         : names_[index].size() + 2);
+    }
+    std::string result;
+    result.reserve(size);
+    for (const Segment& segment : segments_) {
+      if (segment.parameter != kLiteral &&
+          values[segment.parameter].has_value()) {
+        const absl::string_view value = *values[segment.parameter];
+        result.append(value.data(), value.size());
+      } else {
+        result.append(text_, segment.begin, segment.end - segment.begin);
+      }
+    }
+    return result;
+  }
+
+ private:
+  static constexpr size_t kLiteral = static_cast<size_t>(-1);
+
+  // A range of `text_`, which is either literal text or the placeholder of
+  // the parameter at index `parameter` of `names_`.
+  struct Segment {
+    size_t begin;
+    size_t end;
+    size_t parameter;
+  };
+
+  void AddLiteral(size_t begin, size_t end) {
+    if (begin < end) {
+      segments_.push_back({begin, end, kLiteral});
+      literal_size_ += end - begin;
+    }
+  }
+
+  std::string text_;
+  std::vector<Segment> segments_;
+  std::vector<std::string> names_;
+  std::vector<size_t> occurrences_;
+  absl::flat_hash_map<std::string, size_t> parameters_;
+  size_t literal_size_ = 0;
+};
+
+absl::StatusOr<std::shared_ptr<const CompiledTemplate>> GetCompiledTemplate(
+    absl::string_view template_string) {
+  static auto* const cache =
+      new BoundedCache<CompiledTemplate>(kTemplateCacheCapacity);
+  return cache->GetOrCreate(
+      template_string,
+      [](absl::string_view key) -> absl::StatusOr<CompiledTemplate> {
+        return CompiledTemplate(key);
+      });
+}
+
+// Renders `compiled` with `replacements` of parameter names by values. Where
+// a name is repeated, its first value is used. Names that can't appear in a
+// placeholder are replaced verbatim, as they used to be, which takes a scan
+// of the whole template.
+std::string Render(
+    const CompiledTemplate& compiled, absl::string_view template_string,
+    absl::Span<const std::pair<absl::string_view, absl::string_view>>
+        replacements) {
+  for (const auto& replacement : replacements) {
+    if (!IsParameterName(replacement.first)) {
+      std::vector<std::pair<std::string, absl::string_view>> braced;
+      for (const auto& [name, value] : replacements) {
+        braced.emplace_back(absl::StrFormat("{%s}", name), value);
+      }
+      return absl::StrReplaceAll(template_string, braced);
+    }
+  }
+  std::vector<std::optional<absl::string_view>> values(
+      compiled.names().size());
+  for (const auto& [name, value] : replacements) {
+    std::optional<size_t> index = compiled.Find(name);
+    if (index.has_value() && !values[*index].has_value()) {
+      values[*index] = value;
+    }
+  }
+  return compiled.Render(values);
+}
+
+}  // namespace
 
 absl::Status PromptTemplate::CheckWellFormed(
     const v0::Intrinsic& intrinsic_pb) const {
@@ -47,31 +209,26 @@ absl::Status PromptTemplate::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
                                          Context* context) const {
   const absl::string_view template_string(
       intrinsic_pb.static_parameter().str());
-  absl::string_view input(template_string);
-  std::string parameter;
-  // Extract template placeholders.
-  absl::flat_hash_set<std::string> parameters_set;
-  while (RE2::FindAndConsume(&input, kParameterRe, &parameter)) {
-    parameters_set.insert(parameter);
-  }
+  std::shared_ptr<const CompiledTemplate> compiled =
+      GENC_TRY(GetCompiledTemplate(template_string));
 
-  std::vector<std::pair<std::string, std::string>> replacements = {};
-  if (parameters_set.size() == 1) {
+  std::vector<std::pair<absl::string_view, absl::string_view>> replacements;
+  if (compiled->names().size() == 1) {
     // Handle univariate template.
     if (!arg.has_str()) {
       return absl::InvalidArgumentError(
           "Expect input to PromptTemplate to have str value, got none.");
     }
-    replacements.emplace_back(parameter, arg.str());
+    replacements.emplace_back(compiled->names()[0], arg.str());
   } else {
     // Handle multivariate template.
+    replacements.reserve(arg.struct_().element_size());
     for (const auto& arg : arg.struct_().element()) {
-      replacements.emplace_back(absl::StrFormat("{%s}", arg.label()),
-                                arg.str());
+      replacements.emplace_back(arg.label(), arg.str());
     }
   }
 
-  result->set_str(absl::StrReplaceAll(template_string, replacements));
+  result->set_str(Render(*compiled, template_string, replacements));
   return absl::OkStatus();
 }
 
@@ -119,7 +276,8 @@ absl::Status PromptTemplateWithParameters::ExecuteCall(
     return absl::InvalidArgumentError(absl::StrCat(
         "The argument is not a struct: ", arg.DebugString()));
   }
-  auto params = intrinsic_pb.static_parameter().struct_().element(1).struct_();
+  const v0::Struct& params =
+      intrinsic_pb.static_parameter().struct_().element(1).struct_();
   if (params.element_size() != arg.struct_().element_size()) {
     return absl::InvalidArgumentError(absl::StrCat(
         "Mismatching the number of elements in the argument: ",
@@ -129,14 +287,10 @@ absl::Status PromptTemplateWithParameters::ExecuteCall(
         " in the template: ",
         intrinsic_pb.static_parameter().struct_().DebugString()));
   }
-  absl::string_view input(template_string);
-  std::string parameter;
-  // Extract template placeholders.
-  absl::flat_hash_set<std::string> parameters_set;
-  while (RE2::FindAndConsume(&input, kParameterRe, &parameter)) {
-    parameters_set.insert(parameter);
-  }
-  std::vector<std::pair<std::string, std::string>> replacements = {};
+  std::shared_ptr<const CompiledTemplate> compiled =
+      GENC_TRY(GetCompiledTemplate(template_string));
+  std::vector<std::pair<absl::string_view, absl::string_view>> replacements;
+  replacements.reserve(params.element_size());
   for (int index = 0; index < params.element_size(); ++index) {
     const v0::Value& arg_element = arg.struct_().element(index);
     if (!arg_element.has_str()) {
@@ -147,10 +301,9 @@ absl::Status PromptTemplateWithParameters::ExecuteCall(
     if (!param_element.has_str()) {
       return absl::InternalError("Non-string parameter name.");
     }
-    replacements.emplace_back(
-        absl::StrFormat("{%s}", param_element.str()), arg_element.str());
+    replacements.emplace_back(param_element.str(), arg_element.str());
   }
-  result->set_str(absl::StrReplaceAll(template_string, replacements));
+  result->set_str(Render(*compiled, template_string, replacements));
   return absl::OkStatus();
 }
 
@@ -0,0 +1,121 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Measures rendering a prompt template, compiled once and cached, against
+// scanning it with RE2 and substituting with `absl::StrReplaceAll` on every
+// call, as was done before the cache.
+//
+//   bazel run -c opt //genc/cc/intrinsics:prompt_template_benchmark
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_replace.h"
+#include "absl/strings/string_view.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/cc/intrinsics/prompt_template.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "re2/re2.h"
+
+namespace genc {
+namespace intrinsics {
+namespace {
+
+// A template of about `size` bytes, with `num_parameters` distinct
+// parameters, each of which occurs every few hundred bytes.
+std::string MakeTemplate(size_t size, int num_parameters) {
+  std::string text;
+  for (int index = 0; text.size() < size; ++index) {
+    absl::StrAppend(&text, "Answer the question based on the context, in no ",
+                    "more than a paragraph, citing the sources you used. ",
+                    "Context {p", index % num_parameters, "}, question {p",
+                    (index + 1) % num_parameters, "}.\n");
+  }
+  return text;
+}
+
+v0::Value MakeArg(int num_parameters) {
+  v0::Value arg;
+  if (num_parameters == 1) {
+    arg.set_str("What is the weather like in Paris in the spring?");
+    return arg;
+  }
+  for (int index = 0; index < num_parameters; ++index) {
+    v0::Value* element = arg.mutable_struct_()->add_element();
+    element->set_label(absl::StrCat("p", index));
+    element->set_str(absl::StrCat("value of parameter ", index));
+  }
+  return arg;
+}
+
+// The implementation replaced by the cache, for reference.
+std::string RenderUncached(absl::string_view template_string,
+                           const v0::Value& arg) {
+  absl::string_view input(template_string);
+  std::string parameter;
+  absl::flat_hash_set<std::string> parameters_set;
+  while (RE2::FindAndConsume(&input, "(\\{[a-zA-Z0-9_]*\\})", &parameter)) {
+    parameters_set.insert(parameter);
+  }
+  std::vector<std::pair<std::string, std::string>> replacements;
+  if (parameters_set.size() == 1) {
+    replacements.emplace_back(parameter, arg.str());
+  } else {
+    for (const auto& element : arg.struct_().element()) {
+      replacements.emplace_back(absl::StrFormat("{%s}", element.label()),
+                                element.str());
+    }
+  }
+  return absl::StrReplaceAll(template_string, replacements);
+}
+
+void BM_Uncached(benchmark::State& state) {
+  const std::string template_string =
+      MakeTemplate(state.range(0), state.range(1));
+  const v0::Value arg = MakeArg(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(RenderUncached(template_string, arg));
+  }
+}
+
+void BM_Cached(benchmark::State& state) {
+  const v0::Value template_pb =
+      CreatePromptTemplate(MakeTemplate(state.range(0), state.range(1)))
+          .value();
+  const v0::Value arg = MakeArg(state.range(1));
+  PromptTemplate handler;
+  for (auto _ : state) {
+    v0::Value result;
+    benchmark::DoNotOptimize(
+        handler.ExecuteCall(template_pb.intrinsic(), arg, &result, nullptr));
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+#define TEMPLATE_ARGS \
+  ArgNames({"size", "parameters"})->ArgsProduct({{200, 10000}, {1, 8}})
+
+BENCHMARK(BM_Uncached)->TEMPLATE_ARGS;
+BENCHMARK(BM_Cached)->TEMPLATE_ARGS;
+
+}  // namespace
+}  // namespace intrinsics
+}  // namespace genc
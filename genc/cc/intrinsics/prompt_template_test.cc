@@ -0,0 +1,110 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/intrinsics/prompt_template.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace intrinsics {
+namespace {
+
+v0::Value CreateStr(absl::string_view str) {
+  v0::Value value_pb;
+  value_pb.set_str(std::string(str));
+  return value_pb;
+}
+
+v0::Value CreateArgs(
+    std::vector<std::pair<absl::string_view, absl::string_view>> args) {
+  v0::Value value_pb;
+  for (const auto& [label, str] : args) {
+    v0::Value* element = value_pb.mutable_struct_()->add_element();
+    element->set_label(std::string(label));
+    element->set_str(std::string(str));
+  }
+  return value_pb;
+}
+
+absl::StatusOr<std::string> Render(absl::string_view template_str,
+                                   const v0::Value& arg) {
+  v0::Value template_pb = CreatePromptTemplate(template_str).value();
+  v0::Value result;
+  absl::Status status = PromptTemplate().ExecuteCall(template_pb.intrinsic(),
+                                                     arg, &result, nullptr);
+  if (!status.ok()) {
+    return status;
+  }
+  return result.str();
+}
+
+TEST(PromptTemplateTest, ReplacesEveryOccurrenceOfSingleParameter) {
+  EXPECT_EQ(Render("Q: {q}? A: {q}!", CreateStr("why")).value(),
+            "Q: why? A: why!");
+  EXPECT_EQ(Render("{{q}}", CreateStr("x")).value(), "{x}");
+  EXPECT_EQ(Render("{}", CreateStr("x")).value(), "x");
+}
+
+TEST(PromptTemplateTest, RequiresStrForSingleParameter) {
+  EXPECT_EQ(Render("{q}", CreateArgs({{"q", "x"}})).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(PromptTemplateTest, ReplacesLabeledParameters) {
+  EXPECT_EQ(Render("{a} and {b}, {a}, {c}",
+                   CreateArgs({{"b", "2"}, {"a", "1"}, {"d", "4"}}))
+                .value(),
+            "1 and 2, 1, {c}");
+  EXPECT_EQ(Render("{a-b} {c} {d}",
+                   CreateArgs({{"a-b", "1"}, {"c", "2"}, {"d", "3"}}))
+                .value(),
+            "1 2 3");
+  EXPECT_EQ(Render("no parameters", CreateArgs({})).value(), "no parameters");
+  EXPECT_EQ(Render("{a {b} c} {c}", CreateArgs({{"b", "1"}, {"c", "2"}}))
+                .value(),
+            "{a 1 c} 2");
+}
+
+TEST(PromptTemplateWithParametersTest, ReplacesNamedParameters) {
+  v0::Value template_pb =
+      CreatePromptTemplateWithParameters("{x} vs. {y}: {x}", {"x", "y"})
+          .value();
+  v0::Value result;
+  ASSERT_TRUE(PromptTemplateWithParameters()
+                  .ExecuteCall(template_pb.intrinsic(),
+                               CreateArgs({{"", "1"}, {"", "2"}}), &result,
+                               nullptr)
+                  .ok());
+  EXPECT_EQ(result.str(), "1 vs. 2: 1");
+
+  EXPECT_EQ(PromptTemplateWithParameters()
+                .ExecuteCall(template_pb.intrinsic(), CreateArgs({{"", "1"}}),
+                             &result, nullptr)
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace intrinsics
+}  // namespace genc
@@ -0,0 +1,66 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/intrinsics/regex_cache.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "genc/cc/runtime/bounded_cache.h"
+#include "re2/re2.h"
+
+namespace genc {
+namespace intrinsics {
+namespace {
+
+// The number of distinct patterns kept compiled.
+constexpr size_t kRegexCacheCapacity = 1024;
+
+// The options that affect how a pattern compiles, other than the encoding,
+// which is among the parse flags.
+std::string OptionsKey(const RE2::Options& options) {
+  return absl::StrCat(options.ParseFlags(), ":", options.longest_match(), ":",
+                      options.max_mem(), ":");
+}
+
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<const RE2>> GetCompiledRegex(
+    absl::string_view pattern, const RE2::Options& options) {
+  static auto* const cache = new BoundedCache<RE2>(kRegexCacheCapacity);
+  const std::string key = absl::StrCat(OptionsKey(options), pattern);
+  const size_t prefix_size = key.size() - pattern.size();
+  return cache->GetOrCreate(
+      key,
+      [&options, prefix_size](absl::string_view key)
+          -> absl::StatusOr<std::unique_ptr<RE2>> {
+        key.remove_prefix(prefix_size);
+        auto regex = std::make_unique<RE2>(
+            re2::StringPiece(key.data(), key.size()), options);
+        if (!regex->ok()) {
+          return absl::InvalidArgumentError(absl::StrCat(
+              "Invalid regex \"", key, "\": ", regex->error()));
+        }
+        return regex;
+      });
+}
+
+}  // namespace intrinsics
+}  // namespace genc
@@ -0,0 +1,37 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_INTRINSICS_REGEX_CACHE_H_
+#define GENC_CC_INTRINSICS_REGEX_CACHE_H_
+
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "re2/re2.h"
+
+namespace genc {
+namespace intrinsics {
+
+// Returns `pattern` compiled with `options`, from a cache shared by the whole
+// process that keeps the most recently compiled patterns, so that a pattern
+// used over and over is only compiled once. Fails if the pattern is invalid.
+absl::StatusOr<std::shared_ptr<const RE2>> GetCompiledRegex(
+    absl::string_view pattern, const RE2::Options& options = RE2::Quiet);
+
+}  // namespace intrinsics
+}  // namespace genc
+
+#endif  // GENC_CC_INTRINSICS_REGEX_CACHE_H_
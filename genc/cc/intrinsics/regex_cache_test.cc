@@ -0,0 +1,53 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/intrinsics/regex_cache.h"
+
+#include <memory>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "re2/re2.h"
+
+namespace genc {
+namespace intrinsics {
+namespace {
+
+TEST(RegexCacheTest, CompilesEachPatternOnce) {
+  std::shared_ptr<const RE2> regex = GetCompiledRegex("a+b").value();
+  EXPECT_TRUE(RE2::PartialMatch("xaab", *regex));
+  EXPECT_EQ(GetCompiledRegex("a+b").value(), regex);
+}
+
+TEST(RegexCacheTest, DistinguishesOptions) {
+  RE2::Options case_insensitive(RE2::Quiet);
+  case_insensitive.set_case_sensitive(false);
+  std::shared_ptr<const RE2> regex =
+      GetCompiledRegex("finish", case_insensitive).value();
+  std::shared_ptr<const RE2> case_sensitive_regex =
+      GetCompiledRegex("finish").value();
+  EXPECT_NE(case_sensitive_regex, regex);
+  EXPECT_TRUE(RE2::PartialMatch("FINISH", *regex));
+  EXPECT_FALSE(RE2::PartialMatch("FINISH", *case_sensitive_regex));
+}
+
+TEST(RegexCacheTest, FailsOnInvalidPattern) {
+  EXPECT_EQ(GetCompiledRegex("a(b").status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace intrinsics
+}  // namespace genc
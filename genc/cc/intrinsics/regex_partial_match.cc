@@ -15,8 +15,12 @@ limitations under the License
 
 #include "genc/cc/intrinsics/regex_partial_match.h"
 
+#include <memory>
+
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "genc/cc/intrinsics/regex_cache.h"
+#include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/computation.pb.h"
 #include "re2/re2.h"
 
@@ -28,15 +32,16 @@ absl::Status RegexPartialMatch::CheckWellFormed(
   if (!intrinsic_pb.static_parameter().has_str()) {
     return absl::InvalidArgumentError("Expect regex str, got none.");
   }
-  return absl::OkStatus();
+  return GetCompiledRegex(intrinsic_pb.static_parameter().str()).status();
 }
 
 absl::Status RegexPartialMatch::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
                                             const v0::Value& arg,
                                             v0::Value* result,
                                             Context* context) const {
-  result->set_boolean(
-      RE2::PartialMatch(arg.str(), intrinsic_pb.static_parameter().str()));
+  std::shared_ptr<const RE2> regex =
+      GENC_TRY(GetCompiledRegex(intrinsic_pb.static_parameter().str()));
+  result->set_boolean(RE2::PartialMatch(arg.str(), *regex));
   return absl::OkStatus();
 }
 
@@ -0,0 +1,122 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/intrinsics/regex_set_match.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "genc/cc/runtime/bounded_cache.h"
+#include "genc/cc/runtime/status_macros.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "re2/re2.h"
+#include "re2/set.h"
+
+namespace genc {
+namespace intrinsics {
+namespace {
+
+// The number of distinct lists of patterns kept compiled.
+constexpr size_t kRegexSetCacheCapacity = 256;
+
+absl::StatusOr<std::unique_ptr<RE2::Set>> CompileRegexSet(
+    const v0::Struct& patterns) {
+  auto regex_set = std::make_unique<RE2::Set>(RE2::Quiet, RE2::UNANCHORED);
+  for (const v0::Value& pattern : patterns.element()) {
+    std::string error;
+    if (regex_set->Add(pattern.str(), &error) < 0) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Invalid regex \"", pattern.str(), "\": ", error));
+    }
+  }
+  if (!regex_set->Compile()) {
+    return absl::ResourceExhaustedError(
+        "Out of memory compiling the regex set.");
+  }
+  return regex_set;
+}
+
+// Returns the set compiled from `patterns`, compiling it on first use.
+absl::StatusOr<std::shared_ptr<const RE2::Set>> GetCompiledRegexSet(
+    const v0::Struct& patterns) {
+  static auto* const cache = new BoundedCache<RE2::Set>(kRegexSetCacheCapacity);
+  // Length-prefixed, so that distinct lists can't have the same key.
+  std::string key;
+  for (const v0::Value& pattern : patterns.element()) {
+    absl::StrAppend(&key, pattern.str().size(), ":", pattern.str());
+  }
+  return cache->GetOrCreate(key, [&patterns](absl::string_view) {
+    return CompileRegexSet(patterns);
+  });
+}
+
+}  // namespace
+
+absl::Status RegexSetMatch::CheckWellFormed(
+    const v0::Intrinsic& intrinsic_pb) const {
+  if (!intrinsic_pb.static_parameter().has_struct_()) {
+    return absl::InvalidArgumentError("Expect regex patterns as struct.");
+  }
+  const v0::Struct& patterns = intrinsic_pb.static_parameter().struct_();
+  if (patterns.element_size() == 0) {
+    return absl::InvalidArgumentError("Expect at least one regex pattern.");
+  }
+  for (const v0::Value& pattern : patterns.element()) {
+    if (!pattern.has_str()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Expect regex patterns as str, got ", pattern.DebugString()));
+    }
+  }
+  return GetCompiledRegexSet(patterns).status();
+}
+
+absl::Status RegexSetMatch::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
+                                        const v0::Value& arg,
+                                        v0::Value* result,
+                                        Context* context) const {
+  const v0::Struct& patterns = intrinsic_pb.static_parameter().struct_();
+  std::shared_ptr<const RE2::Set> regex_set =
+      GENC_TRY(GetCompiledRegexSet(patterns));
+  std::vector<int> matches;
+  RE2::Set::ErrorInfo error_info;
+  // Also false if nothing matched, which isn't an error.
+  if (!regex_set->Match(arg.str(), &matches, &error_info) &&
+      error_info.kind != RE2::Set::kNoError) {
+    return absl::InternalError(absl::StrCat(
+        "Failed to match the regex set, error kind: ", error_info.kind));
+  }
+  std::vector<bool> matched(patterns.element_size(), false);
+  for (int index : matches) {
+    matched[index] = true;
+  }
+  v0::Struct* result_struct = result->mutable_struct_();
+  for (int index = 0; index < patterns.element_size(); ++index) {
+    v0::Value* element = result_struct->add_element();
+    if (!patterns.element(index).label().empty()) {
+      element->set_label(patterns.element(index).label());
+    }
+    element->set_boolean(matched[index]);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace intrinsics
+}  // namespace genc
@@ -0,0 +1,89 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/intrinsics/regex_set_match.h"
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace intrinsics {
+namespace {
+
+TEST(RegexSetMatchTest, MatchesEveryPattern) {
+  v0::Value matcher_pb =
+      CreateRegexSetMatch({"Finish\\[", "Math\\[", "[Ss]earch"}).value();
+  RegexSetMatch handler;
+  ASSERT_TRUE(handler.CheckWellFormed(matcher_pb.intrinsic()).ok());
+
+  v0::Value arg;
+  arg.set_str("Thought: look it up.\nAction: Search[x] then Math[1+1]");
+  v0::Value result;
+  ASSERT_TRUE(
+      handler.ExecuteCall(matcher_pb.intrinsic(), arg, &result, nullptr).ok());
+  ASSERT_EQ(result.struct_().element_size(), 3);
+  EXPECT_FALSE(result.struct_().element(0).boolean());
+  EXPECT_TRUE(result.struct_().element(1).boolean());
+  EXPECT_TRUE(result.struct_().element(2).boolean());
+}
+
+TEST(RegexSetMatchTest, MatchesNoPattern) {
+  v0::Value matcher_pb = CreateRegexSetMatch({"yes", "no"}).value();
+  v0::Value arg;
+  arg.set_str("maybe");
+  v0::Value result;
+  ASSERT_TRUE(RegexSetMatch()
+                  .ExecuteCall(matcher_pb.intrinsic(), arg, &result, nullptr)
+                  .ok());
+  ASSERT_EQ(result.struct_().element_size(), 2);
+  EXPECT_FALSE(result.struct_().element(0).boolean());
+  EXPECT_FALSE(result.struct_().element(1).boolean());
+}
+
+TEST(RegexSetMatchTest, KeepsPatternLabels) {
+  v0::Value matcher_pb = CreateRegexSetMatch({"yes", "no"}).value();
+  v0::Struct* patterns = matcher_pb.mutable_intrinsic()
+                             ->mutable_static_parameter()
+                             ->mutable_struct_();
+  patterns->mutable_element(0)->set_label("accept");
+  patterns->mutable_element(1)->set_label("reject");
+
+  v0::Value arg;
+  arg.set_str("yes");
+  v0::Value result;
+  ASSERT_TRUE(RegexSetMatch()
+                  .ExecuteCall(matcher_pb.intrinsic(), arg, &result, nullptr)
+                  .ok());
+  EXPECT_EQ(result.struct_().element(0).label(), "accept");
+  EXPECT_TRUE(result.struct_().element(0).boolean());
+  EXPECT_EQ(result.struct_().element(1).label(), "reject");
+  EXPECT_FALSE(result.struct_().element(1).boolean());
+}
+
+TEST(RegexSetMatchTest, RejectsInvalidPatterns) {
+  RegexSetMatch handler;
+  EXPECT_EQ(handler
+                .CheckWellFormed(
+                    CreateRegexSetMatch({"ok", "a(b"}).value().intrinsic())
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_FALSE(CreateRegexSetMatch({}).ok());
+}
+
+}  // namespace
+}  // namespace intrinsics
+}  // namespace genc
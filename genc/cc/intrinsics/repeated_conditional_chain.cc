@@ -12,18 +12,90 @@ limitations under the License
 
 #include "genc/cc/intrinsics/repeated_conditional_chain.h"
 
+#include <memory>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 namespace intrinsics {
+namespace {
+
+// Drives a single asynchronous repeated conditional chain. Each body function
+// is materialized through a continuation rather than a blocking call.
+class AsyncRepeatedChain
+    : public std::enable_shared_from_this<AsyncRepeatedChain> {
+ public:
+  using Context = ControlFlowIntrinsicHandlerInterface::Context;
+  using ValueRef = ControlFlowIntrinsicHandlerInterface::ValueRef;
+
+  AsyncRepeatedChain(int num_steps, std::vector<ValueRef> body_fns,
+                     std::shared_ptr<Context> context)
+      : num_steps_(num_steps),
+        body_fns_(std::move(body_fns)),
+        context_(std::move(context)),
+        result_(std::make_shared<Promise<ValueRef>>()) {}
+
+  std::shared_ptr<FutureInterface<ValueRef>> result() const { return result_; }
+
+  // Runs body function `fn_index` of iteration `step` on `state`.
+  void Step(int step, size_t fn_index, ValueRef state) {
+    if (fn_index == body_fns_.size()) {
+      step += 1;
+      fn_index = 0;
+    }
+    if (step >= num_steps_ || body_fns_.empty()) {
+      result_->Set(std::move(state));
+      return;
+    }
+    absl::StatusOr<ValueRef> fn_val =
+        context_->CreateCall(body_fns_[fn_index], state);
+    if (!fn_val.ok()) {
+      result_->Set(fn_val.status());
+      return;
+    }
+    context_->concurrency_interface()->Then(
+        context_->MaterializeAsync(*std::move(fn_val)),
+        [self = shared_from_this(), step, fn_index,
+         state](absl::StatusOr<v0::Value> next_state_pb) -> absl::Status {
+          absl::Status status =
+              self->Continue(step, fn_index, state, std::move(next_state_pb));
+          if (!status.ok()) {
+            self->result_->Set(status);
+          }
+          return status;
+        });
+  }
+
+ private:
+  absl::Status Continue(int step, size_t fn_index, ValueRef state,
+                        absl::StatusOr<v0::Value> next_state_or) {
+    v0::Value next_state_pb = GENC_TRY(std::move(next_state_or));
+    if (!next_state_pb.has_boolean()) {
+      state = GENC_TRY(context_->CreateValue(next_state_pb));
+    } else if (next_state_pb.boolean()) {
+      result_->Set(std::move(state));
+      return absl::OkStatus();
+    }
+    Step(step, fn_index + 1, std::move(state));
+    return absl::OkStatus();
+  }
+
+  const int num_steps_;
+  const std::vector<ValueRef> body_fns_;
+  const std::shared_ptr<Context> context_;
+  const std::shared_ptr<Promise<ValueRef>> result_;
+};
+
+}  // namespace
 
 absl::Status RepeatedConditionalChain::CheckWellFormed(
     const v0::Intrinsic& intrinsic_pb) const {
@@ -75,5 +147,26 @@ RepeatedConditionalChain::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
   return state;
 }
 
+std::shared_ptr<FutureInterface<ControlFlowIntrinsicHandlerInterface::ValueRef>>
+RepeatedConditionalChain::ExecuteCallAsync(
+    const v0::Intrinsic& intrinsic_pb, std::optional<ValueRef> arg,
+    std::shared_ptr<Context> context) const {
+  int num_steps = intrinsic_pb.static_parameter().struct_().element(0).int_32();
+  auto params = intrinsic_pb.static_parameter().struct_().element();
+  std::vector<ValueRef> body_fns_ref;
+  // First param is reserved for num_steps
+  for (auto it = params.begin() + 1; it != params.end(); it++) {
+    absl::StatusOr<ValueRef> body_fn = context->CreateValue(*it);
+    if (!body_fn.ok()) {
+      return MakeReadyFuture<ValueRef>(body_fn.status());
+    }
+    body_fns_ref.push_back(*std::move(body_fn));
+  }
+  auto chain = std::make_shared<AsyncRepeatedChain>(
+      num_steps, std::move(body_fns_ref), std::move(context));
+  chain->Step(0, 0, arg.value());
+  return chain->result();
+}
+
 }  // namespace intrinsics
 }  // namespace genc
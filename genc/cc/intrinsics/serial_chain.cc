@@ -12,16 +12,67 @@ limitations under the License
 
 #include "genc/cc/intrinsics/serial_chain.h"
 
+#include <memory>
 #include <optional>
+#include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 namespace intrinsics {
+namespace {
+
+// Drives a single asynchronous chain, calling each function once the output
+// of the previous one is ready.
+class AsyncChain : public std::enable_shared_from_this<AsyncChain> {
+ public:
+  using Context = ControlFlowIntrinsicHandlerInterface::Context;
+  using ValueRef = ControlFlowIntrinsicHandlerInterface::ValueRef;
+
+  AsyncChain(std::vector<ValueRef> fns, std::shared_ptr<Context> context)
+      : fns_(std::move(fns)),
+        context_(std::move(context)),
+        result_(std::make_shared<Promise<ValueRef>>()) {}
+
+  std::shared_ptr<FutureInterface<ValueRef>> result() const { return result_; }
+
+  // Calls the function at `index` on `state` once `state` is ready.
+  void Step(size_t index, ValueRef state) {
+    if (index == fns_.size()) {
+      result_->Set(std::move(state));
+      return;
+    }
+    context_->concurrency_interface()->Then(
+        context_->WhenReady(std::move(state)),
+        [self = shared_from_this(),
+         index](absl::StatusOr<ValueRef> state) -> absl::Status {
+          absl::Status status = self->Call(index, std::move(state));
+          if (!status.ok()) {
+            self->result_->Set(status);
+          }
+          return status;
+        });
+  }
+
+ private:
+  absl::Status Call(size_t index, absl::StatusOr<ValueRef> state_or) {
+    ValueRef state = GENC_TRY(std::move(state_or));
+    Step(index + 1, GENC_TRY(context_->CreateCall(fns_[index], state)));
+    return absl::OkStatus();
+  }
+
+  const std::vector<ValueRef> fns_;
+  const std::shared_ptr<Context> context_;
+  const std::shared_ptr<Promise<ValueRef>> result_;
+};
+
+}  // namespace
 
 absl::Status SerialChain::CheckWellFormed(
     const v0::Intrinsic& intrinsic_pb) const {
@@ -47,5 +98,22 @@ SerialChain::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
   return state;
 }
 
+std::shared_ptr<FutureInterface<ControlFlowIntrinsicHandlerInterface::ValueRef>>
+SerialChain::ExecuteCallAsync(const v0::Intrinsic& intrinsic_pb,
+                              std::optional<ValueRef> arg,
+                              std::shared_ptr<Context> context) const {
+  std::vector<ValueRef> fns;
+  for (const auto& fn : intrinsic_pb.static_parameter().struct_().element()) {
+    absl::StatusOr<ValueRef> fn_ref = context->CreateValue(fn);
+    if (!fn_ref.ok()) {
+      return MakeReadyFuture<ValueRef>(fn_ref.status());
+    }
+    fns.push_back(*std::move(fn_ref));
+  }
+  auto chain = std::make_shared<AsyncChain>(std::move(fns), std::move(context));
+  chain->Step(0, arg.value());
+  return chain->result();
+}
+
 }  // namespace intrinsics
 }  // namespace genc
@@ -10,11 +10,13 @@ See the License for the specific language governing permissions and
 limitations under the License
 ==============================================================================*/
 
+#include <memory>
 #include <optional>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "genc/cc/intrinsics/intrinsic_uris.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/proto/v0/computation.pb.h"
 
@@ -31,6 +33,9 @@ class SerialChain : public ControlFlowIntrinsicHandlerBase {
   absl::StatusOr<ValueRef> ExecuteCall(const v0::Intrinsic& intrinsic_pb,
                                        std::optional<ValueRef> arg,
                                        Context* context) const final;
+  std::shared_ptr<FutureInterface<ValueRef>> ExecuteCallAsync(
+      const v0::Intrinsic& intrinsic_pb, std::optional<ValueRef> arg,
+      std::shared_ptr<Context> context) const final;
 };
 }  // namespace intrinsics
 }  // namespace genc
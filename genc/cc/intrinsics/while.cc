@@ -15,17 +15,89 @@ limitations under the License
 
 #include "genc/cc/intrinsics/while.h"
 
+#include <memory>
 #include <optional>
+#include <utility>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 namespace intrinsics {
+namespace {
+
+// Drives a single asynchronous `While` loop. Each step is scheduled as a
+// continuation of the values it depends on, so no thread is held while the
+// loop waits on the condition or the body.
+class AsyncWhileLoop : public std::enable_shared_from_this<AsyncWhileLoop> {
+ public:
+  using Context = ControlFlowIntrinsicHandlerInterface::Context;
+  using ValueRef = ControlFlowIntrinsicHandlerInterface::ValueRef;
+
+  AsyncWhileLoop(ValueRef condition_fn, ValueRef body_fn,
+                 std::shared_ptr<Context> context)
+      : condition_fn_(std::move(condition_fn)),
+        body_fn_(std::move(body_fn)),
+        context_(std::move(context)),
+        result_(std::make_shared<Promise<ValueRef>>()) {}
+
+  std::shared_ptr<FutureInterface<ValueRef>> result() const { return result_; }
+
+  // Evaluates the condition on `state` once `state` is ready.
+  void Step(ValueRef state) {
+    context_->concurrency_interface()->Then(
+        context_->WhenReady(std::move(state)),
+        [self = shared_from_this()](absl::StatusOr<ValueRef> state) {
+          return self->SetIfError(self->CheckCondition(std::move(state)));
+        });
+  }
+
+ private:
+  absl::Status CheckCondition(absl::StatusOr<ValueRef> state_or) {
+    ValueRef state = GENC_TRY(std::move(state_or));
+    ValueRef condition_val =
+        GENC_TRY(context_->CreateCall(condition_fn_, state));
+    context_->concurrency_interface()->Then(
+        context_->MaterializeAsync(condition_val),
+        [self = shared_from_this(), state](absl::StatusOr<v0::Value> cond_pb) {
+          return self->SetIfError(self->Continue(state, std::move(cond_pb)));
+        });
+    return absl::OkStatus();
+  }
+
+  absl::Status Continue(ValueRef state, absl::StatusOr<v0::Value> cond_pb_or) {
+    v0::Value cond_pb = GENC_TRY(std::move(cond_pb_or));
+    if (!cond_pb.has_boolean()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Condition does not have boolean: ", cond_pb.DebugString()));
+    }
+    if (!cond_pb.boolean()) {
+      result_->Set(std::move(state));
+      return absl::OkStatus();
+    }
+    Step(GENC_TRY(context_->CreateCall(body_fn_, state)));
+    return absl::OkStatus();
+  }
+
+  absl::Status SetIfError(absl::Status status) {
+    if (!status.ok()) {
+      result_->Set(status);
+    }
+    return status;
+  }
+
+  const ValueRef condition_fn_;
+  const ValueRef body_fn_;
+  const std::shared_ptr<Context> context_;
+  const std::shared_ptr<Promise<ValueRef>> result_;
+};
+
+}  // namespace
 
 absl::Status While::CheckWellFormed(const v0::Intrinsic& intrinsic_pb) const {
   if (intrinsic_pb.static_parameter().struct_().element_size() != 2) {
@@ -66,5 +138,25 @@ While::ExecuteCall(const v0::Intrinsic& intrinsic_pb,
   return state;
 }
 
+std::shared_ptr<FutureInterface<ControlFlowIntrinsicHandlerInterface::ValueRef>>
+While::ExecuteCallAsync(const v0::Intrinsic& intrinsic_pb,
+                        std::optional<ValueRef> arg,
+                        std::shared_ptr<Context> context) const {
+  absl::StatusOr<ValueRef> condition_fn =
+      context->CreateValue(intrinsic_pb.static_parameter().struct_().element(0));
+  if (!condition_fn.ok()) {
+    return MakeReadyFuture<ValueRef>(condition_fn.status());
+  }
+  absl::StatusOr<ValueRef> body_fn =
+      context->CreateValue(intrinsic_pb.static_parameter().struct_().element(1));
+  if (!body_fn.ok()) {
+    return MakeReadyFuture<ValueRef>(body_fn.status());
+  }
+  auto loop = std::make_shared<AsyncWhileLoop>(
+      *std::move(condition_fn), *std::move(body_fn), std::move(context));
+  loop->Step(arg.value());
+  return loop->result();
+}
+
 }  // namespace intrinsics
 }  // namespace genc
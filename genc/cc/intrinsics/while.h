@@ -16,11 +16,13 @@ limitations under the License
 #ifndef GENC_CC_INTRINSICS_WHILE_H_
 #define GENC_CC_INTRINSICS_WHILE_H_
 
+#include <memory>
 #include <optional>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "genc/cc/intrinsics/intrinsic_uris.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/proto/v0/computation.pb.h"
 
@@ -38,6 +40,10 @@ class While : public ControlFlowIntrinsicHandlerBase {
   absl::StatusOr<ValueRef> ExecuteCall(const v0::Intrinsic& intrinsic_pb,
                                        std::optional<ValueRef> arg,
                                        Context* context) const final;
+
+  std::shared_ptr<FutureInterface<ValueRef>> ExecuteCallAsync(
+      const v0::Intrinsic& intrinsic_pb, std::optional<ValueRef> arg,
+      std::shared_ptr<Context> context) const final;
 };
 }  // namespace intrinsics
 }  // namespace genc
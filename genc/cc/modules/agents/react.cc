@@ -17,22 +17,35 @@ limitations under the License
 
 #include <cstddef>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "genc/cc/intrinsics/custom_function.h"
+#include "genc/cc/intrinsics/regex_cache.h"
+#include "genc/cc/runtime/status_macros.h"
 #include "re2/re2.h"
 namespace genc {
 
-absl::StatusOr<v0::Value> ReAct::ExtractPythonCode(v0::Value input) {
-  RE2::Options options;
+namespace {
+
+// Options for patterns in which `.` also matches a newline.
+RE2::Options DotNlOptions() {
+  RE2::Options options(RE2::Quiet);
   options.set_dot_nl(true);
-  RE2 code_block_regex(R"(```python(.*?)```)", options);
+  return options;
+}
+
+}  // namespace
+
+absl::StatusOr<v0::Value> ReAct::ExtractPythonCode(v0::Value input) {
+  std::shared_ptr<const RE2> code_block_regex = GENC_TRY(
+      intrinsics::GetCompiledRegex(R"(```python(.*?)```)", DotNlOptions()));
 
   std::string output;
-  if (RE2::PartialMatch(input.str(), code_block_regex, &output)) {
+  if (RE2::PartialMatch(input.str(), *code_block_regex, &output)) {
   } else {
     std::cout << "No Python code block found in the input." << std::endl;
   }
@@ -48,12 +61,12 @@ absl::StatusOr<v0::Value> ReAct::ExtractPythonCode(v0::Value input) {
 }
 
 absl::StatusOr<v0::Value> ReAct::ExtractJsCode(v0::Value input) {
-  RE2::Options options;
-  options.set_dot_nl(true);
-  RE2 code_block_regex(R"(```(?:javascript|js)?(.*?)```)", options);
+  std::shared_ptr<const RE2> code_block_regex =
+      GENC_TRY(intrinsics::GetCompiledRegex(R"(```(?:javascript|js)?(.*?)```)",
+                                            DotNlOptions()));
 
   std::string output;
-  if (RE2::PartialMatch(input.str(), code_block_regex, &output)) {
+  if (RE2::PartialMatch(input.str(), *code_block_regex, &output)) {
   } else {
     std::cout << "No JS code block found in the input. input:" << input.str()
               << std::endl;
@@ -70,9 +83,10 @@ absl::StatusOr<v0::Value> ReAct::ExtractJsCode(v0::Value input) {
 }
 
 absl::StatusOr<v0::Value> ReAct::ExtractMathQuestion(v0::Value input) {
-  RE2 math_pattern("Math\\[(.*?)\\]", RE2::Quiet);
+  std::shared_ptr<const RE2> math_pattern =
+      GENC_TRY(intrinsics::GetCompiledRegex("Math\\[(.*?)\\]"));
   std::string math_question;
-  RE2::PartialMatch(input.str(), math_pattern, &math_question);
+  RE2::PartialMatch(input.str(), *math_pattern, &math_question);
 
   v0::Value result;
   result.set_str(math_question);
@@ -92,11 +106,12 @@ std::string BeforeFirstObservationOrOriginalText(const std::string& text) {
 }
 
 // Extract "Finish[...]" from llm output. If not found reutrn empty string.
-std::string ExtractFinish(const std::string& text) {
-  RE2 pattern("(Finish\\[.*?\\])");
+absl::StatusOr<std::string> ExtractFinish(const std::string& text) {
+  std::shared_ptr<const RE2> pattern =
+      GENC_TRY(intrinsics::GetCompiledRegex("(Finish\\[.*?\\])"));
   std::string match;
   // Search for the pattern in the text
-  if (RE2::PartialMatch(text, pattern, &match)) {
+  if (RE2::PartialMatch(text, *pattern, &match)) {
     return match;
   }
   return "";
@@ -107,14 +122,16 @@ std::string ExtractFinish(const std::string& text) {
 absl::StatusOr<v0::Value> ReAct::ParseThoughtAction(v0::Value input) {
   std::string sanitized_input =
       BeforeFirstObservationOrOriginalText(input.str());
-  RE2 thought_pattern("Thought:\\s*(?:\n)?(.*?)\n", RE2::Quiet);
-  RE2 action_pattern("Action:\\s*(?:\n)?([^\\n]+)", RE2::Quiet);
+  std::shared_ptr<const RE2> thought_pattern = GENC_TRY(
+      intrinsics::GetCompiledRegex("Thought:\\s*(?:\n)?(.*?)\n"));
+  std::shared_ptr<const RE2> action_pattern = GENC_TRY(
+      intrinsics::GetCompiledRegex("Action:\\s*(?:\n)?([^\\n]+)"));
 
   std::string thought;
   std::string action;
-  RE2::PartialMatch(sanitized_input, thought_pattern, &thought);
-  if (!RE2::PartialMatch(sanitized_input, action_pattern, &action)) {
-    action = ExtractFinish(sanitized_input);
+  RE2::PartialMatch(sanitized_input, *thought_pattern, &thought);
+  if (!RE2::PartialMatch(sanitized_input, *action_pattern, &action)) {
+    action = GENC_TRY(ExtractFinish(sanitized_input));
   }
 
   std::string thought_action =
@@ -35,15 +35,15 @@ absl::StatusOr<v0::Value> GeminiParser::GetTopCandidateAsText(v0::Value input) {
         "Failed parsing json output from Gemini: $0", input.DebugString()));
   }
 
-  std::string extract_first_candidate_as_text =
+  // Parsed once, on first use, by the shared environment.
+  constexpr char kExtractFirstCandidateAsText[] =
       "{% if candidates %}{% for p in candidates.0.content.parts "
       "%}{{p.text}}{% endfor %}{%   endif %}";
 
-  inja_status_or::Environment env;
-
   v0::Value result;
-  std::string result_str =
-      GENC_TRY(env.render(extract_first_candidate_as_text, parsed_json));
+  std::string result_str = GENC_TRY(
+      inja_status_or::SharedEnvironment::Default().render(
+          kExtractFirstCandidateAsText, parsed_json));
   result.set_str(result_str);
   return result;
 }
@@ -15,17 +15,28 @@ limitations under the License
 
 #include "genc/cc/modules/templates/inja_status_or.h"
 
+#include <cstddef>
 #include <exception>
+#include <memory>
 #include <string>
 #include <string_view>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "genc/cc/runtime/status_macros.h"
 #include <inja/inja.hpp>
 #include <nlohmann/json.hpp>
 
 namespace inja_status_or {
+namespace {
+
+// The number of distinct templates the default environment keeps parsed.
+constexpr size_t kDefaultTemplateCapacity = 256;
+
+}  // namespace
 
 absl::StatusOr<std::string> Environment::render(std::string_view input,
                                                 const nlohmann::json& data) {
@@ -37,4 +48,46 @@ absl::StatusOr<std::string> Environment::render(std::string_view input,
     return absl::InternalError("Render: something went wrong.");
   }
 }
+
+absl::StatusOr<inja::Template> Environment::parse(std::string_view input) {
+  try {
+    return inja::Environment::parse(input);
+  } catch (const std::exception& e) {
+    return absl::InternalError(absl::StrCat("Parse: ", e.what()));
+  } catch (...) {
+    return absl::InternalError("Parse: something went wrong.");
+  }
+}
+
+absl::StatusOr<std::string> Environment::render(const inja::Template& tmpl,
+                                                const nlohmann::json& data) {
+  try {
+    return inja::Environment::render(tmpl, data);
+  } catch (const std::exception& e) {
+    return absl::InternalError(absl::StrCat("Render: ", e.what()));
+  } catch (...) {
+    return absl::InternalError("Render: something went wrong.");
+  }
+}
+
+SharedEnvironment& SharedEnvironment::Default() {
+  static SharedEnvironment* env =
+      new SharedEnvironment(kDefaultTemplateCapacity);
+  return *env;
+}
+
+SharedEnvironment::SharedEnvironment(size_t capacity) : templates_(capacity) {}
+
+absl::StatusOr<std::string> SharedEnvironment::render(
+    std::string_view input, const nlohmann::json& data) {
+  std::shared_ptr<const inja::Template> tmpl =
+      GENC_TRY(templates_.GetOrCreate(
+          absl::string_view(input.data(), input.size()),
+          [this](absl::string_view key) -> absl::StatusOr<inja::Template> {
+            absl::MutexLock lock(&mutex_);
+            return env_.parse(std::string_view(key.data(), key.size()));
+          }));
+  absl::ReaderMutexLock lock(&mutex_);
+  return env_.render(*tmpl, data);
+}
 }  // namespace inja_status_or
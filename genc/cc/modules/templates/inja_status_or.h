@@ -16,11 +16,16 @@ limitations under the License
 #ifndef GENC_CC_MODULES_TEMPLATES_INJA_STATUS_OR_H_
 #define GENC_CC_MODULES_TEMPLATES_INJA_STATUS_OR_H_
 
+#include <cstddef>
 #include <ostream>
 #include <string>
+#include <string_view>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "genc/cc/runtime/bounded_cache.h"
 #include <inja/inja.hpp>
 #include <nlohmann/json.hpp>
 
@@ -30,6 +35,35 @@ class Environment : public inja::Environment {
  public:
   absl::StatusOr<std::string> render(std::string_view input,
                                      const nlohmann::json& data);
+
+  absl::StatusOr<inja::Template> parse(std::string_view input);
+
+  absl::StatusOr<std::string> render(const inja::Template& tmpl,
+                                     const nlohmann::json& data);
+};
+
+// An environment that can be shared across threads, and that parses each
+// distinct template once, keeping the most recent ones for later calls.
+class SharedEnvironment {
+ public:
+  // The environment shared by the whole process.
+  static SharedEnvironment& Default();
+
+  // Keeps up to `capacity` parsed templates.
+  explicit SharedEnvironment(size_t capacity);
+
+  SharedEnvironment(const SharedEnvironment&) = delete;
+  SharedEnvironment& operator=(const SharedEnvironment&) = delete;
+
+  absl::StatusOr<std::string> render(std::string_view input,
+                                     const nlohmann::json& data);
+
+ private:
+  // Parsing may add included templates to the environment, so it excludes
+  // rendering, which only reads it.
+  absl::Mutex mutex_;
+  Environment env_ ABSL_GUARDED_BY(mutex_);
+  genc::BoundedCache<inja::Template> templates_;
 };
 }  // namespace inja_status_or
 
@@ -26,8 +26,11 @@ limitations under the License
 #include "genc/cc/runtime/executor.h"
 #include "genc/cc/runtime/executor_service.h"
 #include "genc/cc/runtime/status_macros.h"
+#include "genc/cc/runtime/threading.h"
 #include "genc/proto/v0/executor.grpc.pb.h"
 #include "genc/proto/v0/executor.pb.h"
+#include "include/grpc/grpc.h"
+#include "include/grpcpp/resource_quota.h"
 #include "include/grpcpp/security/server_credentials.h"
 #include "include/grpcpp/server.h"
 #include "include/grpcpp/server_builder.h"
@@ -54,27 +57,68 @@ absl::StatusOr<std::shared_ptr<grpc::ServerCredentials>> GetCreds(
   return absl::InvalidArgumentError("Unsupported channel type");
 }
 
+void ApplySizing(const RunServerOptions& opt, grpc::ServerBuilder* builder) {
+  if (opt.max_threads > 0) {
+    grpc::ResourceQuota quota("genc_worker");
+    quota.SetMaxThreads(opt.max_threads);
+    builder->SetResourceQuota(quota);
+  }
+  if (opt.num_completion_queues > 0) {
+    builder->SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::NUM_CQS,
+                                 opt.num_completion_queues);
+  }
+  if (opt.min_pollers > 0) {
+    builder->SetSyncServerOption(
+        grpc::ServerBuilder::SyncServerOption::MIN_POLLERS, opt.min_pollers);
+  }
+  if (opt.max_pollers > 0) {
+    builder->SetSyncServerOption(
+        grpc::ServerBuilder::SyncServerOption::MAX_POLLERS, opt.max_pollers);
+  }
+  if (opt.max_concurrent_streams > 0) {
+    builder->AddChannelArgument(GRPC_ARG_MAX_CONCURRENT_STREAMS,
+                                opt.max_concurrent_streams);
+  }
+}
+
 }  // namespace
 
 absl::Status RunServer(
     std::shared_ptr<Executor> executor, const RunServerOptions& options) {
+  if (options.use_callback_service && !options.use_oak &&
+      (options.num_completion_queues > 0 || options.min_pollers > 0 ||
+       options.max_pollers > 0)) {
+    return absl::InvalidArgumentError(
+        "Completion queues and pollers only apply to the synchronous "
+        "service; set use_callback_service to false to configure them.");
+  }
   std::shared_ptr<grpc::ServerCredentials> creds = GENC_TRY(GetCreds(options));
   std::shared_ptr<v0::Executor::Service> executor_service =
-      GENC_TRY(CreateExecutorService(executor));
+      GENC_TRY(CreateExecutorService(executor, options.compression));
   grpc::ServerBuilder builder;
   builder.AddListeningPort(options.server_address, creds);
+  ApplySizing(options, &builder);
   std::shared_ptr<oak::session::v1::UnarySession::Service> oak_service;
+  std::shared_ptr<v0::Executor::CallbackService> callback_service;
   if (options.use_oak) {
     if (options.debug) {
       std::cout << "Exposing Oak's UnarySession service.\n";
     }
     oak_service = GENC_TRY(interop::oak::CreateService(
-        executor_service,
+        executor,
         GENC_TRY(
             interop::confidential_computing::CreateAttestationProvider(
                 options.debug)),
         options.debug));
     builder.RegisterService(oak_service.get());
+  } else if (options.use_callback_service) {
+    if (options.debug) {
+      std::cout << "Exposing the callback Executor service.\n";
+    }
+    callback_service = GENC_TRY(CreateCallbackExecutorService(
+        executor, CreateWorkStealingConcurrencyManager(),
+        options.compression));
+    builder.RegisterService(callback_service.get());
   } else {
     if (options.debug) {
       std::cout << "Exposing the regular Executor service.\n";
@@ -20,6 +20,7 @@ limitations under the License
 #include <string>
 
 #include "absl/status/status.h"
+#include "genc/cc/runtime/compression.h"
 #include "genc/cc/runtime/executor.h"
 
 namespace genc {
@@ -37,6 +38,31 @@ struct RunServerOptions {
   std::string ssl_key_path;
   bool use_oak = false;
   bool debug = false;
+
+  // Whether to serve with gRPC's callback API, which parks materializations
+  // until their values are ready rather than holding a thread for each. Calls
+  // that may block run on a work-stealing pool of the default size. Not
+  // supported with Oak, which calls into the synchronous service.
+  bool use_callback_service = true;
+
+  // The maximum number of threads used by the server, or 0 for no limit.
+  int max_threads = 0;
+
+  // The number of completion queues, and the minimum and maximum number of
+  // threads polling each, for the synchronous service (or Oak's). 0 keeps the
+  // defaults. Setting them with `use_callback_service` is an error, since the
+  // callback service doesn't poll.
+  int num_completion_queues = 0;
+  int min_pollers = 0;
+  int max_pollers = 0;
+
+  // The maximum number of calls in progress on each client connection, beyond
+  // which further calls queue up on the client, or 0 for gRPC's default.
+  int max_concurrent_streams = 0;
+
+  // How to compress the values sent back to clients. Not applied with Oak,
+  // whose messages are encrypted.
+  CompressionOptions compression;
 };
 
 absl::Status RunServer(
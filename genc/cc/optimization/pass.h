@@ -0,0 +1,37 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_OPTIMIZATION_PASS_H_
+#define GENC_CC_OPTIMIZATION_PASS_H_
+
+#include "absl/strings/string_view.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+
+// A rewrite of a computation that preserves its result.
+class Pass {
+ public:
+  virtual ~Pass() {}
+
+  virtual absl::string_view name() const = 0;
+
+  // Rewrites `value_pb` in place. Returns whether anything was changed.
+  virtual bool Run(v0::Value* value_pb) const = 0;
+};
+
+}  // namespace genc
+
+#endif  // GENC_CC_OPTIMIZATION_PASS_H_
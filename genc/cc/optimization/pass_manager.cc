@@ -0,0 +1,49 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/optimization/pass_manager.h"
+
+#include <memory>
+
+#include "genc/cc/optimization/passes.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+
+bool PassManager::Run(v0::Value* value_pb) const {
+  bool changed = false;
+  for (int i = 0; i < max_iterations_; ++i) {
+    bool changed_in_iteration = false;
+    for (const std::unique_ptr<Pass>& pass : passes_) {
+      changed_in_iteration |= pass->Run(value_pb);
+    }
+    if (!changed_in_iteration) {
+      break;
+    }
+    changed = true;
+  }
+  return changed;
+}
+
+std::shared_ptr<PassManager> CreateDefaultPassManager() {
+  auto pass_manager = std::make_shared<PassManager>();
+  pass_manager->AddPass(CreateLambdaInliningPass());
+  pass_manager->AddPass(CreateConstantFoldingPass());
+  pass_manager->AddPass(CreateCommonSubexpressionEliminationPass());
+  pass_manager->AddPass(CreateDeadLocalEliminationPass());
+  return pass_manager;
+}
+
+}  // namespace genc
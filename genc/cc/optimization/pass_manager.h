@@ -0,0 +1,54 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_OPTIMIZATION_PASS_MANAGER_H_
+#define GENC_CC_OPTIMIZATION_PASS_MANAGER_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "genc/cc/optimization/pass.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+
+// Runs a sequence of passes over a computation before it is executed.
+class PassManager {
+ public:
+  // Runs the whole sequence at most `max_iterations` times, stopping early
+  // once an iteration leaves the computation unchanged.
+  explicit PassManager(int max_iterations = 8)
+      : max_iterations_(max_iterations) {}
+
+  void AddPass(std::unique_ptr<Pass> pass) {
+    passes_.push_back(std::move(pass));
+  }
+
+  // Rewrites `value_pb` in place. Returns whether anything was changed.
+  bool Run(v0::Value* value_pb) const;
+
+ private:
+  const int max_iterations_;
+  std::vector<std::unique_ptr<Pass>> passes_;
+};
+
+// Returns a pass manager that inlines trivial lambdas, folds constants,
+// eliminates common subexpressions and drops unused locals.
+std::shared_ptr<PassManager> CreateDefaultPassManager();
+
+}  // namespace genc
+
+#endif  // GENC_CC_OPTIMIZATION_PASS_MANAGER_H_
@@ -0,0 +1,116 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/optimization/pass_manager.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/cc/optimization/pass.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace {
+
+// Replaces a `str` with a shorter one, one character at a time.
+class TruncatePass : public Pass {
+ public:
+  absl::string_view name() const final { return "truncate"; }
+
+  bool Run(v0::Value* value_pb) const final {
+    if (!value_pb->has_str() || value_pb->str().empty()) {
+      return false;
+    }
+    value_pb->mutable_str()->pop_back();
+    return true;
+  }
+};
+
+TEST(PassManagerTest, RunsPassesUntilNothingChanges) {
+  PassManager pass_manager;
+  pass_manager.AddPass(std::make_unique<TruncatePass>());
+  v0::Value value_pb;
+  value_pb.set_str("abc");
+  EXPECT_TRUE(pass_manager.Run(&value_pb));
+  EXPECT_EQ(value_pb.str(), "");
+  EXPECT_FALSE(pass_manager.Run(&value_pb));
+}
+
+TEST(PassManagerTest, StopsAfterMaxIterations) {
+  PassManager pass_manager(/*max_iterations=*/2);
+  pass_manager.AddPass(std::make_unique<TruncatePass>());
+  v0::Value value_pb;
+  value_pb.set_str("abcd");
+  EXPECT_TRUE(pass_manager.Run(&value_pb));
+  EXPECT_EQ(value_pb.str(), "ab");
+}
+
+TEST(PassManagerTest, DefaultPipelineSimplifiesComputation) {
+  // x -> Block [t="Tokyo", p=(y -> y), q=prompt(t), unused=prompt(x),
+  //             a=model(p(q)), b=model(p(q))] -> <a,b>
+  // becomes x -> Block [q="Q: Tokyo", a=model(q), b=model(q)] -> <a,b>,
+  // with the model calls left as they are.
+  auto local = [](absl::string_view name, v0::Value value_pb) {
+    v0::Block::Local local_pb;
+    local_pb.set_name(std::string(name));
+    *local_pb.mutable_value() = std::move(value_pb);
+    return local_pb;
+  };
+  v0::Value tokyo_pb;
+  tokyo_pb.set_str("Tokyo");
+  v0::Value prompt_pb = CreatePromptTemplate("Q: {x}").value();
+  v0::Value model_pb = CreateModelInference("test_model").value();
+  v0::Value p_of_q =
+      CreateCall(CreateReference("p").value(), CreateReference("q").value())
+          .value();
+  v0::Value block_pb;
+  v0::Block* block = block_pb.mutable_block();
+  *block->add_local() = local("t", tokyo_pb);
+  *block->add_local() =
+      local("p", CreateLambda("y", CreateReference("y").value()).value());
+  *block->add_local() =
+      local("q", CreateCall(prompt_pb, CreateReference("t").value()).value());
+  *block->add_local() = local(
+      "unused", CreateCall(prompt_pb, CreateReference("x").value()).value());
+  *block->add_local() = local("a", CreateCall(model_pb, p_of_q).value());
+  *block->add_local() = local("b", CreateCall(model_pb, p_of_q).value());
+  *block->mutable_result() = CreateStruct({CreateReference("a").value(),
+                                           CreateReference("b").value()})
+                                 .value();
+  v0::Value computation_pb = CreateLambda("x", block_pb).value();
+
+  v0::Value expected_block_pb;
+  v0::Block* expected_block = expected_block_pb.mutable_block();
+  v0::Value folded_pb;
+  folded_pb.set_str("Q: Tokyo");
+  *expected_block->add_local() = local("q", folded_pb);
+  *expected_block->add_local() =
+      local("a", CreateCall(model_pb, CreateReference("q").value()).value());
+  *expected_block->add_local() =
+      local("b", CreateCall(model_pb, CreateReference("q").value()).value());
+  *expected_block->mutable_result() = block->result();
+  v0::Value expected_pb = CreateLambda("x", expected_block_pb).value();
+
+  EXPECT_TRUE(CreateDefaultPassManager()->Run(&computation_pb));
+  EXPECT_EQ(computation_pb.DebugString(), expected_pb.DebugString());
+}
+
+}  // namespace
+}  // namespace genc
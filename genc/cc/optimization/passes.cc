@@ -0,0 +1,843 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/optimization/passes.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "genc/cc/intrinsics/intrinsic_uris.h"
+#include "genc/cc/intrinsics/logical_not.h"
+#include "genc/cc/intrinsics/prompt_template.h"
+#include "genc/cc/optimization/pass.h"
+#include "genc/cc/runtime/intrinsic_handler.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace {
+
+using NameSet = absl::flat_hash_set<std::string>;
+using Rewrite = std::function<bool(v0::Value*)>;
+
+bool IsPureIntrinsic(absl::string_view uri) {
+  return uri == intrinsics::kLogicalNot || uri == intrinsics::kPromptTemplate ||
+         uri == intrinsics::kPromptTemplateWithParameters ||
+         uri == intrinsics::kRegexPartialMatch ||
+         uri == intrinsics::kRegexSetMatch;
+}
+
+// Whether evaluating `value_pb` has no side effects.
+bool IsPure(const v0::Value& value_pb) {
+  switch (value_pb.value_case()) {
+    case v0::Value::kCall: {
+      const v0::Call& call_pb = value_pb.call();
+      return call_pb.function().has_intrinsic() &&
+             IsPureIntrinsic(call_pb.function().intrinsic().uri()) &&
+             (!call_pb.has_argument() || IsPure(call_pb.argument()));
+    }
+    case v0::Value::kStruct: {
+      for (const v0::Value& element_pb : value_pb.struct_().element()) {
+        if (!IsPure(element_pb)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case v0::Value::kSelection: {
+      return IsPure(value_pb.selection().source());
+    }
+    case v0::Value::kBlock: {
+      for (const v0::Block::Local& local_pb : value_pb.block().local()) {
+        if (!IsPure(local_pb.value())) {
+          return false;
+        }
+      }
+      return IsPure(value_pb.block().result());
+    }
+    default: {
+      // Creating lambdas and intrinsics doesn't invoke them.
+      return true;
+    }
+  }
+}
+
+// Whether `value_pb` is made of literals only.
+bool IsConstant(const v0::Value& value_pb) {
+  switch (value_pb.value_case()) {
+    case v0::Value::kStr:
+    case v0::Value::kBoolean:
+    case v0::Value::kInt32:
+    case v0::Value::kFloat32:
+    case v0::Value::kMedia: {
+      return true;
+    }
+    case v0::Value::kStruct: {
+      for (const v0::Value& element_pb : value_pb.struct_().element()) {
+        if (!IsConstant(element_pb)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// Returns the names referenced in `value_pb` that are not bound within it.
+NameSet FreeReferences(const v0::Value& value_pb) {
+  NameSet names;
+  auto add = [&names](NameSet other) {
+    names.insert(other.begin(), other.end());
+  };
+  switch (value_pb.value_case()) {
+    case v0::Value::kReference: {
+      names.insert(value_pb.reference().name());
+      break;
+    }
+    case v0::Value::kCall: {
+      add(FreeReferences(value_pb.call().function()));
+      if (value_pb.call().has_argument()) {
+        add(FreeReferences(value_pb.call().argument()));
+      }
+      break;
+    }
+    case v0::Value::kStruct: {
+      for (const v0::Value& element_pb : value_pb.struct_().element()) {
+        add(FreeReferences(element_pb));
+      }
+      break;
+    }
+    case v0::Value::kSelection: {
+      add(FreeReferences(value_pb.selection().source()));
+      break;
+    }
+    case v0::Value::kLambda: {
+      add(FreeReferences(value_pb.lambda().result()));
+      names.erase(value_pb.lambda().parameter_name());
+      break;
+    }
+    case v0::Value::kBlock: {
+      const v0::Block& block_pb = value_pb.block();
+      add(FreeReferences(block_pb.result()));
+      for (int i = block_pb.local_size() - 1; i >= 0; --i) {
+        names.erase(block_pb.local(i).name());
+        add(FreeReferences(block_pb.local(i).value()));
+      }
+      break;
+    }
+    case v0::Value::kIntrinsic: {
+      add(FreeReferences(value_pb.intrinsic().static_parameter()));
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+  return names;
+}
+
+// Replaces `value_pb` with `replacement`, which may be nested in it.
+void Replace(v0::Value* value_pb, v0::Value* replacement) {
+  v0::Value detached = std::move(*replacement);
+  *value_pb = std::move(detached);
+}
+
+bool RewriteLambdaBodies(v0::Value* static_parameter_pb, const Rewrite& fn);
+
+// Applies `fn` to `value_pb` and to the values nested in it that are
+// evaluated as part of the computation, children first.
+bool RewriteBottomUp(v0::Value* value_pb, const Rewrite& fn) {
+  bool changed = false;
+  switch (value_pb->value_case()) {
+    case v0::Value::kCall: {
+      changed |= RewriteBottomUp(value_pb->mutable_call()->mutable_function(),
+                                 fn);
+      if (value_pb->call().has_argument()) {
+        changed |= RewriteBottomUp(
+            value_pb->mutable_call()->mutable_argument(), fn);
+      }
+      break;
+    }
+    case v0::Value::kStruct: {
+      for (v0::Value& element_pb :
+           *value_pb->mutable_struct_()->mutable_element()) {
+        changed |= RewriteBottomUp(&element_pb, fn);
+      }
+      break;
+    }
+    case v0::Value::kSelection: {
+      changed |= RewriteBottomUp(
+          value_pb->mutable_selection()->mutable_source(), fn);
+      break;
+    }
+    case v0::Value::kLambda: {
+      changed |=
+          RewriteBottomUp(value_pb->mutable_lambda()->mutable_result(), fn);
+      break;
+    }
+    case v0::Value::kBlock: {
+      for (v0::Block::Local& local_pb :
+           *value_pb->mutable_block()->mutable_local()) {
+        changed |= RewriteBottomUp(local_pb.mutable_value(), fn);
+      }
+      changed |=
+          RewriteBottomUp(value_pb->mutable_block()->mutable_result(), fn);
+      break;
+    }
+    case v0::Value::kIntrinsic: {
+      if (value_pb->intrinsic().has_static_parameter()) {
+        changed |= RewriteLambdaBodies(
+            value_pb->mutable_intrinsic()->mutable_static_parameter(), fn);
+      }
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+  changed |= fn(value_pb);
+  return changed;
+}
+
+// Applies `RewriteBottomUp` to the bodies of the lambdas in a static
+// parameter, which is otherwise left as it is.
+bool RewriteLambdaBodies(v0::Value* static_parameter_pb, const Rewrite& fn) {
+  switch (static_parameter_pb->value_case()) {
+    case v0::Value::kLambda: {
+      return RewriteBottomUp(
+          static_parameter_pb->mutable_lambda()->mutable_result(), fn);
+    }
+    case v0::Value::kStruct: {
+      bool changed = false;
+      for (v0::Value& element_pb :
+           *static_parameter_pb->mutable_struct_()->mutable_element()) {
+        changed |= RewriteLambdaBodies(&element_pb, fn);
+      }
+      return changed;
+    }
+    case v0::Value::kIntrinsic: {
+      return static_parameter_pb->intrinsic().has_static_parameter() &&
+             RewriteLambdaBodies(static_parameter_pb->mutable_intrinsic()
+                                     ->mutable_static_parameter(),
+                                 fn);
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+bool RewriteInScope(v0::Value* value_pb, absl::string_view name,
+                    const Rewrite& fn);
+
+bool RewriteLambdaBodiesInScope(v0::Value* static_parameter_pb,
+                                absl::string_view name, const Rewrite& fn) {
+  switch (static_parameter_pb->value_case()) {
+    case v0::Value::kLambda: {
+      return RewriteInScope(static_parameter_pb, name, fn);
+    }
+    case v0::Value::kStruct: {
+      bool changed = false;
+      for (v0::Value& element_pb :
+           *static_parameter_pb->mutable_struct_()->mutable_element()) {
+        changed |= RewriteLambdaBodiesInScope(&element_pb, name, fn);
+      }
+      return changed;
+    }
+    case v0::Value::kIntrinsic: {
+      return static_parameter_pb->intrinsic().has_static_parameter() &&
+             RewriteLambdaBodiesInScope(static_parameter_pb->mutable_intrinsic()
+                                            ->mutable_static_parameter(),
+                                        name, fn);
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// Applies `fn` to `value_pb` and to the values nested in it in which `name`
+// refers to the same binding as it does outside of `value_pb`, parents first.
+bool RewriteInScope(v0::Value* value_pb, absl::string_view name,
+                    const Rewrite& fn) {
+  bool changed = fn(value_pb);
+  switch (value_pb->value_case()) {
+    case v0::Value::kCall: {
+      changed |= RewriteInScope(value_pb->mutable_call()->mutable_function(),
+                                name, fn);
+      if (value_pb->call().has_argument()) {
+        changed |= RewriteInScope(
+            value_pb->mutable_call()->mutable_argument(), name, fn);
+      }
+      break;
+    }
+    case v0::Value::kStruct: {
+      for (v0::Value& element_pb :
+           *value_pb->mutable_struct_()->mutable_element()) {
+        changed |= RewriteInScope(&element_pb, name, fn);
+      }
+      break;
+    }
+    case v0::Value::kSelection: {
+      changed |= RewriteInScope(
+          value_pb->mutable_selection()->mutable_source(), name, fn);
+      break;
+    }
+    case v0::Value::kLambda: {
+      if (value_pb->lambda().parameter_name() != name) {
+        changed |= RewriteInScope(value_pb->mutable_lambda()->mutable_result(),
+                                  name, fn);
+      }
+      break;
+    }
+    case v0::Value::kBlock: {
+      for (v0::Block::Local& local_pb :
+           *value_pb->mutable_block()->mutable_local()) {
+        changed |= RewriteInScope(local_pb.mutable_value(), name, fn);
+        if (local_pb.name() == name) {
+          return changed;
+        }
+      }
+      changed |= RewriteInScope(value_pb->mutable_block()->mutable_result(),
+                                name, fn);
+      break;
+    }
+    case v0::Value::kIntrinsic: {
+      if (value_pb->intrinsic().has_static_parameter()) {
+        changed |= RewriteLambdaBodiesInScope(
+            value_pb->mutable_intrinsic()->mutable_static_parameter(), name,
+            fn);
+      }
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+  return changed;
+}
+
+// Applies `RewriteInScope` with the name of the `index`-th local of `block_pb`
+// to the rest of the block, i.e., wherever that local is visible.
+bool RewriteUsesOfLocal(v0::Block* block_pb, int index, const Rewrite& fn) {
+  const std::string name = block_pb->local(index).name();
+  bool changed = false;
+  for (int i = index + 1; i < block_pb->local_size(); ++i) {
+    v0::Block::Local* local_pb = block_pb->mutable_local(i);
+    changed |= RewriteInScope(local_pb->mutable_value(), name, fn);
+    if (local_pb->name() == name) {
+      return changed;
+    }
+  }
+  changed |= RewriteInScope(block_pb->mutable_result(), name, fn);
+  return changed;
+}
+
+bool IsReferenceTo(const v0::Value& value_pb, absl::string_view name) {
+  return value_pb.has_reference() && value_pb.reference().name() == name;
+}
+
+class LambdaInliningPass : public Pass {
+ public:
+  absl::string_view name() const final { return "lambda_inlining"; }
+
+  bool Run(v0::Value* value_pb) const final {
+    return RewriteBottomUp(value_pb, [](v0::Value* value_pb) {
+      return InlineAppliedLambda(value_pb) || InlineIdentityLocals(value_pb);
+    });
+  }
+
+ private:
+  // (x -> body)(arg) becomes Block [x=arg] -> body.
+  static bool InlineAppliedLambda(v0::Value* value_pb) {
+    if (!value_pb->has_call() || !value_pb->call().function().has_lambda() ||
+        !value_pb->call().has_argument()) {
+      return false;
+    }
+    v0::Call* call_pb = value_pb->mutable_call();
+    v0::Lambda* lambda_pb = call_pb->mutable_function()->mutable_lambda();
+    v0::Value block_pb;
+    v0::Block::Local* local_pb = block_pb.mutable_block()->add_local();
+    local_pb->set_name(lambda_pb->parameter_name());
+    *local_pb->mutable_value() = std::move(*call_pb->mutable_argument());
+    *block_pb.mutable_block()->mutable_result() =
+        std::move(*lambda_pb->mutable_result());
+    *value_pb = std::move(block_pb);
+    return true;
+  }
+
+  // Block [f=(x -> x), ...] -> ... f(arg) ... becomes ... arg ...
+  static bool InlineIdentityLocals(v0::Value* value_pb) {
+    if (!value_pb->has_block()) {
+      return false;
+    }
+    v0::Block* block_pb = value_pb->mutable_block();
+    bool changed = false;
+    for (int i = 0; i < block_pb->local_size(); ++i) {
+      const v0::Value& local_value_pb = block_pb->local(i).value();
+      if (!local_value_pb.has_lambda() ||
+          !IsReferenceTo(local_value_pb.lambda().result(),
+                         local_value_pb.lambda().parameter_name())) {
+        continue;
+      }
+      const std::string name = block_pb->local(i).name();
+      changed |= RewriteUsesOfLocal(block_pb, i, [&name](v0::Value* use_pb) {
+        if (!use_pb->has_call() ||
+            !IsReferenceTo(use_pb->call().function(), name) ||
+            !use_pb->call().has_argument()) {
+          return false;
+        }
+        Replace(use_pb, use_pb->mutable_call()->mutable_argument());
+        return true;
+      });
+    }
+    return changed;
+  }
+};
+
+class ConstantFoldingPass : public Pass {
+ public:
+  absl::string_view name() const final { return "constant_folding"; }
+
+  bool Run(v0::Value* value_pb) const final {
+    return RewriteBottomUp(value_pb, [](v0::Value* value_pb) {
+      return PropagateConstantLocals(value_pb) || FoldCall(value_pb);
+    });
+  }
+
+ private:
+  // Returns the handler used to evaluate calls of `uri` ahead of time, or
+  // `nullptr` if they are not folded.
+  static const InlineIntrinsicHandlerBase* GetFoldableHandler(
+      absl::string_view uri) {
+    static const auto* const handlers = [] {
+      auto* handlers = new absl::flat_hash_map<
+          std::string, std::unique_ptr<InlineIntrinsicHandlerBase>>();
+      for (InlineIntrinsicHandlerBase* handler :
+           std::vector<InlineIntrinsicHandlerBase*>{
+               new intrinsics::LogicalNot(), new intrinsics::PromptTemplate(),
+               new intrinsics::PromptTemplateWithParameters()}) {
+        handlers->emplace(handler->uri(), handler);
+      }
+      return handlers;
+    }();
+    auto it = handlers->find(uri);
+    return it != handlers->end() ? it->second.get() : nullptr;
+  }
+
+  static bool IsFoldableCall(const v0::Value& value_pb) {
+    return value_pb.has_call() && value_pb.call().has_argument() &&
+           value_pb.call().function().has_intrinsic() &&
+           GetFoldableHandler(value_pb.call().function().intrinsic().uri()) !=
+               nullptr;
+  }
+
+  static bool FoldCall(v0::Value* value_pb) {
+    if (!IsFoldableCall(*value_pb) ||
+        !IsConstant(value_pb->call().argument())) {
+      return false;
+    }
+    const v0::Intrinsic& intrinsic_pb = value_pb->call().function().intrinsic();
+    const InlineIntrinsicHandlerBase* handler =
+        GetFoldableHandler(intrinsic_pb.uri());
+    v0::Value result_pb;
+    // Calls that would fail are left to fail at runtime.
+    if (!handler->CheckWellFormed(intrinsic_pb).ok() ||
+        !handler
+             ->ExecuteCall(intrinsic_pb, value_pb->call().argument(),
+                           &result_pb, /*context=*/nullptr)
+             .ok()) {
+      return false;
+    }
+    *value_pb = std::move(result_pb);
+    return true;
+  }
+
+  // Substitutes block locals bound to constants where they are passed, as the
+  // argument or an element of it, to calls that can be folded.
+  static bool PropagateConstantLocals(v0::Value* value_pb) {
+    if (!value_pb->has_block()) {
+      return false;
+    }
+    v0::Block* block_pb = value_pb->mutable_block();
+    bool changed = false;
+    for (int i = 0; i < block_pb->local_size(); ++i) {
+      if (!IsConstant(block_pb->local(i).value())) {
+        continue;
+      }
+      const v0::Block::Local& local_pb = block_pb->local(i);
+      const std::string name = local_pb.name();
+      const v0::Value constant_pb = local_pb.value();
+      changed |= RewriteUsesOfLocal(
+          block_pb, i, [&name, &constant_pb](v0::Value* use_pb) {
+            if (!IsFoldableCall(*use_pb)) {
+              return false;
+            }
+            v0::Value* argument_pb = use_pb->mutable_call()->mutable_argument();
+            bool substituted = false;
+            if (IsReferenceTo(*argument_pb, name)) {
+              *argument_pb = constant_pb;
+              substituted = true;
+            }
+            if (argument_pb->has_struct_()) {
+              for (v0::Value& element_pb :
+                   *argument_pb->mutable_struct_()->mutable_element()) {
+                if (IsReferenceTo(element_pb, name)) {
+                  element_pb = constant_pb;
+                  substituted = true;
+                }
+              }
+            }
+            if (substituted) {
+              FoldCall(use_pb);
+            }
+            return substituted;
+          });
+    }
+    return changed;
+  }
+};
+
+// Allocates names not used anywhere in a computation.
+class NameGenerator {
+ public:
+  explicit NameGenerator(const v0::Value& value_pb) { AddNames(value_pb); }
+
+  std::string Next() {
+    std::string name;
+    do {
+      name = absl::StrCat("_cse_", next_index_++);
+    } while (!names_.insert(name).second);
+    return name;
+  }
+
+ private:
+  void AddNames(const v0::Value& value_pb) {
+    switch (value_pb.value_case()) {
+      case v0::Value::kReference: {
+        names_.insert(value_pb.reference().name());
+        break;
+      }
+      case v0::Value::kCall: {
+        AddNames(value_pb.call().function());
+        AddNames(value_pb.call().argument());
+        break;
+      }
+      case v0::Value::kStruct: {
+        for (const v0::Value& element_pb : value_pb.struct_().element()) {
+          AddNames(element_pb);
+        }
+        break;
+      }
+      case v0::Value::kSelection: {
+        AddNames(value_pb.selection().source());
+        break;
+      }
+      case v0::Value::kLambda: {
+        names_.insert(value_pb.lambda().parameter_name());
+        AddNames(value_pb.lambda().result());
+        break;
+      }
+      case v0::Value::kBlock: {
+        for (const v0::Block::Local& local_pb : value_pb.block().local()) {
+          names_.insert(local_pb.name());
+          AddNames(local_pb.value());
+        }
+        AddNames(value_pb.block().result());
+        break;
+      }
+      case v0::Value::kIntrinsic: {
+        AddNames(value_pb.intrinsic().static_parameter());
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+  }
+
+  NameSet names_;
+  int next_index_ = 0;
+};
+
+class CommonSubexpressionEliminationPass : public Pass {
+ public:
+  absl::string_view name() const final {
+    return "common_subexpression_elimination";
+  }
+
+  bool Run(v0::Value* value_pb) const final {
+    NameGenerator names(*value_pb);
+    return RewriteBottomUp(value_pb, [&names](v0::Value* value_pb) {
+      return ReuseEarlierLocals(value_pb) ||
+             HoistRepeatedCalls(value_pb, &names);
+    });
+  }
+
+ private:
+  // Block [a=e, ..., b=e] -> ... becomes Block [a=e, ..., b=a] -> ..., as long
+  // as the names in `e` and `a` refer to the same values at `b`.
+  static bool ReuseEarlierLocals(v0::Value* value_pb) {
+    if (!value_pb->has_block()) {
+      return false;
+    }
+    v0::Block* block_pb = value_pb->mutable_block();
+    bool changed = false;
+    for (int i = 0; i < block_pb->local_size(); ++i) {
+      const v0::Value& value_i = block_pb->local(i).value();
+      if (value_i.has_reference() || IsConstant(value_i) || !IsPure(value_i)) {
+        continue;
+      }
+      const std::string& name_i = block_pb->local(i).name();
+      const NameSet free_names = FreeReferences(value_i);
+      if (free_names.contains(name_i)) {
+        continue;
+      }
+      const std::string serialized_i = value_i.SerializeAsString();
+      for (int j = i + 1; j < block_pb->local_size(); ++j) {
+        v0::Block::Local* local_j = block_pb->mutable_local(j);
+        if (local_j->value().SerializeAsString() == serialized_i) {
+          local_j->mutable_value()->mutable_reference()->set_name(name_i);
+          changed = true;
+        }
+        if (local_j->name() == name_i || free_names.contains(local_j->name())) {
+          break;
+        }
+      }
+    }
+    return changed;
+  }
+
+  // Adds to `calls` the calls without side effects that are evaluated as part
+  // of `value_pb`, with no bindings in between.
+  static void CollectPureCalls(v0::Value* value_pb,
+                               std::vector<v0::Value*>* calls) {
+    switch (value_pb->value_case()) {
+      case v0::Value::kCall: {
+        if (IsPure(*value_pb)) {
+          calls->push_back(value_pb);
+        }
+        CollectPureCalls(value_pb->mutable_call()->mutable_function(), calls);
+        if (value_pb->call().has_argument()) {
+          CollectPureCalls(value_pb->mutable_call()->mutable_argument(), calls);
+        }
+        break;
+      }
+      case v0::Value::kStruct: {
+        for (v0::Value& element_pb :
+             *value_pb->mutable_struct_()->mutable_element()) {
+          CollectPureCalls(&element_pb, calls);
+        }
+        break;
+      }
+      case v0::Value::kSelection: {
+        CollectPureCalls(value_pb->mutable_selection()->mutable_source(),
+                         calls);
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+  }
+
+  // An expression e in which a call c occurs more than once becomes
+  // Block [t=c] -> e', where e' is e with the occurrences of c replaced by t.
+  static bool HoistRepeatedCalls(v0::Value* value_pb, NameGenerator* names) {
+    std::vector<v0::Value*> calls;
+    CollectPureCalls(value_pb, &calls);
+    absl::flat_hash_map<std::string, std::vector<v0::Value*>> occurrences;
+    std::string repeated_key;
+    size_t repeated_size = 0;
+    for (v0::Value* call_pb : calls) {
+      std::string key = call_pb->SerializeAsString();
+      std::vector<v0::Value*>& same_calls = occurrences[key];
+      same_calls.push_back(call_pb);
+      // Prefers the largest repeated call; the calls nested in it go with it.
+      if (same_calls.size() > 1 && key.size() > repeated_size) {
+        repeated_key = std::move(key);
+        repeated_size = repeated_key.size();
+      }
+    }
+    if (repeated_size == 0) {
+      return false;
+    }
+    const std::vector<v0::Value*>& repeated = occurrences[repeated_key];
+    v0::Value block_pb;
+    v0::Block::Local* local_pb = block_pb.mutable_block()->add_local();
+    local_pb->set_name(names->Next());
+    *local_pb->mutable_value() = *repeated.front();
+    for (v0::Value* call_pb : repeated) {
+      call_pb->Clear();
+      call_pb->mutable_reference()->set_name(local_pb->name());
+    }
+    *block_pb.mutable_block()->mutable_result() = std::move(*value_pb);
+    *value_pb = std::move(block_pb);
+    return true;
+  }
+};
+
+class DeadLocalEliminationPass : public Pass {
+ public:
+  absl::string_view name() const final { return "dead_local_elimination"; }
+
+  bool Run(v0::Value* value_pb) const final {
+    return RewriteBottomUp(value_pb, [](v0::Value* value_pb) {
+      if (!value_pb->has_block()) {
+        return false;
+      }
+      bool changed = FlattenResult(value_pb->mutable_block());
+      changed |= FlattenLocals(value_pb->mutable_block());
+      changed |= DropUnusedLocals(value_pb->mutable_block());
+      changed |= InlineLastLocal(value_pb->mutable_block());
+      if (value_pb->block().local().empty()) {
+        Replace(value_pb, value_pb->mutable_block()->mutable_result());
+        changed = true;
+      }
+      return changed;
+    });
+  }
+
+ private:
+  // Block [a] -> Block [b] -> r becomes Block [a, b] -> r.
+  static bool FlattenResult(v0::Block* block_pb) {
+    if (!block_pb->result().has_block()) {
+      return false;
+    }
+    v0::Block inner_pb =
+        std::move(*block_pb->mutable_result()->mutable_block());
+    for (v0::Block::Local& local_pb : *inner_pb.mutable_local()) {
+      *block_pb->add_local() = std::move(local_pb);
+    }
+    *block_pb->mutable_result() = std::move(*inner_pb.mutable_result());
+    return true;
+  }
+
+  // Block [x=Block [a] -> r, ...] -> ... becomes Block [a, x=r, ...] -> ...,
+  // as long as the names defined in `a` are not referenced after `x`.
+  static bool FlattenLocals(v0::Block* block_pb) {
+    // The names referenced after each local.
+    std::vector<NameSet> used_after(block_pb->local_size());
+    NameSet used = FreeReferences(block_pb->result());
+    for (int i = block_pb->local_size() - 1; i >= 0; --i) {
+      used_after[i] = used;
+      used.erase(block_pb->local(i).name());
+      NameSet used_by_local = FreeReferences(block_pb->local(i).value());
+      used.insert(used_by_local.begin(), used_by_local.end());
+    }
+    std::vector<bool> flatten(block_pb->local_size());
+    bool changed = false;
+    for (int i = 0; i < block_pb->local_size(); ++i) {
+      const v0::Value& value_pb = block_pb->local(i).value();
+      flatten[i] = value_pb.has_block();
+      for (const v0::Block::Local& inner_pb : value_pb.block().local()) {
+        flatten[i] = flatten[i] && !used_after[i].contains(inner_pb.name());
+      }
+      changed |= flatten[i];
+    }
+    if (!changed) {
+      return false;
+    }
+    v0::Block flattened_block_pb;
+    for (int i = 0; i < block_pb->local_size(); ++i) {
+      v0::Block::Local* local_pb = block_pb->mutable_local(i);
+      if (!flatten[i]) {
+        *flattened_block_pb.add_local() = std::move(*local_pb);
+        continue;
+      }
+      v0::Block inner_pb =
+          std::move(*local_pb->mutable_value()->mutable_block());
+      for (v0::Block::Local& inner_local_pb : *inner_pb.mutable_local()) {
+        *flattened_block_pb.add_local() = std::move(inner_local_pb);
+      }
+      v0::Block::Local* flattened_pb = flattened_block_pb.add_local();
+      flattened_pb->set_name(local_pb->name());
+      *flattened_pb->mutable_value() = std::move(*inner_pb.mutable_result());
+    }
+    block_pb->mutable_local()->Swap(flattened_block_pb.mutable_local());
+    return true;
+  }
+
+  static bool DropUnusedLocals(v0::Block* block_pb) {
+    NameSet used = FreeReferences(block_pb->result());
+    std::vector<bool> keep(block_pb->local_size());
+    bool changed = false;
+    for (int i = block_pb->local_size() - 1; i >= 0; --i) {
+      const v0::Block::Local& local_pb = block_pb->local(i);
+      keep[i] = used.contains(local_pb.name()) || !IsPure(local_pb.value());
+      if (!keep[i]) {
+        changed = true;
+        continue;
+      }
+      used.erase(local_pb.name());
+      NameSet used_by_local = FreeReferences(local_pb.value());
+      used.insert(used_by_local.begin(), used_by_local.end());
+    }
+    if (changed) {
+      v0::Block kept_block_pb;
+      for (int i = 0; i < block_pb->local_size(); ++i) {
+        if (keep[i]) {
+          *kept_block_pb.add_local() = std::move(*block_pb->mutable_local(i));
+        }
+      }
+      block_pb->mutable_local()->Swap(kept_block_pb.mutable_local());
+    }
+    return changed;
+  }
+
+  // Block [..., x=e] -> x becomes Block [...] -> e.
+  static bool InlineLastLocal(v0::Block* block_pb) {
+    if (block_pb->local().empty() ||
+        !IsReferenceTo(block_pb->result(),
+                       block_pb->local(block_pb->local_size() - 1).name())) {
+      return false;
+    }
+    Replace(block_pb->mutable_result(),
+            block_pb->mutable_local(block_pb->local_size() - 1)
+                ->mutable_value());
+    block_pb->mutable_local()->RemoveLast();
+    return true;
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<Pass> CreateLambdaInliningPass() {
+  return std::make_unique<LambdaInliningPass>();
+}
+
+std::unique_ptr<Pass> CreateConstantFoldingPass() {
+  return std::make_unique<ConstantFoldingPass>();
+}
+
+std::unique_ptr<Pass> CreateCommonSubexpressionEliminationPass() {
+  return std::make_unique<CommonSubexpressionEliminationPass>();
+}
+
+std::unique_ptr<Pass> CreateDeadLocalEliminationPass() {
+  return std::make_unique<DeadLocalEliminationPass>();
+}
+
+}  // namespace genc
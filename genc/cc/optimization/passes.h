@@ -0,0 +1,52 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_OPTIMIZATION_PASSES_H_
+#define GENC_CC_OPTIMIZATION_PASSES_H_
+
+#include <memory>
+
+#include "genc/cc/optimization/pass.h"
+
+namespace genc {
+
+// The passes below only remove, merge or reorder the evaluation of values
+// without side effects: those that call nothing but `logical_not`,
+// `prompt_template`, `prompt_template_with_parameters` and
+// `regex_partial_match`. The static parameters of intrinsics are left as they
+// are, except for the bodies of lambdas in them.
+
+// Replaces calls of lambdas with blocks that bind the argument to the
+// parameter, and calls of identity lambdas bound to block locals with their
+// argument.
+std::unique_ptr<Pass> CreateLambdaInliningPass();
+
+// Evaluates calls of `logical_not`, `prompt_template` and
+// `prompt_template_with_parameters` with constant arguments, including those
+// passed through block locals bound to constants.
+std::unique_ptr<Pass> CreateConstantFoldingPass();
+
+// Evaluates identical subexpressions without side effects only once: later
+// block locals identical to earlier ones become references to them, and calls
+// repeated within an expression are hoisted into a block local.
+std::unique_ptr<Pass> CreateCommonSubexpressionEliminationPass();
+
+// Drops block locals that are not referenced and have no side effects, and
+// flattens nested and empty blocks.
+std::unique_ptr<Pass> CreateDeadLocalEliminationPass();
+
+}  // namespace genc
+
+#endif  // GENC_CC_OPTIMIZATION_PASSES_H_
@@ -0,0 +1,208 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/optimization/passes.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace {
+
+v0::Value CreateBlock(
+    std::vector<std::pair<std::string, v0::Value>> locals, v0::Value result) {
+  v0::Value block_pb;
+  for (auto& [name, value] : locals) {
+    v0::Block::Local* local_pb = block_pb.mutable_block()->add_local();
+    local_pb->set_name(name);
+    *local_pb->mutable_value() = std::move(value);
+  }
+  *block_pb.mutable_block()->mutable_result() = std::move(result);
+  return block_pb;
+}
+
+v0::Value CreateStr(absl::string_view str) {
+  v0::Value value_pb;
+  value_pb.set_str(std::string(str));
+  return value_pb;
+}
+
+v0::Value Ref(absl::string_view name) { return CreateReference(name).value(); }
+
+v0::Value CallModel(v0::Value arg) {
+  return CreateCall(CreateModelInference("test_model").value(), std::move(arg))
+      .value();
+}
+
+v0::Value CallTemplate(v0::Value arg) {
+  return CreateCall(CreatePromptTemplate("Q: {x}").value(), std::move(arg))
+      .value();
+}
+
+// Runs `pass` over `value_pb`, and expects it to become `expected_pb`.
+void ExpectRewrite(const Pass& pass, v0::Value value_pb,
+                   const v0::Value& expected_pb) {
+  EXPECT_TRUE(pass.Run(&value_pb));
+  EXPECT_EQ(value_pb.DebugString(), expected_pb.DebugString());
+}
+
+void ExpectUnchanged(const Pass& pass, v0::Value value_pb) {
+  const v0::Value original_pb = value_pb;
+  EXPECT_FALSE(pass.Run(&value_pb));
+  EXPECT_EQ(value_pb.DebugString(), original_pb.DebugString());
+}
+
+TEST(LambdaInliningPassTest, InlinesAppliedLambda) {
+  // (x -> model(x))(y) becomes Block [x=y] -> model(x).
+  ExpectRewrite(
+      *CreateLambdaInliningPass(),
+      CreateCall(CreateLambda("x", CallModel(Ref("x"))).value(), Ref("y"))
+          .value(),
+      CreateBlock({{"x", Ref("y")}}, CallModel(Ref("x"))));
+}
+
+TEST(LambdaInliningPassTest, InlinesIdentityLocals) {
+  // Block [f=(x -> x), g=(z -> f(z))] -> f(y) becomes
+  // Block [f=(x -> x), g=(z -> z)] -> y.
+  ExpectRewrite(
+      *CreateLambdaInliningPass(),
+      CreateBlock(
+          {{"f", CreateLambda("x", Ref("x")).value()},
+           {"g", CreateLambda("z", CreateCall(Ref("f"), Ref("z")).value())
+                     .value()}},
+          CreateCall(Ref("f"), Ref("y")).value()),
+      CreateBlock({{"f", CreateLambda("x", Ref("x")).value()},
+                   {"g", CreateLambda("z", Ref("z")).value()}},
+                  Ref("y")));
+}
+
+TEST(LambdaInliningPassTest, RespectsShadowing) {
+  // The `f` called in the result is the model, not the identity lambda.
+  ExpectUnchanged(
+      *CreateLambdaInliningPass(),
+      CreateBlock({{"f", CreateLambda("x", Ref("x")).value()},
+                   {"f", CreateModelInference("test_model").value()}},
+                  CreateCall(Ref("f"), Ref("y")).value()));
+}
+
+TEST(ConstantFoldingPassTest, FoldsPromptTemplateAndLogicalNot) {
+  ExpectRewrite(*CreateConstantFoldingPass(), CallTemplate(CreateStr("Hi")),
+                CreateStr("Q: Hi"));
+  v0::Value true_pb;
+  true_pb.set_boolean(true);
+  v0::Value false_pb;
+  false_pb.set_boolean(false);
+  ExpectRewrite(*CreateConstantFoldingPass(),
+                CreateCall(CreateLogicalNot().value(), true_pb).value(),
+                false_pb);
+}
+
+TEST(ConstantFoldingPassTest, FoldsConstantsBoundToLocals) {
+  // Block [x="Hi"] -> model(prompt(x)) becomes Block [x="Hi"] -> model("Q: Hi")
+  ExpectRewrite(
+      *CreateConstantFoldingPass(),
+      CreateBlock({{"x", CreateStr("Hi")}}, CallModel(CallTemplate(Ref("x")))),
+      CreateBlock({{"x", CreateStr("Hi")}}, CallModel(CreateStr("Q: Hi"))));
+}
+
+TEST(ConstantFoldingPassTest, LeavesNonConstantAndFailingCallsAlone) {
+  ExpectUnchanged(*CreateConstantFoldingPass(), CallTemplate(Ref("x")));
+  v0::Value number_pb;
+  number_pb.set_int_32(1);
+  ExpectUnchanged(*CreateConstantFoldingPass(),
+                  CreateCall(CreateLogicalNot().value(), number_pb).value());
+}
+
+TEST(CommonSubexpressionEliminationPassTest, ReusesEarlierLocals) {
+  // Block [a=prompt(x), b=prompt(x)] -> <a,b> becomes
+  // Block [a=prompt(x), b=a] -> <a,b>.
+  ExpectRewrite(
+      *CreateCommonSubexpressionEliminationPass(),
+      CreateBlock(
+          {{"a", CallTemplate(Ref("x"))}, {"b", CallTemplate(Ref("x"))}},
+          CreateStruct({Ref("a"), Ref("b")}).value()),
+      CreateBlock({{"a", CallTemplate(Ref("x"))}, {"b", Ref("a")}},
+                  CreateStruct({Ref("a"), Ref("b")}).value()));
+}
+
+TEST(CommonSubexpressionEliminationPassTest, HoistsRepeatedCalls) {
+  // model(<prompt(x),prompt(x)>) becomes
+  // Block [_cse_0=prompt(x)] -> model(<_cse_0,_cse_0>).
+  ExpectRewrite(
+      *CreateCommonSubexpressionEliminationPass(),
+      CallModel(CreateStruct({CallTemplate(Ref("x")), CallTemplate(Ref("x"))})
+                    .value()),
+      CallModel(CreateBlock({{"_cse_0", CallTemplate(Ref("x"))}},
+                            CreateStruct({Ref("_cse_0"), Ref("_cse_0")})
+                                .value())));
+}
+
+TEST(CommonSubexpressionEliminationPassTest, KeepsCallsWithSideEffects) {
+  ExpectUnchanged(
+      *CreateCommonSubexpressionEliminationPass(),
+      CreateBlock({{"a", CallModel(Ref("x"))}, {"b", CallModel(Ref("x"))}},
+                  CreateStruct({Ref("a"), Ref("b")}).value()));
+}
+
+TEST(CommonSubexpressionEliminationPassTest, RespectsRebindings) {
+  // The second `prompt(x)` sees a different `x`.
+  ExpectUnchanged(
+      *CreateCommonSubexpressionEliminationPass(),
+      CreateBlock({{"a", CallTemplate(Ref("x"))},
+                   {"x", CreateStr("y")},
+                   {"b", CallTemplate(Ref("x"))}},
+                  CreateStruct({Ref("a"), Ref("b")}).value()));
+}
+
+TEST(DeadLocalEliminationPassTest, DropsUnusedLocalsWithoutSideEffects) {
+  // Block [a=prompt(x), b=model(x), c=x] -> c becomes Block [b=model(x)] -> x.
+  ExpectRewrite(*CreateDeadLocalEliminationPass(),
+                CreateBlock({{"a", CallTemplate(Ref("x"))},
+                             {"b", CallModel(Ref("x"))},
+                             {"c", Ref("x")}},
+                            Ref("c")),
+                CreateBlock({{"b", CallModel(Ref("x"))}}, Ref("x")));
+}
+
+TEST(DeadLocalEliminationPassTest, FlattensNestedBlocks) {
+  // Block [a=Block [b=model(x)] -> model(b)] -> Block [c=model(a)] -> c
+  // becomes Block [b=model(x), a=model(b)] -> model(a).
+  ExpectRewrite(
+      *CreateDeadLocalEliminationPass(),
+      CreateBlock({{"a", CreateBlock({{"b", CallModel(Ref("x"))}},
+                                     CallModel(Ref("b")))}},
+                  CreateBlock({{"c", CallModel(Ref("a"))}}, Ref("c"))),
+      CreateBlock({{"b", CallModel(Ref("x"))}, {"a", CallModel(Ref("b"))}},
+                  CallModel(Ref("a"))));
+}
+
+TEST(DeadLocalEliminationPassTest, DoesNotFlattenIntoShadowedNames) {
+  // Flattening would make the result refer to the inner `x`.
+  ExpectUnchanged(
+      *CreateDeadLocalEliminationPass(),
+      CreateBlock({{"a", CreateBlock({{"x", CallModel(Ref("y"))}},
+                                     CallModel(Ref("x")))}},
+                  CallModel(CreateStruct({Ref("a"), Ref("x")}).value())));
+}
+
+}  // namespace
+}  // namespace genc
@@ -0,0 +1,119 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_RUNTIME_BOUNDED_CACHE_H_
+#define GENC_CC_RUNTIME_BOUNDED_CACHE_H_
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace genc {
+
+// A thread-safe cache of values derived from keys, such as templates or
+// patterns compiled from strings, holding at most `capacity` of them and
+// evicting the oldest first. Lookups only take a shared lock.
+template <class Value, class Key = std::string>
+class BoundedCache {
+ public:
+  // String keys are looked up without being copied.
+  using KeyArg = std::conditional_t<std::is_same_v<Key, std::string>,
+                                    absl::string_view, const Key&>;
+
+  explicit BoundedCache(size_t capacity) : capacity_(capacity) {}
+
+  BoundedCache(const BoundedCache&) = delete;
+  BoundedCache& operator=(const BoundedCache&) = delete;
+
+  // Returns the value cached under `key`, or else the one returned by
+  // `create(key)`, which is cached unless it is an error. `create` returns
+  // an `absl::StatusOr` of either a `Value` or, for values that can't be
+  // moved, a `std::unique_ptr<Value>` or `std::shared_ptr<const Value>`.
+  // It runs without the lock held, so concurrent misses on the same key may
+  // each run it, in which case the first value cached wins.
+  template <class Create>
+  absl::StatusOr<std::shared_ptr<const Value>> GetOrCreate(KeyArg key,
+                                                           Create create) {
+    if (std::shared_ptr<const Value> cached = Find(key)) {
+      return cached;
+    }
+    auto value = create(key);
+    if (!value.ok()) {
+      return value.status();
+    }
+    std::shared_ptr<const Value> shared = Share(*std::move(value));
+    if (capacity_ == 0) {
+      return shared;
+    }
+    absl::MutexLock lock(&mutex_);
+    auto [it, inserted] = cache_.emplace(key, shared);
+    if (!inserted) {
+      return it->second;
+    }
+    insertion_order_.emplace_back(key);
+    if (insertion_order_.size() > capacity_) {
+      cache_.erase(insertion_order_.front());
+      insertion_order_.pop_front();
+    }
+    return shared;
+  }
+
+  // Returns the value cached under `key`, or null if there is none.
+  std::shared_ptr<const Value> Find(KeyArg key) const {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+      return nullptr;
+    }
+    return it->second;
+  }
+
+  size_t size() const {
+    absl::ReaderMutexLock lock(&mutex_);
+    return cache_.size();
+  }
+
+ private:
+  static std::shared_ptr<const Value> Share(Value value) {
+    return std::make_shared<const Value>(std::move(value));
+  }
+  static std::shared_ptr<const Value> Share(std::unique_ptr<Value> value) {
+    return value;
+  }
+  static std::shared_ptr<const Value> Share(
+      std::shared_ptr<const Value> value) {
+    return value;
+  }
+
+  const size_t capacity_;
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<Key, std::shared_ptr<const Value>> cache_
+      ABSL_GUARDED_BY(mutex_);
+  std::deque<Key> insertion_order_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace genc
+
+#endif  // GENC_CC_RUNTIME_BOUNDED_CACHE_H_
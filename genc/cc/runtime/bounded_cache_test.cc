@@ -0,0 +1,101 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/bounded_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace genc {
+namespace {
+
+TEST(BoundedCacheTest, CreatesEachValueOnce) {
+  BoundedCache<std::string> cache(/*capacity=*/4);
+  int num_created = 0;
+  auto create = [&num_created](absl::string_view key)
+      -> absl::StatusOr<std::string> {
+    ++num_created;
+    return absl::StrCat(key, "!");
+  };
+  std::shared_ptr<const std::string> first =
+      cache.GetOrCreate("a", create).value();
+  std::shared_ptr<const std::string> second =
+      cache.GetOrCreate("a", create).value();
+  EXPECT_EQ(*first, "a!");
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(num_created, 1);
+}
+
+TEST(BoundedCacheTest, EvictsOldestValues) {
+  BoundedCache<std::string> cache(/*capacity=*/2);
+  int num_created = 0;
+  auto create = [&num_created](absl::string_view key)
+      -> absl::StatusOr<std::string> {
+    ++num_created;
+    return std::string(key);
+  };
+  for (absl::string_view key : {"a", "b", "c"}) {
+    ASSERT_TRUE(cache.GetOrCreate(key, create).ok());
+  }
+  EXPECT_EQ(cache.size(), 2u);
+  ASSERT_TRUE(cache.GetOrCreate("c", create).ok());
+  EXPECT_EQ(num_created, 3);
+  ASSERT_TRUE(cache.GetOrCreate("a", create).ok());
+  EXPECT_EQ(num_created, 4);
+}
+
+TEST(BoundedCacheTest, DoesNotCacheErrors) {
+  BoundedCache<std::string> cache(/*capacity=*/2);
+  absl::StatusOr<std::shared_ptr<const std::string>> value = cache.GetOrCreate(
+      "a", [](absl::string_view key) -> absl::StatusOr<std::string> {
+        return absl::InvalidArgumentError("bad key");
+      });
+  EXPECT_EQ(value.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(BoundedCacheTest, ZeroCapacityDisablesCaching) {
+  BoundedCache<std::string> cache(/*capacity=*/0);
+  auto create = [](absl::string_view key) -> absl::StatusOr<std::string> {
+    return std::string(key);
+  };
+  EXPECT_EQ(*cache.GetOrCreate("a", create).value(), "a");
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(BoundedCacheTest, HoldsValuesThatCannotBeMoved) {
+  struct Pinned {
+    explicit Pinned(absl::string_view key) : key(key) {}
+    Pinned(Pinned&&) = delete;
+    const std::string key;
+  };
+  BoundedCache<Pinned> cache(/*capacity=*/1);
+  auto create = [](absl::string_view key)
+      -> absl::StatusOr<std::unique_ptr<Pinned>> {
+    return std::make_unique<Pinned>(key);
+  };
+  std::shared_ptr<const Pinned> value = cache.GetOrCreate("a", create).value();
+  EXPECT_EQ(value->key, "a");
+  EXPECT_EQ(cache.GetOrCreate("a", create).value(), value);
+}
+
+}  // namespace
+}  // namespace genc
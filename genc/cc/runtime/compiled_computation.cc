@@ -0,0 +1,409 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/compiled_computation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
+#include "absl/hash/hash.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "genc/cc/runtime/intrinsic_handler.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+
+namespace genc {
+
+class CompiledComputation::Compiler {
+ public:
+  Compiler(CompiledComputation* computation,
+           const IntrinsicHandlerSet& handlers)
+      : computation_(computation), handlers_(handlers) {}
+
+  // Makes the names in `environment` available for capture by the frames
+  // compiled next.
+  void AddEnvironment(const LexicalEnvironment& environment) {
+    scopes_.push_back(Scope{environment, {}, nullptr});
+  }
+
+  // Compiles `body_pb` in a new frame nested inside the current one, binding
+  // `parameter_name` to slot 0 if one is given.
+  const CompiledFrame* CompileFrame(
+      const v0::Value& body_pb,
+      std::optional<absl::string_view> parameter_name) {
+    CompiledFrame* frame = PushFrame();
+    if (parameter_name.has_value()) {
+      scopes_.back().bindings.emplace_back(std::string(*parameter_name), 0);
+      frame->num_slots = 1;
+    }
+    frame->body = CompileNode(body_pb);
+    scopes_.pop_back();
+    return frame;
+  }
+
+ private:
+  // The names visible in a frame under construction.
+  struct Scope {
+    LexicalEnvironment bindings;
+    absl::flat_hash_map<std::string, int> captures;
+    // `nullptr` for an environment added with `AddEnvironment`.
+    CompiledFrame* frame;
+  };
+
+  CompiledFrame* PushFrame() {
+    CompiledFrame* frame = &computation_->frames_.emplace_back();
+    scopes_.push_back(Scope{{}, {}, frame});
+    return frame;
+  }
+
+  CompiledNode* NewNode(CompiledNode::Kind kind, const v0::Value& value_pb) {
+    CompiledNode& node = computation_->nodes_.emplace_back();
+    node.kind = kind;
+    node.value_pb = &value_pb;
+    return &node;
+  }
+
+  const CompiledNode* CompileNode(const v0::Value& value_pb) {
+    switch (value_pb.value_case()) {
+      case v0::Value::kBlock: {
+        CompiledNode* node = NewNode(CompiledNode::BLOCK, value_pb);
+        // Compiling nested frames grows `scopes_`, so avoid holding on to
+        // references into it.
+        const size_t level = scopes_.size() - 1;
+        const size_t num_visible = scopes_[level].bindings.size();
+        for (const v0::Block::Local& local_pb : value_pb.block().local()) {
+          node->children.push_back(CompileNode(local_pb.value()));
+          const int slot = scopes_[level].frame->num_slots++;
+          node->local_slots.push_back(slot);
+          scopes_[level].bindings.emplace_back(local_pb.name(), slot);
+        }
+        node->children.push_back(CompileNode(value_pb.block().result()));
+        scopes_[level].bindings.resize(num_visible);
+        AddLocalDependencies(node);
+        SetHasCall(node);
+        return node;
+      }
+      case v0::Value::kReference: {
+        CompiledNode* node = NewNode(CompiledNode::REFERENCE, value_pb);
+        node->slot = Lookup(value_pb.reference().name(), scopes_.size() - 1);
+        return node;
+      }
+      case v0::Value::kCall: {
+        CompiledNode* node = NewNode(CompiledNode::CALL, value_pb);
+        node->children.push_back(CompileNode(value_pb.call().function()));
+        if (value_pb.call().has_argument()) {
+          node->children.push_back(CompileNode(value_pb.call().argument()));
+        }
+        node->has_call = true;
+        return node;
+      }
+      case v0::Value::kStruct: {
+        CompiledNode* node = NewNode(CompiledNode::STRUCT, value_pb);
+        for (const v0::Value& element_pb : value_pb.struct_().element()) {
+          node->children.push_back(CompileNode(element_pb));
+        }
+        SetHasCall(node);
+        return node;
+      }
+      case v0::Value::kSelection: {
+        CompiledNode* node = NewNode(CompiledNode::SELECTION, value_pb);
+        node->children.push_back(CompileNode(value_pb.selection().source()));
+        SetHasCall(node);
+        return node;
+      }
+      case v0::Value::kLambda: {
+        CompiledNode* node = NewNode(CompiledNode::LAMBDA, value_pb);
+        node->frame = CompileFrame(value_pb.lambda().result(),
+                                   value_pb.lambda().parameter_name());
+        return node;
+      }
+      case v0::Value::kIntrinsic: {
+        return CompileIntrinsic(value_pb);
+      }
+      default: {
+        return NewNode(CompiledNode::VALUE, value_pb);
+      }
+    }
+  }
+
+  const CompiledNode* CompileIntrinsic(const v0::Value& value_pb) {
+    const v0::Intrinsic& intrinsic_pb = value_pb.intrinsic();
+    absl::StatusOr<const IntrinsicHandler*> handler =
+        handlers_.GetHandler(intrinsic_pb.uri());
+    if (handler.ok()) {
+      absl::Status status = (*handler)->CheckWellFormed(intrinsic_pb);
+      if (!status.ok()) {
+        handler = status;
+      } else if ((*handler)->interface_type() !=
+                 IntrinsicHandler::CONTROL_FLOW) {
+        // Non control-flow intrinsics must be handled by the child executor.
+        return NewNode(CompiledNode::VALUE, value_pb);
+      }
+    }
+    CompiledNode* node = NewNode(CompiledNode::INTRINSIC, value_pb);
+    CompiledIntrinsic& intrinsic = computation_->intrinsics_.emplace_back();
+    intrinsic.handler = handler;
+    node->frame = PushFrame();
+    if (handler.ok()) {
+      const v0::Value& static_parameter_pb = intrinsic_pb.static_parameter();
+      if (static_parameter_pb.has_struct_()) {
+        for (const v0::Value& element_pb :
+             static_parameter_pb.struct_().element()) {
+          intrinsic.static_parameters[&element_pb] =
+              CompileFrame(element_pb, std::nullopt);
+        }
+      } else {
+        intrinsic.static_parameters[&static_parameter_pb] =
+            CompileFrame(static_parameter_pb, std::nullopt);
+      }
+    }
+    for (const auto& [name, slot] : scopes_.back().captures) {
+      intrinsic.environment.emplace_back(name, slot);
+    }
+    scopes_.pop_back();
+    node->intrinsic = &intrinsic;
+    return node;
+  }
+
+  static void SetHasCall(CompiledNode* node) {
+    for (const CompiledNode* child : node->children) {
+      node->has_call = node->has_call || child->has_call;
+    }
+  }
+
+  // Adds to `slots` the slots of the current frame read by `node`.
+  static void CollectReads(const CompiledNode& node,
+                           absl::flat_hash_set<int>* slots) {
+    if (node.slot.has_value()) {
+      slots->insert(*node.slot);
+    }
+    if (node.frame != nullptr) {
+      slots->insert(node.frame->capture_sources.begin(),
+                    node.frame->capture_sources.end());
+    }
+    for (const CompiledNode* child : node.children) {
+      CollectReads(*child, slots);
+    }
+  }
+
+  static void AddLocalDependencies(CompiledNode* block) {
+    const size_t num_locals = block->local_slots.size();
+    block->local_dependencies.resize(num_locals);
+    for (size_t i = 0; i < num_locals; ++i) {
+      absl::flat_hash_set<int> reads;
+      CollectReads(*block->children[i], &reads);
+      for (size_t j = 0; j < i; ++j) {
+        if (reads.contains(block->local_slots[j])) {
+          block->local_dependencies[i].push_back(j);
+        }
+      }
+    }
+  }
+
+  // Returns the slot holding `name` in the frame of `scopes_[level]`, adding
+  // captures to it (and to the frames it is nested in) as needed.
+  std::optional<int> Lookup(absl::string_view name, size_t level) {
+    Scope& scope = scopes_[level];
+    for (auto it = scope.bindings.rbegin(); it != scope.bindings.rend();
+         ++it) {
+      if (it->first == name) {
+        return it->second;
+      }
+    }
+    auto capture = scope.captures.find(name);
+    if (capture != scope.captures.end()) {
+      return capture->second;
+    }
+    if (level == 0 || scope.frame == nullptr) {
+      return std::nullopt;
+    }
+    std::optional<int> source = Lookup(name, level - 1);
+    if (!source.has_value()) {
+      return std::nullopt;
+    }
+    const int slot = scope.frame->num_slots++;
+    scope.frame->capture_sources.push_back(*source);
+    scope.frame->capture_slots.push_back(slot);
+    scope.captures.emplace(name, slot);
+    return slot;
+  }
+
+  CompiledComputation* const computation_;
+  const IntrinsicHandlerSet& handlers_;
+  std::vector<Scope> scopes_;
+};
+
+std::shared_ptr<const CompiledComputation> CompiledComputation::Compile(
+    v0::Value value_pb, const IntrinsicHandlerSet& handlers) {
+  return Compile(std::move(value_pb), LexicalEnvironment(), handlers);
+}
+
+std::shared_ptr<const CompiledComputation> CompiledComputation::Compile(
+    v0::Value value_pb, const LexicalEnvironment& environment,
+    const IntrinsicHandlerSet& handlers) {
+  return Compile(std::make_shared<const v0::Value>(std::move(value_pb)),
+                 environment, handlers);
+}
+
+std::shared_ptr<const CompiledComputation> CompiledComputation::Compile(
+    std::shared_ptr<const v0::Value> value_pb,
+    const LexicalEnvironment& environment,
+    const IntrinsicHandlerSet& handlers) {
+  std::shared_ptr<CompiledComputation> computation(
+      new CompiledComputation(std::move(value_pb), environment));
+  Compiler compiler(computation.get(), handlers);
+  compiler.AddEnvironment(environment);
+  computation->root_ =
+      compiler.CompileFrame(*computation->value_pb_, std::nullopt);
+  return computation;
+}
+
+namespace {
+
+// Compares the bytes serialized into it with `expected`, without holding more
+// than one buffer of them.
+class ComparingOutputStream
+    : public google::protobuf::io::ZeroCopyOutputStream {
+ public:
+  explicit ComparingOutputStream(absl::string_view expected)
+      : expected_(expected) {}
+
+  bool Next(void** data, int* size) override {
+    Compare();
+    *data = buffer_;
+    *size = sizeof(buffer_);
+    used_ = sizeof(buffer_);
+    byte_count_ += used_;
+    return true;
+  }
+
+  void BackUp(int count) override {
+    used_ -= count;
+    byte_count_ -= count;
+  }
+
+  int64_t ByteCount() const override { return byte_count_; }
+
+  // Whether the bytes serialized so far are exactly `expected`.
+  bool Matches() {
+    Compare();
+    return matches_ && expected_.empty();
+  }
+
+ private:
+  void Compare() {
+    const absl::string_view written(buffer_, used_);
+    matches_ = matches_ && absl::ConsumePrefix(&expected_, written);
+    used_ = 0;
+  }
+
+  absl::string_view expected_;
+  char buffer_[4096];
+  int used_ = 0;
+  int64_t byte_count_ = 0;
+  bool matches_ = true;
+};
+
+// Whether `computation` was compiled from the value serialized as `serialized`
+// in `environment`.
+bool IsCompiledFrom(const CompiledComputation& computation,
+                    absl::string_view serialized,
+                    const LexicalEnvironment& environment) {
+  if (computation.environment() != environment) {
+    return false;
+  }
+  ComparingOutputStream output(serialized);
+  {
+    google::protobuf::io::CodedOutputStream coded_output(&output);
+    computation.value_pb().SerializeToCodedStream(&coded_output);
+  }
+  return output.Matches();
+}
+
+}  // namespace
+
+std::shared_ptr<const CompiledComputation>
+CompiledComputationCache::GetOrCompile(const v0::Value& value_pb,
+                                       const LexicalEnvironment& environment) {
+  return GetOrCompileByContent(value_pb, environment, [&]() {
+    return CompiledComputation::Compile(value_pb, environment, *handlers_);
+  });
+}
+
+std::shared_ptr<const CompiledComputation>
+CompiledComputationCache::GetOrCompile(
+    std::shared_ptr<const v0::Value> value_pb) {
+  if (std::shared_ptr<const CompiledComputation> computation =
+          by_address_.Find(value_pb.get())) {
+    return computation;
+  }
+  std::shared_ptr<const CompiledComputation> compiled;
+  std::shared_ptr<const CompiledComputation> computation =
+      GetOrCompileByContent(*value_pb, {}, [&]() {
+        compiled = CompiledComputation::Compile(value_pb, {}, *handlers_);
+        return compiled;
+      });
+  if (computation == compiled) {
+    by_address_
+        .GetOrCreate(value_pb.get(),
+                     [&](const v0::Value*) {
+                       return absl::StatusOr<
+                           std::shared_ptr<const CompiledComputation>>(
+                           computation);
+                     })
+        .IgnoreError();
+  }
+  return computation;
+}
+
+std::shared_ptr<const CompiledComputation>
+CompiledComputationCache::GetOrCompileByContent(
+    const v0::Value& value_pb, const LexicalEnvironment& environment,
+    absl::FunctionRef<std::shared_ptr<const CompiledComputation>()> compile) {
+  const std::string serialized = value_pb.SerializeAsString();
+  std::shared_ptr<const CompiledComputation> compiled;
+  // Compilation never fails.
+  std::shared_ptr<const CompiledComputation> computation =
+      by_content_
+          .GetOrCreate(absl::HashOf(serialized, environment),
+                       [&](size_t)
+                           -> absl::StatusOr<
+                               std::shared_ptr<const CompiledComputation>> {
+                         compiled = compile();
+                         return compiled;
+                       })
+          .value();
+  if (computation == compiled ||
+      IsCompiledFrom(*computation, serialized, environment)) {
+    return computation;
+  }
+  // A different computation has the same fingerprint, so this one is not
+  // cached.
+  return compile();
+}
+
+}  // namespace genc
@@ -0,0 +1,211 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_RUNTIME_COMPILED_COMPUTATION_H_
+#define GENC_CC_RUNTIME_COMPILED_COMPUTATION_H_
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/statusor.h"
+#include "genc/cc/runtime/bounded_cache.h"
+#include "genc/cc/runtime/intrinsic_handler.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+
+struct CompiledFrame;
+struct CompiledIntrinsic;
+
+// A node of a computation lowered for evaluation. Every node points back at
+// the `v0::Value` it was lowered from, which is owned by the enclosing
+// `CompiledComputation`.
+struct CompiledNode {
+  enum Kind {
+    // Anything that is not a computation, or an intrinsic that is handled by
+    // the child executor. Delegated as-is.
+    VALUE,
+    REFERENCE,
+    BLOCK,
+    CALL,
+    STRUCT,
+    SELECTION,
+    LAMBDA,
+    INTRINSIC
+  };
+
+  Kind kind;
+  const v0::Value* value_pb;
+
+  // REFERENCE: the slot of the current frame holding the referenced value, or
+  // `nullopt` if the name is not in scope (reported only if evaluated).
+  std::optional<int> slot;
+
+  // BLOCK: the locals followed by the result. CALL: the function, followed by
+  // the argument if there is one. STRUCT: the elements. SELECTION: the source.
+  std::vector<const CompiledNode*> children;
+
+  // BLOCK: the slot in the current frame assigned to each local.
+  std::vector<int> local_slots;
+
+  // BLOCK: for each local, the indices of the earlier locals it reads, either
+  // directly or through the values captured by closures it creates.
+  std::vector<std::vector<int>> local_dependencies;
+
+  // Whether evaluating the node calls a function, as opposed to only creating
+  // values. The bodies of closures and intrinsics created by it don't count.
+  bool has_call = false;
+
+  // LAMBDA: the body. INTRINSIC: the environment for the static parameters.
+  const CompiledFrame* frame = nullptr;
+
+  // INTRINSIC: the control flow intrinsic invoked by this node.
+  const CompiledIntrinsic* intrinsic = nullptr;
+};
+
+// A flat array of `num_slots` values in which a lambda body (or other nested
+// computation) is evaluated. Slot 0 holds the lambda parameter. Names defined
+// outside the frame are captured by value when the closure is created: the
+// value at `capture_sources[i]` of the enclosing frame is copied into slot
+// `capture_slots[i]` of each new frame. Closures therefore never reference
+// the frame they were created in.
+struct CompiledFrame {
+  int num_slots = 0;
+  const CompiledNode* body = nullptr;
+  std::vector<int> capture_sources;
+  std::vector<int> capture_slots;
+};
+
+// Names visible in a frame, with the slots that hold them. Later bindings
+// shadow earlier ones.
+using LexicalEnvironment = std::vector<std::pair<std::string, int>>;
+
+// A control flow intrinsic. Handlers ask the executor to create values out of
+// (parts of) the static parameter, so these are compiled up front as frames
+// nested inside an environment frame of values captured for the intrinsic.
+struct CompiledIntrinsic {
+  // The handler, or the error from looking it up or validating the intrinsic.
+  absl::StatusOr<const IntrinsicHandler*> handler;
+
+  // The static parameter and each of its struct elements, keyed by address.
+  absl::flat_hash_map<const v0::Value*, const CompiledFrame*>
+      static_parameters;
+
+  // The names captured in the environment frame, used to compile any other
+  // computation that the handler hands back.
+  LexicalEnvironment environment;
+};
+
+// A `v0::Value` lowered once for repeated evaluation. References are resolved
+// to slot indices at compile time, so evaluation never compares names, and
+// each lambda invocation gets a single flat frame rather than a chain of
+// bindings per local.
+//
+// Compilation itself never fails. Errors that the tree-walking evaluator would
+// report, such as unknown references and intrinsics, are recorded in the
+// affected nodes and only surface if those nodes are evaluated.
+class CompiledComputation {
+ public:
+  // Compiles `value_pb` as the root of a computation, with no names in scope.
+  static std::shared_ptr<const CompiledComputation> Compile(
+      v0::Value value_pb, const IntrinsicHandlerSet& handlers);
+
+  // Compiles `value_pb` to be evaluated in a frame whose captures are taken
+  // from an enclosing frame laid out as described by `environment`.
+  static std::shared_ptr<const CompiledComputation> Compile(
+      v0::Value value_pb, const LexicalEnvironment& environment,
+      const IntrinsicHandlerSet& handlers);
+
+  // Like the above, but shares `value_pb` rather than copying it.
+  static std::shared_ptr<const CompiledComputation> Compile(
+      std::shared_ptr<const v0::Value> value_pb,
+      const LexicalEnvironment& environment,
+      const IntrinsicHandlerSet& handlers);
+
+  // The frame in which to evaluate the whole computation.
+  const CompiledFrame& root() const { return *root_; }
+
+  // The computation that was compiled, and the environment it was compiled
+  // in.
+  const v0::Value& value_pb() const { return *value_pb_; }
+  const LexicalEnvironment& environment() const { return environment_; }
+
+  CompiledComputation(const CompiledComputation&) = delete;
+  CompiledComputation& operator=(const CompiledComputation&) = delete;
+
+ private:
+  class Compiler;
+
+  CompiledComputation(std::shared_ptr<const v0::Value> value_pb,
+                      LexicalEnvironment environment)
+      : value_pb_(std::move(value_pb)), environment_(std::move(environment)) {}
+
+  const std::shared_ptr<const v0::Value> value_pb_;
+  const LexicalEnvironment environment_;
+  std::deque<CompiledNode> nodes_;
+  std::deque<CompiledFrame> frames_;
+  std::deque<CompiledIntrinsic> intrinsics_;
+  const CompiledFrame* root_ = nullptr;
+};
+
+// A thread-safe cache of compiled computations. Computations are found by a
+// fingerprint of their content and of the environment they are compiled in,
+// and compared in full on a match, so that each entry holds nothing but the
+// compiled form. Shared computations are also found by address, so that
+// running the same one again doesn't even hash it.
+class CompiledComputationCache {
+ public:
+  // Caches up to `capacity` computations by content, and as many by address,
+  // evicting the oldest first.
+  CompiledComputationCache(std::shared_ptr<IntrinsicHandlerSet> handlers,
+                           size_t capacity)
+      : handlers_(std::move(handlers)),
+        by_content_(capacity),
+        by_address_(capacity) {}
+
+  // Returns the compiled form of `value_pb`, to be evaluated in a frame laid
+  // out as described by `environment`, compiling it on a cache miss.
+  std::shared_ptr<const CompiledComputation> GetOrCompile(
+      const v0::Value& value_pb, const LexicalEnvironment& environment = {});
+
+  // Like the above, for an immutable computation with no names in scope,
+  // which is compiled without being copied.
+  std::shared_ptr<const CompiledComputation> GetOrCompile(
+      std::shared_ptr<const v0::Value> value_pb);
+
+ private:
+  // Finds `value_pb` by content, or else caches the result of `compile()`.
+  std::shared_ptr<const CompiledComputation> GetOrCompileByContent(
+      const v0::Value& value_pb, const LexicalEnvironment& environment,
+      absl::FunctionRef<std::shared_ptr<const CompiledComputation>()>
+          compile);
+
+  const std::shared_ptr<IntrinsicHandlerSet> handlers_;
+  BoundedCache<CompiledComputation, size_t> by_content_;
+  // Only holds computations that share the value they are keyed by, and so
+  // keep it alive, which prevents its address from being reused.
+  BoundedCache<CompiledComputation, const v0::Value*> by_address_;
+};
+
+}  // namespace genc
+
+#endif  // GENC_CC_RUNTIME_COMPILED_COMPUTATION_H_
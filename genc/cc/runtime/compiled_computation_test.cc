@@ -0,0 +1,196 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/compiled_computation.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/cc/intrinsics/handler_sets.h"
+#include "genc/cc/runtime/intrinsic_handler.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace {
+
+class CompiledComputationTest : public ::testing::Test {
+ protected:
+  std::shared_ptr<IntrinsicHandlerSet> handlers_ =
+      intrinsics::CreateCompleteHandlerSet({});
+};
+
+v0::Value CreateBlock(
+    std::vector<std::pair<std::string, v0::Value>> locals, v0::Value result) {
+  v0::Value block_pb;
+  for (auto& [name, value] : locals) {
+    v0::Block::Local* local_pb = block_pb.mutable_block()->add_local();
+    local_pb->set_name(name);
+    *local_pb->mutable_value() = std::move(value);
+  }
+  *block_pb.mutable_block()->mutable_result() = std::move(result);
+  return block_pb;
+}
+
+v0::Value CreateStr(absl::string_view str) {
+  v0::Value value_pb;
+  value_pb.set_str(std::string(str));
+  return value_pb;
+}
+
+TEST_F(CompiledComputationTest, ResolvesLambdaParameterToSlotZero) {
+  auto computation = CompiledComputation::Compile(
+      CreateLambda("x", CreateReference("x").value()).value(), *handlers_);
+  const CompiledNode* lambda = computation->root().body;
+  ASSERT_EQ(lambda->kind, CompiledNode::LAMBDA);
+  EXPECT_EQ(lambda->frame->num_slots, 1);
+  EXPECT_TRUE(lambda->frame->capture_sources.empty());
+  ASSERT_EQ(lambda->frame->body->kind, CompiledNode::REFERENCE);
+  EXPECT_EQ(lambda->frame->body->slot, 0);
+}
+
+TEST_F(CompiledComputationTest, AssignsEachLocalItsOwnSlot) {
+  // Block [x=a, x=b] -> x, where the second `x` shadows the first.
+  auto computation = CompiledComputation::Compile(
+      CreateBlock({{"x", CreateStr("a")}, {"x", CreateStr("b")}},
+                  CreateReference("x").value()),
+      *handlers_);
+  const CompiledFrame& root = computation->root();
+  EXPECT_EQ(root.num_slots, 2);
+  ASSERT_EQ(root.body->kind, CompiledNode::BLOCK);
+  EXPECT_EQ(root.body->local_slots, std::vector<int>({0, 1}));
+  EXPECT_EQ(root.body->children.back()->slot, 1);
+}
+
+TEST_F(CompiledComputationTest, CapturesNamesFromEnclosingFrames) {
+  // Block [y=a, f=(x -> y)] -> f
+  auto computation = CompiledComputation::Compile(
+      CreateBlock({{"y", CreateStr("a")},
+                   {"f", CreateLambda("x", CreateReference("y").value())
+                             .value()}},
+                  CreateReference("f").value()),
+      *handlers_);
+  const CompiledNode* lambda = computation->root().body->children[1];
+  ASSERT_EQ(lambda->kind, CompiledNode::LAMBDA);
+  EXPECT_EQ(lambda->frame->num_slots, 2);
+  EXPECT_EQ(lambda->frame->capture_sources, std::vector<int>({0}));
+  EXPECT_EQ(lambda->frame->capture_slots, std::vector<int>({1}));
+  EXPECT_EQ(lambda->frame->body->slot, 1);
+}
+
+TEST_F(CompiledComputationTest, RecordsDependenciesBetweenLocals) {
+  // Block [a=s, b=f(s), c=(x -> a), d=f(<b,s>)] -> d
+  v0::Value fn = CreateCustomFunction("f").value();
+  auto computation = CompiledComputation::Compile(
+      CreateBlock(
+          {{"a", CreateReference("s").value()},
+           {"b", CreateCall(fn, CreateReference("s").value()).value()},
+           {"c", CreateLambda("x", CreateReference("a").value()).value()},
+           {"d", CreateCall(fn, CreateStruct({CreateReference("b").value(),
+                                              CreateReference("s").value()})
+                                    .value())
+                     .value()}},
+          CreateReference("d").value()),
+      *handlers_);
+  const CompiledNode* block = computation->root().body;
+  ASSERT_EQ(block->kind, CompiledNode::BLOCK);
+  EXPECT_EQ(block->local_dependencies,
+            std::vector<std::vector<int>>({{}, {}, {0}, {1}}));
+  EXPECT_FALSE(block->children[0]->has_call);
+  EXPECT_TRUE(block->children[1]->has_call);
+  EXPECT_FALSE(block->children[2]->has_call);
+  EXPECT_TRUE(block->children[3]->has_call);
+  EXPECT_TRUE(block->has_call);
+}
+
+TEST_F(CompiledComputationTest, LeavesUnknownReferencesUnresolved) {
+  auto computation = CompiledComputation::Compile(
+      CreateLambda("x", CreateReference("y").value()).value(), *handlers_);
+  EXPECT_FALSE(computation->root().body->frame->body->slot.has_value());
+}
+
+TEST_F(CompiledComputationTest, CompilesStaticParametersOfControlFlow) {
+  v0::Value while_pb =
+      CreateWhile(CreateLogicalNot().value(),
+                  CreateLambda("x", CreateReference("y").value()).value())
+          .value();
+  // (y -> While) so that the body can capture `y`.
+  auto computation = CompiledComputation::Compile(
+      CreateLambda("y", while_pb).value(), *handlers_);
+  const CompiledNode* intrinsic = computation->root().body->frame->body;
+  ASSERT_EQ(intrinsic->kind, CompiledNode::INTRINSIC);
+  ASSERT_TRUE(intrinsic->intrinsic->handler.ok());
+  EXPECT_EQ(intrinsic->intrinsic->static_parameters.size(), 2u);
+  ASSERT_EQ(intrinsic->intrinsic->environment.size(), 1u);
+  EXPECT_EQ(intrinsic->intrinsic->environment[0].first, "y");
+  EXPECT_EQ(intrinsic->frame->capture_sources, std::vector<int>({0}));
+}
+
+TEST_F(CompiledComputationTest, DefersUnknownIntrinsicErrors) {
+  v0::Value intrinsic_pb;
+  intrinsic_pb.mutable_intrinsic()->set_uri("no_such_intrinsic");
+  auto computation = CompiledComputation::Compile(intrinsic_pb, *handlers_);
+  const CompiledNode* intrinsic = computation->root().body;
+  ASSERT_EQ(intrinsic->kind, CompiledNode::INTRINSIC);
+  EXPECT_FALSE(intrinsic->intrinsic->handler.ok());
+}
+
+TEST_F(CompiledComputationTest, CompilesInGivenEnvironment) {
+  auto computation = CompiledComputation::Compile(
+      CreateReference("y").value(), {{"x", 0}, {"y", 1}}, *handlers_);
+  const CompiledFrame& root = computation->root();
+  EXPECT_EQ(root.capture_sources, std::vector<int>({1}));
+  EXPECT_EQ(root.body->slot, root.capture_slots[0]);
+}
+
+TEST_F(CompiledComputationTest, CacheReturnsSameComputationForEqualValues) {
+  CompiledComputationCache cache(handlers_, /*capacity=*/1);
+  v0::Value lambda_pb = CreateLambda("x", CreateReference("x").value()).value();
+  auto first = cache.GetOrCompile(lambda_pb);
+  EXPECT_EQ(cache.GetOrCompile(v0::Value(lambda_pb)), first);
+
+  // Evicted once another computation is compiled.
+  cache.GetOrCompile(CreateLambda("y", CreateReference("y").value()).value());
+  EXPECT_NE(cache.GetOrCompile(lambda_pb), first);
+}
+
+TEST_F(CompiledComputationTest, CacheKeysOnEnvironment) {
+  CompiledComputationCache cache(handlers_, /*capacity=*/2);
+  v0::Value reference_pb = CreateReference("y").value();
+  auto first = cache.GetOrCompile(reference_pb, {{"y", 0}});
+  EXPECT_EQ(cache.GetOrCompile(reference_pb, {{"y", 0}}), first);
+  auto second = cache.GetOrCompile(reference_pb, {{"x", 0}, {"y", 1}});
+  EXPECT_NE(second, first);
+  EXPECT_EQ(second->root().capture_sources, std::vector<int>({1}));
+}
+
+TEST_F(CompiledComputationTest, CacheSharesComputationsFoundByAddress) {
+  CompiledComputationCache cache(handlers_, /*capacity=*/1);
+  auto lambda_pb = std::make_shared<const v0::Value>(
+      CreateLambda("x", CreateReference("x").value()).value());
+  auto first = cache.GetOrCompile(lambda_pb);
+  EXPECT_EQ(&first->value_pb(), lambda_pb.get());
+  EXPECT_EQ(cache.GetOrCompile(lambda_pb), first);
+
+  // An equal computation elsewhere is found by content.
+  EXPECT_EQ(cache.GetOrCompile(v0::Value(*lambda_pb)), first);
+}
+
+}  // namespace
+}  // namespace genc
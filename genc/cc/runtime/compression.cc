@@ -0,0 +1,49 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/compression.h"
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "include/grpc/compression.h"
+
+namespace genc {
+
+absl::StatusOr<grpc_compression_algorithm> ParseCompressionAlgorithm(
+    absl::string_view name) {
+  const std::string lower = absl::AsciiStrToLower(name);
+  if (lower.empty() || lower == "none" || lower == "identity") {
+    return GRPC_COMPRESS_NONE;
+  }
+  if (lower == "deflate") {
+    return GRPC_COMPRESS_DEFLATE;
+  }
+  if (lower == "gzip") {
+    return GRPC_COMPRESS_GZIP;
+  }
+  if (lower == "zstd") {
+    return absl::UnimplementedError(
+        "gRPC doesn't support zstd compression; use gzip instead.");
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown compression algorithm: ", name));
+}
+
+}  // namespace genc
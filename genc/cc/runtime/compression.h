@@ -0,0 +1,85 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_RUNTIME_COMPRESSION_H_
+#define GENC_CC_RUNTIME_COMPRESSION_H_
+
+#include <cstddef>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "include/grpc/compression.h"
+#include "include/grpcpp/impl/call_op_set.h"
+
+namespace genc {
+
+// How to compress the messages exchanged with a remote executor. Prompts,
+// model configs and model outputs are mostly text, which compresses well, but
+// compressing costs CPU time that only pays off on slower links.
+struct CompressionOptions {
+  // `GRPC_COMPRESS_GZIP` or `GRPC_COMPRESS_DEFLATE`, or `GRPC_COMPRESS_NONE`
+  // to leave messages uncompressed.
+  grpc_compression_algorithm algorithm = GRPC_COMPRESS_NONE;
+
+  // Messages smaller than this many bytes are sent uncompressed, since they
+  // gain little from it.
+  size_t min_message_size = 1024;
+};
+
+// Parses the name of a compression algorithm, i.e., "none", "deflate" or
+// "gzip". Returns UNIMPLEMENTED for algorithms that gRPC doesn't support, like
+// "zstd".
+absl::StatusOr<grpc_compression_algorithm> ParseCompressionAlgorithm(
+    absl::string_view name);
+
+// Whether to compress a message of `size` bytes.
+inline bool ShouldCompress(const CompressionOptions& options, size_t size) {
+  return options.algorithm != GRPC_COMPRESS_NONE &&
+         size >= options.min_message_size;
+}
+
+// Sets the compression algorithm of the call on `context` (a client or server
+// context), if its only message, of `size` bytes, should be compressed.
+template <class Context>
+void CompressUnary(const CompressionOptions& options, size_t size,
+                   Context* context) {
+  if (context != nullptr && ShouldCompress(options, size)) {
+    context->set_compression_algorithm(options.algorithm);
+  }
+}
+
+// Sets the compression algorithm of the streaming call on `context`. Messages
+// are then compressed unless written with `CompressionWriteOptions`.
+template <class Context>
+void CompressStream(const CompressionOptions& options, Context* context) {
+  if (context != nullptr && options.algorithm != GRPC_COMPRESS_NONE) {
+    context->set_compression_algorithm(options.algorithm);
+  }
+}
+
+// The options for writing a message of `size` bytes to a stream set up with
+// `CompressStream`.
+inline grpc::WriteOptions CompressionWriteOptions(
+    const CompressionOptions& options, size_t size) {
+  grpc::WriteOptions write_options;
+  if (!ShouldCompress(options, size)) {
+    write_options.set_no_compression();
+  }
+  return write_options;
+}
+
+}  // namespace genc
+
+#endif  // GENC_CC_RUNTIME_COMPRESSION_H_
@@ -0,0 +1,160 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Measures what gzip, as gRPC applies it to messages, saves on the values a
+// chain typically sends to a remote executor (prompts, JSON model configs and
+// model outputs), and what it costs. This is done on the codec alone, so the
+// numbers carry over to any link: compression pays off where the bytes saved
+// take longer to send than compressing them does.
+//
+//   bazel run -c opt //genc/cc/runtime:compression_benchmark
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "zlib.h"
+
+namespace genc {
+namespace {
+
+enum Payload { kPrompt, kModelConfig, kModelOutput };
+
+constexpr const char* kWords[] = {
+    "the",      "a",         "of",       "to",        "and",     "in",
+    "is",       "that",      "for",      "it",        "with",    "as",
+    "on",       "be",        "this",     "are",       "by",      "from",
+    "model",    "answer",    "question", "context",   "user",    "document",
+    "summary",  "following", "please",   "based",     "provide", "example",
+    "response", "data",      "language", "system",    "result",  "each",
+    "should",   "when",      "which",    "information", "about", "can",
+    "will",     "not",       "or",       "have",      "more",    "one",
+    "request",  "between",   "their",    "customer",  "report",  "step",
+};
+
+// Text with the word frequencies, though not the grammar, of English prose.
+std::string MakeText(size_t size, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::discrete_distribution<int> word({
+      60, 40, 35, 30, 30, 25, 20, 15, 15, 15, 12, 12, 10, 10, 10, 10, 8, 8,
+      6,  6,  6,  6,  5,  5,  5,  5,  5,  5,  4,  4,  4,  4,  4,  4,  4, 4,
+      3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  2,  2,  2,  2,  2,  2,  2, 2});
+  std::string text;
+  while (text.size() < size) {
+    text += kWords[word(rng)];
+    text += rng() % 12 == 0 ? ". " : " ";
+  }
+  text.resize(size);
+  return text;
+}
+
+v0::Value MakePayload(Payload payload, size_t size) {
+  v0::Value value;
+  switch (payload) {
+    case kPrompt:
+      value.set_str("Answer the question based on the context below.\n\n"
+                    "Context: " +
+                    MakeText(size, 1) + "\n\nQuestion: What is the summary?");
+      break;
+    case kModelConfig: {
+      // A request body for a hosted model, with the conversation so far.
+      std::string json = "{\"model\":\"gemini-pro\",\"generationConfig\":{"
+                         "\"temperature\":0.7,\"topP\":0.95,\"topK\":40,"
+                         "\"maxOutputTokens\":1024},\"contents\":[";
+      for (unsigned turn = 0; json.size() < size; ++turn) {
+        json += turn % 2 == 0 ? "{\"role\":\"user\",\"parts\":[{\"text\":\""
+                              : "{\"role\":\"model\",\"parts\":[{\"text\":\"";
+        json += MakeText(200, turn) + "\"}]},";
+      }
+      json += "]}";
+      value.set_str(json);
+      break;
+    }
+    case kModelOutput:
+      // A batch of responses, as returned for a `parallel_map`.
+      for (unsigned i = 0; i * 512 < size; ++i) {
+        v0::Value* element = value.mutable_struct_()->add_element();
+        element->set_label("response");
+        element->set_str(MakeText(512, 100 + i));
+      }
+      break;
+  }
+  return value;
+}
+
+// Compresses as gRPC's "gzip" algorithm does.
+std::string Gzip(const std::string& input) {
+  z_stream stream = {};
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 | 16, 8,
+               Z_DEFAULT_STRATEGY);
+  std::string output(deflateBound(&stream, input.size()), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = input.size();
+  stream.next_out = reinterpret_cast<Bytef*>(output.data());
+  stream.avail_out = output.size();
+  deflate(&stream, Z_FINISH);
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+  return output;
+}
+
+std::string Gunzip(const std::string& input, size_t size) {
+  z_stream stream = {};
+  inflateInit2(&stream, 15 | 16);
+  std::string output(size, '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = input.size();
+  stream.next_out = reinterpret_cast<Bytef*>(output.data());
+  stream.avail_out = output.size();
+  inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  return output;
+}
+
+template <Payload kPayload>
+void BM_Gzip(benchmark::State& state) {
+  const std::string bytes =
+      MakePayload(kPayload, state.range(0)).SerializeAsString();
+  std::string compressed;
+  for (auto _ : state) {
+    compressed = Gzip(bytes);
+    benchmark::DoNotOptimize(compressed);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+  state.counters["bytes"] = bytes.size();
+  state.counters["gzip_bytes"] = compressed.size();
+}
+BENCHMARK(BM_Gzip<kPrompt>)->Arg(256)->Arg(4 << 10)->Arg(64 << 10);
+BENCHMARK(BM_Gzip<kModelConfig>)->Arg(256)->Arg(4 << 10)->Arg(64 << 10);
+BENCHMARK(BM_Gzip<kModelOutput>)->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20);
+
+template <Payload kPayload>
+void BM_Gunzip(benchmark::State& state) {
+  const std::string bytes =
+      MakePayload(kPayload, state.range(0)).SerializeAsString();
+  const std::string compressed = Gzip(bytes);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Gunzip(compressed, bytes.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_Gunzip<kPrompt>)->Arg(4 << 10)->Arg(64 << 10);
+BENCHMARK(BM_Gunzip<kModelOutput>)->Arg(64 << 10)->Arg(1 << 20);
+
+}  // namespace
+}  // namespace genc
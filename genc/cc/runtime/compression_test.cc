@@ -0,0 +1,55 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/compression.h"
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "include/grpc/compression.h"
+
+namespace genc {
+namespace {
+
+TEST(CompressionTest, ParsesAlgorithms) {
+  EXPECT_EQ(ParseCompressionAlgorithm("").value(), GRPC_COMPRESS_NONE);
+  EXPECT_EQ(ParseCompressionAlgorithm("none").value(), GRPC_COMPRESS_NONE);
+  EXPECT_EQ(ParseCompressionAlgorithm("deflate").value(),
+            GRPC_COMPRESS_DEFLATE);
+  EXPECT_EQ(ParseCompressionAlgorithm("GZIP").value(), GRPC_COMPRESS_GZIP);
+  EXPECT_EQ(ParseCompressionAlgorithm("zstd").status().code(),
+            absl::StatusCode::kUnimplemented);
+  EXPECT_EQ(ParseCompressionAlgorithm("lz4").status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(CompressionTest, SkipsSmallMessages) {
+  CompressionOptions options;
+  options.algorithm = GRPC_COMPRESS_GZIP;
+  options.min_message_size = 100;
+  EXPECT_FALSE(ShouldCompress(options, 99));
+  EXPECT_TRUE(ShouldCompress(options, 100));
+  EXPECT_TRUE(CompressionWriteOptions(options, 99).get_no_compression());
+  EXPECT_FALSE(CompressionWriteOptions(options, 100).get_no_compression());
+}
+
+TEST(CompressionTest, NeverCompressesWithoutAnAlgorithm) {
+  CompressionOptions options;
+  options.min_message_size = 0;
+  EXPECT_FALSE(ShouldCompress(options, 1 << 20));
+  EXPECT_TRUE(CompressionWriteOptions(options, 1 << 20).get_no_compression());
+}
+
+}  // namespace
+}  // namespace genc
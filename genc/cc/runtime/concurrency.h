@@ -16,23 +16,227 @@ limitations under the License
 #ifndef GENC_CC_RUNTIME_CONCURRENCY_H_
 #define GENC_CC_RUNTIME_CONCURRENCY_H_
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 
 namespace genc {
 
 template <typename ReturnValue>
 class FutureInterface {
  public:
+  // Blocks until the result is available and returns it.
   virtual absl::StatusOr<ReturnValue> Get() = 0;
+
+  // Registers a `callback` to be invoked once the result is available, i.e.,
+  // once `Get()` no longer blocks. If the result is already available, the
+  // `callback` is invoked immediately on the calling thread. Otherwise, it is
+  // invoked on the thread that makes the result available, so it should be
+  // cheap; use `ConcurrencyInterface::Then` to schedule heavier work.
+  virtual void OnReady(std::function<void()> callback) = 0;
+
   virtual ~FutureInterface() {}
 };
 
+namespace internal {
+
+// Common result storage and callback bookkeeping for the futures below.
+template <typename ReturnValue>
+class FutureBase : public FutureInterface<ReturnValue> {
+ public:
+  void OnReady(std::function<void()> callback) override {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (!done_) {
+        callbacks_.push_back(std::move(callback));
+        return;
+      }
+    }
+    callback();
+  }
+
+  virtual ~FutureBase() {}
+
+ protected:
+  // Stores the result and fires the registered callbacks. Only the first call
+  // has any effect.
+  void SetResult(absl::StatusOr<ReturnValue> result) {
+    std::vector<std::function<void()>> callbacks;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (done_) {
+        return;
+      }
+      result_.emplace(std::move(result));
+      done_ = true;
+      callbacks.swap(callbacks_);
+    }
+    for (std::function<void()>& callback : callbacks) {
+      callback();
+    }
+  }
+
+  // Blocks until `SetResult` has been called, and returns the result.
+  absl::StatusOr<ReturnValue> AwaitResult() {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(&done_));
+    return *result_;
+  }
+
+  absl::Mutex mutex_;
+  bool done_ ABSL_GUARDED_BY(mutex_) = false;
+
+ private:
+  std::optional<absl::StatusOr<ReturnValue>> result_ ABSL_GUARDED_BY(mutex_);
+  std::vector<std::function<void()>> callbacks_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace internal
+
+// A future whose result is supplied explicitly by calling `Set`.
+template <typename ReturnValue>
+class Promise : public internal::FutureBase<ReturnValue> {
+ public:
+  Promise() = default;
+
+  // The optional `drive` callback is invoked by `Get()` before it blocks, so
+  // that a waiting thread can help complete the inputs the result depends on.
+  explicit Promise(std::function<void()> drive) : drive_(std::move(drive)) {}
+
+  void Set(absl::StatusOr<ReturnValue> result) {
+    this->SetResult(std::move(result));
+    absl::MutexLock lock(&this->mutex_);
+    drive_ = nullptr;
+  }
+
+  absl::StatusOr<ReturnValue> Get() override {
+    std::function<void()> drive;
+    {
+      absl::MutexLock lock(&this->mutex_);
+      if (!this->done_) {
+        drive = drive_;
+      }
+    }
+    if (drive) {
+      drive();
+    }
+    return this->AwaitResult();
+  }
+
+  virtual ~Promise() {}
+
+ private:
+  std::function<void()> drive_ ABSL_GUARDED_BY(this->mutex_);
+};
+
+// A future constructed with its result. Since the result never changes, it
+// needs no synchronization.
+template <typename ReturnValue>
+class ReadyFuture : public FutureInterface<ReturnValue> {
+ public:
+  explicit ReadyFuture(absl::StatusOr<ReturnValue> result)
+      : result_(std::move(result)) {}
+
+  absl::StatusOr<ReturnValue> Get() override { return result_; }
+
+  void OnReady(std::function<void()> callback) override { callback(); }
+
+  virtual ~ReadyFuture() {}
+
+ private:
+  const absl::StatusOr<ReturnValue> result_;
+};
+
+// Returns a future whose result is already available.
+template <typename ReturnValue>
+std::shared_ptr<FutureInterface<ReturnValue>> MakeReadyFuture(
+    absl::StatusOr<ReturnValue> result) {
+  return std::make_shared<ReadyFuture<ReturnValue>>(std::move(result));
+}
+
+// Like `ConcurrencyInterface::Then`, but rather than being scheduled, the
+// `lambda` runs on the thread that makes `future` available, or right away on
+// the calling thread if it already is. Only use this for cheap work such as
+// reshaping data, since it holds up the thread that completed `future`.
+template <typename Value, typename Func,
+          typename ReturnValue =
+              typename std::invoke_result_t<Func, absl::StatusOr<Value>>>
+std::shared_ptr<FutureInterface<ReturnValue>> ThenInline(
+    std::shared_ptr<FutureInterface<Value>> future, Func lambda) {
+  auto promise = std::make_shared<Promise<ReturnValue>>(
+      [future]() { future->Get().IgnoreError(); });
+  future->OnReady([future, promise, lambda = std::move(lambda)]() mutable {
+    promise->Set(absl::StatusOr<ReturnValue>(absl::in_place,
+                                             std::move(lambda)(future->Get())));
+  });
+  return promise;
+}
+
+// Returns a future with the result of `future`, surfacing an error held in
+// the inner `StatusOr` as the error of the returned future.
+template <typename ReturnValue>
+std::shared_ptr<FutureInterface<ReturnValue>> Flatten(
+    std::shared_ptr<FutureInterface<absl::StatusOr<ReturnValue>>> future) {
+  auto promise = std::make_shared<Promise<ReturnValue>>(
+      [future]() { future->Get().IgnoreError(); });
+  future->OnReady([future, promise]() {
+    absl::StatusOr<absl::StatusOr<ReturnValue>> result = future->Get();
+    promise->Set(result.ok() ? *std::move(result)
+                             : absl::StatusOr<ReturnValue>(result.status()));
+  });
+  return promise;
+}
+
+// Returns a future that becomes available once all of the `futures` are, with
+// their results in the same order. If any of the `futures` fails, so does the
+// returned future. No thread is blocked while waiting.
+template <typename ReturnValue>
+std::shared_ptr<FutureInterface<std::vector<ReturnValue>>> WhenAll(
+    absl::Span<const std::shared_ptr<FutureInterface<ReturnValue>>> futures) {
+  using Inputs = std::vector<std::shared_ptr<FutureInterface<ReturnValue>>>;
+  auto inputs = std::make_shared<Inputs>(futures.begin(), futures.end());
+  auto promise = std::make_shared<Promise<std::vector<ReturnValue>>>(
+      [inputs]() {
+        for (const auto& input : *inputs) {
+          input->Get().IgnoreError();
+        }
+      });
+  if (inputs->empty()) {
+    promise->Set(std::vector<ReturnValue>());
+    return promise;
+  }
+  auto remaining = std::make_shared<std::atomic<size_t>>(inputs->size());
+  for (const auto& input : *inputs) {
+    input->OnReady([inputs, promise, remaining]() {
+      if (remaining->fetch_sub(1) != 1) {
+        return;
+      }
+      std::vector<ReturnValue> results;
+      results.reserve(inputs->size());
+      for (const auto& ready_input : *inputs) {
+        absl::StatusOr<ReturnValue> result = ready_input->Get();
+        if (!result.ok()) {
+          promise->Set(result.status());
+          return;
+        }
+        results.push_back(*std::move(result));
+      }
+      promise->Set(std::move(results));
+    });
+  }
+  return promise;
+}
+
 class ConcurrencyInterface {
  public:
   template <typename Func,
@@ -44,6 +248,25 @@ class ConcurrencyInterface {
     return task;
   }
 
+  // Schedules `lambda` to run once `future` is available, passing it the
+  // result of `future`. No thread is blocked while waiting. The concurrency
+  // interface must outlive the pending continuation.
+  template <typename Value, typename Func,
+            typename ReturnValue =
+                typename std::invoke_result_t<Func, absl::StatusOr<Value>>>
+  std::shared_ptr<FutureInterface<ReturnValue>> Then(
+      std::shared_ptr<FutureInterface<Value>> future, Func lambda) {
+    auto continuation = [future, lambda = std::move(lambda)]() mutable {
+      return std::move(lambda)(future->Get());
+    };
+    auto task = std::make_shared<Task<decltype(continuation)>>(
+        std::move(continuation), [future]() { future->Get().IgnoreError(); });
+    future->OnReady([this, task]() {
+      task->SetWaitable(Schedule([task]() { task->Run(); }));
+    });
+    return task;
+  }
+
   virtual ~ConcurrencyInterface() {}
 
  protected:
@@ -59,36 +282,67 @@ class ConcurrencyInterface {
  private:
   template <typename Func,
             typename ReturnValue = typename std::result_of_t<Func()>>
-  class Task : public FutureInterface<ReturnValue> {
+  class Task : public internal::FutureBase<ReturnValue> {
    public:
-    Task(Func func) : func_(std::move(func)) {}
+    // The optional `drive` callback is invoked by `Get()` before the task has
+    // been scheduled, to help complete the inputs the task depends on.
+    explicit Task(Func func, std::function<void()> drive = nullptr)
+        : func_(std::move(func)), drive_(std::move(drive)) {}
     virtual ~Task() {}
     void Run() {
-      if (std::is_void_v<ReturnValue>) {
-        std::move(func_)();
-      } else {
-        result_ = std::move(func_)();
-      }
+      absl::StatusOr<ReturnValue> result(absl::in_place,
+                                         std::move(*func_)());
+      // Release the captured state as soon as it is no longer needed.
+      func_.reset();
+      this->SetResult(std::move(result));
     }
     absl::StatusOr<ReturnValue> Get() override {
-      if (!waitable_.ok()) {
-        return waitable_.status();
+      std::function<void()> drive;
+      {
+        absl::MutexLock lock(&this->mutex_);
+        if (!this->done_ && !waitable_.has_value()) {
+          drive = drive_;
+        }
+      }
+      if (drive) {
+        drive();
       }
-      absl::Status status = waitable_.value()->Wait();
-      if (!status.ok()) {
-        return status;
+      std::shared_ptr<WaitableInterface> waitable;
+      {
+        absl::MutexLock lock(&this->mutex_);
+        this->mutex_.Await(absl::Condition(this, &Task::IsDoneOrScheduled));
+        if (!this->done_) {
+          waitable = waitable_->value();
+        }
       }
-      return result_;
+      if (waitable != nullptr) {
+        absl::Status status = waitable->Wait();
+        if (!status.ok()) {
+          return status;
+        }
+      }
+      return this->AwaitResult();
     }
     void SetWaitable(
         absl::StatusOr<std::shared_ptr<WaitableInterface>> waitable) {
+      if (!waitable.ok()) {
+        this->SetResult(waitable.status());
+        return;
+      }
+      absl::MutexLock lock(&this->mutex_);
       waitable_ = std::move(waitable);
+      drive_ = nullptr;
     }
 
    private:
-    Func func_;
-    ReturnValue result_;
-    absl::StatusOr<std::shared_ptr<WaitableInterface>> waitable_;
+    bool IsDoneOrScheduled() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(this->mutex_) {
+      return this->done_ || waitable_.has_value();
+    }
+
+    std::optional<Func> func_;
+    std::optional<absl::StatusOr<std::shared_ptr<WaitableInterface>>> waitable_
+        ABSL_GUARDED_BY(this->mutex_);
+    std::function<void()> drive_ ABSL_GUARDED_BY(this->mutex_);
   };
 };
 
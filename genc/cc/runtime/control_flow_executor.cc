@@ -15,23 +15,27 @@ limitations under the License
 
 #include "genc/cc/runtime/control_flow_executor.h"
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
-#include <tuple>
 #include <utility>
 #include <variant>
 #include <vector>
 
-#include "absl/base/attributes.h"
+#include "absl/container/fixed_array.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "genc/cc/runtime/compiled_computation.h"
 #include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/executor.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
@@ -43,94 +47,81 @@ namespace {
 
 class ExecutorValue;
 class ControlFlowExecutor;
-class Scope;
+class Frame;
 
-using NamedValue = std::tuple<std::string, std::shared_ptr<ExecutorValue>>;
+// A value that becomes available once an asynchronous intrinsic call
+// completes.
+using DeferredValue =
+    std::shared_ptr<FutureInterface<std::shared_ptr<ExecutorValue>>>;
 
-// An object for tracking a lambda that was created in a specific scope.
+// The values a closure captured from its enclosing frame when it was created,
+// in the order of `CompiledFrame::capture_sources`.
+using Captures = absl::InlinedVector<std::shared_ptr<ExecutorValue>, 4>;
+
+// An object for tracking a lambda together with the values it captured.
 class ScopedLambda {
  public:
-  explicit ScopedLambda(v0::Lambda lambda_pb, std::shared_ptr<Scope> scope)
-      : lambda_pb_(std::move(lambda_pb)), scope_(std::move(scope)) {}
-  ScopedLambda(ScopedLambda&& other)
-      : lambda_pb_(std::move(other.lambda_pb_)),
-        scope_(std::move(other.scope_)) {}
+  ScopedLambda(const CompiledNode* lambda, Captures captures,
+               std::shared_ptr<const CompiledComputation> computation)
+      : lambda_(lambda),
+        captures_(std::move(captures)),
+        computation_(std::move(computation)) {}
 
   absl::StatusOr<std::shared_ptr<ExecutorValue>> Call(
       const ControlFlowExecutor& executor,
       std::optional<std::shared_ptr<ExecutorValue>> arg) const;
 
-  v0::Value as_value_pb() const {
-    v0::Value value_pb;
-    *value_pb.mutable_lambda() = lambda_pb_;
-    return value_pb;
+  // The lambda's `v0::Value`, sharing ownership with the computation.
+  std::shared_ptr<const v0::Value> value_pb() const {
+    return std::shared_ptr<const v0::Value>(computation_, lambda_->value_pb);
   }
 
  private:
-  v0::Lambda lambda_pb_;
-  std::shared_ptr<Scope> scope_;
+  const CompiledNode* lambda_;
+  Captures captures_;
+  // Owns `lambda_`.
+  std::shared_ptr<const CompiledComputation> computation_;
 };
 
-// An object for tracking an intrinsic that was created in a specific scope.
+// An object for tracking an intrinsic together with the environment frame of
+// values it captured.
 class ScopedIntrinsic {
  public:
-  explicit ScopedIntrinsic(v0::Intrinsic intrinsic_pb,
-                           const IntrinsicHandler* intrinsic_handler,
-                           std::shared_ptr<Scope> scope)
-      : intrinsic_pb_(std::move(intrinsic_pb)),
+  ScopedIntrinsic(const CompiledNode* intrinsic,
+                  const IntrinsicHandler* intrinsic_handler,
+                  std::shared_ptr<Frame> environment)
+      : intrinsic_(intrinsic),
         intrinsic_handler_(intrinsic_handler),
-        scope_(std::move(scope)) {}
-
-  ScopedIntrinsic(ScopedIntrinsic&& other)
-      : intrinsic_pb_(std::move(other.intrinsic_pb_)),
-        intrinsic_handler_(other.intrinsic_handler_),
-        scope_(std::move(other.scope_)) {}
+        environment_(std::move(environment)) {}
 
+  // The `self` argument is the value holding this intrinsic, which is kept
+  // alive until an asynchronous call completes.
   absl::StatusOr<std::shared_ptr<ExecutorValue>> Call(
       const ControlFlowExecutor& executor,
+      std::shared_ptr<ExecutorValue> self,
       std::optional<std::shared_ptr<ExecutorValue>> arg) const;
 
-  const v0::Intrinsic& intrinsic_pb() const { return intrinsic_pb_; }
+  const v0::Intrinsic& intrinsic_pb() const {
+    return intrinsic_->value_pb->intrinsic();
+  }
 
  private:
-  v0::Intrinsic intrinsic_pb_;
-  const IntrinsicHandler* const intrinsic_handler_;
-  std::shared_ptr<Scope> scope_;
-};
-
-// An object for tracking computaton evalution scopes.
-class Scope {
- public:
-  Scope() = default;
-  Scope(NamedValue binding, std::shared_ptr<Scope> parent)
-      : binding_(std::move(binding)), parent_(std::move(parent)) {}
-  Scope(Scope&& other)
-      : binding_(std::move(other.binding_)),
-        parent_(std::move(other.parent_)) {}
-
-  // Returns the first executor value whose name matches the `name` argument.
-  // Otherwise, returns a `NotFound` error if the `name` is not present in any
-  // ancestor scope.
-  absl::StatusOr<std::shared_ptr<ExecutorValue>> Resolve(
-      absl::string_view name) const;
-
-  // Returns a human readable string for debugging the current scope.
-  std::string DebugString() const;
-
- private:
-  Scope(const Scope& scope) = delete;
-
-  std::optional<NamedValue> binding_;
-
-  // Pointer to enclosing scope. `nullopt` iff this is the root scope.
-  // If a value is present, it must not be `nullptr`.
-  std::optional<std::shared_ptr<Scope>> parent_;
+  const CompiledNode* intrinsic_;
+  const IntrinsicHandler* intrinsic_handler_;
+  std::shared_ptr<Frame> environment_;
 };
 
 // A value object for the ControlFlowExecutor.
 class ExecutorValue {
  public:
-  enum ValueType { UNKNOWN, EMBEDDED, STRUCTURE, LAMBDA, INTRINSIC };
+  enum ValueType {
+    UNKNOWN,
+    EMBEDDED,
+    STRUCTURE,
+    LAMBDA,
+    INTRINSIC,
+    DEFERRED
+  };
 
   explicit ExecutorValue(OwnedValueId&& child_value_id)
       : value_(std::move(child_value_id)) {}
@@ -140,6 +131,8 @@ class ExecutorValue {
       : value_(std::move(scoped_lambda)) {}
   explicit ExecutorValue(ScopedIntrinsic&& scoped_intrinsic)
       : value_(std::move(scoped_intrinsic)) {}
+  explicit ExecutorValue(DeferredValue deferred_value)
+      : value_(std::move(deferred_value)) {}
 
   ValueType type() const {
     if (std::holds_alternative<OwnedValueId>(value_)) {
@@ -151,6 +144,8 @@ class ExecutorValue {
       return LAMBDA;
     } else if (std::holds_alternative<ScopedIntrinsic>(value_)) {
       return INTRINSIC;
+    } else if (std::holds_alternative<DeferredValue>(value_)) {
+      return DEFERRED;
     } else {
       return UNKNOWN;
     }
@@ -170,6 +165,10 @@ class ExecutorValue {
     return std::get<ScopedIntrinsic>(value_);
   }
 
+  const DeferredValue& deferred() const {
+    return std::get<DeferredValue>(value_);
+  }
+
   std::string DebugString() const;
 
   // Move-only.
@@ -182,10 +181,29 @@ class ExecutorValue {
   ExecutorValue() = delete;
 
   std::variant<OwnedValueId, std::vector<std::shared_ptr<ExecutorValue>>,
-               ScopedLambda, ScopedIntrinsic>
+               ScopedLambda, ScopedIntrinsic, DeferredValue>
       value_;
 };
 
+// The slots of a single evaluation of a `CompiledFrame`, allocated together
+// with the frame itself for small frames.
+class Frame {
+ public:
+  Frame(int num_slots, std::shared_ptr<const CompiledComputation> computation)
+      : computation_(std::move(computation)), slots_(num_slots) {}
+
+  std::shared_ptr<ExecutorValue>& slot(int index) { return slots_[index]; }
+
+  // The computation that owns the nodes evaluated in this frame.
+  const std::shared_ptr<const CompiledComputation>& computation() const {
+    return computation_;
+  }
+
+ private:
+  const std::shared_ptr<const CompiledComputation> computation_;
+  absl::FixedArray<std::shared_ptr<ExecutorValue>, 8> slots_;
+};
+
 // Executor that specializes in handling lambda expressions and control flow,
 // and otherwise delegates all processing to a specified child executor.
 class ControlFlowExecutor
@@ -194,10 +212,14 @@ class ControlFlowExecutor
   explicit ControlFlowExecutor(
       std::shared_ptr<IntrinsicHandlerSet> handler_set,
       std::shared_ptr<Executor> child_executor,
-      std::shared_ptr<ConcurrencyInterface> concurrency_interface)
+      std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+      const ControlFlowExecutorOptions& options)
       : intrinsic_handlers_(handler_set),
         child_executor_(std::move(child_executor)),
-        concurrency_interface_(std::move(concurrency_interface)) {}
+        concurrency_interface_(std::move(concurrency_interface)),
+        options_(options),
+        compiled_computations_(handler_set,
+                               options.compiled_computation_cache_size) {}
 
   ~ControlFlowExecutor() override { ClearTracked(); }
 
@@ -205,9 +227,25 @@ class ControlFlowExecutor
     return concurrency_interface_;
   }
 
-  // Evaluates a value in the current scope.
-  absl::StatusOr<std::shared_ptr<ExecutorValue>> Evaluate(
-      const v0::Value& value_pb, const std::shared_ptr<Scope>& scope) const;
+  bool async_control_flow() const { return options_.async_control_flow; }
+
+  // Evaluates `compiled_frame` in a new frame, populated with the values
+  // captured by the closure being evaluated and the optional argument.
+  absl::StatusOr<std::shared_ptr<ExecutorValue>> EvaluateFrame(
+      const CompiledFrame& compiled_frame,
+      absl::Span<const std::shared_ptr<ExecutorValue>> captures,
+      std::optional<std::shared_ptr<ExecutorValue>> arg,
+      std::shared_ptr<const CompiledComputation> computation) const;
+
+  // Evaluates a computation that a handler of `intrinsic` created from its
+  // static parameter, in the intrinsic's `environment` frame.
+  absl::StatusOr<std::shared_ptr<ExecutorValue>> EvaluateStaticParameter(
+      const v0::Value& value_pb, const CompiledIntrinsic& intrinsic,
+      Frame& environment) const;
+
+  // Returns the values `compiled_frame` captures from `enclosing`.
+  static Captures Capture(const CompiledFrame& compiled_frame,
+                          Frame& enclosing);
 
   // TODO(b/295015950): Clean these up by consolidating intrinsic handling
   // in one place behind an interop API, and removing these calls from a public
@@ -224,6 +262,8 @@ class ControlFlowExecutor
                                 v0::Value* value_pb) const;
   absl::StatusOr<std::shared_ptr<ExecutorValue>> ConstCreateExecutorValue(
       const v0::Value& value_pb) const;
+  void ConstOnReady(std::shared_ptr<ExecutorValue> value,
+                    std::function<void()> callback) const;
 
  protected:
   absl::string_view ExecutorName() final {
@@ -234,6 +274,9 @@ class ControlFlowExecutor
   absl::StatusOr<std::shared_ptr<ExecutorValue>> CreateExecutorValue(
       const v0::Value& value_pb) final;
 
+  absl::StatusOr<std::shared_ptr<ExecutorValue>> CreateSharedExecutorValue(
+      std::shared_ptr<const v0::Value> value_pb) final;
+
   absl::StatusOr<std::shared_ptr<ExecutorValue>> CreateCall(
       std::shared_ptr<ExecutorValue> function,
       std::optional<std::shared_ptr<ExecutorValue>> argument) final;
@@ -250,76 +293,68 @@ class ControlFlowExecutor
   absl::Status Materialize(std::shared_ptr<ExecutorValue> value,
                            v0::Value* value_pb) final;
 
+  void OnReady(std::shared_ptr<ExecutorValue> value,
+               std::function<void()> callback) final;
+
  private:
   const std::shared_ptr<IntrinsicHandlerSet> intrinsic_handlers_;
   const std::shared_ptr<Executor> child_executor_;
   const std::shared_ptr<ConcurrencyInterface> concurrency_interface_;
+  const ControlFlowExecutorOptions options_;
+  mutable CompiledComputationCache compiled_computations_;
+
+  // Waits for a deferred value to resolve. Returns other values unchanged.
+  static absl::StatusOr<std::shared_ptr<ExecutorValue>> Resolve(
+      std::shared_ptr<ExecutorValue> value);
 
   // Converts an `ExecutorValue` into a child executor value.
   absl::StatusOr<ValueId> Embed(const ExecutorValue& value,
                                 std::optional<OwnedValueId>* slot) const;
 
+  absl::StatusOr<std::shared_ptr<ExecutorValue>> Evaluate(
+      const CompiledNode& node, const std::shared_ptr<Frame>& frame) const;
+
   absl::StatusOr<std::shared_ptr<ExecutorValue>> EvaluateBlock(
-      const v0::Block& block_pb, const std::shared_ptr<Scope>& scope) const;
+      const CompiledNode& node, const std::shared_ptr<Frame>& frame) const;
 
   absl::StatusOr<std::shared_ptr<ExecutorValue>> EvaluateReference(
-      const v0::Reference& reference_pb,
-      const std::shared_ptr<Scope>& scope) const;
+      const CompiledNode& node, const std::shared_ptr<Frame>& frame) const;
 
   absl::StatusOr<std::shared_ptr<ExecutorValue>> EvaluateLambda(
-      const v0::Lambda& lambda_pb, const std::shared_ptr<Scope>& scope) const;
+      const CompiledNode& node, const std::shared_ptr<Frame>& frame) const;
+
+  absl::StatusOr<std::shared_ptr<ExecutorValue>> EvaluateIntrinsic(
+      const CompiledNode& node, const std::shared_ptr<Frame>& frame) const;
 
   absl::StatusOr<std::shared_ptr<ExecutorValue>> EvaluateCall(
-      const v0::Call& call_pb, const std::shared_ptr<Scope>& scope) const;
+      const CompiledNode& node, const std::shared_ptr<Frame>& frame) const;
 
   absl::StatusOr<std::shared_ptr<ExecutorValue>> EvaluateStruct(
-      const v0::Struct& struct_pb, const std::shared_ptr<Scope>& scope) const;
+      const CompiledNode& node, const std::shared_ptr<Frame>& frame) const;
+
+  // Whether to dispatch the evaluation of `nodes` concurrently.
+  bool ShouldEvaluateInParallel(
+      absl::Span<const CompiledNode* const> nodes) const;
+
+  // Starts evaluating each of the locals of `block` once the locals it depends
+  // on are available, and returns their values in declaration order.
+  std::vector<DeferredValue> DispatchLocals(
+      const CompiledNode& block, const std::shared_ptr<Frame>& frame) const;
+
+  // Waits for all of `values`, and returns the index and error of the first
+  // one in order that failed, if any.
+  static std::optional<std::pair<size_t, absl::Status>> AwaitAll(
+      absl::Span<const DeferredValue> values);
 
   absl::StatusOr<std::shared_ptr<ExecutorValue>> EvaluateSelection(
-      const v0::Selection& selection_pb,
-      const std::shared_ptr<Scope>& scope) const;
+      const CompiledNode& node, const std::shared_ptr<Frame>& frame) const;
 };
 
 absl::StatusOr<std::shared_ptr<ExecutorValue>> ScopedLambda::Call(
     const ControlFlowExecutor& executor,
     std::optional<std::shared_ptr<ExecutorValue>> arg) const {
-  if (arg.has_value()) {
-    NamedValue named_value =
-        std::make_tuple(lambda_pb_.parameter_name(), std::move(arg.value()));
-    auto new_scope = std::make_shared<Scope>(std::move(named_value), scope_);
-    return executor.Evaluate(lambda_pb_.result(), new_scope);
-  } else {
-    return executor.Evaluate(lambda_pb_.result(), scope_);
-  }
-}
-
-absl::StatusOr<std::shared_ptr<ExecutorValue>> Scope::Resolve(
-    absl::string_view name) const {
-  if (binding_.has_value()) {
-    if (std::get<0>(*binding_) == name) {
-      return std::get<1>(*binding_);
-    }
-  }
-  if (parent_.has_value()) {
-    return parent_.value()->Resolve(name);
-  }
-  return absl::NotFoundError(
-      absl::StrCat("Could not find reference [", name, "]"));
-}
-
-std::string Scope::DebugString() const {
-  std::string msg;
-  if (binding_.has_value()) {
-    msg = absl::StrCat("[", std::get<0>(*binding_), "=",
-                       std::get<1>(*binding_)->DebugString(), "]");
-  } else {
-    msg = "[]";
-  }
-  if (parent_.has_value()) {
-    return absl::StrCat(parent_.value()->DebugString(), "->", msg);
-  } else {
-    return msg;
-  }
+  return executor.EvaluateFrame(*lambda_->frame, captures_, std::move(arg),
+                                computation_);
 }
 
 std::string ExecutorValue::DebugString() const {
@@ -328,6 +363,8 @@ std::string ExecutorValue::DebugString() const {
   } else if (std::holds_alternative<
                  std::vector<std::shared_ptr<ExecutorValue>>>(value_)) {
     return "<V>";
+  } else if (std::holds_alternative<DeferredValue>(value_)) {
+    return "D";
   } else {
     return "invalid";
   }
@@ -352,7 +389,9 @@ ControlFlowExecutor::ConstCreateExecutorValue(const v0::Value& value_pb) const {
     case v0::Value::kStruct:
     case v0::Value::kSelection:
     case v0::Value::kIntrinsic: {
-      return Evaluate(value_pb, std::make_shared<Scope>());
+      std::shared_ptr<const CompiledComputation> computation =
+          compiled_computations_.GetOrCompile(value_pb);
+      return EvaluateFrame(computation->root(), {}, std::nullopt, computation);
     }
     default:
       return absl::UnimplementedError(absl::StrCat(
@@ -365,6 +404,37 @@ ControlFlowExecutor::CreateExecutorValue(const v0::Value& value_pb) {
   return ConstCreateExecutorValue(value_pb);
 }
 
+absl::StatusOr<std::shared_ptr<ExecutorValue>>
+ControlFlowExecutor::CreateSharedExecutorValue(
+    std::shared_ptr<const v0::Value> value_pb) {
+  switch (value_pb->value_case()) {
+    case v0::Value::kStr:
+    case v0::Value::kBoolean:
+    case v0::Value::kTensor:
+    case v0::Value::kInt32:
+    case v0::Value::kFloat32:
+    case v0::Value::kMedia: {
+      // Data is passed on to the child executor without copying it.
+      return std::make_shared<ExecutorValue>(
+          GENC_TRY(child_executor_->CreateSharedValue(std::move(value_pb))));
+    }
+    case v0::Value::kBlock:
+    case v0::Value::kReference:
+    case v0::Value::kCall:
+    case v0::Value::kLambda:
+    case v0::Value::kStruct:
+    case v0::Value::kSelection:
+    case v0::Value::kIntrinsic: {
+      // Found by address when the same computation is run again.
+      std::shared_ptr<const CompiledComputation> computation =
+          compiled_computations_.GetOrCompile(std::move(value_pb));
+      return EvaluateFrame(computation->root(), {}, std::nullopt, computation);
+    }
+    default:
+      return ConstCreateExecutorValue(*value_pb);
+  }
+}
+
 absl::StatusOr<std::shared_ptr<ExecutorValue>> ControlFlowExecutor::CreateCall(
     std::shared_ptr<ExecutorValue> function,
     std::optional<std::shared_ptr<ExecutorValue>> argument) {
@@ -375,6 +445,7 @@ absl::StatusOr<std::shared_ptr<ExecutorValue>>
 ControlFlowExecutor::ConstCreateCall(
     std::shared_ptr<ExecutorValue> function,
     std::optional<std::shared_ptr<ExecutorValue>> argument) const {
+  function = GENC_TRY(Resolve(std::move(function)));
   switch (function->type()) {
     case ExecutorValue::EMBEDDED: {
       std::optional<OwnedValueId> slot;
@@ -393,8 +464,10 @@ ControlFlowExecutor::ConstCreateCall(
           "Received value type [STRUCTURE] which is not a function.");
     }
     case ExecutorValue::INTRINSIC: {
-      return function->intrinsic().Call(*this, std::move(argument));
+      const ScopedIntrinsic& intrinsic = function->intrinsic();
+      return intrinsic.Call(*this, std::move(function), std::move(argument));
     }
+    case ExecutorValue::DEFERRED:
     case ExecutorValue::UNKNOWN: {
       return absl::InternalError(
           "Unknown function type passed to CreateCall [UNKNOWN]");
@@ -429,6 +502,7 @@ ControlFlowExecutor::ConstCreateSelection(std::shared_ptr<ExecutorValue> value,
 absl::StatusOr<std::shared_ptr<ExecutorValue>>
 ControlFlowExecutor::CreateSelectionInternal(
     std::shared_ptr<ExecutorValue> source, const uint32_t index) const {
+  source = GENC_TRY(Resolve(std::move(source)));
   switch (source->type()) {
     case ExecutorValue::ValueType::EMBEDDED: {
       const OwnedValueId& child_id = source->embedded();
@@ -451,6 +525,7 @@ ControlFlowExecutor::CreateSelectionInternal(
       return absl::InvalidArgumentError(
           "Cannot perform selection on a Lambda or Intrinsic value");
     }
+    case ExecutorValue::ValueType::DEFERRED:
     case ExecutorValue::ValueType::UNKNOWN: {
       return absl::InvalidArgumentError(
           "Cannot perform selection on unknown type value");
@@ -470,6 +545,70 @@ absl::Status ControlFlowExecutor::ConstMaterialize(
   return child_executor_->Materialize(child_value_id, value_pb);
 }
 
+void ControlFlowExecutor::OnReady(std::shared_ptr<ExecutorValue> value,
+                                  std::function<void()> callback) {
+  ConstOnReady(std::move(value), std::move(callback));
+}
+
+void ControlFlowExecutor::ConstOnReady(std::shared_ptr<ExecutorValue> value,
+                                       std::function<void()> callback) const {
+  switch (value->type()) {
+    case ExecutorValue::ValueType::EMBEDDED: {
+      child_executor_->OnReady(value->embedded(), std::move(callback));
+      return;
+    }
+    case ExecutorValue::ValueType::STRUCTURE: {
+      const std::vector<std::shared_ptr<ExecutorValue>>& elements =
+          value->structure();
+      if (elements.empty()) {
+        callback();
+        return;
+      }
+      auto remaining = std::make_shared<std::atomic<size_t>>(elements.size());
+      auto shared_callback =
+          std::make_shared<std::function<void()>>(std::move(callback));
+      for (const std::shared_ptr<ExecutorValue>& element : elements) {
+        ConstOnReady(element, [remaining, shared_callback]() {
+          if (remaining->fetch_sub(1) == 1) {
+            (*shared_callback)();
+          }
+        });
+      }
+      return;
+    }
+    case ExecutorValue::ValueType::DEFERRED: {
+      DeferredValue deferred = value->deferred();
+      deferred->OnReady(
+          [this, this_keepalive = shared_from_this(), deferred,
+           callback = std::move(callback)]() mutable {
+            absl::StatusOr<std::shared_ptr<ExecutorValue>> resolved =
+                deferred->Get();
+            if (resolved.ok()) {
+              ConstOnReady(*std::move(resolved), std::move(callback));
+            } else {
+              // Let the subsequent `Materialize` report the error.
+              callback();
+            }
+          });
+      return;
+    }
+    case ExecutorValue::ValueType::LAMBDA:
+    case ExecutorValue::ValueType::INTRINSIC:
+    case ExecutorValue::ValueType::UNKNOWN: {
+      callback();
+      return;
+    }
+  }
+}
+
+absl::StatusOr<std::shared_ptr<ExecutorValue>> ControlFlowExecutor::Resolve(
+    std::shared_ptr<ExecutorValue> value) {
+  while (value->type() == ExecutorValue::ValueType::DEFERRED) {
+    value = GENC_TRY(value->deferred()->Get());
+  }
+  return value;
+}
+
 absl::StatusOr<ValueId> ControlFlowExecutor::Embed(
     const ExecutorValue& value, std::optional<OwnedValueId>* slot) const {
   switch (value.type()) {
@@ -496,12 +635,17 @@ absl::StatusOr<ValueId> ControlFlowExecutor::Embed(
     case ExecutorValue::ValueType::LAMBDA: {
       // Forward a lambda to the child executor. An example of this situation is
       // when a Lambda is an argument to an intrinsic call.
-      OwnedValueId embedded_value_id =
-          GENC_TRY(child_executor_->CreateValue(value.lambda().as_value_pb()));
+      OwnedValueId embedded_value_id = GENC_TRY(
+          child_executor_->CreateSharedValue(value.lambda().value_pb()));
       ValueId value_id = embedded_value_id.ref();
       slot->emplace(std::move(embedded_value_id));
       return value_id;
     }
+    case ExecutorValue::ValueType::DEFERRED: {
+      std::shared_ptr<ExecutorValue> resolved =
+          GENC_TRY(value.deferred()->Get());
+      return Embed(*resolved, slot);
+    }
     case ExecutorValue::ValueType::INTRINSIC:
     case ExecutorValue::ValueType::UNKNOWN: {
       return absl::InternalError("Tried to embed an unsupported value type.");
@@ -509,120 +653,274 @@ absl::StatusOr<ValueId> ControlFlowExecutor::Embed(
   }
 }
 
+absl::StatusOr<std::shared_ptr<ExecutorValue>>
+ControlFlowExecutor::EvaluateFrame(
+    const CompiledFrame& compiled_frame,
+    absl::Span<const std::shared_ptr<ExecutorValue>> captures,
+    std::optional<std::shared_ptr<ExecutorValue>> arg,
+    std::shared_ptr<const CompiledComputation> computation) const {
+  auto frame = std::make_shared<Frame>(compiled_frame.num_slots,
+                                       std::move(computation));
+  if (arg.has_value()) {
+    frame->slot(0) = std::move(arg.value());
+  }
+  for (size_t i = 0; i < captures.size(); ++i) {
+    frame->slot(compiled_frame.capture_slots[i]) = captures[i];
+  }
+  return Evaluate(*compiled_frame.body, frame);
+}
+
+absl::StatusOr<std::shared_ptr<ExecutorValue>>
+ControlFlowExecutor::EvaluateStaticParameter(const v0::Value& value_pb,
+                                             const CompiledIntrinsic& intrinsic,
+                                             Frame& environment) const {
+  auto compiled_frame = intrinsic.static_parameters.find(&value_pb);
+  if (compiled_frame != intrinsic.static_parameters.end()) {
+    return EvaluateFrame(*compiled_frame->second,
+                         Capture(*compiled_frame->second, environment),
+                         std::nullopt, environment.computation());
+  }
+  // Not a part of the static parameter that was compiled up front.
+  std::shared_ptr<const CompiledComputation> computation =
+      compiled_computations_.GetOrCompile(value_pb, intrinsic.environment);
+  return EvaluateFrame(computation->root(),
+                       Capture(computation->root(), environment), std::nullopt,
+                       computation);
+}
+
+Captures ControlFlowExecutor::Capture(const CompiledFrame& compiled_frame,
+                                      Frame& enclosing) {
+  Captures captures;
+  captures.reserve(compiled_frame.capture_sources.size());
+  for (int source : compiled_frame.capture_sources) {
+    captures.push_back(enclosing.slot(source));
+  }
+  return captures;
+}
+
 absl::StatusOr<std::shared_ptr<ExecutorValue>> ControlFlowExecutor::Evaluate(
-    const v0::Value& value_pb, const std::shared_ptr<Scope>& scope) const {
-  switch (value_pb.value_case()) {
-    case v0::Value::kBlock: {
-      return EvaluateBlock(value_pb.block(), scope);
+    const CompiledNode& node, const std::shared_ptr<Frame>& frame) const {
+  switch (node.kind) {
+    case CompiledNode::BLOCK: {
+      return EvaluateBlock(node, frame);
     }
-    case v0::Value::kReference: {
-      return EvaluateReference(value_pb.reference(), scope);
+    case CompiledNode::REFERENCE: {
+      return EvaluateReference(node, frame);
     }
-    case v0::Value::kCall: {
-      return EvaluateCall(value_pb.call(), scope);
+    case CompiledNode::CALL: {
+      return EvaluateCall(node, frame);
     }
-    case v0::Value::kSelection: {
-      return EvaluateSelection(value_pb.selection(), scope);
+    case CompiledNode::SELECTION: {
+      return EvaluateSelection(node, frame);
     }
-    case v0::Value::kStruct: {
-      return EvaluateStruct(value_pb.struct_(), scope);
+    case CompiledNode::STRUCT: {
+      return EvaluateStruct(node, frame);
     }
-    case v0::Value::kLambda: {
-      return EvaluateLambda(value_pb.lambda(), scope);
+    case CompiledNode::LAMBDA: {
+      return EvaluateLambda(node, frame);
     }
-    case v0::Value::kIntrinsic: {
-      const v0::Intrinsic& intr_pb = value_pb.intrinsic();
-      const IntrinsicHandler* const handler =
-          GENC_TRY(intrinsic_handlers_->GetHandler(intr_pb.uri()));
-      GENC_TRY(handler->CheckWellFormed(intr_pb));
-      if (handler->interface_type() == IntrinsicHandler::CONTROL_FLOW) {
-        GENC_TRY(handler->CheckWellFormed(intr_pb));
-        return std::make_shared<ExecutorValue>(
-            ScopedIntrinsic{intr_pb, handler, scope});
-      } else {
-        // Non control-flow intrinsics must be handled by the child executor.
-        ABSL_FALLTHROUGH_INTENDED;
-      }
+    case CompiledNode::INTRINSIC: {
+      return EvaluateIntrinsic(node, frame);
     }
-    default: {
+    case CompiledNode::VALUE: {
+      // Shares the node with the child executor instead of copying it.
       return std::make_shared<ExecutorValue>(
-          GENC_TRY(child_executor_->CreateValue(value_pb)));
+          GENC_TRY(child_executor_->CreateSharedValue(
+              std::shared_ptr<const v0::Value>(frame->computation(),
+                                               node.value_pb))));
     }
   }
 }
 
 absl::StatusOr<std::shared_ptr<ExecutorValue>>
-ControlFlowExecutor::EvaluateBlock(const v0::Block& block_pb,
-                                   const std::shared_ptr<Scope>& scope) const {
-  std::shared_ptr<Scope> current_scope = scope;
+ControlFlowExecutor::EvaluateBlock(const CompiledNode& node,
+                                   const std::shared_ptr<Frame>& frame) const {
+  const v0::Block& block_pb = node.value_pb->block();
   auto local_pb_formatter = [](std::string* out,
                                const v0::Block::Local& local_pb) {
     out->append(local_pb.name());
   };
-  for (int i = 0; i < block_pb.local_size(); ++i) {
-    const v0::Block::Local& local_pb = block_pb.local(i);
-    std::shared_ptr<ExecutorValue> value = GENC_TRY(
-        Evaluate(local_pb.value(), current_scope),
-        absl::StrCat(
-            "while evaluating local [", local_pb.name(), "] in block locals [",
-            absl::StrJoin(block_pb.local(), ",", local_pb_formatter), "]"));
-    current_scope = std::make_shared<Scope>(
-        std::make_tuple(local_pb.name(), std::move(value)),
-        std::move(current_scope));
+  auto annotation = [&](int i) {
+    return absl::StrCat(
+        "while evaluating local [", block_pb.local(i).name(),
+        "] in block locals [",
+        absl::StrJoin(block_pb.local(), ",", local_pb_formatter), "]");
+  };
+  absl::Span<const CompiledNode* const> locals =
+      absl::MakeConstSpan(node.children).first(block_pb.local_size());
+  if (ShouldEvaluateInParallel(locals)) {
+    std::optional<std::pair<size_t, absl::Status>> error =
+        AwaitAll(DispatchLocals(node, frame));
+    if (error.has_value()) {
+      GENC_TRY(error->second, annotation(error->first));
+    }
+  } else {
+    for (int i = 0; i < block_pb.local_size(); ++i) {
+      frame->slot(node.local_slots[i]) =
+          GENC_TRY(Evaluate(*node.children[i], frame), annotation(i));
+    }
   }
-  return Evaluate(block_pb.result(), current_scope);
+  return Evaluate(*node.children.back(), frame);
 }
 
 absl::StatusOr<std::shared_ptr<ExecutorValue>>
 ControlFlowExecutor::EvaluateReference(
-    const v0::Reference& reference_pb,
-    const std::shared_ptr<Scope>& scope) const {
-  std::shared_ptr<ExecutorValue> resolved_value =
-      GENC_TRY(scope->Resolve(reference_pb.name()),
-               absl::StrCat("while searching scope: ", scope->DebugString()));
+    const CompiledNode& node, const std::shared_ptr<Frame>& frame) const {
+  std::shared_ptr<ExecutorValue> resolved_value;
+  if (node.slot.has_value()) {
+    resolved_value = frame->slot(*node.slot);
+  }
   if (resolved_value == nullptr) {
-    return absl::InternalError(
-        absl::StrCat("Resolved reference [", reference_pb.name(),
-                     "] was nullptr. Scope: ", scope->DebugString()));
+    return absl::NotFoundError(absl::StrCat(
+        "Could not find reference [", node.value_pb->reference().name(), "]"));
   }
   return resolved_value;
 }
 
 absl::StatusOr<std::shared_ptr<ExecutorValue>>
-ControlFlowExecutor::EvaluateCall(const v0::Call& call_pb,
-                                  const std::shared_ptr<Scope>& scope) const {
+ControlFlowExecutor::EvaluateCall(const CompiledNode& node,
+                                  const std::shared_ptr<Frame>& frame) const {
   std::shared_ptr<ExecutorValue> function =
-      GENC_TRY(Evaluate(call_pb.function(), scope));
+      GENC_TRY(Evaluate(*node.children[0], frame));
   std::optional<std::shared_ptr<ExecutorValue>> argument;
-  if (call_pb.has_argument()) {
-    argument = GENC_TRY(Evaluate(call_pb.argument(), scope));
+  if (node.children.size() > 1) {
+    argument = GENC_TRY(Evaluate(*node.children[1], frame));
   }
   return ConstCreateCall(std::move(function), std::move(argument));
 }
 
 absl::StatusOr<std::shared_ptr<ExecutorValue>>
-ControlFlowExecutor::EvaluateStruct(const v0::Struct& struct_pb,
-                                    const std::shared_ptr<Scope>& scope) const {
+ControlFlowExecutor::EvaluateStruct(const CompiledNode& node,
+                                    const std::shared_ptr<Frame>& frame) const {
   std::vector<std::shared_ptr<ExecutorValue>> elements;
-  elements.reserve(struct_pb.element_size());
-  for (const v0::Value& element_pb : struct_pb.element()) {
-    elements.emplace_back(GENC_TRY(Evaluate(element_pb, scope)));
+  elements.reserve(node.children.size());
+  if (!ShouldEvaluateInParallel(node.children)) {
+    for (const CompiledNode* element : node.children) {
+      elements.emplace_back(GENC_TRY(Evaluate(*element, frame)));
+    }
+    return std::make_shared<ExecutorValue>(std::move(elements));
+  }
+  std::vector<DeferredValue> deferred_elements;
+  deferred_elements.reserve(node.children.size());
+  for (const CompiledNode* element : node.children) {
+    if (element->has_call) {
+      deferred_elements.push_back(Flatten(concurrency_interface_->RunAsync(
+          [this, this_keepalive = shared_from_this(), element, frame]() {
+            return Evaluate(*element, frame);
+          })));
+    } else {
+      deferred_elements.push_back(MakeReadyFuture(Evaluate(*element, frame)));
+    }
+  }
+  std::optional<std::pair<size_t, absl::Status>> error =
+      AwaitAll(deferred_elements);
+  if (error.has_value()) {
+    return error->second;
+  }
+  for (const DeferredValue& element : deferred_elements) {
+    elements.emplace_back(*element->Get());
   }
   return std::make_shared<ExecutorValue>(std::move(elements));
 }
 
+bool ControlFlowExecutor::ShouldEvaluateInParallel(
+    absl::Span<const CompiledNode* const> nodes) const {
+  if (!options_.parallel_evaluation) {
+    return false;
+  }
+  int num_calls = 0;
+  for (const CompiledNode* node : nodes) {
+    if (node->has_call && ++num_calls > 1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<DeferredValue> ControlFlowExecutor::DispatchLocals(
+    const CompiledNode& block, const std::shared_ptr<Frame>& frame) const {
+  const size_t num_locals = block.local_slots.size();
+  std::vector<DeferredValue> locals;
+  locals.reserve(num_locals);
+  // Whether each local was evaluated synchronously, and is hence available.
+  std::vector<bool> evaluated(num_locals, false);
+  for (size_t i = 0; i < num_locals; ++i) {
+    const CompiledNode* local = block.children[i];
+    const int slot = block.local_slots[i];
+    // Each local writes only its own slot, and reads only the slots of the
+    // locals it depends on, after they have been written.
+    auto evaluate = [this, this_keepalive = shared_from_this(), local, slot,
+                     frame]()
+        -> absl::StatusOr<std::shared_ptr<ExecutorValue>> {
+      std::shared_ptr<ExecutorValue> value = GENC_TRY(Evaluate(*local, frame));
+      frame->slot(slot) = value;
+      return value;
+    };
+    std::vector<DeferredValue> pending;
+    for (int dependency : block.local_dependencies[i]) {
+      if (!evaluated[dependency]) {
+        pending.push_back(locals[dependency]);
+      }
+    }
+    if (!pending.empty()) {
+      locals.push_back(Flatten(concurrency_interface_->Then(
+          WhenAll<std::shared_ptr<ExecutorValue>>(pending),
+          [evaluate = std::move(evaluate)](
+              absl::StatusOr<std::vector<std::shared_ptr<ExecutorValue>>>
+                  dependencies)
+              -> absl::StatusOr<std::shared_ptr<ExecutorValue>> {
+            GENC_TRY(dependencies);
+            return evaluate();
+          })));
+    } else if (local->has_call) {
+      locals.push_back(
+          Flatten(concurrency_interface_->RunAsync(std::move(evaluate))));
+    } else {
+      locals.push_back(MakeReadyFuture(evaluate()));
+      evaluated[i] = true;
+    }
+  }
+  return locals;
+}
+
+std::optional<std::pair<size_t, absl::Status>> ControlFlowExecutor::AwaitAll(
+    absl::Span<const DeferredValue> values) {
+  std::optional<std::pair<size_t, absl::Status>> error;
+  for (size_t i = 0; i < values.size(); ++i) {
+    absl::Status status = values[i]->Get().status();
+    if (!status.ok() && !error.has_value()) {
+      error.emplace(i, std::move(status));
+    }
+  }
+  return error;
+}
+
 absl::StatusOr<std::shared_ptr<ExecutorValue>>
 ControlFlowExecutor::EvaluateSelection(
-    const v0::Selection& selection_pb,
-    const std::shared_ptr<Scope>& scope) const {
-  return CreateSelectionInternal(
-      GENC_TRY(Evaluate(selection_pb.source(), scope)), selection_pb.index());
+    const CompiledNode& node, const std::shared_ptr<Frame>& frame) const {
+  return CreateSelectionInternal(GENC_TRY(Evaluate(*node.children[0], frame)),
+                                 node.value_pb->selection().index());
 }
 
 absl::StatusOr<std::shared_ptr<ExecutorValue>>
-ControlFlowExecutor::EvaluateLambda(const v0::Lambda& lambda_pb,
-                                    const std::shared_ptr<Scope>& scope) const {
-  return std::make_shared<ExecutorValue>(ScopedLambda{lambda_pb, scope});
+ControlFlowExecutor::EvaluateLambda(const CompiledNode& node,
+                                    const std::shared_ptr<Frame>& frame) const {
+  return std::make_shared<ExecutorValue>(ScopedLambda(
+      &node, Capture(*node.frame, *frame), frame->computation()));
+}
+
+absl::StatusOr<std::shared_ptr<ExecutorValue>>
+ControlFlowExecutor::EvaluateIntrinsic(
+    const CompiledNode& node, const std::shared_ptr<Frame>& frame) const {
+  const IntrinsicHandler* const handler = GENC_TRY(node.intrinsic->handler);
+  auto environment =
+      std::make_shared<Frame>(node.frame->num_slots, frame->computation());
+  Captures captures = Capture(*node.frame, *frame);
+  for (size_t i = 0; i < captures.size(); ++i) {
+    environment->slot(node.frame->capture_slots[i]) = std::move(captures[i]);
+  }
+  return std::make_shared<ExecutorValue>(
+      ScopedIntrinsic(&node, handler, std::move(environment)));
 }
 
 class ControlFlowIntrinsicCallContextImpl
@@ -659,10 +957,13 @@ class ControlFlowIntrinsicCallContextImpl
   }
 
   ControlFlowIntrinsicCallContextImpl(
-      const ControlFlowExecutor* executor, const std::shared_ptr<Scope>& scope,
+      const ControlFlowExecutor* executor, const CompiledIntrinsic* intrinsic,
+      std::shared_ptr<Frame> environment,
       std::shared_ptr<ConcurrencyInterface> concurrency_interface)
       : executor_(executor),
-        scope_(scope),
+        executor_keepalive_(executor->shared_from_this()),
+        intrinsic_(intrinsic),
+        environment_(std::move(environment)),
         concurrency_interface_(concurrency_interface) {}
 
   std::shared_ptr<ConcurrencyInterface> concurrency_interface() const override {
@@ -673,7 +974,8 @@ class ControlFlowIntrinsicCallContextImpl
       const v0::Value& val_pb) final {
     return std::shared_ptr<Value>(static_cast<Value*>(new ValueImpl(
         GENC_TRY(HasComputation(val_pb)
-                     ? executor_->Evaluate(val_pb, scope_)
+                     ? executor_->EvaluateStaticParameter(val_pb, *intrinsic_,
+                                                          *environment_)
                      : executor_->ConstCreateExecutorValue(val_pb)))));
   }
 
@@ -738,19 +1040,49 @@ class ControlFlowIntrinsicCallContextImpl
     return absl::UnimplementedError("Not implemented.");
   }
 
+  void OnReady(std::shared_ptr<Value> value,
+               std::function<void()> callback) final {
+    absl::StatusOr<std::shared_ptr<ExecutorValue>> val =
+        ExtractExecutorValue(value);
+    if (!val.ok()) {
+      callback();
+      return;
+    }
+    executor_->ConstOnReady(*std::move(val), std::move(callback));
+  }
+
+  std::optional<std::vector<std::shared_ptr<Value>>> StructElements(
+      std::shared_ptr<Value> value) final {
+    absl::StatusOr<std::shared_ptr<ExecutorValue>> val =
+        ExtractExecutorValue(value);
+    if (!val.ok() ||
+        (*val)->type() != ExecutorValue::ValueType::STRUCTURE) {
+      return std::nullopt;
+    }
+    std::vector<std::shared_ptr<Value>> elements;
+    elements.reserve((*val)->structure().size());
+    for (const std::shared_ptr<ExecutorValue>& element : (*val)->structure()) {
+      elements.push_back(
+          std::shared_ptr<Value>(static_cast<Value*>(new ValueImpl(element))));
+    }
+    return elements;
+  }
+
  private:
   const ControlFlowExecutor* const executor_;
-  const std::shared_ptr<Scope> scope_;
+  // Keeps the executor alive for as long as handlers hold on to the context,
+  // e.g., to check on calls they abandon.
+  const std::shared_ptr<const Executor> executor_keepalive_;
+  const CompiledIntrinsic* const intrinsic_;
+  const std::shared_ptr<Frame> environment_;
   const std::shared_ptr<ConcurrencyInterface> concurrency_interface_;
 };
 
 absl::StatusOr<std::shared_ptr<ExecutorValue>> ScopedIntrinsic::Call(
-    const ControlFlowExecutor& executor,
+    const ControlFlowExecutor& executor, std::shared_ptr<ExecutorValue> self,
     std::optional<std::shared_ptr<ExecutorValue>> arg) const {
   const ControlFlowIntrinsicHandlerInterface* const interface =
       GENC_TRY(IntrinsicHandler::GetControlFlowInterface(intrinsic_handler_));
-  ControlFlowIntrinsicCallContextImpl context(&executor, scope_,
-                                              executor.concurrency_interface());
   std::optional<std::shared_ptr<ControlFlowIntrinsicHandlerInterface::Value>>
       arg_val;
   if (arg.has_value()) {
@@ -758,8 +1090,33 @@ absl::StatusOr<std::shared_ptr<ExecutorValue>> ScopedIntrinsic::Call(
         static_cast<ControlFlowIntrinsicCallContextImpl::Value*>(
             new ControlFlowIntrinsicCallContextImpl::ValueImpl(arg.value())));
   }
+  if (executor.async_control_flow()) {
+    auto context = std::make_shared<ControlFlowIntrinsicCallContextImpl>(
+        &executor, intrinsic_->intrinsic, environment_,
+        executor.concurrency_interface());
+    std::shared_ptr<
+        FutureInterface<ControlFlowIntrinsicHandlerInterface::ValueRef>>
+        result = interface->ExecuteCallAsync(intrinsic_pb(), std::move(arg_val),
+                                             std::move(context));
+    auto deferred = std::make_shared<Promise<std::shared_ptr<ExecutorValue>>>(
+        [result]() { result->Get().IgnoreError(); });
+    result->OnReady([result, deferred, self = std::move(self)]() {
+      absl::StatusOr<ControlFlowIntrinsicHandlerInterface::ValueRef> value =
+          result->Get();
+      if (value.ok()) {
+        deferred->Set(ControlFlowIntrinsicCallContextImpl::ExtractExecutorValue(
+            *std::move(value)));
+      } else {
+        deferred->Set(value.status());
+      }
+    });
+    return std::make_shared<ExecutorValue>(DeferredValue(std::move(deferred)));
+  }
+  ControlFlowIntrinsicCallContextImpl context(
+      &executor, intrinsic_->intrinsic, environment_,
+      executor.concurrency_interface());
   std::shared_ptr<ControlFlowIntrinsicHandlerInterface::Value> result_val =
-      GENC_TRY(interface->ExecuteCall(intrinsic_pb_, arg_val, &context));
+      GENC_TRY(interface->ExecuteCall(intrinsic_pb(), arg_val, &context));
   std::shared_ptr<ExecutorValue> result_executor_value = GENC_TRY(
       ControlFlowIntrinsicCallContextImpl::ExtractExecutorValue(result_val));
   return result_executor_value;
@@ -770,9 +1127,11 @@ absl::StatusOr<std::shared_ptr<ExecutorValue>> ScopedIntrinsic::Call(
 absl::StatusOr<std::shared_ptr<Executor>> CreateControlFlowExecutor(
     std::shared_ptr<IntrinsicHandlerSet> handler_set,
     std::shared_ptr<Executor> child_executor,
-    std::shared_ptr<ConcurrencyInterface> concurrency_interface) {
+    std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+    const ControlFlowExecutorOptions& options) {
+  handler_set->Freeze();
   return std::make_shared<ControlFlowExecutor>(handler_set, child_executor,
-                                               concurrency_interface);
+                                               concurrency_interface, options);
 }
 
 }  // namespace genc
@@ -16,21 +16,48 @@ limitations under the License
 #ifndef GENC_CC_RUNTIME_CONTROL_FLOW_EXECUTOR_H_
 #define GENC_CC_RUNTIME_CONTROL_FLOW_EXECUTOR_H_
 
+#include <cstddef>
 #include <memory>
 
 #include "absl/status/statusor.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/executor.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
 
 namespace genc {
 
+struct ControlFlowExecutorOptions {
+  // If true, control flow intrinsics are invoked through
+  // `ExecuteCallAsync`, and their results are tracked as deferred values that
+  // resolve once the intrinsic completes. Handlers that chain their steps as
+  // continuations (e.g., `While`) then do not hold a thread while waiting on
+  // intermediate results, so many concurrent loops can share a small pool.
+  bool async_control_flow = false;
+
+  // Computations are compiled once into a form with references resolved to
+  // frame slots, and cached by content. This bounds the number of distinct
+  // computations kept compiled; 0 disables caching.
+  size_t compiled_computation_cache_size = 1024;
+
+  // If true, the locals of a block are evaluated as soon as the earlier locals
+  // they reference are available, and the elements of a struct concurrently,
+  // with work dispatched through the concurrency interface. Only used where
+  // more than one local or element calls a function. The result, and the
+  // error reported for the first failing local or element in declaration
+  // order, are the same as when evaluating sequentially, although locals and
+  // elements that are independent of the failure may then still be evaluated.
+  bool parallel_evaluation = false;
+};
+
 // Returns an executor that specializes in handling lambda expressions and
 // control flow intrinsics, and otherwise delegates all processing, including
 // inline intrinsics such as model calls, to the specified child executor.
+// Freezes `handler_set`.
 absl::StatusOr<std::shared_ptr<Executor>> CreateControlFlowExecutor(
     std::shared_ptr<IntrinsicHandlerSet> handler_set,
     std::shared_ptr<Executor> child_executor,
-    std::shared_ptr<ConcurrencyInterface> concurrency_interface);
+    std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+    const ControlFlowExecutorOptions& options = {});
 
 }  // namespace genc
 
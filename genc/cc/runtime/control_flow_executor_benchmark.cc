@@ -0,0 +1,98 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Measures the cost of running loop bodies that embed large constants, such as
+// long prompt templates or model configs. Each iteration of `Repeat` creates a
+// closure for the body and embeds the constant in the child executor, so any
+// deep copy of the computation shows up as time proportional to its size.
+//
+//   bazel run -c opt //genc/cc/runtime:control_flow_executor_benchmark
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/cc/intrinsics/handler_sets.h"
+#include "genc/cc/intrinsics/model_inference.h"
+#include "genc/cc/runtime/control_flow_executor.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/inline_executor.h"
+#include "genc/cc/runtime/intrinsic_handler.h"
+#include "genc/cc/runtime/runner.h"
+#include "genc/cc/runtime/threading.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace {
+
+constexpr int kNumIterations = 10;
+
+std::shared_ptr<Executor> CreateBenchmarkExecutor() {
+  intrinsics::HandlerSetConfig config;
+  config.model_inference_map["echo"] = [](const v0::Value& arg) {
+    return arg;
+  };
+  std::shared_ptr<IntrinsicHandlerSet> handler_set =
+      intrinsics::CreateCompleteHandlerSet(config);
+  auto concurrency_interface = CreateWorkStealingConcurrencyManager();
+  return CreateControlFlowExecutor(
+             handler_set,
+             CreateInlineExecutor(handler_set, concurrency_interface).value(),
+             concurrency_interface)
+      .value();
+}
+
+// x -> Block [document = <constant of `size` bytes>] -> echo(x)
+v0::Value CreateBodyWithConstant(int size) {
+  v0::Value body_pb;
+  v0::Block* block = body_pb.mutable_block();
+  v0::Block::Local* document = block->add_local();
+  document->set_name("document");
+  document->mutable_value()->set_str(std::string(size, 'x'));
+  *block->mutable_result() = CreateCall(CreateModelInference("echo").value(),
+                                        CreateReference("x").value())
+                                 .value();
+  return CreateLambda("x", body_pb).value();
+}
+
+void BM_RepeatBodyWithLargeConstant(benchmark::State& state) {
+  Runner runner = Runner::Create(CreateBenchmarkExecutor()).value();
+  v0::Value repeat_pb =
+      CreateRepeat(kNumIterations, CreateBodyWithConstant(state.range(0)))
+          .value();
+  v0::Value arg;
+  arg.set_str("arg");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(runner.Run(repeat_pb, arg).value());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumIterations);
+}
+
+// The cost of a single deep copy of the loop body, which is what closures
+// used to pay each time they were created.
+void BM_CopyBody(benchmark::State& state) {
+  v0::Value body_pb = CreateBodyWithConstant(state.range(0));
+  for (auto _ : state) {
+    v0::Lambda copy = body_pb.lambda();
+    benchmark::DoNotOptimize(copy);
+  }
+}
+
+BENCHMARK(BM_RepeatBodyWithLargeConstant)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_CopyBody)->Range(1 << 10, 1 << 20);
+
+}  // namespace
+}  // namespace genc
@@ -15,17 +15,25 @@ limitations under the License
 
 #include "genc/cc/runtime/control_flow_executor.h"
 
+#include <algorithm>
 #include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
 #include "googletest/include/gtest/gtest.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "genc/cc/authoring/constructor.h"
 #include "genc/cc/intrinsics/custom_function.h"
@@ -52,7 +60,8 @@ class ControlFlowExecutorTest : public ::testing::Test {
 
 absl::StatusOr<std::shared_ptr<Executor>> CreateTestControlFlowExecutor(
     intrinsics::ModelInference::InferenceMap* inference_map = nullptr,
-    intrinsics::CustomFunction::FunctionMap* custom_fn_map = nullptr) {
+    intrinsics::CustomFunction::FunctionMap* custom_fn_map = nullptr,
+    const ControlFlowExecutorOptions& options = {}) {
   std::shared_ptr<IntrinsicHandlerSet> handler_set;
 
   intrinsics::HandlerSetConfig config;
@@ -67,7 +76,34 @@ absl::StatusOr<std::shared_ptr<Executor>> CreateTestControlFlowExecutor(
   return CreateControlFlowExecutor(
       handler_set,
       GENC_TRY(CreateInlineExecutor(handler_set, concurrency_interface)),
-      concurrency_interface);
+      concurrency_interface, options);
+}
+
+// Creates an executor that runs control flow intrinsics asynchronously on a
+// work-stealing pool with `num_workers` threads.
+absl::StatusOr<std::shared_ptr<Executor>> CreateAsyncTestControlFlowExecutor(
+    int num_workers,
+    intrinsics::ModelInference::InferenceMap* inference_map = nullptr,
+    intrinsics::CustomFunction::FunctionMap* custom_fn_map = nullptr) {
+  intrinsics::HandlerSetConfig config;
+  if (custom_fn_map != nullptr) {
+    config.custom_function_map = *custom_fn_map;
+  }
+  if (inference_map != nullptr) {
+    config.model_inference_map = *inference_map;
+  }
+  std::shared_ptr<IntrinsicHandlerSet> handler_set =
+      intrinsics::CreateCompleteHandlerSet(config);
+  WorkStealingConcurrencyManagerOptions concurrency_options;
+  concurrency_options.num_workers = num_workers;
+  auto concurrency_interface =
+      CreateWorkStealingConcurrencyManager(concurrency_options);
+  ControlFlowExecutorOptions options;
+  options.async_control_flow = true;
+  return CreateControlFlowExecutor(
+      handler_set,
+      GENC_TRY(CreateInlineExecutor(handler_set, concurrency_interface)),
+      concurrency_interface, options);
 }
 
 TEST_F(ControlFlowExecutorTest, ReturnsExecutorOnCreation) {
@@ -269,6 +305,101 @@ TEST_F(ControlFlowExecutorTest, RepeatedConditionalChainCanToLoopAndBreak) {
   EXPECT_EQ(result.str(), "[START]foobarfoobarfoobar[FINISH]foo");
 }
 
+TEST_F(ControlFlowExecutorTest, AsyncWhileLoopExecution) {
+  v0::Value test_condition_fn =
+      CreateSerialChain({CreateRegexPartialMatch("Action: Finish").value(),
+                         CreateLogicalNot().value()})
+          .value();
+  intrinsics::ModelInference::InferenceMap inference_map;
+  v0::Value test_body_fn = CreateModelInference("test_body_fn").value();
+  int current_val = 1;
+  inference_map["test_body_fn"] = [&current_val](const v0::Value& arg) {
+    v0::Value result;
+    if (current_val == 3) {
+      result.set_str(absl::StrCat(arg.str(), "Action: Finish"));
+    } else {
+      result.set_str(absl::StrCat(arg.str(), current_val));
+    }
+    current_val++;
+    return result;
+  };
+
+  std::shared_ptr<Executor> executor =
+      CreateAsyncTestControlFlowExecutor(/*num_workers=*/2, &inference_map)
+          .value();
+  v0::Value while_pb = CreateWhile(test_condition_fn, test_body_fn).value();
+
+  Runner runner = Runner::Create(executor).value();
+  v0::Value arg;
+  arg.set_str("");
+  v0::Value result = runner.Run(while_pb, arg).value();
+  EXPECT_EQ(result.str(), "12Action: Finish");
+}
+
+TEST_F(ControlFlowExecutorTest, AsyncRepeatedConditionalChainCanBreak) {
+  intrinsics::ModelInference::InferenceMap inference_map;
+  inference_map["append_foo"] = [](const v0::Value& arg) {
+    v0::Value result;
+    result.set_str(absl::StrCat(arg.str(), "foo"));
+    return result;
+  };
+  std::shared_ptr<Executor> executor =
+      CreateAsyncTestControlFlowExecutor(/*num_workers=*/2, &inference_map)
+          .value();
+
+  v0::Value comp_pb =
+      CreateRepeatedConditionalChain(
+          100, std::vector<v0::Value>{
+                   CreateModelInference("append_foo").value(),
+                   CreateRegexPartialMatch("foofoofoo").value()})
+          .value();
+
+  Runner runner = Runner::Create(executor).value();
+  v0::Value arg;
+  arg.set_str("[START]");
+  v0::Value result = runner.Run(comp_pb, arg).value();
+  EXPECT_EQ(result.str(), "[START]foofoofoo");
+}
+
+TEST_F(ControlFlowExecutorTest, AsyncLoopsDoNotHoldWorkerThreads) {
+  intrinsics::ModelInference::InferenceMap inference_map;
+  inference_map["append_foo"] = [](const v0::Value& arg) {
+    v0::Value result;
+    result.set_str(absl::StrCat(arg.str(), "foo"));
+    return result;
+  };
+  // Far more concurrent loops than workers; each loop only occupies a worker
+  // while one of its steps is actually running.
+  std::shared_ptr<Executor> executor =
+      CreateAsyncTestControlFlowExecutor(/*num_workers=*/2, &inference_map)
+          .value();
+  v0::Value while_pb =
+      CreateWhile(
+          CreateSerialChain({CreateRegexPartialMatch("foofoofoo").value(),
+                             CreateLogicalNot().value()})
+              .value(),
+          CreateSerialChain({CreateModelInference("append_foo").value()})
+              .value())
+          .value();
+  Runner runner = Runner::Create(executor).value();
+
+  // Callers run on their own threads, separate from the executor's workers.
+  auto callers = CreateThreadBasedConcurrencyManager();
+  constexpr int kNumLoops = 64;
+  std::vector<std::shared_ptr<FutureInterface<absl::StatusOr<v0::Value>>>>
+      results;
+  for (int i = 0; i < kNumLoops; ++i) {
+    v0::Value arg;
+    arg.set_str(absl::StrCat(i, ":"));
+    results.push_back(callers->RunAsync(
+        [&runner, &while_pb, arg]() { return runner.Run(while_pb, arg); }));
+  }
+  for (int i = 0; i < kNumLoops; ++i) {
+    v0::Value result = results[i]->Get().value().value();
+    EXPECT_EQ(result.str(), absl::StrCat(i, ":foofoofoo"));
+  }
+}
+
 TEST_F(ControlFlowExecutorTest, BreakableChainCanChainAndBreak) {
   intrinsics::ModelInference::InferenceMap inference_map;
   inference_map["append_foo"] = [](const v0::Value& arg) {
@@ -448,6 +579,380 @@ TEST_F(ControlFlowExecutorTest, ParallelMapOnSuccessAppliesFnToAllArguments) {
   EXPECT_EQ(result.DebugString(), expected_result.DebugString());
 }
 
+// Keeps track of the most calls in progress at a time, out of `num_calls`.
+// Each call returns its argument once the `limit - 1` calls after it have
+// started, so that as many calls as allowed are in progress together.
+class CallTracker {
+ public:
+  CallTracker(int limit, int num_calls)
+      : limit_(limit), num_calls_(num_calls) {}
+
+  absl::StatusOr<v0::Value> Track(const v0::Value& arg) {
+    absl::MutexLock lock(&mutex_);
+    const int num_to_start = std::min(num_started_ + limit_, num_calls_);
+    ++num_started_;
+    max_in_flight_ = std::max(max_in_flight_, ++in_flight_);
+    auto started = [this, num_to_start]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(
+                       mutex_) { return num_started_ >= num_to_start; };
+    const bool all_started =
+        mutex_.AwaitWithTimeout(absl::Condition(&started), absl::Seconds(10));
+    --in_flight_;
+    if (!all_started) {
+      return absl::DeadlineExceededError("Too few calls in progress.");
+    }
+    return arg;
+  }
+
+  int max_in_flight() {
+    absl::MutexLock lock(&mutex_);
+    return max_in_flight_;
+  }
+
+ private:
+  const int limit_;
+  const int num_calls_;
+  absl::Mutex mutex_;
+  int num_started_ ABSL_GUARDED_BY(mutex_) = 0;
+  int in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  int max_in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// Returns a custom function "track", which calls `tracker`.
+intrinsics::CustomFunction::FunctionMap CreateTrackingFunction(
+    std::shared_ptr<CallTracker> tracker) {
+  intrinsics::CustomFunction::FunctionMap fn_map;
+  fn_map["track"] = [tracker](const v0::Value& arg) {
+    return tracker->Track(arg);
+  };
+  return fn_map;
+}
+
+v0::Value CreateStrStruct(int num_elements) {
+  v0::Value value;
+  for (int i = 0; i < num_elements; ++i) {
+    value.mutable_struct_()->add_element()->set_str(absl::StrCat(i));
+  }
+  return value;
+}
+
+TEST_F(ControlFlowExecutorTest, ParallelMapLimitsCallsInFlight) {
+  auto tracker = std::make_shared<CallTracker>(/*limit=*/3, /*num_calls=*/12);
+  intrinsics::CustomFunction::FunctionMap fn_map =
+      CreateTrackingFunction(tracker);
+  std::shared_ptr<Executor> executor =
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map).value();
+  Runner runner = Runner::Create(executor).value();
+
+  v0::Value comp_pb =
+      CreateParallelMapWithOptions(CreateCustomFunction("track").value(),
+                                   /*max_in_flight=*/3, /*ordered=*/true,
+                                   /*fail_fast=*/true)
+          .value();
+  v0::Value arg = CreateStrStruct(12);
+  v0::Value result = runner.Run(comp_pb, arg).value();
+  EXPECT_EQ(result.DebugString(), arg.DebugString());
+  EXPECT_EQ(tracker->max_in_flight(), 3);
+}
+
+TEST_F(ControlFlowExecutorTest, AsyncParallelMapLimitsCallsInFlight) {
+  auto tracker = std::make_shared<CallTracker>(/*limit=*/2, /*num_calls=*/8);
+  intrinsics::CustomFunction::FunctionMap fn_map =
+      CreateTrackingFunction(tracker);
+  std::shared_ptr<Executor> executor =
+      CreateAsyncTestControlFlowExecutor(/*num_workers=*/4,
+                                         /*inference_map=*/nullptr, &fn_map)
+          .value();
+  Runner runner = Runner::Create(executor).value();
+
+  v0::Value comp_pb =
+      CreateParallelMapWithOptions(CreateCustomFunction("track").value(),
+                                   /*max_in_flight=*/2, /*ordered=*/true,
+                                   /*fail_fast=*/true)
+          .value();
+  v0::Value arg = CreateStrStruct(8);
+  v0::Value result = runner.Run(comp_pb, arg).value();
+  EXPECT_EQ(result.DebugString(), arg.DebugString());
+  EXPECT_EQ(tracker->max_in_flight(), 2);
+}
+
+TEST_F(ControlFlowExecutorTest, ParallelMapFailsFastOrCollectsFailures) {
+  intrinsics::CustomFunction::FunctionMap fn_map;
+  fn_map["check"] = [](const v0::Value& arg) -> absl::StatusOr<v0::Value> {
+    if (arg.str() == "bad") {
+      return absl::InvalidArgumentError("bad input");
+    }
+    return arg;
+  };
+  std::shared_ptr<Executor> executor =
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map).value();
+  Runner runner = Runner::Create(executor).value();
+  v0::Value fn_pb = CreateCustomFunction("check").value();
+
+  v0::Value arg;
+  arg.mutable_struct_()->add_element()->set_str("good");
+  arg.mutable_struct_()->add_element()->set_str("bad");
+  absl::StatusOr<v0::Value> result =
+      runner.Run(CreateParallelMap(fn_pb).value(), arg);
+  ASSERT_FALSE(result.ok());
+  EXPECT_EQ(result.status().code(), absl::StatusCode::kInvalidArgument);
+
+  result = runner.Run(CreateParallelMapWithOptions(fn_pb, /*max_in_flight=*/1,
+                                                   /*ordered=*/true,
+                                                   /*fail_fast=*/false)
+                          .value(),
+                      arg);
+  ASSERT_TRUE(result.ok()) << result.status();
+  ASSERT_EQ(result->struct_().element_size(), 2);
+  EXPECT_EQ(result->struct_().element(0).str(), "good");
+  EXPECT_EQ(result->struct_().element(1).label(), "error");
+  EXPECT_NE(result->struct_().element(1).str().find("bad input"),
+            std::string::npos);
+}
+
+TEST_F(ControlFlowExecutorTest, AsyncParallelMapFailsWithoutWaitingForCalls) {
+  auto release = std::make_shared<absl::Notification>();
+  auto slow_finished = std::make_shared<absl::Notification>();
+  intrinsics::CustomFunction::FunctionMap fn_map;
+  fn_map["check"] = [release, slow_finished](
+                        const v0::Value& arg) -> absl::StatusOr<v0::Value> {
+    if (arg.str() == "bad") {
+      return absl::InvalidArgumentError("bad input");
+    }
+    release->WaitForNotificationWithTimeout(absl::Seconds(10));
+    slow_finished->Notify();
+    return arg;
+  };
+  std::shared_ptr<Executor> executor =
+      CreateAsyncTestControlFlowExecutor(/*num_workers=*/2,
+                                         /*inference_map=*/nullptr, &fn_map)
+          .value();
+  Runner runner = Runner::Create(executor).value();
+
+  v0::Value arg;
+  arg.mutable_struct_()->add_element()->set_str("slow");
+  arg.mutable_struct_()->add_element()->set_str("bad");
+  absl::StatusOr<v0::Value> result = runner.Run(
+      CreateParallelMap(CreateCustomFunction("check").value()).value(), arg);
+  EXPECT_EQ(result.status().code(), absl::StatusCode::kInvalidArgument);
+  // The map failed while the slow call was still in progress.
+  EXPECT_FALSE(slow_finished->HasBeenNotified());
+  release->Notify();
+  slow_finished->WaitForNotification();
+}
+
+// Returns a custom function "gate", which returns arguments ending in "open"
+// or "pass" right away, the former opening the gate, and any other argument
+// once the gate is open.
+intrinsics::CustomFunction::FunctionMap CreateGateFunction() {
+  auto notification = std::make_shared<absl::Notification>();
+  intrinsics::CustomFunction::FunctionMap fn_map;
+  fn_map["gate"] = [notification](const v0::Value& arg) {
+    if (absl::EndsWith(arg.str(), "open")) {
+      if (!notification->HasBeenNotified()) {
+        notification->Notify();
+      }
+    } else if (!absl::EndsWith(arg.str(), "pass") &&
+               !notification->WaitForNotificationWithTimeout(
+                   absl::Seconds(10))) {
+      v0::Value result;
+      result.set_str("timed out");
+      return result;
+    }
+    return arg;
+  };
+  return fn_map;
+}
+
+TEST_F(ControlFlowExecutorTest, ParallelMapReturnsResultsAsTheyComplete) {
+  intrinsics::CustomFunction::FunctionMap fn_map = CreateGateFunction();
+  std::shared_ptr<Executor> executor =
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map).value();
+  Runner runner = Runner::Create(executor).value();
+
+  v0::Value comp_pb =
+      CreateParallelMapWithOptions(CreateCustomFunction("gate").value(),
+                                   /*max_in_flight=*/2, /*ordered=*/false,
+                                   /*fail_fast=*/true)
+          .value();
+  // "wait" needs "open", which is only started once "pass" is done.
+  v0::Value arg;
+  arg.mutable_struct_()->add_element()->set_str("wait");
+  arg.mutable_struct_()->add_element()->set_str("pass");
+  arg.mutable_struct_()->add_element()->set_str("open");
+  v0::Value result = runner.Run(comp_pb, arg).value();
+  ASSERT_EQ(result.struct_().element_size(), 3);
+  EXPECT_EQ(result.struct_().element(0).str(), "pass");
+  std::vector<std::string> rest = {result.struct_().element(1).str(),
+                                   result.struct_().element(2).str()};
+  std::sort(rest.begin(), rest.end());
+  EXPECT_EQ(rest, std::vector<std::string>({"open", "wait"}));
+}
+
+TEST_F(ControlFlowExecutorTest, ParallelMapStartsOnElementsAsTheyBecomeReady) {
+  intrinsics::CustomFunction::FunctionMap fn_map = CreateGateFunction();
+  fn_map["append_open"] = [](const v0::Value& arg) {
+    v0::Value result;
+    result.set_str(absl::StrCat(arg.str(), "open"));
+    return result;
+  };
+  std::shared_ptr<Executor> executor =
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map).value();
+  Runner runner = Runner::Create(executor).value();
+
+  // x -> parallel_map(gate)(<gate(x), append_open(x)>), where the first
+  // element is only ready once the second one has been mapped.
+  v0::Value gate_pb = CreateCustomFunction("gate").value();
+  v0::Value struct_pb =
+      CreateStruct(
+          {CreateCall(gate_pb, CreateReference("x").value()).value(),
+           CreateCall(CreateCustomFunction("append_open").value(),
+                      CreateReference("x").value())
+               .value()})
+          .value();
+  v0::Value comp_pb =
+      CreateLambda("x", CreateCall(CreateParallelMap(gate_pb).value(),
+                                   struct_pb)
+                            .value())
+          .value();
+  v0::Value arg;
+  arg.set_str("x");
+  v0::Value result = runner.Run(comp_pb, arg).value();
+  ASSERT_EQ(result.struct_().element_size(), 2);
+  EXPECT_EQ(result.struct_().element(0).str(), "x");
+  EXPECT_EQ(result.struct_().element(1).str(), "xopen");
+}
+
+// Returns custom functions for fallback candidates: "fail", which fails,
+// "fast", which succeeds right away, and "slow", which succeeds once
+// `release` has been notified, and then counts itself down in `slow_finished`.
+intrinsics::CustomFunction::FunctionMap CreateCandidateFunctions(
+    std::shared_ptr<absl::Notification> release,
+    std::shared_ptr<absl::BlockingCounter> slow_finished) {
+  intrinsics::CustomFunction::FunctionMap fn_map;
+  fn_map["fail"] = [](const v0::Value& arg) -> absl::StatusOr<v0::Value> {
+    return absl::UnavailableError("candidate failed");
+  };
+  fn_map["fast"] = [](const v0::Value& arg) -> absl::StatusOr<v0::Value> {
+    v0::Value result;
+    result.set_str("fast");
+    return result;
+  };
+  fn_map["slow"] = [release, slow_finished](
+                       const v0::Value& arg) -> absl::StatusOr<v0::Value> {
+    release->WaitForNotification();
+    slow_finished->DecrementCount();
+    v0::Value result;
+    result.set_str("slow");
+    return result;
+  };
+  return fn_map;
+}
+
+std::vector<v0::Value> CreateCandidates(
+    std::vector<absl::string_view> fn_uris) {
+  std::vector<v0::Value> candidates;
+  for (absl::string_view fn_uri : fn_uris) {
+    candidates.push_back(CreateCustomFunction(fn_uri).value());
+  }
+  return candidates;
+}
+
+TEST_F(ControlFlowExecutorTest, FallbackTriesCandidatesInOrder) {
+  intrinsics::CustomFunction::FunctionMap fn_map = CreateCandidateFunctions(
+      std::make_shared<absl::Notification>(),
+      std::make_shared<absl::BlockingCounter>(0));
+  // A single worker, which a fallback waiting for its candidates would hold.
+  std::vector<std::shared_ptr<Executor>> executors = {
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map)
+          .value(),
+      CreateAsyncTestControlFlowExecutor(/*num_workers=*/1,
+                                         /*inference_map=*/nullptr, &fn_map)
+          .value()};
+  v0::Value arg;
+  arg.set_str("x");
+
+  for (const std::shared_ptr<Executor>& executor : executors) {
+    Runner runner = Runner::Create(executor).value();
+    v0::Value result =
+        runner.Run(CreateFallback(CreateCandidates({"fail", "fast", "slow"}))
+                       .value(),
+                   arg)
+            .value();
+    EXPECT_EQ(result.str(), "fast");
+
+    absl::StatusOr<v0::Value> failed = runner.Run(
+        CreateFallback(CreateCandidates({"fail", "fail"})).value(), arg);
+    EXPECT_EQ(failed.status().code(), absl::StatusCode::kUnavailable);
+    EXPECT_EQ(runner.Run(CreateFallback({}).value(), arg).status().code(),
+              absl::StatusCode::kUnavailable);
+  }
+}
+
+TEST_F(ControlFlowExecutorTest, FallbackHedgesOrRacesSlowCandidates) {
+  auto release = std::make_shared<absl::Notification>();
+  auto slow_finished = std::make_shared<absl::BlockingCounter>(4);
+  intrinsics::CustomFunction::FunctionMap fn_map =
+      CreateCandidateFunctions(release, slow_finished);
+  std::vector<std::shared_ptr<Executor>> executors = {
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map)
+          .value(),
+      CreateAsyncTestControlFlowExecutor(/*num_workers=*/4,
+                                         /*inference_map=*/nullptr, &fn_map)
+          .value()};
+  v0::Value arg;
+  arg.set_str("x");
+
+  for (const std::shared_ptr<Executor>& executor : executors) {
+    Runner runner = Runner::Create(executor).value();
+    for (absl::string_view mode : {"hedged", "race"}) {
+      v0::Value result =
+          runner
+              .Run(CreateFallbackWithOptions(
+                       CreateCandidates({"slow", "fail", "fast"}), mode,
+                       /*hedge_delay_ms=*/10)
+                       .value(),
+                   arg)
+              .value();
+      EXPECT_EQ(result.str(), "fast") << mode;
+    }
+    absl::StatusOr<v0::Value> failed =
+        runner.Run(CreateFallbackWithOptions(CreateCandidates({"fail", "fail"}),
+                                             "race", /*hedge_delay_ms=*/0)
+                       .value(),
+                   arg);
+    EXPECT_EQ(failed.status().code(), absl::StatusCode::kUnavailable);
+  }
+  // The abandoned calls, which are still blocked, keep what they use alive.
+  executors.clear();
+  release->Notify();
+  slow_finished->Wait();
+}
+
+TEST_F(ControlFlowExecutorTest, FallbackRejectsInvalidOptions) {
+  EXPECT_FALSE(
+      CreateFallbackWithOptions(CreateCandidates({"fast"}), "eager", 0).ok());
+  EXPECT_FALSE(
+      CreateFallbackWithOptions(CreateCandidates({"fast"}), "hedged", -1).ok());
+
+  intrinsics::CustomFunction::FunctionMap fn_map = CreateCandidateFunctions(
+      std::make_shared<absl::Notification>(),
+      std::make_shared<absl::BlockingCounter>(0));
+  std::shared_ptr<Executor> executor =
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map).value();
+  Runner runner = Runner::Create(executor).value();
+  v0::Value fallback_pb = CreateFallback(CreateCandidates({"fast"})).value();
+  v0::Value* mode_pb = fallback_pb.mutable_intrinsic()
+                           ->mutable_static_parameter()
+                           ->mutable_struct_()
+                           ->add_element();
+  mode_pb->set_label("mode");
+  mode_pb->set_str("hedged");
+  v0::Value arg;
+  arg.set_str("x");
+  EXPECT_EQ(runner.Run(fallback_pb, arg).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
 TEST_F(ControlFlowExecutorTest, CreateSelectionInIntrinsicHandler) {
   class TestIntrinsic : public ControlFlowIntrinsicHandlerBase {
    public:
@@ -500,6 +1005,193 @@ TEST_F(ControlFlowExecutorTest, CreateSelectionInIntrinsicHandler) {
   EXPECT_EQ(result.DebugString(), x.struct_().element(0).DebugString());
 }
 
+TEST_F(ControlFlowExecutorTest, ClosuresCaptureLocalsOfEnclosingBlock) {
+  std::shared_ptr<Executor> executor = CreateTestControlFlowExecutor().value();
+  Runner runner = Runner::Create(executor).value();
+
+  // x -> Block [y=x, y=(z -> y), f=(z -> y(z))] -> f
+  // The second `y` shadows the first, and is called from within `f`.
+  v0::Value block_pb;
+  v0::Block* block = block_pb.mutable_block();
+  v0::Block::Local* y_1 = block->add_local();
+  y_1->set_name("y");
+  *y_1->mutable_value() = CreateReference("x").value();
+  v0::Block::Local* y_2 = block->add_local();
+  y_2->set_name("y");
+  *y_2->mutable_value() =
+      CreateLambda("z", CreateReference("y").value()).value();
+  v0::Block::Local* f = block->add_local();
+  f->set_name("f");
+  *f->mutable_value() =
+      CreateLambda("z", CreateCall(CreateReference("y").value(),
+                                   CreateReference("z").value())
+                            .value())
+          .value();
+  *block->mutable_result() = CreateReference("f").value();
+  v0::Value make_f = CreateLambda("x", block_pb).value();
+
+  v0::Value arg;
+  arg.set_str("captured");
+  OwnedValueId f_val =
+      executor->CreateCall(executor->CreateValue(make_f).value(),
+                           executor->CreateValue(arg).value())
+          .value();
+  // Calling the returned closure after the block has been evaluated.
+  v0::Value unused;
+  unused.set_str("unused");
+  OwnedValueId result_val =
+      executor->CreateCall(f_val, executor->CreateValue(unused).value())
+          .value();
+  v0::Value result;
+  ASSERT_TRUE(executor->Materialize(result_val, &result).ok());
+  EXPECT_EQ(result.str(), "captured");
+
+  // The same computation is served from the compiled computation cache.
+  EXPECT_EQ(runner.Run(CreateCall(make_f, arg).value(), unused).value().str(),
+            "captured");
+}
+
+// Returns custom functions "wait", which blocks until "signal" has been
+// called (or gives up after a while), and "signal".
+intrinsics::CustomFunction::FunctionMap CreateWaitAndSignalFunctions(
+    std::shared_ptr<absl::Notification> notification) {
+  intrinsics::CustomFunction::FunctionMap fn_map;
+  fn_map["wait"] = [notification](const v0::Value& arg) {
+    v0::Value result;
+    result.set_str(notification->WaitForNotificationWithTimeout(
+                       absl::Seconds(10))
+                       ? absl::StrCat(arg.str(), ":waited")
+                       : "timed out");
+    return result;
+  };
+  fn_map["signal"] = [notification](const v0::Value& arg) {
+    notification->Notify();
+    v0::Value result;
+    result.set_str(absl::StrCat(arg.str(), ":signaled"));
+    return result;
+  };
+  fn_map["concat"] = [](const v0::Value& arg) {
+    v0::Value result;
+    for (const v0::Value& element : arg.struct_().element()) {
+      result.mutable_str()->append(element.str());
+    }
+    return result;
+  };
+  return fn_map;
+}
+
+ControlFlowExecutorOptions ParallelEvaluationOptions() {
+  ControlFlowExecutorOptions options;
+  options.parallel_evaluation = true;
+  return options;
+}
+
+// Fallback materializes the result of the function it calls, so the calling
+// thread is held until that function returns.
+v0::Value CreateBlockingCall(absl::string_view fn_uri, v0::Value arg) {
+  return CreateCall(CreateFallback({CreateCustomFunction(fn_uri).value()})
+                        .value(),
+                    std::move(arg))
+      .value();
+}
+
+TEST_F(ControlFlowExecutorTest, ParallelEvaluationOverlapsIndependentLocals) {
+  intrinsics::CustomFunction::FunctionMap fn_map =
+      CreateWaitAndSignalFunctions(std::make_shared<absl::Notification>());
+  std::shared_ptr<Executor> executor =
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map,
+                                    ParallelEvaluationOptions())
+          .value();
+  Runner runner = Runner::Create(executor).value();
+
+  // x -> Block [a=wait(x), b=signal(x), c=wait(b)] -> concat(<a,c>)
+  // Evaluated in order, `a` would wait for `b` in vain.
+  v0::Value block_pb;
+  v0::Block* block = block_pb.mutable_block();
+  v0::Block::Local* a = block->add_local();
+  a->set_name("a");
+  *a->mutable_value() =
+      CreateBlockingCall("wait", CreateReference("x").value());
+  v0::Block::Local* b = block->add_local();
+  b->set_name("b");
+  *b->mutable_value() =
+      CreateBlockingCall("signal", CreateReference("x").value());
+  v0::Block::Local* c = block->add_local();
+  c->set_name("c");
+  *c->mutable_value() =
+      CreateBlockingCall("wait", CreateReference("b").value());
+  *block->mutable_result() =
+      CreateCall(CreateCustomFunction("concat").value(),
+                 CreateStruct({CreateReference("a").value(),
+                               CreateReference("c").value()})
+                     .value())
+          .value();
+
+  v0::Value arg;
+  arg.set_str("x");
+  v0::Value result =
+      runner.Run(CreateLambda("x", block_pb).value(), arg).value();
+  EXPECT_EQ(result.str(), "x:waitedx:signaled:waited");
+}
+
+TEST_F(ControlFlowExecutorTest, ParallelEvaluationOverlapsStructElements) {
+  intrinsics::CustomFunction::FunctionMap fn_map =
+      CreateWaitAndSignalFunctions(std::make_shared<absl::Notification>());
+  std::shared_ptr<Executor> executor =
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map,
+                                    ParallelEvaluationOptions())
+          .value();
+  Runner runner = Runner::Create(executor).value();
+
+  v0::Value struct_pb =
+      CreateStruct({CreateBlockingCall("wait", CreateReference("x").value()),
+                    CreateReference("x").value(),
+                    CreateBlockingCall("signal", CreateReference("x").value())})
+          .value();
+
+  v0::Value arg;
+  arg.set_str("x");
+  v0::Value result =
+      runner.Run(CreateLambda("x", struct_pb).value(), arg).value();
+  ASSERT_EQ(result.struct_().element_size(), 3);
+  EXPECT_EQ(result.struct_().element(0).str(), "x:waited");
+  EXPECT_EQ(result.struct_().element(1).str(), "x");
+  EXPECT_EQ(result.struct_().element(2).str(), "x:signaled");
+}
+
+TEST_F(ControlFlowExecutorTest, ParallelEvaluationReportsFirstFailingLocal) {
+  intrinsics::CustomFunction::FunctionMap fn_map =
+      CreateWaitAndSignalFunctions(std::make_shared<absl::Notification>());
+  std::shared_ptr<Executor> executor =
+      CreateTestControlFlowExecutor(/*inference_map=*/nullptr, &fn_map,
+                                    ParallelEvaluationOptions())
+          .value();
+  Runner runner = Runner::Create(executor).value();
+
+  // Block [a=signal(x), b=signal(missing_b), c=signal(missing_c)] -> a
+  v0::Value block_pb;
+  v0::Block* block = block_pb.mutable_block();
+  for (absl::string_view name : {"a", "b", "c"}) {
+    v0::Block::Local* local = block->add_local();
+    local->set_name(std::string(name));
+    *local->mutable_value() = CreateBlockingCall(
+        "signal",
+        CreateReference(name == "a" ? "x" : absl::StrCat("missing_", name))
+            .value());
+  }
+  *block->mutable_result() = CreateReference("a").value();
+
+  v0::Value arg;
+  arg.set_str("x");
+  absl::StatusOr<v0::Value> result =
+      runner.Run(CreateLambda("x", block_pb).value(), arg);
+  ASSERT_FALSE(result.ok());
+  EXPECT_EQ(result.status().code(), absl::StatusCode::kNotFound);
+  EXPECT_EQ(result.status().message(),
+            "Could not find reference [missing_b] while evaluating local [b] "
+            "in block locals [a,b,c]");
+}
+
 TEST_F(ControlFlowExecutorTest, CanProcessStruct) {
   std::shared_ptr<Executor> executor = CreateTestControlFlowExecutor().value();
 
@@ -0,0 +1,112 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/dispose_batcher.h"
+
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "genc/proto/v0/executor.pb.h"
+
+namespace genc {
+namespace {
+
+DisposeBatcherOptions WithStats(DisposeBatcherOptions options) {
+  if (options.stats == nullptr) {
+    options.stats = std::make_shared<DisposeStats>();
+  }
+  return options;
+}
+
+}  // namespace
+
+DisposeBatcher::DisposeBatcher(SendFn send, DisposeBatcherOptions options)
+    : send_(std::move(send)),
+      options_(WithStats(std::move(options))),
+      sender_([this]() { SendBatches(); }) {}
+
+DisposeBatcher::~DisposeBatcher() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  sender_.join();
+}
+
+void DisposeBatcher::Add(v0::ValueRef value_ref) {
+  absl::MutexLock lock(&mutex_);
+  if (pending_.empty()) {
+    oldest_ = absl::Now();
+  }
+  pending_.push_back(std::move(value_ref));
+}
+
+std::vector<v0::ValueRef> DisposeBatcher::Take() {
+  std::vector<v0::ValueRef> batch;
+  {
+    absl::MutexLock lock(&mutex_);
+    batch.swap(pending_);
+  }
+  if (!batch.empty()) {
+    options_.stats->num_refs += batch.size();
+    ++options_.stats->num_piggybacked;
+  }
+  return batch;
+}
+
+void DisposeBatcher::SendBatches() {
+  bool done = false;
+  while (!done) {
+    std::vector<v0::ValueRef> batch;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &DisposeBatcher::HasWork));
+      // Unless the batch is already full, give it until the oldest reference
+      // has waited long enough to fill up.
+      mutex_.AwaitWithDeadline(
+          absl::Condition(this, &DisposeBatcher::IsFullOrStopping),
+          oldest_ + options_.max_delay);
+      if (pending_.size() > options_.max_batch_size) {
+        auto end = pending_.begin() + options_.max_batch_size;
+        batch.assign(std::make_move_iterator(pending_.begin()),
+                     std::make_move_iterator(end));
+        pending_.erase(pending_.begin(), end);
+      } else {
+        batch.swap(pending_);
+      }
+      done = stopping_ && pending_.empty();
+    }
+    if (!batch.empty()) {
+      options_.stats->num_refs += batch.size();
+      ++options_.stats->num_batches;
+      send_(std::move(batch));
+    }
+  }
+}
+
+bool DisposeBatcher::HasWork() const {
+  return stopping_ || !pending_.empty();
+}
+
+bool DisposeBatcher::IsFullOrStopping() const {
+  return stopping_ || pending_.size() >= options_.max_batch_size;
+}
+
+}  // namespace genc
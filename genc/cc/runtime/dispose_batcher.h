@@ -0,0 +1,101 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_RUNTIME_DISPOSE_BATCHER_H_
+#define GENC_CC_RUNTIME_DISPOSE_BATCHER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "genc/proto/v0/executor.pb.h"
+
+namespace genc {
+
+// Counters describing how disposals were batched, for monitoring.
+struct DisposeStats {
+  // The number of references disposed of.
+  std::atomic<int64_t> num_refs = 0;
+  // The number of batches sent on their own by the batcher.
+  std::atomic<int64_t> num_batches = 0;
+  // The number of batches taken to be sent along with other requests.
+  std::atomic<int64_t> num_piggybacked = 0;
+
+  // The average number of references per batch sent.
+  double RefsPerBatch() const {
+    const int64_t batches = num_batches + num_piggybacked;
+    return batches == 0 ? 0.0 : static_cast<double>(num_refs) / batches;
+  }
+};
+
+struct DisposeBatcherOptions {
+  // A batch is sent as soon as it holds `max_batch_size` references (and never
+  // holds more), or once its oldest reference has waited for `max_delay`.
+  size_t max_batch_size = 64;
+  absl::Duration max_delay = absl::Milliseconds(50);
+  // Where to record the counters. If null, the batcher keeps its own.
+  std::shared_ptr<DisposeStats> stats;
+};
+
+// Accumulates references to remote values that are no longer needed, so that
+// they are disposed of in a few batched requests rather than with one request
+// per value. Batches are sent by `send` on a thread owned by the batcher, by
+// count or by time, unless taken earlier to be sent along with a request that
+// is going out anyway. Whatever is left is sent on destruction.
+class DisposeBatcher {
+ public:
+  using SendFn = std::function<void(std::vector<v0::ValueRef>)>;
+
+  DisposeBatcher(SendFn send, DisposeBatcherOptions options);
+  ~DisposeBatcher();
+
+  DisposeBatcher(const DisposeBatcher&) = delete;
+  DisposeBatcher& operator=(const DisposeBatcher&) = delete;
+
+  void Add(v0::ValueRef value_ref);
+
+  // Removes and returns the pending references, for the caller to send along
+  // with another request.
+  std::vector<v0::ValueRef> Take();
+
+  const DisposeStats& stats() const { return *options_.stats; }
+
+ private:
+  void SendBatches();
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool IsFullOrStopping() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const SendFn send_;
+  const DisposeBatcherOptions options_;
+
+  absl::Mutex mutex_;
+  std::vector<v0::ValueRef> pending_ ABSL_GUARDED_BY(mutex_);
+  // When the oldest pending reference was added.
+  absl::Time oldest_ ABSL_GUARDED_BY(mutex_);
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+
+  std::thread sender_;
+};
+
+}  // namespace genc
+
+#endif  // GENC_CC_RUNTIME_DISPOSE_BATCHER_H_
@@ -0,0 +1,118 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/dispose_batcher.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "genc/proto/v0/executor.pb.h"
+#include "googletest/include/gtest/gtest.h"
+
+namespace genc {
+namespace {
+
+v0::ValueRef Ref(int id) {
+  v0::ValueRef value_ref;
+  value_ref.set_id(absl::StrCat(id));
+  return value_ref;
+}
+
+// Records the batches sent.
+class Recorder {
+ public:
+  DisposeBatcher::SendFn SendFn() {
+    return [this](std::vector<v0::ValueRef> batch) {
+      absl::MutexLock lock(&mutex_);
+      batch_sizes_.push_back(batch.size());
+    };
+  }
+
+  std::vector<size_t> batch_sizes() {
+    absl::MutexLock lock(&mutex_);
+    return batch_sizes_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<size_t> batch_sizes_;
+};
+
+TEST(DisposeBatcherTest, SendsFullBatches) {
+  Recorder recorder;
+  DisposeBatcherOptions options;
+  options.max_batch_size = 3;
+  options.max_delay = absl::Hours(1);
+  {
+    DisposeBatcher batcher(recorder.SendFn(), options);
+    for (int i = 0; i < 7; ++i) {
+      batcher.Add(Ref(i));
+    }
+    // The remaining reference is sent on destruction.
+  }
+  size_t total = 0;
+  for (size_t size : recorder.batch_sizes()) {
+    EXPECT_LE(size, 3u);
+    total += size;
+  }
+  EXPECT_EQ(total, 7u);
+  EXPECT_EQ(recorder.batch_sizes().size(), 3u);
+}
+
+TEST(DisposeBatcherTest, SendsPartialBatchAfterDelay) {
+  absl::Notification sent;
+  DisposeBatcherOptions options;
+  options.max_batch_size = 100;
+  options.max_delay = absl::Milliseconds(10);
+  DisposeBatcher batcher(
+      [&sent](std::vector<v0::ValueRef> batch) {
+        EXPECT_EQ(batch.size(), 2u);
+        sent.Notify();
+      },
+      options);
+  batcher.Add(Ref(1));
+  batcher.Add(Ref(2));
+  EXPECT_TRUE(sent.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  EXPECT_EQ(batcher.stats().num_refs, 2);
+  EXPECT_EQ(batcher.stats().num_batches, 1);
+}
+
+TEST(DisposeBatcherTest, TakesPendingReferencesToPiggyback) {
+  Recorder recorder;
+  DisposeBatcherOptions options;
+  options.max_delay = absl::Hours(1);
+  options.stats = std::make_shared<DisposeStats>();
+  {
+    DisposeBatcher batcher(recorder.SendFn(), options);
+    batcher.Add(Ref(1));
+    batcher.Add(Ref(2));
+    std::vector<v0::ValueRef> taken = batcher.Take();
+    ASSERT_EQ(taken.size(), 2u);
+    EXPECT_EQ(taken[0].id(), "1");
+    EXPECT_TRUE(batcher.Take().empty());
+  }
+  EXPECT_TRUE(recorder.batch_sizes().empty());
+  EXPECT_EQ(options.stats->num_piggybacked, 1);
+  EXPECT_EQ(options.stats->num_batches, 0);
+  EXPECT_EQ(options.stats->RefsPerBatch(), 2.0);
+}
+
+}  // namespace
+}  // namespace genc
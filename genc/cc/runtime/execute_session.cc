@@ -0,0 +1,167 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/execute_session.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/status_macros.h"
+#include "genc/cc/runtime/value_ref.h"
+#include "genc/proto/v0/executor.pb.h"
+
+namespace genc {
+namespace {
+
+void SetError(const absl::Status& status, v0::ExecuteResponse* response) {
+  response->set_error_code(static_cast<int32_t>(status.code()));
+  response->set_error_message(std::string(status.message()));
+}
+
+}  // namespace
+
+ExecuteSession::~ExecuteSession() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(
+      +[](int* num_pending) { return *num_pending == 0; }, &num_pending_));
+}
+
+void ExecuteSession::Handle(const v0::ExecutorRequest& request) {
+  switch (request.request_case()) {
+    case v0::ExecutorRequest::kCreateValue:
+      Bind(request.result_ref(),
+           executor_->CreateValue(request.create_value().value()));
+      break;
+    case v0::ExecutorRequest::kCreateCall:
+      Bind(request.result_ref(), CreateCall(request.create_call()));
+      break;
+    case v0::ExecutorRequest::kCreateStruct:
+      Bind(request.result_ref(), CreateStruct(request.create_struct()));
+      break;
+    case v0::ExecutorRequest::kCreateSelection:
+      Bind(request.result_ref(), CreateSelection(request.create_selection()));
+      break;
+    case v0::ExecutorRequest::kMaterialize:
+      Materialize(request.materialize().value_ref());
+      break;
+    case v0::ExecutorRequest::kDispose:
+      for (const v0::ValueRef& value_ref : request.dispose().value_ref()) {
+        absl::StatusOr<uint64_t> key = RefToValueId(value_ref);
+        if (key.ok()) {
+          values_.erase(*key);
+        }
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void ExecuteSession::Bind(const v0::ValueRef& value_ref,
+                          absl::StatusOr<OwnedValueId> value) {
+  absl::StatusOr<uint64_t> key = RefToValueId(value_ref);
+  if (!key.ok()) {
+    // Nothing can refer to the value, so it is dropped.
+    return;
+  }
+  if (!value.ok()) {
+    values_.insert_or_assign(*key, value.status());
+    return;
+  }
+  values_.insert_or_assign(*key,
+                           std::make_shared<OwnedValueId>(*std::move(value)));
+}
+
+absl::StatusOr<ExecuteSession::SharedValue> ExecuteSession::Find(
+    const v0::ValueRef& value_ref) const {
+  const uint64_t key = GENC_TRY(RefToValueId(value_ref));
+  auto it = values_.find(key);
+  if (it == values_.end()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unknown value reference: ", key));
+  }
+  return it->second;
+}
+
+absl::StatusOr<ValueId> ExecuteSession::Lookup(
+    const v0::ValueRef& value_ref) const {
+  return GENC_TRY(Find(value_ref))->ref();
+}
+
+absl::StatusOr<OwnedValueId> ExecuteSession::CreateCall(
+    const v0::CreateCallRequest& request) {
+  const ValueId function = GENC_TRY(Lookup(request.function_ref()));
+  std::optional<ValueId> argument;
+  if (request.has_argument_ref()) {
+    argument = GENC_TRY(Lookup(request.argument_ref()));
+  }
+  return executor_->CreateCall(function, argument);
+}
+
+absl::StatusOr<OwnedValueId> ExecuteSession::CreateStruct(
+    const v0::CreateStructRequest& request) {
+  std::vector<ValueId> elements;
+  elements.reserve(request.element_ref().size());
+  for (const v0::ValueRef& element_ref : request.element_ref()) {
+    elements.push_back(GENC_TRY(Lookup(element_ref)));
+  }
+  return executor_->CreateStruct(elements);
+}
+
+absl::StatusOr<OwnedValueId> ExecuteSession::CreateSelection(
+    const v0::CreateSelectionRequest& request) {
+  return executor_->CreateSelection(GENC_TRY(Lookup(request.source_ref())),
+                                    request.index());
+}
+
+void ExecuteSession::Materialize(const v0::ValueRef& value_ref) {
+  absl::StatusOr<SharedValue> found = Find(value_ref);
+  if (!found.ok()) {
+    v0::ExecuteResponse response;
+    *response.mutable_value_ref() = value_ref;
+    SetError(found.status(), &response);
+    respond_(response);
+    return;
+  }
+  SharedValue value = *std::move(found);
+  {
+    absl::MutexLock lock(&mutex_);
+    ++num_pending_;
+  }
+  executor_->OnReady(value->ref(), [this, value, value_ref]() {
+    v0::ExecuteResponse response;
+    *response.mutable_value_ref() = value_ref;
+    absl::Status status =
+        executor_->Materialize(value->ref(), response.mutable_value());
+    if (!status.ok()) {
+      response.clear_value();
+      SetError(status, &response);
+    }
+    respond_(response);
+    absl::MutexLock lock(&mutex_);
+    --num_pending_;
+  });
+}
+
+}  // namespace genc
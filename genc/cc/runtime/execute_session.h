@@ -0,0 +1,91 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_RUNTIME_EXECUTE_SESSION_H_
+#define GENC_CC_RUNTIME_EXECUTE_SESSION_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/proto/v0/executor.pb.h"
+
+namespace genc {
+
+// The state of an `Execute` stream, or of any other transport that carries
+// batches of `ExecutorRequest`s with client-assigned references: the values
+// created through it, keyed by those references, and the materializations in
+// flight. Values are disposed of when the session is destroyed.
+class ExecuteSession {
+ public:
+  // Sends a response on the stream. Called once per materialization, from
+  // whichever thread completes it, so it must be thread-safe.
+  using Respond = std::function<void(const v0::ExecuteResponse&)>;
+
+  ExecuteSession(std::shared_ptr<Executor> executor, Respond respond)
+      : executor_(std::move(executor)), respond_(std::move(respond)) {}
+
+  // Waits for the pending materializations before disposing of the values.
+  ~ExecuteSession();
+
+  ExecuteSession(const ExecuteSession&) = delete;
+  ExecuteSession& operator=(const ExecuteSession&) = delete;
+
+  // Runs `request`. Must not be called concurrently, since later requests may
+  // refer to the values created by earlier ones.
+  void Handle(const v0::ExecutorRequest& request);
+
+ private:
+  using SharedValue = std::shared_ptr<OwnedValueId>;
+
+  // Binds `value` to `value_ref`. A failure is recorded in place of the value,
+  // and reported when it, or any value created from it, is materialized.
+  void Bind(const v0::ValueRef& value_ref, absl::StatusOr<OwnedValueId> value);
+
+  // Returns the value bound to `value_ref`, or the error bound in its place.
+  absl::StatusOr<SharedValue> Find(const v0::ValueRef& value_ref) const;
+
+  absl::StatusOr<ValueId> Lookup(const v0::ValueRef& value_ref) const;
+
+  absl::StatusOr<OwnedValueId> CreateCall(const v0::CreateCallRequest& request);
+  absl::StatusOr<OwnedValueId> CreateStruct(
+      const v0::CreateStructRequest& request);
+  absl::StatusOr<OwnedValueId> CreateSelection(
+      const v0::CreateSelectionRequest& request);
+
+  // Responds once the value is ready, without holding up the stream.
+  void Materialize(const v0::ValueRef& value_ref);
+
+  const std::shared_ptr<Executor> executor_;
+  const Respond respond_;
+
+  // Keyed by the client-assigned references, decoded like value IDs. Only
+  // accessed by the thread handling requests.
+  absl::flat_hash_map<uint64_t, absl::StatusOr<SharedValue>> values_;
+
+  absl::Mutex mutex_;
+  int num_pending_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace genc
+
+#endif  // GENC_CC_RUNTIME_EXECUTE_SESSION_H_
@@ -0,0 +1,147 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/execute_session.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "genc/cc/intrinsics/handler_sets.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/inline_executor.h"
+#include "genc/cc/runtime/threading.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "genc/proto/v0/executor.pb.h"
+
+namespace genc {
+namespace {
+
+class ExecuteSessionTest : public ::testing::Test {
+ protected:
+  ExecuteSessionTest()
+      : session_(CreateInlineExecutor(intrinsics::CreateCompleteHandlerSet({}),
+                                      CreateThreadBasedConcurrencyManager())
+                     .value(),
+                 [this](const v0::ExecuteResponse& response) {
+                   absl::MutexLock lock(&mutex_);
+                   responses_.push_back(response);
+                 }) {}
+
+  static v0::ValueRef Ref(uint64_t id) {
+    v0::ValueRef value_ref;
+    value_ref.set_numeric_id(id);
+    return value_ref;
+  }
+
+  void CreateStr(uint64_t id, const char* str) {
+    v0::ExecutorRequest request;
+    request.mutable_create_value()->mutable_value()->set_str(str);
+    *request.mutable_result_ref() = Ref(id);
+    session_.Handle(request);
+  }
+
+  void Materialize(uint64_t id) {
+    v0::ExecutorRequest request;
+    *request.mutable_materialize()->mutable_value_ref() = Ref(id);
+    session_.Handle(request);
+  }
+
+  // Waits until there are `n` responses in total, and returns them.
+  std::vector<v0::ExecuteResponse> AwaitResponses(size_t n) {
+    absl::MutexLock lock(&mutex_);
+    num_expected_ = n;
+    mutex_.Await(absl::Condition(this, &ExecuteSessionTest::HasResponses));
+    return responses_;
+  }
+
+ private:
+  bool HasResponses() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return responses_.size() >= num_expected_;
+  }
+
+  absl::Mutex mutex_;
+  std::vector<v0::ExecuteResponse> responses_ ABSL_GUARDED_BY(mutex_);
+  size_t num_expected_ ABSL_GUARDED_BY(mutex_) = 0;
+
+ protected:
+  // Declared last, so that it is destroyed while the responses can still be
+  // recorded.
+  ExecuteSession session_;
+};
+
+TEST_F(ExecuteSessionTest, MaterializesCreatedValues) {
+  CreateStr(1, "a");
+  CreateStr(2, "b");
+  v0::ExecutorRequest request;
+  *request.mutable_create_struct()->add_element_ref() = Ref(1);
+  *request.mutable_create_struct()->add_element_ref() = Ref(2);
+  *request.mutable_result_ref() = Ref(3);
+  session_.Handle(request);
+  request.Clear();
+  *request.mutable_create_selection()->mutable_source_ref() = Ref(3);
+  request.mutable_create_selection()->set_index(1);
+  *request.mutable_result_ref() = Ref(4);
+  session_.Handle(request);
+  Materialize(4);
+
+  std::vector<v0::ExecuteResponse> responses = AwaitResponses(1);
+  ASSERT_EQ(responses.size(), 1u);
+  EXPECT_EQ(responses[0].value_ref().numeric_id(), 4u);
+  EXPECT_EQ(responses[0].error_code(), 0);
+  EXPECT_EQ(responses[0].value().str(), "b");
+}
+
+TEST_F(ExecuteSessionTest, ReportsUnknownAndDisposedReferences) {
+  CreateStr(1, "a");
+  v0::ExecutorRequest request;
+  *request.mutable_dispose()->add_value_ref() = Ref(1);
+  session_.Handle(request);
+  Materialize(1);
+  Materialize(2);
+
+  std::vector<v0::ExecuteResponse> responses = AwaitResponses(2);
+  ASSERT_EQ(responses.size(), 2u);
+  for (const v0::ExecuteResponse& response : responses) {
+    EXPECT_EQ(response.error_code(),
+              static_cast<int>(absl::StatusCode::kInvalidArgument));
+  }
+}
+
+TEST_F(ExecuteSessionTest, ReportsFailuresOfDependencies) {
+  v0::ExecutorRequest request;
+  *request.mutable_create_selection()->mutable_source_ref() = Ref(7);
+  *request.mutable_result_ref() = Ref(1);
+  session_.Handle(request);
+  request.Clear();
+  *request.mutable_create_struct()->add_element_ref() = Ref(1);
+  *request.mutable_result_ref() = Ref(2);
+  session_.Handle(request);
+  Materialize(2);
+
+  std::vector<v0::ExecuteResponse> responses = AwaitResponses(1);
+  ASSERT_EQ(responses.size(), 1u);
+  EXPECT_NE(responses[0].error_code(), 0);
+  EXPECT_NE(responses[0].error_message().find("7"), std::string::npos);
+}
+
+}  // namespace
+}  // namespace genc
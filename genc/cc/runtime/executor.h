@@ -17,6 +17,7 @@ limitations under the License
 #define GENC_CC_RUNTIME_EXECUTOR_H_
 
 #include <cstdint>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <optional>
@@ -24,15 +25,13 @@ limitations under the License
 #include <utility>
 #include <vector>
 
-#include "absl/base/thread_annotations.h"
-#include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
-#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "genc/cc/runtime/status_macros.h"
+#include "genc/cc/runtime/value_table.h"
 #include "genc/proto/v0/computation.pb.h"
 #include "genc/proto/v0/executor.pb.h"
 
@@ -52,6 +51,15 @@ class ExecutorInterface {
   // asynchronously.
   virtual absl::StatusOr<OutValRefType> CreateValue(const v0::Value& val) = 0;
 
+  // Embeds an immutable `Value` shared with the caller. Executors may hold on
+  // to `val` rather than copying it, which avoids repeatedly deep-copying large
+  // computations (e.g., a loop body with a long prompt template or model
+  // config). By default, this is equivalent to `CreateValue(*val)`.
+  virtual absl::StatusOr<OutValRefType> CreateSharedValue(
+      std::shared_ptr<const v0::Value> val) {
+    return CreateValue(*val);
+  }
+
   // Calls `function` with optional `argument`.
   //
   // This method is expected to return quickly. It should not block on complex
@@ -100,6 +108,17 @@ class ExecutorInterface {
   // Dispose of a value, releasing any associated resources.
   virtual absl::Status Dispose(InValRefType value) = 0;
 
+  // Invokes `callback` once `value` is available, i.e., once `Materialize`
+  // no longer needs to wait on pending computation. The `callback` may be
+  // invoked synchronously if the value is already available, or otherwise on
+  // the thread that completes it, so it should be cheap.
+  //
+  // The default implementation invokes `callback` immediately, which is only
+  // appropriate for executors that cannot tell when their values are ready.
+  virtual void OnReady(InValRefType value, std::function<void()> callback) {
+    callback();
+  }
+
   virtual ~ExecutorInterface() {}
 };
 
@@ -185,29 +204,23 @@ class ExecutorBase : public Executor,
                 " must be copy-constructible.");
 
  private:
-  absl::Mutex mutex_;
-  ValueId next_value_id_ ABSL_GUARDED_BY(mutex_) = 0;
-  absl::flat_hash_map<ValueId, ExecutorValue> tracked_values_
-      ABSL_GUARDED_BY(mutex_);
+  ShardedValueTable<ExecutorValue> tracked_values_;
 
   // Tracks the provided value and returns the ID which refers to it.
   absl::StatusOr<OwnedValueId> TrackValue(ExecutorValue value) {
-    absl::WriterMutexLock lock(&mutex_);
-    ValueId id = next_value_id_++;
-    tracked_values_.emplace(id, std::move(value));
+    ValueId id = tracked_values_.Insert(std::move(value));
     return absl::StatusOr<OwnedValueId>(absl::in_place_t(), shared_from_this(),
                                         id);
   }
 
   // Returns a copy of the value previously stored with `TrackValue`.
   absl::StatusOr<ExecutorValue> GetTracked(ValueId value_id) {
-    absl::ReaderMutexLock lock(&mutex_);
-    auto value_iter = tracked_values_.find(value_id);
-    if (value_iter == tracked_values_.end()) {
+    std::optional<ExecutorValue> value = tracked_values_.Get(value_id);
+    if (!value.has_value()) {
       return absl::NotFoundError(
           absl::StrCat(ExecutorName(), " value not found: ", value_id));
     }
-    return value_iter->second;
+    return *std::move(value);
   }
 
  protected:
@@ -215,10 +228,7 @@ class ExecutorBase : public Executor,
   // This method is intended to be used by child class destructors to ensure
   // that the `ExecutorValue` references held by `tracked_values_` have been
   // destroyed.
-  void ClearTracked() {
-    absl::WriterMutexLock lock(&mutex_);
-    tracked_values_.clear();
-  }
+  void ClearTracked() { tracked_values_.Clear(); }
 
   // Returns the string name of the current executor.
   virtual absl::string_view ExecutorName() = 0;
@@ -226,6 +236,11 @@ class ExecutorBase : public Executor,
   virtual absl::StatusOr<ExecutorValue> CreateExecutorValue(
       const v0::Value& val) = 0;
 
+  virtual absl::StatusOr<ExecutorValue> CreateSharedExecutorValue(
+      std::shared_ptr<const v0::Value> val) {
+    return CreateExecutorValue(*val);
+  }
+
   virtual absl::StatusOr<ExecutorValue> CreateCall(
       ExecutorValue function, std::optional<ExecutorValue> argument) = 0;
 
@@ -237,6 +252,10 @@ class ExecutorBase : public Executor,
 
   virtual absl::Status Materialize(ExecutorValue value, v0::Value* val) = 0;
 
+  virtual void OnReady(ExecutorValue value, std::function<void()> callback) {
+    callback();
+  }
+
   ~ExecutorBase() override {}
 
  public:
@@ -244,6 +263,11 @@ class ExecutorBase : public Executor,
     return TrackValue(GENC_TRY(CreateExecutorValue(val)));
   }
 
+  absl::StatusOr<OwnedValueId> CreateSharedValue(
+      std::shared_ptr<const v0::Value> val) final {
+    return TrackValue(GENC_TRY(CreateSharedExecutorValue(std::move(val))));
+  }
+
   absl::StatusOr<OwnedValueId> CreateCall(
       const ValueId function,
       const std::optional<const ValueId> argument) final {
@@ -275,14 +299,21 @@ class ExecutorBase : public Executor,
     return Materialize(GENC_TRY(GetTracked(value_id)), value_pb);
   }
 
+  void OnReady(const ValueId value_id, std::function<void()> callback) final {
+    absl::StatusOr<ExecutorValue> value = GetTracked(value_id);
+    if (!value.ok()) {
+      // Let the subsequent `Materialize` report the error.
+      callback();
+      return;
+    }
+    OnReady(*std::move(value), std::move(callback));
+  }
+
   absl::Status Dispose(const ValueId value) final {
-    absl::WriterMutexLock lock(&mutex_);
-    auto value_iter = tracked_values_.find(value);
-    if (value_iter == tracked_values_.end()) {
+    if (!tracked_values_.Erase(value)) {
       return absl::NotFoundError(absl::StrCat(
           ExecutorName(), " value not found: ", value, ", cannot dispose."));
     }
-    tracked_values_.erase(value_iter);
     return absl::OkStatus();
   }
 };
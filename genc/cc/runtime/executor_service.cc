@@ -15,50 +15,271 @@ limitations under the License
 
 #include "genc/cc/runtime/executor_service.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
-#include "absl/strings/numbers.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "genc/cc/base/to_from_grpc_status.h"
+#include "genc/cc/runtime/compression.h"
+#include "genc/cc/runtime/concurrency.h"
+#include "genc/cc/runtime/execute_session.h"
 #include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/status_macros.h"
+#include "genc/cc/runtime/value_chunks.h"
+#include "genc/cc/runtime/value_ref.h"
 #include "genc/proto/v0/executor.grpc.pb.h"
 #include "genc/proto/v0/executor.pb.h"
 #include "include/grpcpp/server_context.h"
+#include "include/grpcpp/support/server_callback.h"
 #include "include/grpcpp/support/status.h"
+#include "include/grpcpp/support/sync_stream.h"
 
 namespace genc {
 namespace {
 
-v0::ValueRef ValueIdToRef(ValueId id) {
-  v0::ValueRef value_ref;
-  value_ref.set_id(absl::StrCat(id));
-  return value_ref;
-}
+// Serves an `Execute` stream with the callback API. No thread is held while
+// waiting for requests or for values to be materialized, and responses are
+// queued so that at most one write is in flight, as the API requires. Each
+// batch is handled on `concurrency_interface`, since creating values may
+// evaluate calls before returning, and the next one is only read after that.
+class ExecuteReactor
+    : public grpc::ServerBidiReactor<v0::ExecuteRequest, v0::ExecuteResponse> {
+ public:
+  ExecuteReactor(std::shared_ptr<Executor> executor,
+                 std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+                 grpc::CallbackServerContext* context,
+                 const CompressionOptions& compression)
+      : concurrency_interface_(std::move(concurrency_interface)),
+        compression_(compression),
+        session_(std::move(executor),
+                 [this](const v0::ExecuteResponse& response) {
+                   Respond(response);
+                 }) {
+    CompressStream(compression_, context);
+    StartRead(&request_);
+  }
+
+  void OnReadDone(bool ok) override {
+    if (ok) {
+      {
+        absl::MutexLock lock(&mutex_);
+        for (const v0::ExecutorRequest& request : request_.request()) {
+          if (request.has_materialize()) {
+            ++num_unanswered_;
+          }
+        }
+      }
+      concurrency_interface_->RunAsync([this]() {
+        for (const v0::ExecutorRequest& request : request_.request()) {
+          session_.Handle(request);
+        }
+        // The stream can't finish while a read is pending, so this is the
+        // last use of `this`.
+        StartRead(&request_);
+        return absl::OkStatus();
+      });
+      return;
+    }
+    bool finish;
+    {
+      absl::MutexLock lock(&mutex_);
+      reading_ = false;
+      finish = ShouldFinish();
+    }
+    if (finish) {
+      Finish(grpc::Status::OK);
+    }
+  }
+
+  void OnWriteDone(bool ok) override {
+    const v0::ExecuteResponse* next = nullptr;
+    bool finish = false;
+    {
+      absl::MutexLock lock(&mutex_);
+      writes_.pop_front();
+      if (!ok) {
+        // The client is gone, so the remaining responses are dropped.
+        writes_.clear();
+        writes_failed_ = true;
+      }
+      if (!writes_.empty()) {
+        next = &writes_.front();
+      } else {
+        finish = ShouldFinish();
+      }
+    }
+    if (next != nullptr) {
+      Write(next);
+    } else if (finish) {
+      Finish(grpc::Status::OK);
+    }
+  }
+
+  void OnDone() override { delete this; }
+
+ private:
+  void Respond(const v0::ExecuteResponse& response) {
+    const v0::ExecuteResponse* next = nullptr;
+    bool finish = false;
+    {
+      absl::MutexLock lock(&mutex_);
+      --num_unanswered_;
+      if (writes_failed_) {
+        finish = ShouldFinish();
+      } else {
+        writes_.push_back(response);
+        if (writes_.size() == 1) {
+          next = &writes_.front();
+        }
+      }
+    }
+    if (next != nullptr) {
+      Write(next);
+    } else if (finish) {
+      Finish(grpc::Status::OK);
+    }
+  }
 
-absl::StatusOr<ValueId> RefToValueId(v0::ValueRef ref) {
-  ValueId value_id;
-  if (absl::SimpleAtoi(ref.id(), &value_id)) {
-    return value_id;
-  } else {
-    return absl::InvalidArgumentError(absl::StrCat(
-        "Invalid value reference: ", ref.id()));
+  void Write(const v0::ExecuteResponse* response) {
+    StartWrite(response,
+               CompressionWriteOptions(compression_, response->ByteSizeLong()));
   }
+
+  // Whether the stream is done, in which case it must be finished exactly
+  // once, without holding `mutex_`.
+  bool ShouldFinish() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (reading_ || num_unanswered_ > 0 || !writes_.empty() || finished_) {
+      return false;
+    }
+    finished_ = true;
+    return true;
+  }
+
+  const std::shared_ptr<ConcurrencyInterface> concurrency_interface_;
+  const CompressionOptions compression_;
+  v0::ExecuteRequest request_;
+
+  absl::Mutex mutex_;
+  bool reading_ ABSL_GUARDED_BY(mutex_) = true;
+  // Materializations requested but not yet responded to.
+  int num_unanswered_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Responses not yet written, starting with the one being written. A deque
+  // keeps the address of the one being written stable.
+  std::deque<v0::ExecuteResponse> writes_ ABSL_GUARDED_BY(mutex_);
+  bool writes_failed_ ABSL_GUARDED_BY(mutex_) = false;
+  bool finished_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // Declared last, so that it is destroyed first: its destructor waits for the
+  // materializations still responding through this reactor.
+  ExecuteSession session_;
+};
+
+// The chunk size asked for by the client, capped so that it can't make the
+// server allocate more than a default-sized chunk at a time.
+size_t MaxChunkSize(const v0::MaterializeRequest& request) {
+  return request.max_chunk_size() > 0
+             ? std::min<size_t>(request.max_chunk_size(), kDefaultMaxChunkSize)
+             : kDefaultMaxChunkSize;
 }
 
+// Serves a `MaterializeStream` call with the callback API. No thread is held
+// while waiting for the value, or for the chunks to be written. Once the value
+// is ready, it is serialized on `concurrency_interface`, and each chunk is
+// copied out of the serialized form once the previous one has been written,
+// so that only one chunk is in flight at a time.
+class MaterializeStreamReactor
+    : public grpc::ServerWriteReactor<v0::MaterializeChunk> {
+ public:
+  MaterializeStreamReactor(
+      std::shared_ptr<Executor> executor,
+      std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+      const v0::MaterializeRequest& request,
+      grpc::CallbackServerContext* context,
+      const CompressionOptions& compression)
+      : max_chunk_size_(MaxChunkSize(request)), compression_(compression) {
+    CompressStream(compression_, context);
+    absl::StatusOr<ValueId> val = RefToValueId(request.value_ref());
+    if (!val.ok()) {
+      Finish(AbslToGrpcStatus(val.status()));
+      return;
+    }
+    // The thread told that the value is ready may be a gRPC thread, so the
+    // value is copied out and serialized elsewhere.
+    executor->OnReady(*val, [this, executor, concurrency_interface,
+                             value_id = *val]() {
+      concurrency_interface->RunAsync([this, executor, value_id]() {
+        v0::Value value;
+        const absl::Status status = executor->Materialize(value_id, &value);
+        if (!status.ok()) {
+          Finish(AbslToGrpcStatus(status));
+        } else if (!value.SerializeToString(&serialized_)) {
+          Finish(grpc::Status(grpc::StatusCode::INTERNAL,
+                              "Failed to serialize the value."));
+        } else {
+          WriteNext();
+        }
+        return absl::OkStatus();
+      });
+    });
+  }
+
+  void OnWriteDone(bool ok) override {
+    if (!ok) {
+      // The client is gone.
+      Finish(grpc::Status(grpc::StatusCode::UNAVAILABLE,
+                          "Failed to write the value."));
+      return;
+    }
+    WriteNext();
+  }
+
+  void OnDone() override { delete this; }
+
+ private:
+  // Writes the next chunk, or finishes the call once there are none left.
+  // Only called once the previous write is done, so never concurrently.
+  void WriteNext() {
+    if (position_ == serialized_.size()) {
+      // Deletes `this` once done.
+      Finish(grpc::Status::OK);
+      return;
+    }
+    const size_t size =
+        std::min(max_chunk_size_, serialized_.size() - position_);
+    chunk_.set_data(serialized_.substr(position_, size));
+    position_ += size;
+    StartWrite(&chunk_,
+               CompressionWriteOptions(compression_, chunk_.ByteSizeLong()));
+  }
+
+  const size_t max_chunk_size_;
+  const CompressionOptions compression_;
+  std::string serialized_;
+  // The bytes of `serialized_` written so far, or being written.
+  size_t position_ = 0;
+  v0::MaterializeChunk chunk_;
+};
+
 }  // namespace
 
 // An implementation of the `Executor` service defined in executor.proto that
 // maps incoming calls to an underlying implementation of C++ `Executor` API.
 class ExecutorService : public v0::Executor::Service {
  public:
-  explicit ExecutorService(std::shared_ptr<Executor> executor)
-      : executor_(executor) {}
+  ExecutorService(std::shared_ptr<Executor> executor,
+                  const CompressionOptions& compression)
+      : executor_(executor), compression_(compression) {}
 
   ~ExecutorService() override {}
 
@@ -146,9 +367,57 @@ class ExecutorService : public v0::Executor::Service {
     }
     absl::Status status =
         executor_->Materialize(val.value(), response->mutable_value());
+    if (status.ok()) {
+      CompressUnary(compression_, response->ByteSizeLong(), context);
+    }
     return AbslToGrpcStatus(status);
   }
 
+  grpc::Status MaterializeStream(
+      grpc::ServerContext* context, const v0::MaterializeRequest* request,
+      grpc::ServerWriter<v0::MaterializeChunk>* writer) override {
+    absl::StatusOr<ValueId> val = RefToValueId(request->value_ref());
+    if (!val.ok()) {
+      return AbslToGrpcStatus(val.status());
+    }
+    v0::Value value;
+    absl::Status status = executor_->Materialize(val.value(), &value);
+    if (!status.ok()) {
+      return AbslToGrpcStatus(status);
+    }
+    CompressStream(compression_, context);
+    return AbslToGrpcStatus(WriteValueChunks(
+        value, MaxChunkSize(*request),
+        [this, writer](const v0::MaterializeChunk& chunk) {
+          return writer->Write(chunk, CompressionWriteOptions(
+                                          compression_, chunk.ByteSizeLong()));
+        }));
+  }
+
+  grpc::Status Execute(
+      grpc::ServerContext* context,
+      grpc::ServerReaderWriter<v0::ExecuteResponse, v0::ExecuteRequest>* stream)
+      override {
+    CompressStream(compression_, context);
+    absl::Mutex write_mutex;
+    ExecuteSession session(
+        executor_,
+        [this, stream, &write_mutex](const v0::ExecuteResponse& response) {
+          absl::MutexLock lock(&write_mutex);
+          // A failed write means the client is gone, which ends the stream
+          // anyway.
+          stream->Write(response, CompressionWriteOptions(
+                                      compression_, response.ByteSizeLong()));
+        });
+    v0::ExecuteRequest request;
+    while (stream->Read(&request)) {
+      for (const v0::ExecutorRequest& executor_request : request.request()) {
+        session.Handle(executor_request);
+      }
+    }
+    return grpc::Status::OK;
+  }
+
   grpc::Status Dispose(grpc::ServerContext* context,
                        const v0::DisposeRequest* request,
                        v0::DisposeResponse* response) override {
@@ -175,11 +444,156 @@ class ExecutorService : public v0::Executor::Service {
 
  private:
   const std::shared_ptr<Executor> executor_;
+  const CompressionOptions compression_;
+};
+
+// Like `ExecutorService`, but using gRPC's callback API. Materializations are
+// parked until the values are ready, rather than each holding up a thread.
+// Creating values may block, e.g., while calls are evaluated synchronously, so
+// the other calls are served by the synchronous implementation on
+// `concurrency_interface`, rather than on gRPC's threads.
+class CallbackExecutorService : public v0::Executor::CallbackService {
+ public:
+  CallbackExecutorService(
+      std::shared_ptr<Executor> executor,
+      std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+      const CompressionOptions& compression)
+      : executor_(executor),
+        concurrency_interface_(std::move(concurrency_interface)),
+        compression_(compression),
+        service_(executor, compression) {}
+
+  ~CallbackExecutorService() override {}
+
+  grpc::ServerUnaryReactor* CreateValue(
+      grpc::CallbackServerContext* context,
+      const v0::CreateValueRequest* request,
+      v0::CreateValueResponse* response) override {
+    return RunAndFinish(context, [this, request, response]() {
+      return service_.CreateValue(nullptr, request, response);
+    });
+  }
+
+  grpc::ServerUnaryReactor* CreateCall(grpc::CallbackServerContext* context,
+                                       const v0::CreateCallRequest* request,
+                                       v0::CreateCallResponse* response)
+      override {
+    return RunAndFinish(context, [this, request, response]() {
+      return service_.CreateCall(nullptr, request, response);
+    });
+  }
+
+  grpc::ServerUnaryReactor* CreateStruct(
+      grpc::CallbackServerContext* context,
+      const v0::CreateStructRequest* request,
+      v0::CreateStructResponse* response) override {
+    return RunAndFinish(context, [this, request, response]() {
+      return service_.CreateStruct(nullptr, request, response);
+    });
+  }
+
+  grpc::ServerUnaryReactor* CreateSelection(
+      grpc::CallbackServerContext* context,
+      const v0::CreateSelectionRequest* request,
+      v0::CreateSelectionResponse* response) override {
+    return RunAndFinish(context, [this, request, response]() {
+      return service_.CreateSelection(nullptr, request, response);
+    });
+  }
+
+  grpc::ServerUnaryReactor* Materialize(
+      grpc::CallbackServerContext* context,
+      const v0::MaterializeRequest* request,
+      v0::MaterializeResponse* response) override {
+    absl::StatusOr<ValueId> val = RefToValueId(request->value_ref());
+    if (!val.ok()) {
+      return Finish(context, AbslToGrpcStatus(val.status()));
+    }
+    grpc::ServerUnaryReactor* reactor = context->DefaultReactor();
+    // The request and response outlive the call to `Finish()`. Copying out a
+    // large value takes a while, so it isn't done on the thread that made it
+    // ready.
+    executor_->OnReady(*val, [this, value_id = *val, context, response,
+                              reactor]() {
+      concurrency_interface_->RunAsync([this, value_id, context, response,
+                                        reactor]() {
+        absl::Status status =
+            executor_->Materialize(value_id, response->mutable_value());
+        if (status.ok()) {
+          CompressUnary(compression_, response->ByteSizeLong(), context);
+        }
+        reactor->Finish(AbslToGrpcStatus(status));
+        return absl::OkStatus();
+      });
+    });
+    return reactor;
+  }
+
+  grpc::ServerWriteReactor<v0::MaterializeChunk>* MaterializeStream(
+      grpc::CallbackServerContext* context,
+      const v0::MaterializeRequest* request) override {
+    return new MaterializeStreamReactor(executor_, concurrency_interface_,
+                                        *request, context, compression_);
+  }
+
+  grpc::ServerBidiReactor<v0::ExecuteRequest, v0::ExecuteResponse>* Execute(
+      grpc::CallbackServerContext* context) override {
+    return new ExecuteReactor(executor_, concurrency_interface_, context,
+                              compression_);
+  }
+
+  grpc::ServerUnaryReactor* Dispose(grpc::CallbackServerContext* context,
+                                    const v0::DisposeRequest* request,
+                                    v0::DisposeResponse* response) override {
+    return RunAndFinish(context, [this, request, response]() {
+      return service_.Dispose(nullptr, request, response);
+    });
+  }
+
+ private:
+  static grpc::ServerUnaryReactor* Finish(grpc::CallbackServerContext* context,
+                                          const grpc::Status& status) {
+    grpc::ServerUnaryReactor* reactor = context->DefaultReactor();
+    reactor->Finish(status);
+    return reactor;
+  }
+
+  // Finishes the call with the status returned by `handler`, which runs on
+  // `concurrency_interface_`.
+  template <typename Handler>
+  grpc::ServerUnaryReactor* RunAndFinish(grpc::CallbackServerContext* context,
+                                         Handler handler) {
+    grpc::ServerUnaryReactor* reactor = context->DefaultReactor();
+    concurrency_interface_->RunAsync(
+        [reactor, handler = std::move(handler)]() {
+          reactor->Finish(handler());
+          return absl::OkStatus();
+        });
+    return reactor;
+  }
+
+  const std::shared_ptr<Executor> executor_;
+  const std::shared_ptr<ConcurrencyInterface> concurrency_interface_;
+  const CompressionOptions compression_;
+  ExecutorService service_;
 };
 
 absl::StatusOr<std::shared_ptr<v0::Executor::Service>> CreateExecutorService(
-    std::shared_ptr<Executor> executor) {
-  return std::make_shared<ExecutorService>(executor);
+    std::shared_ptr<Executor> executor, const CompressionOptions& compression) {
+  return std::make_shared<ExecutorService>(executor, compression);
+}
+
+absl::StatusOr<std::shared_ptr<v0::Executor::CallbackService>>
+CreateCallbackExecutorService(
+    std::shared_ptr<Executor> executor,
+    std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+    const CompressionOptions& compression) {
+  if (concurrency_interface == nullptr) {
+    return absl::InvalidArgumentError(
+        "The callback service needs a concurrency interface to run on.");
+  }
+  return std::make_shared<CallbackExecutorService>(
+      executor, std::move(concurrency_interface), compression);
 }
 
 }  // namespace genc
@@ -19,13 +19,27 @@ limitations under the License
 #include <memory>
 
 #include "absl/status/statusor.h"
+#include "genc/cc/runtime/compression.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/executor.h"
 #include "genc/proto/v0/executor.grpc.pb.h"
 
 namespace genc {
 
+// Responses (values being materialized) are compressed as per `compression`.
 absl::StatusOr<std::shared_ptr<v0::Executor::Service>> CreateExecutorService(
-     std::shared_ptr<Executor> executor);
+    std::shared_ptr<Executor> executor,
+    const CompressionOptions& compression = {});
+
+// Creates a service implemented with gRPC's callback API, which doesn't hold a
+// thread while values are being materialized. The calls that may block, such
+// as creating values, run on `concurrency_interface`, which should be bounded
+// (e.g., a work-stealing pool) rather than spawn a thread per call.
+absl::StatusOr<std::shared_ptr<v0::Executor::CallbackService>>
+CreateCallbackExecutorService(
+    std::shared_ptr<Executor> executor,
+    std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+    const CompressionOptions& compression = {});
 
 }  // namespace genc
 
@@ -0,0 +1,264 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/executor_service.h"
+
+#include <chrono>  // NOLINT
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+#include "genc/cc/intrinsics/handler_sets.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/inline_executor.h"
+#include "genc/cc/runtime/remote_executor.h"
+#include "genc/cc/runtime/threading.h"
+#include "genc/cc/runtime/value_chunks.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "genc/proto/v0/executor.grpc.pb.h"
+#include "genc/proto/v0/executor.pb.h"
+#include "include/grpcpp/client_context.h"
+#include "include/grpcpp/server.h"
+#include "include/grpcpp/server_builder.h"
+#include "include/grpcpp/support/channel_arguments.h"
+#include "include/grpcpp/support/status.h"
+#include "include/grpcpp/support/sync_stream.h"
+
+namespace genc {
+namespace {
+
+void AddMaterialize(uint64_t id, v0::ExecuteRequest* batch) {
+  v0::ExecutorRequest* request = batch->add_request();
+  request->mutable_materialize()->mutable_value_ref()->set_numeric_id(id);
+}
+
+// Runs each test against both the synchronous and the callback service, served
+// in process.
+class ExecutorServiceTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    std::shared_ptr<Executor> executor =
+        CreateInlineExecutor(intrinsics::CreateCompleteHandlerSet({}),
+                             CreateThreadBasedConcurrencyManager())
+            .value();
+    grpc::ServerBuilder builder;
+    if (GetParam()) {
+      WorkStealingConcurrencyManagerOptions options;
+      options.num_workers = 2;
+      callback_service_ =
+          CreateCallbackExecutorService(
+              executor, CreateWorkStealingConcurrencyManager(options))
+              .value();
+      builder.RegisterService(callback_service_.get());
+    } else {
+      service_ = CreateExecutorService(executor).value();
+      builder.RegisterService(service_.get());
+    }
+    server_ = builder.BuildAndStart();
+    stub_ = v0::Executor::NewStub(
+        server_->InProcessChannel(grpc::ChannelArguments()));
+  }
+
+  void TearDown() override { server_->Shutdown(); }
+
+  v0::ValueRef CreateStr(const std::string& str) {
+    grpc::ClientContext context;
+    v0::CreateValueRequest request;
+    request.mutable_value()->set_str(str);
+    v0::CreateValueResponse response;
+    EXPECT_TRUE(stub_->CreateValue(&context, request, &response).ok());
+    return response.value_ref();
+  }
+
+  std::shared_ptr<v0::Executor::Service> service_;
+  std::shared_ptr<v0::Executor::CallbackService> callback_service_;
+  std::unique_ptr<grpc::Server> server_;
+  std::unique_ptr<v0::Executor::Stub> stub_;
+};
+
+TEST_P(ExecutorServiceTest, MaterializesInChunks) {
+  const std::string str(100000, 'x');
+  v0::MaterializeRequest request;
+  *request.mutable_value_ref() = CreateStr(str);
+  request.set_max_chunk_size(4096);
+  grpc::ClientContext context;
+  std::unique_ptr<grpc::ClientReaderInterface<v0::MaterializeChunk>> reader =
+      stub_->MaterializeStream(&context, request);
+  int num_chunks = 0;
+  v0::Value value;
+  ASSERT_TRUE(ReadValueChunks(
+                  [&](v0::MaterializeChunk* chunk) {
+                    if (!reader->Read(chunk)) {
+                      return false;
+                    }
+                    EXPECT_LE(chunk->data().size(), 4096u);
+                    ++num_chunks;
+                    return true;
+                  },
+                  &value)
+                  .ok());
+  EXPECT_TRUE(reader->Finish().ok());
+  EXPECT_EQ(value.str(), str);
+  EXPECT_GT(num_chunks, 24);
+}
+
+TEST_P(ExecutorServiceTest, CapsChunkSizeAskedForByClient) {
+  const std::string str(kDefaultMaxChunkSize + 1000, 'x');
+  v0::MaterializeRequest request;
+  *request.mutable_value_ref() = CreateStr(str);
+  request.set_max_chunk_size(std::numeric_limits<uint32_t>::max());
+  grpc::ClientContext context;
+  std::unique_ptr<grpc::ClientReaderInterface<v0::MaterializeChunk>> reader =
+      stub_->MaterializeStream(&context, request);
+  size_t total_size = 0;
+  v0::MaterializeChunk chunk;
+  while (reader->Read(&chunk)) {
+    EXPECT_LE(chunk.data().size(), kDefaultMaxChunkSize);
+    total_size += chunk.data().size();
+  }
+  EXPECT_TRUE(reader->Finish().ok());
+  EXPECT_GT(total_size, str.size());
+}
+
+TEST_P(ExecutorServiceTest, MaterializesManyStreamsAtOnce) {
+  const std::string str(200000, 'x');
+  v0::MaterializeRequest request;
+  *request.mutable_value_ref() = CreateStr(str);
+  request.set_max_chunk_size(4096);
+  constexpr int kNumStreams = 32;
+  std::vector<std::unique_ptr<grpc::ClientContext>> contexts;
+  using ChunkReader = grpc::ClientReaderInterface<v0::MaterializeChunk>;
+  std::vector<std::unique_ptr<ChunkReader>> readers;
+  for (int i = 0; i < kNumStreams; ++i) {
+    contexts.push_back(std::make_unique<grpc::ClientContext>());
+    contexts.back()->set_deadline(std::chrono::system_clock::now() +
+                                  std::chrono::seconds(30));
+    readers.push_back(stub_->MaterializeStream(contexts.back().get(), request));
+  }
+  // Every stream makes progress before any is read to the end, though the
+  // service has fewer threads than streams.
+  std::vector<std::string> serialized(kNumStreams);
+  v0::MaterializeChunk chunk;
+  for (int i = 0; i < kNumStreams; ++i) {
+    ASSERT_TRUE(readers[i]->Read(&chunk));
+    serialized[i] = chunk.data();
+  }
+  for (int i = 0; i < kNumStreams; ++i) {
+    while (readers[i]->Read(&chunk)) {
+      serialized[i].append(chunk.data());
+    }
+    ASSERT_TRUE(readers[i]->Finish().ok());
+    v0::Value value;
+    ASSERT_TRUE(value.ParseFromString(serialized[i]));
+    EXPECT_EQ(value.str(), str);
+  }
+}
+
+TEST_P(ExecutorServiceTest, FailsToMaterializeUnknownValue) {
+  v0::MaterializeRequest request;
+  request.mutable_value_ref()->set_numeric_id(12345);
+  grpc::ClientContext context;
+  std::unique_ptr<grpc::ClientReaderInterface<v0::MaterializeChunk>> reader =
+      stub_->MaterializeStream(&context, request);
+  v0::MaterializeChunk chunk;
+  EXPECT_FALSE(reader->Read(&chunk));
+  EXPECT_FALSE(reader->Finish().ok());
+}
+
+TEST_P(ExecutorServiceTest, ExecutesBatchesOnStream) {
+  grpc::ClientContext context;
+  std::unique_ptr<grpc::ClientReaderWriterInterface<v0::ExecuteRequest,
+                                                    v0::ExecuteResponse>>
+      stream = stub_->Execute(&context);
+  v0::ExecuteRequest batch;
+  for (uint64_t id : {1, 2}) {
+    v0::ExecutorRequest* request = batch.add_request();
+    request->mutable_result_ref()->set_numeric_id(id);
+    request->mutable_create_value()->mutable_value()->set_str(
+        id == 1 ? "x" : "y");
+  }
+  v0::ExecutorRequest* xy = batch.add_request();
+  xy->mutable_result_ref()->set_numeric_id(3);
+  xy->mutable_create_struct()->add_element_ref()->set_numeric_id(1);
+  xy->mutable_create_struct()->add_element_ref()->set_numeric_id(2);
+  AddMaterialize(3, &batch);
+  ASSERT_TRUE(stream->Write(batch));
+  v0::ExecuteResponse response;
+  ASSERT_TRUE(stream->Read(&response));
+  EXPECT_EQ(response.value_ref().numeric_id(), 3u);
+  EXPECT_EQ(response.error_code(), 0);
+  ASSERT_EQ(response.value().struct_().element_size(), 2);
+  EXPECT_EQ(response.value().struct_().element(1).str(), "y");
+
+  // Later batches refer to the values created by earlier ones.
+  batch.Clear();
+  v0::ExecutorRequest* y = batch.add_request();
+  y->mutable_result_ref()->set_numeric_id(4);
+  y->mutable_create_selection()->mutable_source_ref()->set_numeric_id(3);
+  y->mutable_create_selection()->set_index(1);
+  AddMaterialize(4, &batch);
+  ASSERT_TRUE(stream->Write(batch));
+  ASSERT_TRUE(stream->Read(&response));
+  EXPECT_EQ(response.value_ref().numeric_id(), 4u);
+  EXPECT_EQ(response.value().str(), "y");
+
+  batch.Clear();
+  AddMaterialize(5, &batch);
+  ASSERT_TRUE(stream->Write(batch));
+  ASSERT_TRUE(stream->Read(&response));
+  EXPECT_EQ(response.value_ref().numeric_id(), 5u);
+  EXPECT_NE(response.error_code(), 0);
+
+  // The server ends the stream once the client has.
+  EXPECT_TRUE(stream->WritesDone());
+  EXPECT_FALSE(stream->Read(&response));
+  EXPECT_TRUE(stream->Finish().ok());
+}
+
+TEST_P(ExecutorServiceTest, ServesStreamingRemoteExecutor) {
+  RemoteExecutorOptions options;
+  options.use_execute_stream = true;
+  std::shared_ptr<Executor> executor =
+      CreateRemoteExecutor(
+          v0::Executor::NewStub(
+              server_->InProcessChannel(grpc::ChannelArguments())),
+          CreateThreadBasedConcurrencyManager(), options)
+          .value();
+  std::vector<OwnedValueId> values;
+  for (int i = 0; i < 10; ++i) {
+    v0::Value value;
+    value.set_str(std::to_string(i));
+    values.push_back(executor->CreateValue(value).value());
+  }
+  std::vector<ValueId> value_ids;
+  for (const OwnedValueId& value : values) {
+    value_ids.push_back(value.ref());
+  }
+  OwnedValueId all = executor->CreateStruct(value_ids).value();
+  v0::Value all_pb;
+  ASSERT_TRUE(executor->Materialize(all.ref(), &all_pb).ok());
+  ASSERT_EQ(all_pb.struct_().element_size(), 10);
+  EXPECT_EQ(all_pb.struct_().element(9).str(), "9");
+}
+
+INSTANTIATE_TEST_SUITE_P(SyncAndCallback, ExecutorServiceTest,
+                         ::testing::Bool());
+
+}  // namespace
+}  // namespace genc
@@ -33,7 +33,7 @@ absl::StatusOr<std::shared_ptr<Executor>> CreateLocalExecutor(
     std::shared_ptr<IntrinsicHandlerSet> handler_set,
     std::shared_ptr<ConcurrencyInterface> concurrency_interface) {
   if (concurrency_interface == nullptr) {
-    concurrency_interface = CreateThreadBasedConcurrencyManager();
+    concurrency_interface = CreateWorkStealingConcurrencyManager();
   }
   return CreateControlFlowExecutor(
       handler_set,
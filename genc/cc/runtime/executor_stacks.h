@@ -27,6 +27,7 @@ namespace genc {
 
 // Constructs a local executor for a given set of intrinsic handlers.
 // Use this when you have a set of custom handlers to add that is non default.
+// If `concurrency_interface` is null, a work-stealing thread pool is used.
 absl::StatusOr<std::shared_ptr<Executor>> CreateLocalExecutor(
     std::shared_ptr<IntrinsicHandlerSet> handler_set,
     std::shared_ptr<ConcurrencyInterface> concurrency_interface = nullptr);
@@ -15,16 +15,22 @@ limitations under the License
 
 #include "genc/cc/runtime/inline_executor.h"
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/executor.h"
 #include "genc/cc/runtime/intrinsic_handler.h"
@@ -34,33 +40,151 @@ limitations under the License
 namespace genc {
 namespace {
 
+// An immutable value. Leaves are protos shared with whoever created them.
+// Structs built by `CreateStruct` are kept as trees of their elements, so that
+// building them, selecting from them, and materializing them never copies the
+// payloads (e.g., long strings or media) of the elements more than once.
 class ExecutorValue {
  public:
-  explicit ExecutorValue(const std::shared_ptr<v0::Value>& value_pb)
-      : value_(value_pb) {}
+  explicit ExecutorValue(std::shared_ptr<const v0::Value> value_pb)
+      : value_(std::move(value_pb)) {}
+
+  // A struct of the given `elements`, which are shared rather than copied.
+  explicit ExecutorValue(std::vector<ExecutorValue> elements);
 
   ExecutorValue(const ExecutorValue& other) = default;
-  ExecutorValue(ExecutorValue&& other) : value_(std::move(other.value_)) {}
-  ExecutorValue& operator=(ExecutorValue&& other) {
-    this->value_ = std::move(other.value_);
-    return *this;
-  }
+  ExecutorValue(ExecutorValue&& other) = default;
+  ExecutorValue& operator=(const ExecutorValue& other) = default;
+  ExecutorValue& operator=(ExecutorValue&& other) = default;
+
+  // Returns the value as a single proto. For a struct tree, the proto is
+  // assembled the first time it is requested (e.g., to pass the struct as an
+  // argument to an intrinsic), and then reused.
+  const std::shared_ptr<const v0::Value>& shared_value() const;
+  const v0::Value& value() const { return *shared_value(); }
 
-  const v0::Value& value() const { return *value_; }
+  // Returns the element at `index` of a struct, sharing it with the struct.
+  absl::StatusOr<ExecutorValue> Select(uint32_t index) const;
+
+  // Copies the value into `value_pb`, which is the only copy made of it.
+  void CopyTo(v0::Value* value_pb) const;
 
  private:
+  struct Elements;
+
   ExecutorValue() = delete;
 
-  std::shared_ptr<v0::Value> value_;
+  // Exactly one of these is set.
+  std::shared_ptr<const v0::Value> value_;
+  std::shared_ptr<const Elements> elements_;
+};
+
+struct ExecutorValue::Elements {
+  explicit Elements(std::vector<ExecutorValue> values)
+      : values(std::move(values)) {}
+
+  const std::vector<ExecutorValue> values;
+  mutable absl::once_flag assembled_once;
+  mutable std::shared_ptr<const v0::Value> assembled;
 };
 
+ExecutorValue::ExecutorValue(std::vector<ExecutorValue> elements)
+    : elements_(std::make_shared<const Elements>(std::move(elements))) {}
+
+const std::shared_ptr<const v0::Value>& ExecutorValue::shared_value() const {
+  if (elements_ == nullptr) {
+    return value_;
+  }
+  absl::call_once(elements_->assembled_once, [this]() {
+    std::shared_ptr<v0::Value> value_pb = std::make_shared<v0::Value>();
+    CopyTo(value_pb.get());
+    elements_->assembled = std::move(value_pb);
+  });
+  return elements_->assembled;
+}
+
+absl::StatusOr<ExecutorValue> ExecutorValue::Select(uint32_t index) const {
+  if (elements_ != nullptr) {
+    if (elements_->values.size() <= index) {
+      return absl::OutOfRangeError("Selection index out of bounds.");
+    }
+    return elements_->values[index];
+  }
+  if (!value_->has_struct_()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Not a struct: ", value_->DebugString()));
+  }
+  if (static_cast<uint32_t>(value_->struct_().element_size()) <= index) {
+    return absl::OutOfRangeError("Selection index out of bounds.");
+  }
+  return ExecutorValue(std::shared_ptr<const v0::Value>(
+      value_, &value_->struct_().element(index)));
+}
+
+void ExecutorValue::CopyTo(v0::Value* value_pb) const {
+  if (elements_ == nullptr) {
+    value_pb->CopyFrom(*value_);
+    return;
+  }
+  value_pb->Clear();
+  auto elements = value_pb->mutable_struct_()->mutable_element();
+  elements->Reserve(elements_->values.size());
+  for (const ExecutorValue& element : elements_->values) {
+    element.CopyTo(elements->Add());
+  }
+}
+
 using ValueFuture =
     std::shared_ptr<FutureInterface<absl::StatusOr<ExecutorValue>>>;
 
+// Returns a future that already holds `value`. Values are immutable once
+// created, so there is nothing to schedule.
+ValueFuture ReadyValue(ExecutorValue value) {
+  return MakeReadyFuture(absl::StatusOr<absl::StatusOr<ExecutorValue>>(
+      absl::in_place, std::move(value)));
+}
+
 absl::StatusOr<ExecutorValue> Wait(ValueFuture value_future) {
   return GENC_TRY(value_future->Get());
 }
 
+using ValueVectorOr =
+    absl::StatusOr<std::vector<absl::StatusOr<ExecutorValue>>>;
+
+// Unpacks the result of a `WhenAll` over value futures, returning the first
+// error encountered, if any.
+absl::StatusOr<std::vector<ExecutorValue>> Unwrap(ValueVectorOr values_or) {
+  std::vector<absl::StatusOr<ExecutorValue>> values_or_errors =
+      GENC_TRY(std::move(values_or));
+  std::vector<ExecutorValue> values;
+  values.reserve(values_or_errors.size());
+  for (absl::StatusOr<ExecutorValue>& value : values_or_errors) {
+    values.push_back(GENC_TRY(std::move(value)));
+  }
+  return values;
+}
+
+// The handler for an intrinsic function value, or the error from looking it
+// up or validating the intrinsic.
+struct ResolvedIntrinsic {
+  uint64_t executor_id = 0;
+  const v0::Value* value_pb = nullptr;
+  // Shares ownership of the control block of `value_pb` so that while the
+  // entry exists, no other value can be allocated with the same owner.
+  std::weak_ptr<const v0::Value> owner;
+  absl::StatusOr<const InlineIntrinsicHandlerInterface*> interface;
+};
+
+// Intrinsics resolved on this thread, direct-mapped by address. Values that
+// are shared rather than copied into the executor, like the nodes of the
+// computations compiled by the control flow executor, thus only get resolved
+// once per thread, and lookups take no locks.
+constexpr size_t kResolvedIntrinsicCacheSize = 64;
+thread_local std::array<ResolvedIntrinsic, kResolvedIntrinsicCacheSize>
+    resolved_intrinsics;
+
+std::atomic<uint64_t> next_executor_id = 1;
+
 // Executor that specializes in handling inline intrinsics.
 class InlineExecutor : public ExecutorBase<ValueFuture>,
                        public InlineIntrinsicHandlerInterface::Context {
@@ -69,7 +193,9 @@ class InlineExecutor : public ExecutorBase<ValueFuture>,
       std::shared_ptr<IntrinsicHandlerSet> handler_set,
       std::shared_ptr<ConcurrencyInterface> concurrency_interface)
       : concurrency_interface_(std::move(concurrency_interface)),
-        intrinsic_handlers_(std::move(handler_set)) {}
+        intrinsic_handlers_(std::move(handler_set)),
+        executor_id_(
+            next_executor_id.fetch_add(1, std::memory_order_relaxed)) {}
 
   ~InlineExecutor() override { ClearTracked(); }
 
@@ -84,41 +210,52 @@ class InlineExecutor : public ExecutorBase<ValueFuture>,
 
   absl::StatusOr<ValueFuture> CreateExecutorValue(
       const v0::Value& val_pb) final {
-    return concurrency_interface_->RunAsync(
-        [val_pb]() -> absl::StatusOr<ExecutorValue> {
-          return ExecutorValue(std::make_shared<v0::Value>(val_pb));
-        });
+    return CreateSharedExecutorValue(std::make_shared<const v0::Value>(val_pb));
+  }
+
+  absl::StatusOr<ValueFuture> CreateSharedExecutorValue(
+      std::shared_ptr<const v0::Value> val_pb) final {
+    return ReadyValue(ExecutorValue(std::move(val_pb)));
   }
 
   absl::Status Materialize(ValueFuture value_future, v0::Value* val_pb) final {
     ExecutorValue value = GENC_TRY(Wait(value_future));
     if (val_pb != nullptr) {
-      val_pb->CopyFrom(value.value());
+      value.CopyTo(val_pb);
     }
     return absl::OkStatus();
   }
 
+  void OnReady(ValueFuture value_future,
+               std::function<void()> callback) final {
+    value_future->OnReady(std::move(callback));
+  }
+
   absl::StatusOr<ValueFuture> CreateCall(
       ValueFuture func_future, std::optional<ValueFuture> arg_future) final {
     if (!arg_future.has_value()) {
       return absl::InvalidArgumentError("An argument is always required.");
     }
-    return concurrency_interface_->RunAsync(
-        [function = std::move(func_future), argument = std::move(arg_future),
-         this]() -> absl::StatusOr<ExecutorValue> {
-          ExecutorValue fn = GENC_TRY(Wait(function));
-          ExecutorValue arg = GENC_TRY(Wait(argument.value()));
+    const std::vector<ValueFuture> inputs = {std::move(func_future),
+                                             std::move(arg_future.value())};
+    return concurrency_interface_->Then(
+        WhenAll(absl::MakeConstSpan(inputs)),
+        // Keeps the executor alive for calls that are abandoned, e.g., by a
+        // fallback that has its result.
+        [this, this_keepalive = shared_from_this()](
+            ValueVectorOr input_values) -> absl::StatusOr<ExecutorValue> {
+          std::vector<ExecutorValue> values =
+              GENC_TRY(Unwrap(std::move(input_values)));
+          const ExecutorValue& fn = values[0];
+          const ExecutorValue& arg = values[1];
           if (!fn.value().has_intrinsic()) {
             return absl::InvalidArgumentError(
                 absl::StrCat("Unsupported function type: ",
                     fn.value().DebugString()));
           }
           const v0::Intrinsic& intr_pb = fn.value().intrinsic();
-          const IntrinsicHandler* const handler =
-              GENC_TRY(intrinsic_handlers_->GetHandler(intr_pb.uri()));
-          GENC_TRY(handler->CheckWellFormed(intr_pb));
           const InlineIntrinsicHandlerInterface* const interface =
-              GENC_TRY(IntrinsicHandler::GetInlineInterface(handler));
+              GENC_TRY(ResolveIntrinsic(fn));
           std::shared_ptr<v0::Value> result = std::make_shared<v0::Value>();
           GENC_TRY(
               interface->ExecuteCall(intr_pb, arg.value(), result.get(), this));
@@ -128,38 +265,53 @@ class InlineExecutor : public ExecutorBase<ValueFuture>,
 
   absl::StatusOr<ValueFuture> CreateStruct(
       std::vector<ValueFuture> member_futures) final {
-    return concurrency_interface_->RunAsync(
-        [member_futures]() -> absl::StatusOr<ExecutorValue> {
-          std::shared_ptr<v0::Value> result_pb = std::make_shared<v0::Value>();
-          auto elements = result_pb->mutable_struct_()->mutable_element();
-          for (const auto& member_future : member_futures) {
-            ExecutorValue val = GENC_TRY(Wait(member_future));
-            elements->Add()->CopyFrom(val.value());
-          }
-          return ExecutorValue(result_pb);
+    // Only real intrinsic calls are scheduled; reshaping data is cheap enough
+    // to do on whichever thread completes the inputs.
+    return ThenInline(
+        WhenAll(absl::MakeConstSpan(member_futures)),
+        [](ValueVectorOr member_values) -> absl::StatusOr<ExecutorValue> {
+          return ExecutorValue(GENC_TRY(Unwrap(std::move(member_values))));
         });
   }
 
   absl::StatusOr<ValueFuture> CreateSelection(ValueFuture value_future,
                                               const uint32_t index) final {
-    return concurrency_interface_->RunAsync(
-        [value_future, index]() -> absl::StatusOr<ExecutorValue> {
-          ExecutorValue val = GENC_TRY(Wait(value_future));
-          if (!val.value().has_struct_()) {
-            return absl::InvalidArgumentError(
-                absl::StrCat("Not a struct: ", val.value().DebugString()));
-          }
-          if (val.value().struct_().element_size() <= index) {
-            return absl::OutOfRangeError("Selection index out of bounds.");
-          }
-          return ExecutorValue(std::make_shared<v0::Value>(
-              val.value().struct_().element(index)));
+    return ThenInline(
+        value_future,
+        [index](absl::StatusOr<absl::StatusOr<ExecutorValue>> value_or)
+            -> absl::StatusOr<ExecutorValue> {
+          ExecutorValue val = GENC_TRY(GENC_TRY(std::move(value_or)));
+          return val.Select(index);
         });
   }
 
  private:
+  absl::StatusOr<const InlineIntrinsicHandlerInterface*> ResolveIntrinsic(
+      const ExecutorValue& fn) const {
+    const std::shared_ptr<const v0::Value>& value = fn.shared_value();
+    const uintptr_t address = reinterpret_cast<uintptr_t>(value.get());
+    ResolvedIntrinsic& entry =
+        resolved_intrinsics[((address >> 4) ^ executor_id_) %
+                            kResolvedIntrinsicCacheSize];
+    if (entry.executor_id != executor_id_ || entry.value_pb != value.get() ||
+        entry.owner.owner_before(value) || value.owner_before(entry.owner)) {
+      entry = ResolvedIntrinsic{executor_id_, value.get(), value,
+                                LookUpIntrinsic(value->intrinsic())};
+    }
+    return entry.interface;
+  }
+
+  absl::StatusOr<const InlineIntrinsicHandlerInterface*> LookUpIntrinsic(
+      const v0::Intrinsic& intr_pb) const {
+    const IntrinsicHandler* const handler =
+        GENC_TRY(intrinsic_handlers_->GetHandler(intr_pb.uri()));
+    GENC_TRY(handler->CheckWellFormed(intr_pb));
+    return IntrinsicHandler::GetInlineInterface(handler);
+  }
+
   const std::shared_ptr<ConcurrencyInterface> concurrency_interface_;
   const std::shared_ptr<IntrinsicHandlerSet> intrinsic_handlers_;
+  const uint64_t executor_id_;
 };
 
 }  // namespace
@@ -167,6 +319,7 @@ class InlineExecutor : public ExecutorBase<ValueFuture>,
 absl::StatusOr<std::shared_ptr<Executor>> CreateInlineExecutor(
     std::shared_ptr<IntrinsicHandlerSet> handler_set,
     std::shared_ptr<ConcurrencyInterface> concurrency_interface) {
+  handler_set->Freeze();
   return std::make_shared<InlineExecutor>(std::move(handler_set),
                                           std::move(concurrency_interface));
 }
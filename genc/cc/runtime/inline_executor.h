@@ -26,6 +26,7 @@ limitations under the License
 namespace genc {
 
 // Creates an executor that specializes in handling inline intrinsic calls.
+// Freezes `handler_set`.
 absl::StatusOr<std::shared_ptr<Executor>> CreateInlineExecutor(
     std::shared_ptr<IntrinsicHandlerSet> handler_set,
     std::shared_ptr<ConcurrencyInterface> concurrency_interface);
@@ -0,0 +1,82 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Measures the per-operation overhead of the inline executor for values that
+// need no intrinsic call: creating a value, building a struct out of values,
+// and selecting an element from it. Each iteration materializes the result,
+// so the time includes whatever scheduling the operation incurs.
+//
+//   bazel run -c opt //genc/cc/runtime:inline_executor_benchmark
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "genc/cc/intrinsics/handler_sets.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/inline_executor.h"
+#include "genc/cc/runtime/threading.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace {
+
+std::shared_ptr<Executor> CreateBenchmarkExecutor() {
+  return CreateInlineExecutor(intrinsics::CreateCompleteHandlerSet({}),
+                              CreateWorkStealingConcurrencyManager())
+      .value();
+}
+
+v0::Value CreateStr() {
+  v0::Value value_pb;
+  value_pb.set_str("The quick brown fox jumps over the lazy dog.");
+  return value_pb;
+}
+
+void BM_CreateValue(benchmark::State& state) {
+  std::shared_ptr<Executor> executor = CreateBenchmarkExecutor();
+  const v0::Value value_pb = CreateStr();
+  for (auto _ : state) {
+    OwnedValueId value = executor->CreateValue(value_pb).value();
+    benchmark::DoNotOptimize(executor->Materialize(value.ref(), nullptr));
+  }
+}
+BENCHMARK(BM_CreateValue)->UseRealTime();
+
+void BM_CreateStruct(benchmark::State& state) {
+  std::shared_ptr<Executor> executor = CreateBenchmarkExecutor();
+  OwnedValueId element = executor->CreateValue(CreateStr()).value();
+  const std::vector<ValueId> elements(state.range(0), element.ref());
+  for (auto _ : state) {
+    OwnedValueId value = executor->CreateStruct(elements).value();
+    benchmark::DoNotOptimize(executor->Materialize(value.ref(), nullptr));
+  }
+}
+BENCHMARK(BM_CreateStruct)->Arg(2)->Arg(16)->UseRealTime();
+
+void BM_CreateSelection(benchmark::State& state) {
+  std::shared_ptr<Executor> executor = CreateBenchmarkExecutor();
+  OwnedValueId element = executor->CreateValue(CreateStr()).value();
+  const std::vector<ValueId> elements(16, element.ref());
+  OwnedValueId source = executor->CreateStruct(elements).value();
+  for (auto _ : state) {
+    OwnedValueId value = executor->CreateSelection(source.ref(), 7).value();
+    benchmark::DoNotOptimize(executor->Materialize(value.ref(), nullptr));
+  }
+}
+BENCHMARK(BM_CreateSelection)->UseRealTime();
+
+}  // namespace
+}  // namespace genc
@@ -15,10 +15,12 @@ limitations under the License
 
 #include "genc/cc/runtime/inline_executor.h"
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <streambuf>
+#include <utility>
 #include <vector>
 
 #include "googletest/include/gtest/gtest.h"
@@ -29,6 +31,7 @@ limitations under the License
 #include "genc/cc/authoring/constructor.h"
 #include "genc/cc/intrinsics/handler_sets.h"
 #include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/intrinsic_handler.h"
 #include "genc/cc/runtime/runner.h"
 #include "genc/cc/runtime/threading.h"
 #include "genc/proto/v0/computation.pb.h"
@@ -243,6 +246,64 @@ TEST_F(InlineExecutorTest, CreateStructAndSelection) {
   EXPECT_EQ(b_pb.DebugString(), y.DebugString());
 }
 
+TEST_F(InlineExecutorTest, NestedStructsShareTheirElements) {
+  std::shared_ptr<Executor> executor =
+      CreateInlineExecutor(intrinsics::CreateCompleteHandlerSet({}),
+                           CreateThreadBasedConcurrencyManager())
+          .value();
+
+  auto location_pb = std::make_shared<v0::Value>();
+  location_pb->set_label("location");
+  location_pb->set_str("Tokyo");
+  OwnedValueId location_val = executor->CreateSharedValue(location_pb).value();
+  OwnedValueId inner_val =
+      executor->CreateStruct({location_val.ref()}).value();
+  OwnedValueId outer_val =
+      executor->CreateStruct({inner_val.ref(), location_val.ref()}).value();
+
+  v0::Value outer_pb;
+  ASSERT_TRUE(executor->Materialize(outer_val.ref(), &outer_pb).ok());
+  ASSERT_EQ(outer_pb.struct_().element_size(), 2);
+  EXPECT_EQ(outer_pb.struct_().element(0).struct_().element(0).DebugString(),
+            location_pb->DebugString());
+  EXPECT_EQ(outer_pb.struct_().element(1).DebugString(),
+            location_pb->DebugString());
+
+  OwnedValueId selected_val =
+      executor->CreateSelection(outer_val.ref(), 0).value();
+  selected_val = executor->CreateSelection(selected_val.ref(), 0).value();
+  v0::Value selected_pb;
+  ASSERT_TRUE(executor->Materialize(selected_val.ref(), &selected_pb).ok());
+  EXPECT_EQ(selected_pb.DebugString(), location_pb->DebugString());
+
+  OwnedValueId out_of_range_val =
+      executor->CreateSelection(inner_val.ref(), 1).value();
+  EXPECT_EQ(executor->Materialize(out_of_range_val.ref(), nullptr).code(),
+            absl::StatusCode::kOutOfRange);
+  OwnedValueId not_a_struct_val =
+      executor->CreateSelection(location_val.ref(), 0).value();
+  EXPECT_EQ(executor->Materialize(not_a_struct_val.ref(), nullptr).code(),
+            absl::StatusCode::kInvalidArgument);
+
+  // The struct is assembled into a single proto when passed to an intrinsic.
+  auto mode_pb = std::make_shared<v0::Value>();
+  mode_pb->set_label("mode");
+  mode_pb->set_str("train");
+  OwnedValueId mode_val = executor->CreateSharedValue(mode_pb).value();
+  OwnedValueId arg_val =
+      executor->CreateStruct({location_val.ref(), mode_val.ref()}).value();
+  OwnedValueId template_val =
+      executor
+          ->CreateValue(
+              CreatePromptTemplate("Trip to {location} by {mode}").value())
+          .value();
+  OwnedValueId result_val =
+      executor->CreateCall(template_val.ref(), arg_val.ref()).value();
+  v0::Value result_pb;
+  ASSERT_TRUE(executor->Materialize(result_val.ref(), &result_pb).ok());
+  EXPECT_EQ(result_pb.str(), "Trip to Tokyo by train");
+}
+
 TEST_F(InlineExecutorTest, LoggerLogsAndLeavesValueUnchanged) {
   absl::StatusOr<std::shared_ptr<Executor>> executor =
       CreateInlineExecutor(intrinsics::CreateCompleteHandlerSet({}),
@@ -263,5 +324,69 @@ TEST_F(InlineExecutorTest, LoggerLogsAndLeavesValueUnchanged) {
   EXPECT_EQ(captured_output.str(), "Boo!\n");
 }
 
+// Counts how often intrinsics are validated, and rejects those without a
+// static parameter.
+class CountingIntrinsic : public InlineIntrinsicHandlerBase {
+ public:
+  explicit CountingIntrinsic(std::shared_ptr<std::atomic<int>> num_checks)
+      : InlineIntrinsicHandlerBase("counting"),
+        num_checks_(std::move(num_checks)) {}
+
+  absl::Status CheckWellFormed(const v0::Intrinsic& intrinsic_pb) const final {
+    num_checks_->fetch_add(1);
+    if (!intrinsic_pb.has_static_parameter()) {
+      return absl::InvalidArgumentError("Missing static parameter.");
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status ExecuteCall(const v0::Intrinsic& intrinsic_pb,
+                           const v0::Value& arg, v0::Value* result,
+                           Context* context) const final {
+    result->CopyFrom(arg);
+    return absl::OkStatus();
+  }
+
+ private:
+  const std::shared_ptr<std::atomic<int>> num_checks_;
+};
+
+TEST_F(InlineExecutorTest, SharedIntrinsicIsValidatedOncePerThread) {
+  auto num_checks = std::make_shared<std::atomic<int>>(0);
+  auto handler_set = std::make_shared<IntrinsicHandlerSet>();
+  handler_set->AddHandler(new CountingIntrinsic(num_checks));
+  std::shared_ptr<Executor> executor =
+      CreateInlineExecutor(handler_set,
+                           CreateWorkStealingConcurrencyManager({1}))
+          .value();
+  EXPECT_TRUE(handler_set->frozen());
+
+  auto well_formed_pb = std::make_shared<v0::Value>();
+  well_formed_pb->mutable_intrinsic()->set_uri("counting");
+  well_formed_pb->mutable_intrinsic()->mutable_static_parameter()->set_str(
+      "x");
+  auto malformed_pb = std::make_shared<v0::Value>();
+  malformed_pb->mutable_intrinsic()->set_uri("counting");
+  v0::Value arg_pb;
+  arg_pb.set_str("Boo!");
+  OwnedValueId arg_val = executor->CreateValue(arg_pb).value();
+
+  for (int i = 0; i < 10; ++i) {
+    OwnedValueId fn_val = executor->CreateSharedValue(well_formed_pb).value();
+    OwnedValueId result_val =
+        executor->CreateCall(fn_val.ref(), arg_val.ref()).value();
+    v0::Value result_pb;
+    ASSERT_TRUE(executor->Materialize(result_val.ref(), &result_pb).ok());
+    EXPECT_EQ(result_pb.str(), "Boo!");
+
+    fn_val = executor->CreateSharedValue(malformed_pb).value();
+    result_val = executor->CreateCall(fn_val.ref(), arg_val.ref()).value();
+    EXPECT_EQ(executor->Materialize(result_val.ref(), nullptr).code(),
+              absl::StatusCode::kInvalidArgument);
+  }
+  // Calls run on the worker, or inline on the waiting test thread.
+  EXPECT_LE(num_checks->load(), 4);
+}
+
 }  // namespace
 }  // namespace genc
@@ -15,13 +15,22 @@ limitations under the License
 
 #include "genc/cc/runtime/intrinsic_handler.h"
 
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
+#include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/status_macros.h"
+#include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 
@@ -34,13 +43,29 @@ IntrinsicHandlerSet::~IntrinsicHandlerSet() {
 
 void IntrinsicHandlerSet::AddHandler(const IntrinsicHandler* handler) {
   absl::MutexLock l(&handlers_lock_);
+  CHECK(!frozen()) << "Cannot add a handler for " << handler->uri()
+                   << " to a frozen set.";
   handlers_[handler->uri()] = handler;
 }
 
+void IntrinsicHandlerSet::Freeze() {
+  absl::MutexLock l(&handlers_lock_);
+  if (frozen()) {
+    return;
+  }
+  frozen_handlers_ = handlers_;
+  frozen_.store(true, std::memory_order_release);
+}
+
 absl::StatusOr<const IntrinsicHandler*> IntrinsicHandlerSet::GetHandler(
     absl::string_view uri) const {
   const IntrinsicHandler* handler = nullptr;
-  {
+  if (frozen()) {
+    auto it = frozen_handlers_.find(uri);
+    if (it != frozen_handlers_.end()) {
+      handler = it->second;
+    }
+  } else {
     absl::ReaderMutexLock l(&handlers_lock_);
     auto it = handlers_.find(uri);
     if (it != handlers_.end()) {
@@ -89,4 +114,45 @@ IntrinsicHandler::GetControlFlowInterface(const IntrinsicHandler* handler) {
   return interface;
 }
 
+std::shared_ptr<FutureInterface<ControlFlowIntrinsicHandlerInterface::ValueRef>>
+ControlFlowIntrinsicHandlerInterface::Context::WhenReady(ValueRef value) {
+  auto promise = std::make_shared<Promise<ValueRef>>();
+  OnReady(value, [value, promise]() { promise->Set(value); });
+  return promise;
+}
+
+std::shared_ptr<FutureInterface<v0::Value>>
+ControlFlowIntrinsicHandlerInterface::Context::MaterializeAsync(
+    ValueRef value) {
+  auto promise = std::make_shared<Promise<v0::Value>>();
+  OnReady(value, [this, value, promise]() {
+    v0::Value value_pb;
+    absl::Status status = Materialize(value, &value_pb);
+    if (status.ok()) {
+      promise->Set(std::move(value_pb));
+    } else {
+      promise->Set(status);
+    }
+  });
+  return promise;
+}
+
+std::optional<std::vector<ControlFlowIntrinsicHandlerInterface::ValueRef>>
+ControlFlowIntrinsicHandlerInterface::Context::StructElements(ValueRef value) {
+  return std::nullopt;
+}
+
+std::shared_ptr<FutureInterface<ControlFlowIntrinsicHandlerInterface::ValueRef>>
+ControlFlowIntrinsicHandlerInterface::ExecuteCallAsync(
+    const v0::Intrinsic& intrinsic_pb, std::optional<ValueRef> arg,
+    std::shared_ptr<Context> context) const {
+  std::shared_ptr<ConcurrencyInterface> concurrency_interface =
+      context->concurrency_interface();
+  return Flatten(concurrency_interface->RunAsync(
+      [this, &intrinsic_pb, arg = std::move(arg),
+       context = std::move(context)]() -> absl::StatusOr<ValueRef> {
+        return ExecuteCall(intrinsic_pb, arg, context.get());
+      }));
+}
+
 }  // namespace genc
@@ -16,11 +16,14 @@ limitations under the License
 #ifndef GENC_CC_RUNTIME_INTRINSIC_HANDLER_H_
 #define GENC_CC_RUNTIME_INTRINSIC_HANDLER_H_
 
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "absl/base/const_init.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -63,6 +66,25 @@ class ControlFlowIntrinsicHandlerInterface {
    public:
     virtual std::shared_ptr<ConcurrencyInterface> concurrency_interface()
         const = 0;
+
+    // Returns a future that becomes available with `value` once `value` is
+    // ready, without blocking a thread in the meantime. The context must
+    // outlive the returned future.
+    std::shared_ptr<FutureInterface<ValueRef>> WhenReady(ValueRef value);
+
+    // Asynchronous counterpart of `Materialize`. The context must outlive the
+    // returned future.
+    std::shared_ptr<FutureInterface<v0::Value>> MaterializeAsync(
+        ValueRef value);
+
+    // Returns the elements of `value` if it is a struct whose elements are
+    // known before they are ready (e.g., one assembled from the results of
+    // separate calls), so that each can be used as soon as it is ready.
+    // Otherwise returns `std::nullopt`, and `value` has to be materialized to
+    // get at its elements.
+    virtual std::optional<std::vector<ValueRef>> StructElements(
+        ValueRef value);
+
     virtual ~Context() {};
   };
 
@@ -70,6 +92,17 @@ class ControlFlowIntrinsicHandlerInterface {
       const v0::Intrinsic& intrinsic_pb, std::optional<ValueRef> arg,
       Context* context) const = 0;
 
+  // Asynchronous counterpart of `ExecuteCall`, used by executors running in
+  // asynchronous control flow mode. Handlers that wait on intermediate results
+  // (e.g., loops) should override this to chain their steps as continuations
+  // rather than blocking in `Materialize`. The default implementation runs
+  // `ExecuteCall` on the context's concurrency interface.
+  //
+  // The `intrinsic_pb` must remain valid until the returned future is ready.
+  virtual std::shared_ptr<FutureInterface<ValueRef>> ExecuteCallAsync(
+      const v0::Intrinsic& intrinsic_pb, std::optional<ValueRef> arg,
+      std::shared_ptr<Context> context) const;
+
   virtual ~ControlFlowIntrinsicHandlerInterface() {}
 };
 
@@ -132,9 +165,16 @@ class IntrinsicHandlerSet {
   IntrinsicHandlerSet() : handlers_lock_(absl::kConstInit), handlers_() {}
 
   // Adds handler to the set. Transfers ownership. The hander set will own the
-  // handler, and will delete it upon destruction.
+  // handler, and will delete it upon destruction. The set must not be frozen.
   void AddHandler(const IntrinsicHandler* handler);
 
+  // Makes the set immutable, so that lookups take no locks. Executors freeze
+  // the set they are created with, so handlers must all be added before then.
+  // Freezing is idempotent.
+  void Freeze();
+
+  bool frozen() const { return frozen_.load(std::memory_order_acquire); }
+
   // Returns the specified handler.
   absl::StatusOr<const IntrinsicHandler*> GetHandler(
       absl::string_view uri) const;
@@ -143,7 +183,12 @@ class IntrinsicHandlerSet {
 
  private:
   mutable absl::Mutex handlers_lock_;
-  absl::flat_hash_map<std::string, const IntrinsicHandler*> handlers_;
+  absl::flat_hash_map<std::string, const IntrinsicHandler*> handlers_
+      ABSL_GUARDED_BY(handlers_lock_);
+
+  // Written once by `Freeze` before `frozen_` is set, and read-only after.
+  std::atomic<bool> frozen_ = false;
+  absl::flat_hash_map<std::string, const IntrinsicHandler*> frozen_handlers_;
 };
 
 }  // namespace genc
@@ -0,0 +1,68 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/intrinsic_handler.h"
+
+#include <memory>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "genc/proto/v0/computation.pb.h"
+
+namespace genc {
+namespace {
+
+class TestIntrinsic : public InlineIntrinsicHandlerBase {
+ public:
+  explicit TestIntrinsic(absl::string_view uri)
+      : InlineIntrinsicHandlerBase(uri) {}
+
+  absl::Status CheckWellFormed(const v0::Intrinsic& intrinsic_pb) const final {
+    return absl::OkStatus();
+  }
+
+  absl::Status ExecuteCall(const v0::Intrinsic& intrinsic_pb,
+                           const v0::Value& arg, v0::Value* result,
+                           Context* context) const final {
+    return absl::OkStatus();
+  }
+};
+
+TEST(IntrinsicHandlerSetTest, FindsHandlersBeforeAndAfterFreezing) {
+  IntrinsicHandlerSet handlers;
+  const IntrinsicHandler* foo = new TestIntrinsic("foo");
+  handlers.AddHandler(foo);
+  EXPECT_FALSE(handlers.frozen());
+  EXPECT_EQ(handlers.GetHandler("foo").value(), foo);
+  EXPECT_EQ(handlers.GetHandler("bar").status().code(),
+            absl::StatusCode::kNotFound);
+
+  handlers.Freeze();
+  EXPECT_TRUE(handlers.frozen());
+  EXPECT_EQ(handlers.GetHandler("foo").value(), foo);
+  EXPECT_EQ(handlers.GetHandler("bar").status().code(),
+            absl::StatusCode::kNotFound);
+}
+
+TEST(IntrinsicHandlerSetTest, RejectsHandlersAddedAfterFreezing) {
+  IntrinsicHandlerSet handlers;
+  handlers.AddHandler(new TestIntrinsic("foo"));
+  handlers.Freeze();
+  EXPECT_DEATH(handlers.AddHandler(new TestIntrinsic("bar")), "frozen");
+}
+
+}  // namespace
+}  // namespace genc
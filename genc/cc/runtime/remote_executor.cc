@@ -15,25 +15,37 @@ limitations under the License
 
 #include "genc/cc/runtime/remote_executor.h"
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string_view>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "genc/cc/base/to_from_grpc_status.h"
+#include "genc/cc/runtime/compression.h"
 #include "genc/cc/runtime/concurrency.h"
+#include "genc/cc/runtime/dispose_batcher.h"
 #include "genc/cc/runtime/executor.h"
 #include "genc/cc/runtime/status_macros.h"
+#include "genc/cc/runtime/value_chunks.h"
 #include "genc/proto/v0/computation.pb.h"
 #include "genc/proto/v0/executor.grpc.pb.h"
 #include "genc/proto/v0/executor.pb.h"
 #include "include/grpcpp/client_context.h"
 #include "include/grpcpp/support/status.h"
+#include "include/grpcpp/support/sync_stream.h"
 
 namespace genc {
 namespace {
@@ -42,37 +54,41 @@ using ExecutorStub = v0::Executor::StubInterface;
 
 class ExecutorValue {
  public:
-  ExecutorValue(std::shared_ptr<ConcurrencyInterface> concurrency_interface,
-                std::shared_ptr<ExecutorStub> executor_stub,
+  ExecutorValue(std::shared_ptr<DisposeBatcher> dispose_batcher,
                 v0::ValueRef value_ref)
-      : concurrency_interface_(concurrency_interface),
-        executor_stub_(executor_stub),
+      : dispose_batcher_(std::move(dispose_batcher)),
         value_ref_(std::move(value_ref)) {}
 
-  ~ExecutorValue() {
-    concurrency_interface_->RunAsync([executor_stub = executor_stub_,
-                                      value_ref = value_ref_]() -> bool {
-      v0::DisposeRequest request;
-      v0::DisposeResponse response;
-      grpc::ClientContext context;
-      *request.add_value_ref() = value_ref;
-      const grpc::Status status =
-          executor_stub->Dispose(&context, request, &response);
-      if (!status.ok()) {
-        // Silently ignore for now...
-      }
-      return true;
-    });
-  }
+  ~ExecutorValue() { dispose_batcher_->Add(value_ref_); }
 
   const v0::ValueRef& ref() const { return value_ref_; }
 
  private:
-  std::shared_ptr<ConcurrencyInterface> concurrency_interface_;
-  const std::shared_ptr<ExecutorStub> executor_stub_;
+  const std::shared_ptr<DisposeBatcher> dispose_batcher_;
   const v0::ValueRef value_ref_;
 };
 
+// Sends each batch of disposals with a single unary call.
+std::shared_ptr<DisposeBatcher> CreateUnaryDisposeBatcher(
+    std::shared_ptr<ExecutorStub> executor_stub,
+    const DisposeBatcherOptions& options) {
+  return std::make_shared<DisposeBatcher>(
+      [executor_stub](std::vector<v0::ValueRef> value_refs) {
+        v0::DisposeRequest request;
+        v0::DisposeResponse response;
+        grpc::ClientContext context;
+        for (v0::ValueRef& value_ref : value_refs) {
+          *request.add_value_ref() = std::move(value_ref);
+        }
+        const grpc::Status status =
+            executor_stub->Dispose(&context, request, &response);
+        if (!status.ok()) {
+          // Silently ignore for now...
+        }
+      },
+      options);
+}
+
 using ValueFuture = std::shared_ptr<
     FutureInterface<absl::StatusOr<std::shared_ptr<ExecutorValue>>>>;
 
@@ -80,13 +96,65 @@ absl::StatusOr<std::shared_ptr<ExecutorValue>> Wait(ValueFuture value_future) {
   return GENC_TRY(value_future->Get());
 }
 
+// Whether `status` is gRPC's own response to a method the server doesn't
+// implement, which carries no message, unlike errors of the values served.
+bool IsUnimplementedMethod(const grpc::Status& status) {
+  return status.error_code() == grpc::StatusCode::UNIMPLEMENTED &&
+         status.error_message().empty();
+}
+
+// Materializes the remote value `value_ref` through `MaterializeStream`,
+// parsing it as its chunks arrive. Returns nothing if the stub or the server
+// doesn't implement the stream.
+std::optional<absl::Status> MaterializeChunked(ExecutorStub& executor_stub,
+                                               const v0::ValueRef& value_ref,
+                                               size_t max_chunk_size,
+                                               v0::Value* val_pb) {
+  grpc::ClientContext context;
+  v0::MaterializeRequest request;
+  *request.mutable_value_ref() = value_ref;
+  request.set_max_chunk_size(max_chunk_size);
+  std::unique_ptr<grpc::ClientReaderInterface<v0::MaterializeChunk>> reader =
+      executor_stub.MaterializeStream(&context, request);
+  if (reader == nullptr) {
+    return std::nullopt;
+  }
+  bool any_chunk = false;
+  v0::Value value;
+  const absl::Status parse_status = ReadValueChunks(
+      [&reader, &any_chunk](v0::MaterializeChunk* chunk) {
+        if (!reader->Read(chunk)) {
+          return false;
+        }
+        any_chunk = true;
+        return true;
+      },
+      &value);
+  const grpc::Status finish_status = reader->Finish();
+  if (!any_chunk && IsUnimplementedMethod(finish_status)) {
+    return std::nullopt;
+  }
+  // An error from the server explains a failure to parse, so it comes first.
+  GENC_TRY(GrpcToAbslStatus(finish_status));
+  GENC_TRY(parse_status);
+  if (val_pb != nullptr) {
+    *val_pb = std::move(value);
+  }
+  return absl::OkStatus();
+}
+
 class RemoteExecutor : public ExecutorBase<ValueFuture> {
  public:
   explicit RemoteExecutor(
-      std::unique_ptr<ExecutorStub> stub,
-      std::shared_ptr<ConcurrencyInterface> concurrency_interface)
-      : executor_stub_(stub.release()),
-        concurrency_interface_(concurrency_interface) {}
+      std::shared_ptr<ExecutorStub> stub,
+      std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+      const RemoteExecutorOptions& options)
+      : executor_stub_(std::move(stub)),
+        concurrency_interface_(concurrency_interface),
+        dispose_batcher_(CreateUnaryDisposeBatcher(executor_stub_,
+                                                   options.dispose_batching)),
+        materialize_chunk_size_(options.materialize_chunk_size),
+        compression_(options.compression) {}
 
   ~RemoteExecutor() override = default;
 
@@ -104,17 +172,28 @@ class RemoteExecutor : public ExecutorBase<ValueFuture> {
           v0::CreateValueRequest request;
           v0::CreateValueResponse response;
           *request.mutable_value() = val_pb;
+          CompressUnary(compression_, request.ByteSizeLong(), &client_context);
           grpc::Status status = executor_stub_->CreateValue(
               &client_context, request, &response);
           GENC_TRY(GrpcToAbslStatus(status));
           return std::make_shared<ExecutorValue>(
-              concurrency_interface_, executor_stub_,
-              std::move(response.value_ref()));
+              dispose_batcher_, std::move(response.value_ref()));
         });
   }
 
   absl::Status Materialize(ValueFuture value_future, v0::Value* val_pb) final {
     std::shared_ptr<ExecutorValue> value_ref = GENC_TRY(Wait(value_future));
+    if (materialize_chunk_size_ > 0 && !stream_unsupported_) {
+      std::optional<absl::Status> status = MaterializeChunked(
+          *executor_stub_, value_ref->ref(), materialize_chunk_size_, val_pb);
+      if (status.has_value()) {
+        return *std::move(status);
+      }
+      // Older servers, and stubs that only implement the unary calls, don't
+      // support the stream, so values are materialized in one piece from now
+      // on.
+      stream_unsupported_ = true;
+    }
     grpc::ClientContext client_context;
     v0::MaterializeRequest request;
     v0::MaterializeResponse response;
@@ -145,8 +224,7 @@ class RemoteExecutor : public ExecutorBase<ValueFuture> {
               &context, request, &response);
           GENC_TRY(GrpcToAbslStatus(status));
           return std::make_shared<ExecutorValue>(
-              concurrency_interface_, executor_stub_,
-              std::move(response.result_ref()));
+              dispose_batcher_, std::move(response.result_ref()));
         });
   }
 
@@ -168,8 +246,7 @@ class RemoteExecutor : public ExecutorBase<ValueFuture> {
               &context, request, &response);
           GENC_TRY(GrpcToAbslStatus(status));
           return std::make_shared<ExecutorValue>(
-              concurrency_interface_, executor_stub_,
-              std::move(response.struct_ref()));
+              dispose_batcher_, std::move(response.struct_ref()));
         });
   }
 
@@ -189,23 +266,350 @@ class RemoteExecutor : public ExecutorBase<ValueFuture> {
               &client_context, request, &response);
           GENC_TRY(GrpcToAbslStatus(status));
           return std::make_shared<ExecutorValue>(
-              concurrency_interface_, executor_stub_,
-              std::move(response.selection_ref()));
+              dispose_batcher_, std::move(response.selection_ref()));
         });
   }
 
  private:
   const std::shared_ptr<ExecutorStub> executor_stub_;
   const std::shared_ptr<ConcurrencyInterface> concurrency_interface_;
+  const std::shared_ptr<DisposeBatcher> dispose_batcher_;
+  const size_t materialize_chunk_size_;
+  const CompressionOptions compression_;
+  // Set once `MaterializeStream` turns out not to be implemented.
+  std::atomic<bool> stream_unsupported_ = false;
+};
+
+// An `Execute` stream shared by the values of a `StreamingRemoteExecutor`.
+// Requests are queued rather than sent right away, and each `Materialize`
+// sends everything queued so far as a single batch, so that a computation
+// graph costs one round trip no matter how many values it creates.
+class ExecuteStream {
+ public:
+  ExecuteStream(std::shared_ptr<ExecutorStub> executor_stub,
+                const RemoteExecutorOptions& options)
+      : executor_stub_(std::move(executor_stub)),
+        compression_(options.compression),
+        stream_(StartStream()),
+        dispose_batcher_(
+            [this](std::vector<v0::ValueRef> value_refs) {
+              SendDisposals(std::move(value_refs));
+            },
+            options.dispose_batching),
+        reader_(stream_ == nullptr
+                    ? std::thread()
+                    : std::thread([this]() { ReadResponses(); })) {}
+
+  ~ExecuteStream() {
+    if (stream_ == nullptr) {
+      return;
+    }
+    // The server disposes of the values when the stream ends, so requests
+    // still queued (i.e., disposals) need not be sent. Half-closing first
+    // lets streams that can't observe the cancellation, such as the one
+    // emulated over Oak, end too. The dispose batcher may be writing a batch
+    // meanwhile, or still send one before it's destroyed.
+    {
+      absl::MutexLock write_lock(&write_mutex_);
+      writes_done_ = true;
+      stream_->WritesDone();
+    }
+    context_.TryCancel();
+    reader_.join();
+  }
+
+  // Whether the stub supports the stream. Nothing else may be called if not.
+  bool started() const { return stream_ != nullptr; }
+
+  // Returns a new reference, unique within the stream.
+  v0::ValueRef NewValueRef() {
+    v0::ValueRef value_ref;
+    value_ref.set_numeric_id(
+        next_value_ref_.fetch_add(1, std::memory_order_relaxed));
+    return value_ref;
+  }
+
+  // Queues `request`, to be sent with the next `Materialize`.
+  void Enqueue(v0::ExecutorRequest request) {
+    absl::MutexLock lock(&mutex_);
+    *pending_.add_request() = std::move(request);
+  }
+
+  // Disposes of `value_ref` with the next batch, whether sent for a
+  // `Materialize` or by the dispose batcher.
+  void Dispose(v0::ValueRef value_ref) {
+    dispose_batcher_.Add(std::move(value_ref));
+  }
+
+  absl::Status Materialize(const v0::ValueRef& value_ref, v0::Value* val_pb) {
+    auto promise = std::make_shared<Promise<v0::Value>>();
+    {
+      absl::MutexLock lock(&mutex_);
+      GENC_TRY(status_);
+      materializations_[value_ref.numeric_id()].push_back(promise);
+      *pending_.add_request()->mutable_materialize()->mutable_value_ref() =
+          value_ref;
+    }
+    GENC_TRY(Flush());
+    v0::Value value = GENC_TRY(promise->Get());
+    if (val_pb != nullptr) {
+      *val_pb = std::move(value);
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  absl::Status Flush() {
+    // Batches are written in the order they were queued in, since later ones
+    // may refer to values created by earlier ones.
+    absl::MutexLock write_lock(&write_mutex_);
+    if (writes_done_) {
+      return absl::UnavailableError("The Execute stream has been closed.");
+    }
+    v0::ExecuteRequest batch;
+    {
+      absl::MutexLock lock(&mutex_);
+      GENC_TRY(status_);
+      batch.Swap(&pending_);
+      // Taken under `mutex_`, so the values were created by the requests
+      // queued so far, either in this batch or in an earlier one.
+      std::vector<v0::ValueRef> disposals = dispose_batcher_.Take();
+      if (!disposals.empty()) {
+        v0::DisposeRequest* dispose = batch.add_request()->mutable_dispose();
+        for (v0::ValueRef& value_ref : disposals) {
+          *dispose->add_value_ref() = std::move(value_ref);
+        }
+      }
+    }
+    if (batch.request().empty()) {
+      return absl::OkStatus();
+    }
+    if (!stream_->Write(batch, CompressionWriteOptions(
+                                   compression_, batch.ByteSizeLong()))) {
+      return absl::UnavailableError("The Execute stream has been closed.");
+    }
+    return absl::OkStatus();
+  }
+
+  // Compression has to be set up before the call starts, so this is called
+  // once `context_` is initialized.
+  std::unique_ptr<grpc::ClientReaderWriterInterface<v0::ExecuteRequest,
+                                                    v0::ExecuteResponse>>
+  StartStream() {
+    CompressStream(compression_, &context_);
+    return executor_stub_->Execute(&context_);
+  }
+
+  void SendDisposals(std::vector<v0::ValueRef> value_refs) {
+    v0::ExecutorRequest request;
+    for (v0::ValueRef& value_ref : value_refs) {
+      *request.mutable_dispose()->add_value_ref() = std::move(value_ref);
+    }
+    Enqueue(std::move(request));
+    // Failures are reported by the next `Materialize`.
+    Flush().IgnoreError();
+  }
+
+  void ReadResponses() {
+    v0::ExecuteResponse response;
+    while (stream_->Read(&response)) {
+      std::shared_ptr<Promise<v0::Value>> promise;
+      {
+        absl::MutexLock lock(&mutex_);
+        auto it = materializations_.find(response.value_ref().numeric_id());
+        if (it == materializations_.end()) {
+          continue;
+        }
+        promise = std::move(it->second.front());
+        it->second.pop_front();
+        if (it->second.empty()) {
+          materializations_.erase(it);
+        }
+      }
+      if (response.error_code() != 0) {
+        promise->Set(
+            absl::Status(static_cast<absl::StatusCode>(response.error_code()),
+                         response.error_message()));
+      } else {
+        promise->Set(std::move(*response.mutable_value()));
+      }
+    }
+    absl::Status status = GrpcToAbslStatus(stream_->Finish());
+    if (status.ok()) {
+      status = absl::UnavailableError("The Execute stream has ended.");
+    }
+    absl::flat_hash_map<uint64_t,
+                        std::deque<std::shared_ptr<Promise<v0::Value>>>>
+        orphaned;
+    {
+      absl::MutexLock lock(&mutex_);
+      status_ = status;
+      orphaned.swap(materializations_);
+    }
+    for (auto& [value_ref, promises] : orphaned) {
+      for (const std::shared_ptr<Promise<v0::Value>>& promise : promises) {
+        promise->Set(status);
+      }
+    }
+  }
+
+  const std::shared_ptr<ExecutorStub> executor_stub_;
+  const CompressionOptions compression_;
+  grpc::ClientContext context_;
+  const std::unique_ptr<
+      grpc::ClientReaderWriterInterface<v0::ExecuteRequest,
+                                        v0::ExecuteResponse>>
+      stream_;
+  std::atomic<uint64_t> next_value_ref_ = 0;
+
+  absl::Mutex write_mutex_;
+  bool writes_done_ ABSL_GUARDED_BY(write_mutex_) = false;
+  absl::Mutex mutex_;
+  v0::ExecuteRequest pending_ ABSL_GUARDED_BY(mutex_);
+  // Promises for the values requested under each reference, in the order in
+  // which they were requested.
+  absl::flat_hash_map<uint64_t,
+                      std::deque<std::shared_ptr<Promise<v0::Value>>>>
+      materializations_ ABSL_GUARDED_BY(mutex_);
+  // Set once the stream has ended.
+  absl::Status status_ ABSL_GUARDED_BY(mutex_);
+
+  // Declared after the members used to send batches, so that it is destroyed
+  // (which sends any remaining disposals) before them.
+  DisposeBatcher dispose_batcher_;
+
+  // Declared last, so it starts once everything else is initialized.
+  std::thread reader_;
+};
+
+// A value created through an `ExecuteStream`, disposed of in the next batch
+// once it is no longer referenced.
+class StreamedValue {
+ public:
+  StreamedValue(std::shared_ptr<ExecuteStream> stream, v0::ValueRef value_ref)
+      : stream_(std::move(stream)), value_ref_(std::move(value_ref)) {}
+
+  ~StreamedValue() { stream_->Dispose(value_ref_); }
+
+  const v0::ValueRef& ref() const { return value_ref_; }
+
+ private:
+  const std::shared_ptr<ExecuteStream> stream_;
+  const v0::ValueRef value_ref_;
+};
+
+// Like `RemoteExecutor`, but rather than making a blocking call per request,
+// queues requests on an `Execute` stream using references it assigns itself.
+// Creating values never blocks, and errors in creating them are reported
+// when they (or values created from them) are materialized.
+class StreamingRemoteExecutor
+    : public ExecutorBase<std::shared_ptr<StreamedValue>> {
+ public:
+  explicit StreamingRemoteExecutor(std::shared_ptr<ExecuteStream> stream)
+      : stream_(std::move(stream)) {}
+
+  ~StreamingRemoteExecutor() override { ClearTracked(); }
+
+  absl::string_view ExecutorName() final {
+    static constexpr absl::string_view kExecutorName =
+        "StreamingRemoteExecutor";
+    return kExecutorName;
+  }
+
+  absl::StatusOr<std::shared_ptr<StreamedValue>> CreateExecutorValue(
+      const v0::Value& val_pb) final {
+    v0::ExecutorRequest request;
+    *request.mutable_create_value()->mutable_value() = val_pb;
+    return Enqueue(std::move(request));
+  }
+
+  absl::StatusOr<std::shared_ptr<StreamedValue>> CreateCall(
+      std::shared_ptr<StreamedValue> function,
+      std::optional<std::shared_ptr<StreamedValue>> argument) final {
+    v0::ExecutorRequest request;
+    *request.mutable_create_call()->mutable_function_ref() = function->ref();
+    if (argument.has_value()) {
+      *request.mutable_create_call()->mutable_argument_ref() =
+          argument.value()->ref();
+    }
+    return Enqueue(std::move(request));
+  }
+
+  absl::StatusOr<std::shared_ptr<StreamedValue>> CreateStruct(
+      std::vector<std::shared_ptr<StreamedValue>> members) final {
+    v0::ExecutorRequest request;
+    for (const std::shared_ptr<StreamedValue>& member : members) {
+      *request.mutable_create_struct()->add_element_ref() = member->ref();
+    }
+    return Enqueue(std::move(request));
+  }
+
+  absl::StatusOr<std::shared_ptr<StreamedValue>> CreateSelection(
+      std::shared_ptr<StreamedValue> source, const uint32_t index) final {
+    v0::ExecutorRequest request;
+    *request.mutable_create_selection()->mutable_source_ref() = source->ref();
+    request.mutable_create_selection()->set_index(index);
+    return Enqueue(std::move(request));
+  }
+
+  absl::Status Materialize(std::shared_ptr<StreamedValue> value,
+                           v0::Value* val_pb) final {
+    return stream_->Materialize(value->ref(), val_pb);
+  }
+
+ private:
+  std::shared_ptr<StreamedValue> Enqueue(v0::ExecutorRequest request) {
+    v0::ValueRef value_ref = stream_->NewValueRef();
+    *request.mutable_result_ref() = value_ref;
+    stream_->Enqueue(std::move(request));
+    return std::make_shared<StreamedValue>(stream_, std::move(value_ref));
+  }
+
+  const std::shared_ptr<ExecuteStream> stream_;
 };
 
 }  // namespace
 
 absl::StatusOr<std::shared_ptr<Executor>> CreateRemoteExecutor(
-    std::unique_ptr<v0::Executor::StubInterface> executor_stub,
-    std::shared_ptr<ConcurrencyInterface> concurrency_interface) {
-  return std::make_shared<RemoteExecutor>(std::move(executor_stub),
-                                          std::move(concurrency_interface));
+    std::shared_ptr<v0::Executor::StubInterface> executor_stub,
+    std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+    const RemoteExecutorOptions& options) {
+  if (options.use_execute_stream) {
+    auto stream = std::make_shared<ExecuteStream>(executor_stub, options);
+    if (stream->started()) {
+      return std::make_shared<StreamingRemoteExecutor>(std::move(stream));
+    }
+    // Stubs that only implement the unary calls return no stream.
+  }
+  return std::make_shared<RemoteExecutor>(
+      std::move(executor_stub), std::move(concurrency_interface), options);
+}
+
+absl::Status MaterializeToSink(
+    v0::Executor::StubInterface& executor_stub, const v0::ValueRef& value_ref,
+    size_t max_chunk_size,
+    const std::function<absl::Status(absl::string_view)>& sink) {
+  grpc::ClientContext context;
+  v0::MaterializeRequest request;
+  *request.mutable_value_ref() = value_ref;
+  request.set_max_chunk_size(max_chunk_size);
+  std::unique_ptr<grpc::ClientReaderInterface<v0::MaterializeChunk>> reader =
+      executor_stub.MaterializeStream(&context, request);
+  if (reader == nullptr) {
+    return absl::UnimplementedError(
+        "The stub doesn't support MaterializeStream.");
+  }
+  v0::MaterializeChunk chunk;
+  absl::Status status;
+  while (status.ok() && reader->Read(&chunk)) {
+    status = sink(chunk.data());
+  }
+  if (!status.ok()) {
+    context.TryCancel();
+  }
+  const absl::Status finish_status = GrpcToAbslStatus(reader->Finish());
+  GENC_TRY(status);
+  return finish_status;
 }
 
 }  // namespace genc
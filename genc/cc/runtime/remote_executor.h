@@ -16,19 +16,65 @@ limitations under the License
 #ifndef GENC_CC_RUNTIME_REMOTE_EXECUTOR_H_
 #define GENC_CC_RUNTIME_REMOTE_EXECUTOR_H_
 
+#include <cstddef>
+#include <functional>
 #include <memory>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "genc/cc/runtime/compression.h"
 #include "genc/cc/runtime/concurrency.h"
+#include "genc/cc/runtime/dispose_batcher.h"
 #include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/value_chunks.h"
 #include "genc/proto/v0/executor.grpc.pb.h"
 
 namespace genc {
 
-// Creates an executor that forwards all requests to a remote backend.
+struct RemoteExecutorOptions {
+  // Whether to queue requests and send them in batches over a single
+  // `Execute` stream, which takes one round trip per `Materialize`. Otherwise,
+  // a blocking unary call is made for each request. Only for servers known to
+  // implement the stream, since requests are not retried as unary calls if it
+  // fails; stubs that return no stream at all fall back to unary calls.
+  // Values materialized over the stream come back in a single message, so
+  // ones too large for gRPC's limits need this off, and `MaterializeStream`.
+  bool use_execute_stream = false;
+
+  // How to batch the disposal of values that are no longer referenced. With
+  // `use_execute_stream`, pending disposals also go out with each batch of
+  // requests sent for a `Materialize`.
+  DisposeBatcherOptions dispose_batching;
+
+  // If nonzero, values are materialized through `MaterializeStream`, in
+  // chunks of at most this many bytes, so that they aren't subject to gRPC's
+  // limits on message sizes, or with `Materialize` if the server doesn't
+  // implement the stream, which isn't tried again after that. Only applies
+  // without `use_execute_stream`.
+  size_t materialize_chunk_size = kDefaultMaxChunkSize;
+
+  // How to compress requests. Responses are compressed as the server is
+  // configured to.
+  CompressionOptions compression;
+};
+
+// Creates an executor that forwards all requests to a remote backend. The stub
+// may be shared, e.g., if leased from a pool, in which case the lease must be
+// held until the executor and the values created by it are gone.
 absl::StatusOr<std::shared_ptr<Executor>> CreateRemoteExecutor(
-    std::unique_ptr<v0::Executor::StubInterface> executor_stub,
-    std::shared_ptr<ConcurrencyInterface> concurrency_interface);
+    std::shared_ptr<v0::Executor::StubInterface> executor_stub,
+    std::shared_ptr<ConcurrencyInterface> concurrency_interface,
+    const RemoteExecutorOptions& options = {});
+
+// Materializes the remote value `value_ref` through `MaterializeStream`,
+// passing the chunks of its serialized form to `sink` as they arrive, so that
+// the value is never held in full (e.g., to write large media to a file).
+// Fails as unimplemented if the stub doesn't support the stream.
+absl::Status MaterializeToSink(
+    v0::Executor::StubInterface& executor_stub, const v0::ValueRef& value_ref,
+    size_t max_chunk_size,
+    const std::function<absl::Status(absl::string_view)>& sink);
 
 }  // namespace genc
 
@@ -0,0 +1,607 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/remote_executor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "genc/cc/authoring/constructor.h"
+#include "genc/cc/intrinsics/handler_sets.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/cc/runtime/executor_service.h"
+#include "genc/cc/runtime/inline_executor.h"
+#include "genc/cc/runtime/status_macros.h"
+#include "genc/cc/runtime/threading.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "genc/proto/v0/executor.grpc.pb.h"
+#include "genc/proto/v0/executor.pb.h"
+#include "include/grpcpp/client_context.h"
+#include "include/grpcpp/server.h"
+#include "include/grpcpp/server_builder.h"
+#include "include/grpcpp/server_context.h"
+#include "include/grpcpp/support/channel_arguments.h"
+#include "include/grpcpp/support/status.h"
+#include "include/grpcpp/support/sync_stream.h"
+
+namespace genc {
+namespace {
+
+// Forwards the unary calls to `stub`, and returns no streams, like stubs for
+// backends that only support unary calls (e.g., those reached through Oak).
+class UnaryOnlyStub : public v0::Executor::StubInterface {
+ public:
+  explicit UnaryOnlyStub(std::unique_ptr<v0::Executor::StubInterface> stub)
+      : stub_(std::move(stub)) {}
+
+  grpc::Status CreateValue(
+      grpc::ClientContext* context,
+      const v0::CreateValueRequest& request,
+      v0::CreateValueResponse* response) override {
+    return stub_->CreateValue(context, request, response);
+  }
+
+  grpc::Status CreateCall(
+      grpc::ClientContext* context,
+      const v0::CreateCallRequest& request,
+      v0::CreateCallResponse* response) override {
+    return stub_->CreateCall(context, request, response);
+  }
+
+  grpc::Status CreateStruct(
+      grpc::ClientContext* context,
+      const v0::CreateStructRequest& request,
+      v0::CreateStructResponse* response) override {
+    return stub_->CreateStruct(context, request, response);
+  }
+
+  grpc::Status CreateSelection(
+      grpc::ClientContext* context,
+      const v0::CreateSelectionRequest& request,
+      v0::CreateSelectionResponse* response) override {
+    return stub_->CreateSelection(context, request, response);
+  }
+
+  grpc::Status Materialize(
+      grpc::ClientContext* context,
+      const v0::MaterializeRequest& request,
+      v0::MaterializeResponse* response) override {
+    return stub_->Materialize(context, request, response);
+  }
+
+  grpc::Status Dispose(
+      grpc::ClientContext* context,
+      const v0::DisposeRequest& request,
+      v0::DisposeResponse* response) override {
+    return stub_->Dispose(context, request, response);
+  }
+
+ private:
+  grpc::ClientAsyncResponseReaderInterface<v0::CreateValueResponse>*
+      AsyncCreateValueRaw(
+          grpc::ClientContext* context,
+          const v0::CreateValueRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::CreateValueResponse>*
+      PrepareAsyncCreateValueRaw(
+          grpc::ClientContext* context,
+          const v0::CreateValueRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::CreateCallResponse>*
+      AsyncCreateCallRaw(
+          grpc::ClientContext* context,
+          const v0::CreateCallRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::CreateCallResponse>*
+      PrepareAsyncCreateCallRaw(
+          grpc::ClientContext* context,
+          const v0::CreateCallRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::CreateStructResponse>*
+      AsyncCreateStructRaw(
+          grpc::ClientContext* context,
+          const v0::CreateStructRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::CreateStructResponse>*
+      PrepareAsyncCreateStructRaw(
+          grpc::ClientContext* context,
+          const v0::CreateStructRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::CreateSelectionResponse>*
+      AsyncCreateSelectionRaw(
+          grpc::ClientContext* context,
+          const v0::CreateSelectionRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::CreateSelectionResponse>*
+      PrepareAsyncCreateSelectionRaw(
+          grpc::ClientContext* context,
+          const v0::CreateSelectionRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::MaterializeResponse>*
+      AsyncMaterializeRaw(
+          grpc::ClientContext* context,
+          const v0::MaterializeRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::MaterializeResponse>*
+      PrepareAsyncMaterializeRaw(
+          grpc::ClientContext* context,
+          const v0::MaterializeRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::DisposeResponse>*
+      AsyncDisposeRaw(
+          grpc::ClientContext* context,
+          const v0::DisposeRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientAsyncResponseReaderInterface<v0::DisposeResponse>*
+      PrepareAsyncDisposeRaw(
+          grpc::ClientContext* context,
+          const v0::DisposeRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientReaderInterface<v0::MaterializeChunk>* MaterializeStreamRaw(
+      grpc::ClientContext* context,
+      const v0::MaterializeRequest& request) override { return nullptr; }
+
+  grpc::ClientAsyncReaderInterface<v0::MaterializeChunk>*
+      AsyncMaterializeStreamRaw(
+          grpc::ClientContext* context,
+          const v0::MaterializeRequest& request,
+          grpc::CompletionQueue* cq,
+          void* tag) override { return nullptr; }
+
+  grpc::ClientAsyncReaderInterface<v0::MaterializeChunk>*
+      PrepareAsyncMaterializeStreamRaw(
+          grpc::ClientContext* context,
+          const v0::MaterializeRequest& request,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+  grpc::ClientReaderWriterInterface<v0::ExecuteRequest, v0::ExecuteResponse>*
+      ExecuteRaw(grpc::ClientContext* context) override { return nullptr; }
+
+  grpc::ClientAsyncReaderWriterInterface<v0::ExecuteRequest,
+                                         v0::ExecuteResponse>*
+      AsyncExecuteRaw(
+          grpc::ClientContext* context,
+          grpc::CompletionQueue* cq,
+          void* tag) override { return nullptr; }
+
+  grpc::ClientAsyncReaderWriterInterface<v0::ExecuteRequest,
+                                         v0::ExecuteResponse>*
+      PrepareAsyncExecuteRaw(
+          grpc::ClientContext* context,
+          grpc::CompletionQueue* cq) override { return nullptr; }
+
+ protected:
+  const std::unique_ptr<v0::Executor::StubInterface> stub_;
+};
+
+// Also forwards `MaterializeStream`, and counts the calls that materialize.
+class CountingStub : public UnaryOnlyStub {
+ public:
+  using UnaryOnlyStub::UnaryOnlyStub;
+
+  grpc::Status Materialize(
+      grpc::ClientContext* context,
+      const v0::MaterializeRequest& request,
+      v0::MaterializeResponse* response) override {
+    ++num_unary_calls_;
+    return UnaryOnlyStub::Materialize(context, request, response);
+  }
+
+  int num_unary_calls() const { return num_unary_calls_; }
+  int num_streams() const { return num_streams_; }
+
+ private:
+  grpc::ClientReaderInterface<v0::MaterializeChunk>* MaterializeStreamRaw(
+      grpc::ClientContext* context,
+      const v0::MaterializeRequest& request) override {
+    ++num_streams_;
+    return stub_->MaterializeStream(context, request).release();
+  }
+
+  std::atomic<int> num_unary_calls_ = 0;
+  std::atomic<int> num_streams_ = 0;
+};
+
+// Serves the unary calls of `service`, like servers that predate
+// `MaterializeStream`, which gRPC then reports as unimplemented.
+class UnaryOnlyService : public v0::Executor::Service {
+ public:
+  explicit UnaryOnlyService(std::shared_ptr<v0::Executor::Service> service)
+      : service_(std::move(service)) {}
+
+  grpc::Status CreateValue(grpc::ServerContext* context,
+                           const v0::CreateValueRequest* request,
+                           v0::CreateValueResponse* response) override {
+    return service_->CreateValue(context, request, response);
+  }
+
+  grpc::Status CreateCall(grpc::ServerContext* context,
+                          const v0::CreateCallRequest* request,
+                          v0::CreateCallResponse* response) override {
+    return service_->CreateCall(context, request, response);
+  }
+
+  grpc::Status CreateStruct(grpc::ServerContext* context,
+                            const v0::CreateStructRequest* request,
+                            v0::CreateStructResponse* response) override {
+    return service_->CreateStruct(context, request, response);
+  }
+
+  grpc::Status CreateSelection(grpc::ServerContext* context,
+                               const v0::CreateSelectionRequest* request,
+                               v0::CreateSelectionResponse* response) override {
+    return service_->CreateSelection(context, request, response);
+  }
+
+  grpc::Status Materialize(grpc::ServerContext* context,
+                           const v0::MaterializeRequest* request,
+                           v0::MaterializeResponse* response) override {
+    return service_->Materialize(context, request, response);
+  }
+
+  grpc::Status Dispose(grpc::ServerContext* context,
+                       const v0::DisposeRequest* request,
+                       v0::DisposeResponse* response) override {
+    return service_->Dispose(context, request, response);
+  }
+
+ private:
+  const std::shared_ptr<v0::Executor::Service> service_;
+};
+
+v0::Value CreateStrValue(const std::string& str) {
+  v0::Value value;
+  value.set_str(str);
+  return value;
+}
+
+// Serves an inline executor in process, to be reached through remote
+// executors.
+class RemoteExecutorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    intrinsics::HandlerSetConfig config;
+    config.custom_function_map["append_foo"] = [](v0::Value arg) {
+      v0::Value result;
+      result.set_str(absl::StrCat(arg.str(), "foo"));
+      return result;
+    };
+    config.custom_function_map["unsupported"] =
+        [](const v0::Value& arg) -> absl::StatusOr<v0::Value> {
+      return absl::UnimplementedError("Not supported yet.");
+    };
+    std::shared_ptr<Executor> executor =
+        CreateInlineExecutor(intrinsics::CreateCompleteHandlerSet(config),
+                             CreateThreadBasedConcurrencyManager())
+            .value();
+    service_ = CreateExecutorService(executor).value();
+    grpc::ServerBuilder builder;
+    builder.RegisterService(service_.get());
+    server_ = builder.BuildAndStart();
+  }
+
+  void TearDown() override { server_->Shutdown(); }
+
+  std::unique_ptr<v0::Executor::Stub> NewStub() {
+    return v0::Executor::NewStub(
+        server_->InProcessChannel(grpc::ChannelArguments()));
+  }
+
+  std::shared_ptr<Executor> CreateRemote(
+      std::shared_ptr<v0::Executor::StubInterface> stub,
+      const RemoteExecutorOptions& options) {
+    return CreateRemoteExecutor(std::move(stub),
+                                CreateThreadBasedConcurrencyManager(), options)
+        .value();
+  }
+
+  // Calls the custom function `append_foo` on `arg`.
+  absl::StatusOr<v0::Value> AppendFoo(Executor& executor,
+                                      const std::string& arg) {
+    OwnedValueId fn = GENC_TRY(
+        executor.CreateValue(CreateCustomFunction("append_foo").value()));
+    OwnedValueId arg_val = GENC_TRY(executor.CreateValue(CreateStrValue(arg)));
+    OwnedValueId result = GENC_TRY(executor.CreateCall(fn.ref(),
+                                                       arg_val.ref()));
+    v0::Value result_pb;
+    GENC_TRY(executor.Materialize(result.ref(), &result_pb));
+    return result_pb;
+  }
+
+  std::shared_ptr<v0::Executor::Service> service_;
+  std::unique_ptr<grpc::Server> server_;
+};
+
+// Runs each test with and without the `Execute` stream.
+class RemoteExecutorModeTest
+    : public RemoteExecutorTest,
+      public ::testing::WithParamInterface<bool> {
+ protected:
+  std::shared_ptr<Executor> CreateRemote() {
+    RemoteExecutorOptions options;
+    options.use_execute_stream = GetParam();
+    return RemoteExecutorTest::CreateRemote(NewStub(), options);
+  }
+};
+
+TEST_P(RemoteExecutorModeTest, CreatesCall) {
+  std::shared_ptr<Executor> executor = CreateRemote();
+  absl::StatusOr<v0::Value> result = AppendFoo(*executor, "bar");
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(result->str(), "barfoo");
+}
+
+TEST_P(RemoteExecutorModeTest, CreatesStructAndSelection) {
+  std::shared_ptr<Executor> executor = CreateRemote();
+  OwnedValueId x = executor->CreateValue(CreateStrValue("x")).value();
+  OwnedValueId y = executor->CreateValue(CreateStrValue("y")).value();
+  OwnedValueId xy = executor->CreateStruct({x.ref(), y.ref()}).value();
+  OwnedValueId selection = executor->CreateSelection(xy.ref(), 1).value();
+  v0::Value xy_pb;
+  ASSERT_TRUE(executor->Materialize(xy.ref(), &xy_pb).ok());
+  ASSERT_EQ(xy_pb.struct_().element_size(), 2);
+  EXPECT_EQ(xy_pb.struct_().element(0).str(), "x");
+  v0::Value selection_pb;
+  ASSERT_TRUE(executor->Materialize(selection.ref(), &selection_pb).ok());
+  EXPECT_EQ(selection_pb.str(), "y");
+}
+
+TEST_P(RemoteExecutorModeTest, MaterializesValueRepeatedly) {
+  std::shared_ptr<Executor> executor = CreateRemote();
+  OwnedValueId x = executor->CreateValue(CreateStrValue("x")).value();
+  for (int i = 0; i < 3; ++i) {
+    v0::Value x_pb;
+    ASSERT_TRUE(executor->Materialize(x.ref(), &x_pb).ok());
+    EXPECT_EQ(x_pb.str(), "x");
+  }
+}
+
+TEST_P(RemoteExecutorModeTest, ReportsErrorsWhenMaterialized) {
+  std::shared_ptr<Executor> executor = CreateRemote();
+  OwnedValueId x = executor->CreateValue(CreateStrValue("x")).value();
+  OwnedValueId xs = executor->CreateStruct({x.ref()}).value();
+  // Selections are validated by the server.
+  OwnedValueId missing = executor->CreateSelection(xs.ref(), 5).value();
+  v0::Value missing_pb;
+  EXPECT_FALSE(executor->Materialize(missing.ref(), &missing_pb).ok());
+  // The failure doesn't affect other values.
+  v0::Value x_pb;
+  ASSERT_TRUE(executor->Materialize(x.ref(), &x_pb).ok());
+  EXPECT_EQ(x_pb.str(), "x");
+}
+
+INSTANTIATE_TEST_SUITE_P(UnaryAndStream, RemoteExecutorModeTest,
+                         ::testing::Bool());
+
+TEST_F(RemoteExecutorTest, FallsBackToUnaryCallsWithoutStreams) {
+  RemoteExecutorOptions options;
+  options.use_execute_stream = true;
+  std::shared_ptr<Executor> executor =
+      CreateRemote(std::make_shared<UnaryOnlyStub>(NewStub()), options);
+  absl::StatusOr<v0::Value> result = AppendFoo(*executor, "bar");
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(result->str(), "barfoo");
+}
+
+TEST_F(RemoteExecutorTest, StopsTryingStreamNotImplementedByServer) {
+  UnaryOnlyService unary_only_service(service_);
+  grpc::ServerBuilder builder;
+  builder.RegisterService(&unary_only_service);
+  std::unique_ptr<grpc::Server> unary_only_server = builder.BuildAndStart();
+  auto stub = std::make_shared<CountingStub>(v0::Executor::NewStub(
+      unary_only_server->InProcessChannel(grpc::ChannelArguments())));
+  {
+    std::shared_ptr<Executor> executor =
+        CreateRemote(stub, RemoteExecutorOptions());
+    OwnedValueId x = executor->CreateValue(CreateStrValue("x")).value();
+    for (int i = 0; i < 3; ++i) {
+      v0::Value x_pb;
+      ASSERT_TRUE(executor->Materialize(x.ref(), &x_pb).ok());
+      EXPECT_EQ(x_pb.str(), "x");
+    }
+  }
+  EXPECT_EQ(stub->num_streams(), 1);
+  EXPECT_EQ(stub->num_unary_calls(), 3);
+  unary_only_server->Shutdown();
+}
+
+TEST_F(RemoteExecutorTest, ReturnsUnimplementedErrorsOfValues) {
+  auto stub = std::make_shared<CountingStub>(NewStub());
+  std::shared_ptr<Executor> executor =
+      CreateRemote(stub, RemoteExecutorOptions());
+  OwnedValueId fn =
+      executor->CreateValue(CreateCustomFunction("unsupported").value())
+          .value();
+  OwnedValueId x = executor->CreateValue(CreateStrValue("x")).value();
+  OwnedValueId result = executor->CreateCall(fn.ref(), x.ref()).value();
+  v0::Value result_pb;
+  EXPECT_EQ(executor->Materialize(result.ref(), &result_pb).code(),
+            absl::StatusCode::kUnimplemented);
+  EXPECT_EQ(stub->num_unary_calls(), 0);
+
+  // The stream is still used for other values.
+  v0::Value x_pb;
+  ASSERT_TRUE(executor->Materialize(x.ref(), &x_pb).ok());
+  EXPECT_EQ(x_pb.str(), "x");
+  EXPECT_EQ(stub->num_streams(), 2);
+  EXPECT_EQ(stub->num_unary_calls(), 0);
+}
+
+TEST_F(RemoteExecutorTest, MaterializesToSinkInChunks) {
+  std::unique_ptr<v0::Executor::Stub> stub = NewStub();
+  const std::string str(10000, 'x');
+  grpc::ClientContext context;
+  v0::CreateValueRequest request;
+  *request.mutable_value() = CreateStrValue(str);
+  v0::CreateValueResponse response;
+  ASSERT_TRUE(stub->CreateValue(&context, request, &response).ok());
+
+  std::string serialized;
+  int num_chunks = 0;
+  ASSERT_TRUE(MaterializeToSink(*stub, response.value_ref(), 1024,
+                                [&](absl::string_view data) {
+                                  EXPECT_LE(data.size(), 1024u);
+                                  absl::StrAppend(&serialized, data);
+                                  ++num_chunks;
+                                  return absl::OkStatus();
+                                })
+                  .ok());
+  v0::Value value;
+  ASSERT_TRUE(value.ParseFromString(serialized));
+  EXPECT_EQ(value.str(), str);
+  EXPECT_GT(num_chunks, 9);
+}
+
+TEST_F(RemoteExecutorTest, StopsMaterializingToSinkOnError) {
+  std::unique_ptr<v0::Executor::Stub> stub = NewStub();
+  grpc::ClientContext context;
+  v0::CreateValueRequest request;
+  *request.mutable_value() = CreateStrValue(std::string(10000, 'x'));
+  v0::CreateValueResponse response;
+  ASSERT_TRUE(stub->CreateValue(&context, request, &response).ok());
+
+  int num_chunks = 0;
+  const absl::Status status = MaterializeToSink(
+      *stub, response.value_ref(), 1024, [&](absl::string_view data) {
+        ++num_chunks;
+        return absl::DataLossError("Disk full.");
+      });
+  EXPECT_EQ(status.code(), absl::StatusCode::kDataLoss);
+  EXPECT_EQ(num_chunks, 1);
+}
+
+TEST_F(RemoteExecutorTest, FailsToMaterializeToSinkWithoutStream) {
+  UnaryOnlyStub stub(NewStub());
+  v0::ValueRef value_ref;
+  value_ref.set_numeric_id(1);
+  EXPECT_EQ(MaterializeToSink(stub, value_ref, 1024,
+                              [](absl::string_view data) {
+                                return absl::OkStatus();
+                              })
+                .code(),
+            absl::StatusCode::kUnimplemented);
+}
+
+TEST_F(RemoteExecutorTest, ClosesStreamWhileDisposing) {
+  RemoteExecutorOptions options;
+  options.use_execute_stream = true;
+  options.dispose_batching.max_batch_size = 1;
+  options.dispose_batching.max_delay = absl::ZeroDuration();
+  for (int i = 0; i < 20; ++i) {
+    std::shared_ptr<Executor> executor = CreateRemote(NewStub(), options);
+    {
+      std::vector<OwnedValueId> values;
+      for (int j = 0; j < 10; ++j) {
+        values.push_back(executor->CreateValue(CreateStrValue("x")).value());
+      }
+      v0::Value x_pb;
+      ASSERT_TRUE(executor->Materialize(values.back().ref(), &x_pb).ok());
+    }
+    // Disposals are still being sent as the stream ends.
+    executor = nullptr;
+  }
+}
+
+TEST_F(RemoteExecutorTest, BindsClientAssignedRefsPerStream) {
+  std::unique_ptr<v0::Executor::Stub> stub = NewStub();
+  auto add_request = [](v0::ExecuteRequest& batch, uint64_t result_id) {
+    v0::ExecutorRequest* request = batch.add_request();
+    request->mutable_result_ref()->set_numeric_id(result_id);
+    return request;
+  };
+  auto add_materialize = [](v0::ExecuteRequest& batch, uint64_t id) {
+    batch.add_request()
+        ->mutable_materialize()
+        ->mutable_value_ref()
+        ->set_numeric_id(id);
+  };
+
+  grpc::ClientContext first_context;
+  auto first = stub->Execute(&first_context);
+  v0::ExecuteRequest batch;
+  *add_request(batch, 1)->mutable_create_value()->mutable_value() =
+      CreateStrValue("x");
+  *add_request(batch, 2)->mutable_create_value()->mutable_value() =
+      CreateStrValue("y");
+  v0::CreateStructRequest* xy = add_request(batch, 3)->mutable_create_struct();
+  xy->add_element_ref()->set_numeric_id(1);
+  xy->add_element_ref()->set_numeric_id(2);
+  v0::CreateSelectionRequest* y =
+      add_request(batch, 4)->mutable_create_selection();
+  y->mutable_source_ref()->set_numeric_id(3);
+  y->set_index(1);
+  add_materialize(batch, 4);
+  ASSERT_TRUE(first->Write(batch));
+  v0::ExecuteResponse response;
+  ASSERT_TRUE(first->Read(&response));
+  EXPECT_EQ(response.value_ref().numeric_id(), 4u);
+  EXPECT_EQ(response.error_code(), 0);
+  EXPECT_EQ(response.value().str(), "y");
+
+  // The same references mean nothing on another stream.
+  grpc::ClientContext second_context;
+  auto second = stub->Execute(&second_context);
+  batch.Clear();
+  add_materialize(batch, 1);
+  ASSERT_TRUE(second->Write(batch));
+  ASSERT_TRUE(second->Read(&response));
+  EXPECT_EQ(response.value_ref().numeric_id(), 1u);
+  EXPECT_NE(response.error_code(), 0);
+  EXPECT_TRUE(second->WritesDone());
+  EXPECT_TRUE(second->Finish().ok());
+
+  // Nor do disposed references. Responses may arrive in any order.
+  batch.Clear();
+  batch.add_request()->mutable_dispose()->add_value_ref()->set_numeric_id(1);
+  add_materialize(batch, 1);
+  add_materialize(batch, 2);
+  ASSERT_TRUE(first->Write(batch));
+  absl::flat_hash_map<uint64_t, v0::ExecuteResponse> responses;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(first->Read(&response));
+    responses[response.value_ref().numeric_id()] = response;
+  }
+  EXPECT_NE(responses[1].error_code(), 0);
+  EXPECT_EQ(responses[2].error_code(), 0);
+  EXPECT_EQ(responses[2].value().str(), "y");
+  EXPECT_TRUE(first->WritesDone());
+  EXPECT_TRUE(first->Finish().ok());
+}
+
+}  // namespace
+}  // namespace genc
@@ -20,46 +20,63 @@ limitations under the License
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "genc/cc/optimization/pass_manager.h"
 #include "genc/cc/runtime/executor.h"
 #include "genc/cc/runtime/status_macros.h"
 #include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 
-absl::StatusOr<Runner> Runner::Create(std::shared_ptr<Executor> executor) {
+absl::StatusOr<Runner> Runner::Create(std::shared_ptr<Executor> executor,
+                                     const RunnerOptions& options) {
   if (executor == nullptr) {
     return absl::InvalidArgumentError("Executor must not be null.");
   }
-  return Runner(nullptr, executor);
+  return Runner(nullptr, executor, options.pass_manager);
 }
 
 absl::StatusOr<Runner> Runner::Create(v0::Value computation,
-                                     std::shared_ptr<Executor> executor) {
+                                     std::shared_ptr<Executor> executor,
+                                     const RunnerOptions& options) {
   if (executor == nullptr) {
     return absl::InvalidArgumentError("Executor must not be null.");
   }
-  return Runner(std::make_unique<v0::Value>(computation), executor);
+  if (options.pass_manager != nullptr) {
+    options.pass_manager->Run(&computation);
+  }
+  // The computation is already rewritten, so it isn't rewritten again.
+  return Runner(std::make_shared<const v0::Value>(std::move(computation)),
+                executor, nullptr);
 }
 
-absl::StatusOr<v0::Value> Runner::Run(v0::Value arg) {
+absl::StatusOr<v0::Value> Runner::Run(const v0::Value& arg) {
   if (computation_or_null_ == nullptr) {
     return absl::InvalidArgumentError(
         "A computation was not provided in the constructor.");
   }
-  return RunInternal(*computation_or_null_, arg);
+  return RunInternal(executor_->CreateSharedValue(computation_or_null_), arg);
 }
 
-absl::StatusOr<v0::Value> Runner::Run(v0::Value computation, v0::Value arg) {
+absl::StatusOr<v0::Value> Runner::Run(const v0::Value& computation,
+                                      const v0::Value& arg) {
   if (computation_or_null_ != nullptr) {
     return absl::InvalidArgumentError(
         "A computation was already provided in the constructor.");
   }
-  return RunInternal(computation, arg);
+  if (pass_manager_ != nullptr) {
+    v0::Value rewritten = computation;
+    pass_manager_->Run(&rewritten);
+    return RunInternal(
+        executor_->CreateSharedValue(
+            std::make_shared<const v0::Value>(std::move(rewritten))),
+        arg);
+  }
+  return RunInternal(executor_->CreateValue(computation), arg);
 }
 
 absl::StatusOr<v0::Value> Runner::RunInternal(
-    v0::Value computation, v0::Value arg) {
-  OwnedValueId comp_val = GENC_TRY(executor_->CreateValue(computation));
+    absl::StatusOr<OwnedValueId> computation, const v0::Value& arg) {
+  OwnedValueId comp_val = GENC_TRY(std::move(computation));
   OwnedValueId arg_val = GENC_TRY(executor_->CreateValue(arg));
   OwnedValueId result_val =
       GENC_TRY(executor_->CreateCall(comp_val.ref(), arg_val.ref()));
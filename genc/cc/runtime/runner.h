@@ -20,43 +20,61 @@ limitations under the License
 #include <utility>
 
 #include "absl/status/statusor.h"
+#include "genc/cc/optimization/pass_manager.h"
 #include "genc/cc/runtime/executor.h"
 #include "genc/proto/v0/computation.pb.h"
 
 namespace genc {
 
+struct RunnerOptions {
+  // If set, computations are rewritten by these passes before being executed
+  // (e.g., the ones from `CreateDefaultPassManager()`). A computation given to
+  // `Create` is rewritten once, whereas those given to `Run` are rewritten on
+  // every call.
+  std::shared_ptr<const PassManager> pass_manager;
+};
+
 // Runner that runs arbitrary computation proto.
 class Runner final {
  public:
   // Creates a Runner with a custom executor and no computation.
   // The computation will have to be provided in the `Run` call.
-  static absl::StatusOr<Runner> Create(std::shared_ptr<Executor> executor);
+  static absl::StatusOr<Runner> Create(std::shared_ptr<Executor> executor,
+                                       const RunnerOptions& options = {});
 
   // Creates a Runner with a custom executor and a computation.
   // The subsequent `Run` calls will all use the computation provided here.
   static absl::StatusOr<Runner> Create(v0::Value computation,
-                                       std::shared_ptr<Executor> executor);
+                                       std::shared_ptr<Executor> executor,
+                                       const RunnerOptions& options = {});
 
   // Runs the computation supplied in the constructor and returns the
   // resulting value. Note that if no computation was provided in the
   // constructor, this call will fail.
-  absl::StatusOr<v0::Value> Run(v0::Value arg);
+  absl::StatusOr<v0::Value> Run(const v0::Value& arg);
 
   // Runs the computation supplied below as an argument and returns the
   // resulting value. Note that if a computation was already provided in the
   // constructor, this call will fail.
-  absl::StatusOr<v0::Value> Run(v0::Value computation, v0::Value arg);
+  absl::StatusOr<v0::Value> Run(const v0::Value& computation,
+                                const v0::Value& arg);
 
  private:
-  Runner(std::shared_ptr<v0::Value> computation,
-         std::shared_ptr<Executor> executor)
+  Runner(std::shared_ptr<const v0::Value> computation,
+         std::shared_ptr<Executor> executor,
+         std::shared_ptr<const PassManager> pass_manager)
             : computation_or_null_(computation),
-              executor_(executor) {}
+              executor_(executor),
+              pass_manager_(std::move(pass_manager)) {}
 
-  absl::StatusOr<v0::Value> RunInternal(v0::Value computation, v0::Value arg);
+  // Calls the computation embedded as `computation` on `arg`.
+  absl::StatusOr<v0::Value> RunInternal(
+      absl::StatusOr<OwnedValueId> computation, const v0::Value& arg);
 
-  std::shared_ptr<v0::Value> computation_or_null_;
+  // Shared with the executor rather than copied into it on every run.
+  std::shared_ptr<const v0::Value> computation_or_null_;
   std::shared_ptr<Executor> executor_;
+  std::shared_ptr<const PassManager> pass_manager_;
 };
 
 }  // namespace genc
@@ -16,10 +16,12 @@ limitations under the License
 #include "genc/cc/runtime/runner.h"
 
 #include <memory>
+#include <string>
 
 #include "googletest/include/gtest/gtest.h"
 #include "absl/status/statusor.h"
 #include "genc/cc/authoring/constructor.h"
+#include "genc/cc/optimization/pass_manager.h"
 #include "genc/cc/runtime/executor.h"
 #include "genc/cc/runtime/executor_stacks.h"
 #include "genc/proto/v0/computation.pb.h"
@@ -81,4 +83,40 @@ TEST(RunnerTest, ModelRunReturnsValueCompAndRuntimeInConstructor) {
             "This is an output from a test model in response to \"Boo!\".");
 }
 
+TEST(RunnerTest, OptimizedRunReturnsSameValue) {
+  // x -> Block [p=prompt("Boo!"), unused=prompt(x)] -> model(p)
+  v0::Value prompt_pb = CreatePromptTemplate("{x}").value();
+  v0::Value boo_pb;
+  boo_pb.set_str("Boo!");
+  v0::Value block_pb;
+  v0::Block::Local* p = block_pb.mutable_block()->add_local();
+  p->set_name("p");
+  *p->mutable_value() = CreateCall(prompt_pb, boo_pb).value();
+  v0::Block::Local* unused = block_pb.mutable_block()->add_local();
+  unused->set_name("unused");
+  *unused->mutable_value() =
+      CreateCall(prompt_pb, CreateReference("x").value()).value();
+  *block_pb.mutable_block()->mutable_result() =
+      CreateCall(CreateModelInference("test_model").value(),
+                 CreateReference("p").value())
+          .value();
+  v0::Value comp_pb = CreateLambda("x", block_pb).value();
+
+  RunnerOptions options;
+  options.pass_manager = CreateDefaultPassManager();
+  Runner runner =
+      Runner::Create(comp_pb, CreateDefaultLocalExecutor().value(), options)
+          .value();
+  Runner runner_without_computation =
+      Runner::Create(CreateDefaultLocalExecutor().value(), options).value();
+
+  v0::Value arg;
+  arg.set_str("ignored");
+  const std::string expected =
+      "This is an output from a test model in response to \"Boo!\".";
+  EXPECT_EQ(runner.Run(arg).value().str(), expected);
+  EXPECT_EQ(runner_without_computation.Run(comp_pb, arg).value().str(),
+            expected);
+}
+
 }  // namespace genc
@@ -15,14 +15,21 @@ limitations under the License
 
 #include "genc/cc/runtime/threading.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>  // NOLINT
 #include <memory>
 #include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "genc/cc/runtime/concurrency.h"
 
 namespace genc {
@@ -56,10 +63,217 @@ class ThreadBasedConcurrencyManager : public ConcurrencyInterface {
   };
 };
 
+// A unit of work that can be run exactly once, either by a pool worker or
+// inline by the first thread that waits on it.
+class WorkItem {
+ public:
+  explicit WorkItem(std::function<void()> callback)
+      : callback_(std::move(callback)) {}
+
+  // Runs the callback if no other thread has claimed it yet. Returns false if
+  // the item was already claimed.
+  bool TryRun() {
+    bool expected = false;
+    if (!claimed_.compare_exchange_strong(expected, true)) {
+      return false;
+    }
+    callback_();
+    // Release whatever the callback captured before waking up waiters, so that
+    // the last reference to captured state is not dropped on a pool thread.
+    callback_ = nullptr;
+    absl::MutexLock lock(&mutex_);
+    done_ = true;
+    return true;
+  }
+
+  // Blocks until the callback has run, running it on the calling thread if it
+  // has not been started yet.
+  void Wait() {
+    if (TryRun()) {
+      return;
+    }
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(&done_));
+  }
+
+ private:
+  std::function<void()> callback_;
+  std::atomic<bool> claimed_ = false;
+  absl::Mutex mutex_;
+  bool done_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// State shared between the manager and its worker threads. Workers hold a
+// reference to it, so that the manager can be destroyed from a worker thread.
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(int num_workers) {
+    queues_.reserve(num_workers);
+    for (int i = 0; i < num_workers; ++i) {
+      queues_.emplace_back(std::make_unique<WorkerQueue>());
+    }
+  }
+
+  int num_workers() const { return queues_.size(); }
+
+  void Push(std::shared_ptr<WorkItem> item) {
+    int index;
+    if (current_pool_ == this) {
+      index = current_worker_;
+    } else {
+      index = next_queue_.fetch_add(1, std::memory_order_relaxed) %
+              queues_.size();
+    }
+    {
+      WorkerQueue& queue = *queues_[index];
+      absl::MutexLock lock(&queue.mutex);
+      queue.items.push_back(std::move(item));
+    }
+    num_queued_.fetch_add(1);
+    if (num_sleeping_.load() > 0) {
+      absl::MutexLock lock(&idle_mutex_);
+      idle_cv_.Signal();
+    }
+  }
+
+  void RunWorker(int index) {
+    current_pool_ = this;
+    current_worker_ = index;
+    while (true) {
+      std::shared_ptr<WorkItem> item = Take(index);
+      if (item != nullptr) {
+        item->TryRun();
+        continue;
+      }
+      absl::MutexLock lock(&idle_mutex_);
+      num_sleeping_.fetch_add(1);
+      while (num_queued_.load() == 0 && !shutdown_) {
+        idle_cv_.Wait(&idle_mutex_);
+      }
+      num_sleeping_.fetch_sub(1);
+      if (num_queued_.load() == 0 && shutdown_) {
+        break;
+      }
+    }
+    current_pool_ = nullptr;
+  }
+
+  void Shutdown() {
+    absl::MutexLock lock(&idle_mutex_);
+    shutdown_ = true;
+    idle_cv_.SignalAll();
+  }
+
+ private:
+  struct WorkerQueue {
+    absl::Mutex mutex;
+    std::deque<std::shared_ptr<WorkItem>> items ABSL_GUARDED_BY(mutex);
+  };
+
+  // Pops the most recently pushed item from the worker's own queue, or else
+  // steals the oldest item from another worker's queue.
+  std::shared_ptr<WorkItem> Take(int index) {
+    std::shared_ptr<WorkItem> item;
+    {
+      WorkerQueue& own = *queues_[index];
+      absl::MutexLock lock(&own.mutex);
+      if (!own.items.empty()) {
+        item = std::move(own.items.back());
+        own.items.pop_back();
+      }
+    }
+    for (size_t i = 1; item == nullptr && i < queues_.size(); ++i) {
+      WorkerQueue& victim = *queues_[(index + i) % queues_.size()];
+      absl::MutexLock lock(&victim.mutex);
+      if (!victim.items.empty()) {
+        item = std::move(victim.items.front());
+        victim.items.pop_front();
+      }
+    }
+    if (item != nullptr) {
+      num_queued_.fetch_sub(1);
+    }
+    return item;
+  }
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::atomic<uint64_t> next_queue_ = 0;
+  std::atomic<int64_t> num_queued_ = 0;
+  std::atomic<int> num_sleeping_ = 0;
+  absl::Mutex idle_mutex_;
+  absl::CondVar idle_cv_;
+  bool shutdown_ ABSL_GUARDED_BY(idle_mutex_) = false;
+
+  static thread_local WorkStealingPool* current_pool_;
+  static thread_local int current_worker_;
+};
+
+thread_local WorkStealingPool* WorkStealingPool::current_pool_ = nullptr;
+thread_local int WorkStealingPool::current_worker_ = 0;
+
+class WorkStealingConcurrencyManager : public ConcurrencyInterface {
+ public:
+  explicit WorkStealingConcurrencyManager(int num_workers)
+      : pool_(std::make_shared<WorkStealingPool>(num_workers)) {
+    threads_.reserve(num_workers);
+    for (int i = 0; i < num_workers; ++i) {
+      threads_.emplace_back([pool = pool_, i]() { pool->RunWorker(i); });
+    }
+  }
+
+  ~WorkStealingConcurrencyManager() override {
+    // Workers drain all queued tasks before exiting.
+    pool_->Shutdown();
+    for (std::thread& thread : threads_) {
+      if (thread.get_id() == std::this_thread::get_id()) {
+        thread.detach();
+      } else {
+        thread.join();
+      }
+    }
+  }
+
+ protected:
+  absl::StatusOr<std::shared_ptr<WaitableInterface>> Schedule(
+      std::function<void()> callback) override {
+    auto item = std::make_shared<WorkItem>(std::move(callback));
+    pool_->Push(item);
+    return std::make_shared<Waitable>(std::move(item));
+  }
+
+ private:
+  class Waitable : public WaitableInterface {
+   public:
+    explicit Waitable(std::shared_ptr<WorkItem> item) : item_(std::move(item)) {}
+    absl::Status Wait() override {
+      item_->Wait();
+      return absl::OkStatus();
+    }
+
+   private:
+    std::shared_ptr<WorkItem> item_;
+  };
+
+  const std::shared_ptr<WorkStealingPool> pool_;
+  std::vector<std::thread> threads_;
+};
+
+int DefaultNumWorkers() {
+  const int num_cores = std::thread::hardware_concurrency();
+  return std::max(16, 4 * num_cores);
+}
+
 }  // namespace
 
 std::shared_ptr<ConcurrencyInterface> CreateThreadBasedConcurrencyManager() {
   return std::make_shared<ThreadBasedConcurrencyManager>();
 }
 
+std::shared_ptr<ConcurrencyInterface> CreateWorkStealingConcurrencyManager(
+    const WorkStealingConcurrencyManagerOptions& options) {
+  const int num_workers =
+      options.num_workers > 0 ? options.num_workers : DefaultNumWorkers();
+  return std::make_shared<WorkStealingConcurrencyManager>(num_workers);
+}
+
 }  // namespace genc
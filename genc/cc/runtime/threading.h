@@ -22,8 +22,26 @@ limitations under the License
 
 namespace genc {
 
+// Returns a concurrency manager that spawns a new detached thread for every
+// scheduled task.
 std::shared_ptr<ConcurrencyInterface> CreateThreadBasedConcurrencyManager();
 
+struct WorkStealingConcurrencyManagerOptions {
+  // The number of worker threads in the pool. If zero or negative, a default
+  // based on the number of available cores is used. Since tasks routinely
+  // block on model calls and other I/O, the default over-provisions threads
+  // relative to cores.
+  int num_workers = 0;
+};
+
+// Returns a concurrency manager backed by a fixed-size pool of worker threads,
+// each with its own task deque. Tasks scheduled from a worker are pushed onto
+// that worker's deque, and idle workers steal from the others. A thread that
+// waits on a task which has not started yet runs it inline, so tasks that
+// block on other tasks cannot starve the pool.
+std::shared_ptr<ConcurrencyInterface> CreateWorkStealingConcurrencyManager(
+    const WorkStealingConcurrencyManagerOptions& options = {});
+
 }  // namespace genc
 
 #endif  // GENC_CC_RUNTIME_THREADING_H_
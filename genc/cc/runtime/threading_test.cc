@@ -15,15 +15,29 @@ limitations under the License
 
 #include "genc/cc/runtime/threading.h"
 
+#include <cstddef>
 #include <memory>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "googletest/include/gtest/gtest.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "genc/cc/runtime/concurrency.h"
 #include "genc/cc/runtime/status_macros.h"
 
 namespace genc {
 namespace {
 
+std::shared_ptr<ConcurrencyInterface> CreateWorkStealingPool(int num_workers) {
+  WorkStealingConcurrencyManagerOptions options;
+  options.num_workers = num_workers;
+  return CreateWorkStealingConcurrencyManager(options);
+}
+
 TEST(ThreadingTest, OneCallback) {
   auto cc = CreateThreadBasedConcurrencyManager();
   auto future = cc->RunAsync([]() -> int { return 10; });
@@ -57,5 +71,159 @@ TEST(ThreadingTest, ParentAndTwoChildCallbacks) {
   EXPECT_EQ(result->value(), 30);
 }
 
+TEST(WorkStealingTest, OneCallback) {
+  auto cc = CreateWorkStealingConcurrencyManager();
+  auto future = cc->RunAsync([]() -> int { return 10; });
+  absl::StatusOr<int> result = future->Get();
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(result.value(), 10);
+}
+
+TEST(WorkStealingTest, ParentAndTwoChildCallbacksOnSingleWorker) {
+  auto cc = CreateWorkStealingPool(1);
+  auto future = cc->RunAsync([cc]() -> absl::StatusOr<int> {
+    auto f1 = cc->RunAsync([]() -> int { return 10; });
+    auto f2 = cc->RunAsync([]() -> int { return 20; });
+    return GENC_TRY(f1->Get()) + GENC_TRY(f2->Get());
+  });
+  auto result = future->Get();
+  EXPECT_TRUE(result.ok());
+  EXPECT_TRUE(result.value().ok());
+  EXPECT_EQ(result->value(), 30);
+}
+
+TEST(WorkStealingTest, ManyCallbacksUseBoundedThreads) {
+  constexpr int kNumWorkers = 4;
+  auto cc = CreateWorkStealingPool(kNumWorkers);
+  absl::Mutex mutex;
+  absl::flat_hash_set<std::thread::id> thread_ids;
+  std::vector<std::shared_ptr<FutureInterface<int>>> futures;
+  for (int i = 0; i < 1000; ++i) {
+    futures.push_back(cc->RunAsync([i, &mutex, &thread_ids]() -> int {
+      absl::MutexLock lock(&mutex);
+      thread_ids.insert(std::this_thread::get_id());
+      return i;
+    }));
+  }
+  for (int i = 0; i < static_cast<int>(futures.size()); ++i) {
+    absl::StatusOr<int> result = futures[i]->Get();
+    EXPECT_TRUE(result.ok());
+    EXPECT_EQ(result.value(), i);
+  }
+  // Waiting on a task that has not started runs it on the waiting thread.
+  absl::MutexLock lock(&mutex);
+  EXPECT_LE(thread_ids.size(), static_cast<size_t>(kNumWorkers + 1));
+}
+
+TEST(WorkStealingTest, DeepChainOnSingleWorker) {
+  auto cc = CreateWorkStealingPool(1);
+  std::shared_ptr<FutureInterface<int>> future =
+      cc->RunAsync([]() -> int { return 0; });
+  for (int i = 0; i < 100; ++i) {
+    future = cc->RunAsync([future]() -> int { return *future->Get() + 1; });
+  }
+  absl::StatusOr<int> result = future->Get();
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(result.value(), 100);
+}
+
+TEST(ContinuationTest, ReadyFuture) {
+  auto future = MakeReadyFuture<int>(10);
+  bool called = false;
+  future->OnReady([&called]() { called = true; });
+  EXPECT_TRUE(called);
+  absl::StatusOr<int> result = future->Get();
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(result.value(), 10);
+}
+
+TEST(ContinuationTest, ThenChain) {
+  auto cc = CreateWorkStealingPool(1);
+  auto first = cc->RunAsync([]() -> int { return 10; });
+  auto second = cc->Then(first, [](absl::StatusOr<int> value) -> int {
+    return value.value() + 1;
+  });
+  auto third = cc->Then(second, [](absl::StatusOr<int> value) -> int {
+    return value.value() * 2;
+  });
+  absl::StatusOr<int> result = third->Get();
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(result.value(), 22);
+}
+
+TEST(ContinuationTest, ThenPropagatesErrors) {
+  auto cc = CreateThreadBasedConcurrencyManager();
+  auto failed =
+      MakeReadyFuture<int>(absl::InvalidArgumentError("Upstream failed."));
+  auto next = cc->Then(failed, [](absl::StatusOr<int> value) -> absl::Status {
+    return value.status();
+  });
+  absl::StatusOr<absl::Status> result = next->Get();
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(result->code(), absl::StatusCode::kInvalidArgument);
+}
+
+TEST(ContinuationTest, ThenInlineRunsRightAwayOnReadyFuture) {
+  auto next = ThenInline(MakeReadyFuture<int>(10),
+                         [](absl::StatusOr<int> value) -> int {
+                           return value.value() + 1;
+                         });
+  bool called = false;
+  next->OnReady([&called]() { called = true; });
+  EXPECT_TRUE(called);
+  EXPECT_EQ(next->Get().value(), 11);
+}
+
+TEST(ContinuationTest, ThenInlineRunsOnCompletingThread) {
+  auto promise = std::make_shared<Promise<int>>();
+  std::thread::id continuation_thread;
+  auto next = ThenInline(std::shared_ptr<FutureInterface<int>>(promise),
+                         [&continuation_thread](absl::StatusOr<int> value) {
+                           continuation_thread = std::this_thread::get_id();
+                           return value.status();
+                         });
+  std::thread completer(
+      [promise]() { promise->Set(absl::NotFoundError("Missing.")); });
+  const std::thread::id completer_thread = completer.get_id();
+  completer.join();
+  absl::StatusOr<absl::Status> result = next->Get();
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(result->code(), absl::StatusCode::kNotFound);
+  EXPECT_EQ(continuation_thread, completer_thread);
+}
+
+TEST(ContinuationTest, WhenAll) {
+  auto cc = CreateWorkStealingPool(2);
+  std::vector<std::shared_ptr<FutureInterface<int>>> futures;
+  for (int i = 0; i < 10; ++i) {
+    futures.push_back(cc->RunAsync([i]() -> int { return i; }));
+  }
+  futures.push_back(MakeReadyFuture<int>(10));
+  auto all = WhenAll(absl::MakeConstSpan(futures));
+  absl::StatusOr<std::vector<int>> result = all->Get();
+  EXPECT_TRUE(result.ok());
+  ASSERT_EQ(result->size(), 11u);
+  for (int i = 0; i < static_cast<int>(result->size()); ++i) {
+    EXPECT_EQ((*result)[i], i);
+  }
+}
+
+TEST(ContinuationTest, WhenAllFailsIfAnyInputFails) {
+  std::vector<std::shared_ptr<FutureInterface<int>>> futures = {
+      MakeReadyFuture<int>(1),
+      MakeReadyFuture<int>(absl::NotFoundError("Missing."))};
+  absl::StatusOr<std::vector<int>> result =
+      WhenAll(absl::MakeConstSpan(futures))->Get();
+  EXPECT_EQ(result.status().code(), absl::StatusCode::kNotFound);
+}
+
+TEST(ContinuationTest, WhenAllOfNothingIsReady) {
+  std::vector<std::shared_ptr<FutureInterface<int>>> futures;
+  absl::StatusOr<std::vector<int>> result =
+      WhenAll(absl::MakeConstSpan(futures))->Get();
+  EXPECT_TRUE(result.ok());
+  EXPECT_TRUE(result->empty());
+}
+
 }  // namespace
 }  // namespace genc
@@ -0,0 +1,157 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/value_chunks.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+
+#include "absl/status/status.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "genc/proto/v0/executor.pb.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+
+namespace genc {
+namespace {
+
+// Hands out the data of one chunk at a time as the serialization buffer, and
+// writes the chunk out once it is full.
+class ChunkOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
+ public:
+  ChunkOutputStream(
+      size_t max_chunk_size,
+      const std::function<bool(const v0::MaterializeChunk&)>& write)
+      : max_chunk_size_(max_chunk_size), write_(write) {}
+
+  bool Next(void** data, int* size) override {
+    if (used_ == max_chunk_size_ && !WriteChunk()) {
+      return false;
+    }
+    std::string* buffer = chunk_.mutable_data();
+    buffer->resize(max_chunk_size_);
+    *data = &(*buffer)[used_];
+    *size = static_cast<int>(max_chunk_size_ - used_);
+    byte_count_ += *size;
+    used_ = max_chunk_size_;
+    return true;
+  }
+
+  void BackUp(int count) override {
+    used_ -= count;
+    byte_count_ -= count;
+  }
+
+  int64_t ByteCount() const override { return byte_count_; }
+
+  // Writes out the last, partially filled chunk.
+  bool Finish() { return used_ == 0 || WriteChunk(); }
+
+ private:
+  bool WriteChunk() {
+    chunk_.mutable_data()->resize(used_);
+    used_ = 0;
+    return write_(chunk_);
+  }
+
+  const size_t max_chunk_size_;
+  const std::function<bool(const v0::MaterializeChunk&)>& write_;
+  v0::MaterializeChunk chunk_;
+  // The bytes of `chunk_` filled or handed out so far.
+  size_t used_ = 0;
+  int64_t byte_count_ = 0;
+};
+
+// Reads the data of one chunk at a time, straight out of the chunk.
+class ChunkInputStream : public google::protobuf::io::ZeroCopyInputStream {
+ public:
+  explicit ChunkInputStream(
+      const std::function<bool(v0::MaterializeChunk*)>& read)
+      : read_(read) {}
+
+  bool Next(const void** data, int* size) override {
+    while (position_ == chunk_.data().size()) {
+      if (!read_(&chunk_)) {
+        return false;
+      }
+      position_ = 0;
+    }
+    *data = chunk_.data().data() + position_;
+    *size = static_cast<int>(chunk_.data().size() - position_);
+    byte_count_ += *size;
+    position_ = chunk_.data().size();
+    return true;
+  }
+
+  void BackUp(int count) override {
+    position_ -= count;
+    byte_count_ -= count;
+  }
+
+  bool Skip(int count) override {
+    const void* data;
+    int size;
+    while (count > 0) {
+      if (!Next(&data, &size)) {
+        return false;
+      }
+      if (size > count) {
+        BackUp(size - count);
+        return true;
+      }
+      count -= size;
+    }
+    return true;
+  }
+
+  int64_t ByteCount() const override { return byte_count_; }
+
+ private:
+  const std::function<bool(v0::MaterializeChunk*)>& read_;
+  v0::MaterializeChunk chunk_;
+  size_t position_ = 0;
+  int64_t byte_count_ = 0;
+};
+
+}  // namespace
+
+absl::Status WriteValueChunks(
+    const v0::Value& value, size_t max_chunk_size,
+    const std::function<bool(const v0::MaterializeChunk&)>& write) {
+  if (max_chunk_size == 0) {
+    return absl::InvalidArgumentError("The chunk size must be positive.");
+  }
+  if (max_chunk_size > std::numeric_limits<int>::max()) {
+    return absl::InvalidArgumentError("The chunk size is too large.");
+  }
+  ChunkOutputStream output(max_chunk_size, write);
+  if (!value.SerializeToZeroCopyStream(&output) || !output.Finish()) {
+    return absl::UnavailableError("Failed to write the value.");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ReadValueChunks(
+    const std::function<bool(v0::MaterializeChunk*)>& read, v0::Value* value) {
+  ChunkInputStream input(read);
+  if (!value->ParseFromZeroCopyStream(&input)) {
+    return absl::DataLossError("Failed to parse the streamed value.");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace genc
@@ -0,0 +1,47 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_RUNTIME_VALUE_CHUNKS_H_
+#define GENC_CC_RUNTIME_VALUE_CHUNKS_H_
+
+#include <cstddef>
+#include <functional>
+
+#include "absl/status/status.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "genc/proto/v0/executor.pb.h"
+
+namespace genc {
+
+// The chunk size used when the client leaves it to the server: well below
+// gRPC's default limit of 4 MiB per message.
+inline constexpr size_t kDefaultMaxChunkSize = 1 << 20;
+
+// Serializes `value` into chunks of at most `max_chunk_size` bytes, passing
+// each to `write` as soon as it is full, so that only one chunk of the
+// serialized form is held at a time. Fails if `write` returns false, or if
+// `max_chunk_size` doesn't fit in an `int`.
+absl::Status WriteValueChunks(
+    const v0::Value& value, size_t max_chunk_size,
+    const std::function<bool(const v0::MaterializeChunk&)>& write);
+
+// Parses `value` from the chunks returned by `read`, which returns false once
+// there are none left, without joining the chunks first.
+absl::Status ReadValueChunks(
+    const std::function<bool(v0::MaterializeChunk*)>& read, v0::Value* value);
+
+}  // namespace genc
+
+#endif  // GENC_CC_RUNTIME_VALUE_CHUNKS_H_
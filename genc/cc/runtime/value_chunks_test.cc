@@ -0,0 +1,112 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/value_chunks.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "genc/proto/v0/computation.pb.h"
+#include "genc/proto/v0/executor.pb.h"
+#include "googletest/include/gtest/gtest.h"
+
+namespace genc {
+namespace {
+
+std::vector<v0::MaterializeChunk> Split(const v0::Value& value,
+                                        size_t max_chunk_size) {
+  std::vector<v0::MaterializeChunk> chunks;
+  EXPECT_TRUE(WriteValueChunks(value, max_chunk_size,
+                               [&chunks](const v0::MaterializeChunk& chunk) {
+                                 chunks.push_back(chunk);
+                                 return true;
+                               })
+                  .ok());
+  return chunks;
+}
+
+absl::Status Join(const std::vector<v0::MaterializeChunk>& chunks,
+                  v0::Value* value) {
+  size_t next = 0;
+  return ReadValueChunks(
+      [&chunks, &next](v0::MaterializeChunk* chunk) {
+        if (next == chunks.size()) {
+          return false;
+        }
+        *chunk = chunks[next++];
+        return true;
+      },
+      value);
+}
+
+v0::Value LargeStruct() {
+  v0::Value value;
+  for (int i = 0; i < 10; ++i) {
+    value.mutable_struct_()->add_element()->set_str(std::string(100, 'a' + i));
+  }
+  return value;
+}
+
+TEST(ValueChunksTest, RoundTripsInBoundedChunks) {
+  const v0::Value value = LargeStruct();
+  const std::vector<v0::MaterializeChunk> chunks = Split(value, 64);
+  size_t total_size = 0;
+  for (const v0::MaterializeChunk& chunk : chunks) {
+    EXPECT_LE(chunk.data().size(), 64u);
+    EXPECT_FALSE(chunk.data().empty());
+    total_size += chunk.data().size();
+  }
+  EXPECT_EQ(total_size, value.ByteSizeLong());
+  v0::Value joined;
+  ASSERT_TRUE(Join(chunks, &joined).ok());
+  EXPECT_EQ(joined.SerializeAsString(), value.SerializeAsString());
+}
+
+TEST(ValueChunksTest, RoundTripsSmallValueInOneChunk) {
+  v0::Value value;
+  value.set_int_32(42);
+  const std::vector<v0::MaterializeChunk> chunks = Split(value, 1024);
+  EXPECT_EQ(chunks.size(), 1u);
+  v0::Value joined;
+  ASSERT_TRUE(Join(chunks, &joined).ok());
+  EXPECT_EQ(joined.int_32(), 42);
+}
+
+TEST(ValueChunksTest, FailsWhenWriteFails) {
+  absl::Status status =
+      WriteValueChunks(LargeStruct(), 64, [](const v0::MaterializeChunk&) {
+        return false;
+      });
+  EXPECT_EQ(status.code(), absl::StatusCode::kUnavailable);
+}
+
+TEST(ValueChunksTest, RejectsChunkSizeTooLargeForAnInt) {
+  absl::Status status = WriteValueChunks(
+      LargeStruct(), size_t{1} << 32,
+      [](const v0::MaterializeChunk&) { return true; });
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+}
+
+TEST(ValueChunksTest, FailsOnTruncatedStream) {
+  std::vector<v0::MaterializeChunk> chunks = Split(LargeStruct(), 64);
+  chunks.pop_back();
+  v0::Value joined;
+  EXPECT_EQ(Join(chunks, &joined).code(), absl::StatusCode::kDataLoss);
+}
+
+}  // namespace
+}  // namespace genc
@@ -0,0 +1,46 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/value_ref.h"
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/proto/v0/executor.pb.h"
+
+namespace genc {
+
+v0::ValueRef ValueIdToRef(ValueId id) {
+  v0::ValueRef value_ref;
+  value_ref.set_numeric_id(id);
+  return value_ref;
+}
+
+absl::StatusOr<ValueId> RefToValueId(const v0::ValueRef& ref) {
+  if (ref.has_numeric_id()) {
+    return ref.numeric_id();
+  }
+  ValueId value_id;
+  if (absl::SimpleAtoi(ref.id(), &value_id)) {
+    return value_id;
+  } else {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Invalid value reference: ", ref.id()));
+  }
+}
+
+}  // namespace genc
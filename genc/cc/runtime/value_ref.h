@@ -0,0 +1,34 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_RUNTIME_VALUE_REF_H_
+#define GENC_CC_RUNTIME_VALUE_REF_H_
+
+#include "absl/status/statusor.h"
+#include "genc/cc/runtime/executor.h"
+#include "genc/proto/v0/executor.pb.h"
+
+namespace genc {
+
+// Encodes `id` in the numeric form of `v0::ValueRef`.
+v0::ValueRef ValueIdToRef(ValueId id);
+
+// Decodes a reference in either form, parsing the legacy string form as a
+// decimal number.
+absl::StatusOr<ValueId> RefToValueId(const v0::ValueRef& ref);
+
+}  // namespace genc
+
+#endif  // GENC_CC_RUNTIME_VALUE_REF_H_
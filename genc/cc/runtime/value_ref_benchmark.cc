@@ -0,0 +1,99 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Compares the numeric and legacy string forms of `v0::ValueRef`: encoding
+// and decoding single references as the executor service does for every
+// request, and the wire cost of a `CreateStructRequest` with many elements.
+//
+//   bazel run -c opt //genc/cc/runtime:value_ref_benchmark
+
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "genc/cc/runtime/value_ref.h"
+#include "genc/proto/v0/executor.pb.h"
+
+namespace genc {
+namespace {
+
+// Typical ids once a long-lived executor has handed out many values.
+constexpr uint64_t kFirstId = 1234567;
+
+void BM_RoundTripNumeric(benchmark::State& state) {
+  uint64_t id = kFirstId;
+  for (auto _ : state) {
+    v0::ValueRef value_ref = ValueIdToRef(id++);
+    benchmark::DoNotOptimize(RefToValueId(value_ref));
+  }
+}
+BENCHMARK(BM_RoundTripNumeric);
+
+void BM_RoundTripString(benchmark::State& state) {
+  uint64_t id = kFirstId;
+  for (auto _ : state) {
+    v0::ValueRef value_ref;
+    value_ref.set_id(absl::StrCat(id++));
+    benchmark::DoNotOptimize(RefToValueId(value_ref));
+  }
+}
+BENCHMARK(BM_RoundTripString);
+
+template <bool kNumeric>
+v0::CreateStructRequest MakeRequest(int num_elements) {
+  v0::CreateStructRequest request;
+  for (int i = 0; i < num_elements; ++i) {
+    if (kNumeric) {
+      *request.add_element_ref() = ValueIdToRef(kFirstId + i);
+    } else {
+      request.add_element_ref()->set_id(absl::StrCat(kFirstId + i));
+    }
+  }
+  return request;
+}
+
+template <bool kNumeric>
+void BM_SerializeStruct(benchmark::State& state) {
+  const v0::CreateStructRequest request =
+      MakeRequest<kNumeric>(state.range(0));
+  std::string bytes;
+  for (auto _ : state) {
+    bytes.clear();
+    request.SerializeToString(&bytes);
+    benchmark::DoNotOptimize(bytes);
+  }
+  state.counters["bytes"] = bytes.size();
+}
+BENCHMARK(BM_SerializeStruct<true>)->Arg(16)->Arg(256);
+BENCHMARK(BM_SerializeStruct<false>)->Arg(16)->Arg(256);
+
+template <bool kNumeric>
+void BM_ParseStruct(benchmark::State& state) {
+  const std::string bytes =
+      MakeRequest<kNumeric>(state.range(0)).SerializeAsString();
+  for (auto _ : state) {
+    v0::CreateStructRequest request;
+    request.ParseFromString(bytes);
+    for (const v0::ValueRef& element_ref : request.element_ref()) {
+      benchmark::DoNotOptimize(RefToValueId(element_ref));
+    }
+  }
+}
+BENCHMARK(BM_ParseStruct<true>)->Arg(16)->Arg(256);
+BENCHMARK(BM_ParseStruct<false>)->Arg(16)->Arg(256);
+
+}  // namespace
+}  // namespace genc
@@ -0,0 +1,50 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/value_ref.h"
+
+#include "absl/status/status.h"
+#include "genc/proto/v0/executor.pb.h"
+#include "googletest/include/gtest/gtest.h"
+
+namespace genc {
+namespace {
+
+TEST(ValueRefTest, EncodesNumericForm) {
+  v0::ValueRef value_ref = ValueIdToRef(42);
+  EXPECT_TRUE(value_ref.has_numeric_id());
+  EXPECT_EQ(value_ref.numeric_id(), 42u);
+  EXPECT_EQ(RefToValueId(value_ref).value(), 42u);
+}
+
+TEST(ValueRefTest, DecodesZero) {
+  EXPECT_EQ(RefToValueId(ValueIdToRef(0)).value(), 0u);
+}
+
+TEST(ValueRefTest, DecodesLegacyStringForm) {
+  v0::ValueRef value_ref;
+  value_ref.set_id("17");
+  EXPECT_EQ(RefToValueId(value_ref).value(), 17u);
+}
+
+TEST(ValueRefTest, RejectsMalformedString) {
+  v0::ValueRef value_ref;
+  value_ref.set_id("seventeen");
+  EXPECT_EQ(RefToValueId(value_ref).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace genc
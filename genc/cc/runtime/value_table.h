@@ -0,0 +1,108 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#ifndef GENC_CC_RUNTIME_VALUE_TABLE_H_
+#define GENC_CC_RUNTIME_VALUE_TABLE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace genc {
+
+// A thread-safe table of values keyed by sequentially allocated IDs.
+//
+// IDs come from an atomic counter, and values are spread across `kNumShards`
+// independently locked maps, so concurrent callers touching different values
+// rarely contend on the same mutex. Consecutive IDs land in different shards.
+template <class Value, size_t kNumShards = 64>
+class ShardedValueTable {
+ public:
+  using Id = uint64_t;
+
+  ShardedValueTable() = default;
+  ShardedValueTable(const ShardedValueTable&) = delete;
+  ShardedValueTable& operator=(const ShardedValueTable&) = delete;
+
+  // Stores `value` and returns the newly allocated ID which refers to it.
+  Id Insert(Value value) {
+    Id id = next_id_.fetch_add(1, std::memory_order_relaxed);
+    Shard& shard = ShardFor(id);
+    absl::MutexLock lock(&shard.mutex);
+    shard.values.emplace(id, std::move(value));
+    return id;
+  }
+
+  // Returns a copy of the value stored under `id`, or `std::nullopt` if there
+  // is none.
+  std::optional<Value> Get(Id id) const {
+    const Shard& shard = ShardFor(id);
+    absl::ReaderMutexLock lock(&shard.mutex);
+    auto iter = shard.values.find(id);
+    if (iter == shard.values.end()) {
+      return std::nullopt;
+    }
+    return iter->second;
+  }
+
+  // Removes the value stored under `id`. Returns false if there was none.
+  // The value is destroyed after the shard lock has been released.
+  bool Erase(Id id) {
+    Shard& shard = ShardFor(id);
+    typename Map::node_type node;
+    {
+      absl::MutexLock lock(&shard.mutex);
+      node = shard.values.extract(id);
+    }
+    return !node.empty();
+  }
+
+  // Removes all values. IDs continue to be allocated from where they left off.
+  void Clear() {
+    for (Shard& shard : shards_) {
+      Map values;
+      {
+        absl::MutexLock lock(&shard.mutex);
+        values.swap(shard.values);
+      }
+    }
+  }
+
+ private:
+  using Map = absl::flat_hash_map<Id, Value>;
+
+  struct alignas(ABSL_CACHELINE_SIZE) Shard {
+    mutable absl::Mutex mutex;
+    Map values ABSL_GUARDED_BY(mutex);
+  };
+
+  Shard& ShardFor(Id id) { return shards_[id % kNumShards]; }
+  const Shard& ShardFor(Id id) const { return shards_[id % kNumShards]; }
+
+  std::atomic<Id> next_id_{0};
+  std::array<Shard, kNumShards> shards_;
+};
+
+}  // namespace genc
+
+#endif  // GENC_CC_RUNTIME_VALUE_TABLE_H_
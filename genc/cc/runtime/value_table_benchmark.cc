@@ -0,0 +1,102 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+// Compares the contention behavior of `ShardedValueTable` against a single
+// mutex-guarded map, which is how `ExecutorBase` used to track values. Each
+// iteration tracks a value, looks it up twice, and disposes of it, mirroring
+// the per-value traffic of a `CreateCall` followed by `Materialize`.
+//
+//   bazel run -c opt //genc/cc/runtime:value_table_benchmark
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "genc/cc/runtime/value_table.h"
+
+namespace genc {
+namespace {
+
+// The previous single-lock table, kept here as the baseline.
+template <class Value>
+class SingleMutexValueTable {
+ public:
+  uint64_t Insert(Value value) {
+    absl::WriterMutexLock lock(&mutex_);
+    uint64_t id = next_id_++;
+    values_.emplace(id, std::move(value));
+    return id;
+  }
+
+  std::optional<Value> Get(uint64_t id) {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto iter = values_.find(id);
+    if (iter == values_.end()) {
+      return std::nullopt;
+    }
+    return iter->second;
+  }
+
+  bool Erase(uint64_t id) {
+    absl::WriterMutexLock lock(&mutex_);
+    return values_.erase(id) > 0;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  uint64_t next_id_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_map<uint64_t, Value> values_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Values are shared pointers, as with the executors' future-backed values.
+using TestValue = std::shared_ptr<int>;
+
+template <class Table>
+void BM_TrackGetDispose(benchmark::State& state) {
+  static Table* table = nullptr;
+  if (state.thread_index() == 0) {
+    table = new Table();
+  }
+  // Each thread tracks its own value so the benchmark measures the table, not
+  // contention on a shared reference count.
+  TestValue value = std::make_shared<int>(state.thread_index());
+  for (auto _ : state) {
+    uint64_t id = table->Insert(value);
+    benchmark::DoNotOptimize(table->Get(id));
+    benchmark::DoNotOptimize(table->Get(id));
+    table->Erase(id);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    // Every thread has left the loop before the benchmark's end barrier.
+    delete table;
+    table = nullptr;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TrackGetDispose, SingleMutexValueTable<TestValue>)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TrackGetDispose, ShardedValueTable<TestValue>)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace genc
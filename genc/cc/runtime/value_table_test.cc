@@ -0,0 +1,84 @@
+/* Copyright 2023, The GenC Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License
+==============================================================================*/
+
+#include "genc/cc/runtime/value_table.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "googletest/include/gtest/gtest.h"
+
+namespace genc {
+namespace {
+
+TEST(ShardedValueTableTest, InsertGetErase) {
+  ShardedValueTable<std::string> table;
+  auto foo = table.Insert("foo");
+  auto bar = table.Insert("bar");
+  EXPECT_NE(foo, bar);
+  EXPECT_EQ(table.Get(foo), "foo");
+  EXPECT_EQ(table.Get(bar), "bar");
+  EXPECT_TRUE(table.Erase(foo));
+  EXPECT_FALSE(table.Erase(foo));
+  EXPECT_EQ(table.Get(foo), std::nullopt);
+  EXPECT_EQ(table.Get(bar), "bar");
+}
+
+TEST(ShardedValueTableTest, ClearRemovesAllValuesButKeepsIdsUnique) {
+  ShardedValueTable<int> table;
+  auto first = table.Insert(1);
+  table.Insert(2);
+  table.Clear();
+  EXPECT_EQ(table.Get(first), std::nullopt);
+  EXPECT_NE(table.Insert(3), first);
+}
+
+TEST(ShardedValueTableTest, ErasedValueIsDestroyed) {
+  ShardedValueTable<std::shared_ptr<int>> table;
+  auto value = std::make_shared<int>(1);
+  auto id = table.Insert(value);
+  EXPECT_EQ(value.use_count(), 2);
+  EXPECT_TRUE(table.Erase(id));
+  EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(ShardedValueTableTest, ConcurrentInsertsAllocateDistinctIds) {
+  ShardedValueTable<int> table;
+  constexpr int kNumThreads = 8;
+  constexpr int kNumValues = 1000;
+  std::vector<std::vector<uint64_t>> ids(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&table, &ids, t]() {
+      for (int i = 0; i < kNumValues; ++i) {
+        ids[t].push_back(table.Insert(t * kNumValues + i));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < kNumThreads; ++t) {
+    for (int i = 0; i < kNumValues; ++i) {
+      EXPECT_EQ(table.Get(ids[t][i]), t * kNumValues + i);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace genc
@@ -32,6 +32,7 @@ from genc.python.authoring.constructors import create_prompt_template
 from genc.python.authoring.constructors import create_prompt_template_with_parameters
 from genc.python.authoring.constructors import create_reference
 from genc.python.authoring.constructors import create_regex_partial_match
+from genc.python.authoring.constructors import create_regex_set_match
 from genc.python.authoring.constructors import create_repeat
 from genc.python.authoring.constructors import create_repeated_conditional_chain
 from genc.python.authoring.constructors import create_rest_call
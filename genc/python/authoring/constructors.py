@@ -108,6 +108,22 @@ def create_regex_partial_match(pattern_string):
   return constructor_bindings.create_regex_partial_match(pattern_string)
 
 
+def create_regex_set_match(patterns):
+  """Creates a partial match against all of the given patterns at once.
+
+  The input is scanned once, however many patterns there are, which makes this
+  suitable for routing a model's output.
+
+  Args:
+    patterns: A list of patterns to search for in the input string.
+
+  Returns:
+    A computation that represents the regex set match intrinsic, which returns
+    a struct with one boolean per pattern, in the same order.
+  """
+  return constructor_bindings.create_regex_set_match(patterns)
+
+
 def create_reference(name):
   """Constructs a reference to `name`.
 
@@ -219,18 +235,27 @@ def create_named_value(name, value):
   return constructor_bindings.create_named_value(name, value)
 
 
-def create_fallback(function_list):
+def create_fallback(function_list, mode='sequential', hedge_delay_ms=0):
   """Contructs a fallback expression from a given list of functions.
 
   Args:
     function_list: Candidate functions to attempt to apply to the argument in
       the order listed. The first successful one is the result; if failed, keep
       going down the list. All functions must be of type `pb.Value`.
+    mode: 'sequential' to attempt each function once the previous one has
+      failed, 'hedged' to also attempt the next one whenever those in progress
+      have taken `hedge_delay_ms` without failing, or 'race' to attempt all of
+      them at once.
+    hedge_delay_ms: The delay between attempts in the 'hedged' mode.
 
   Returns:
     A computation that represents a fallback expression.
   """
-  return constructor_bindings.create_fallback(function_list)
+  if mode == 'sequential':
+    return constructor_bindings.create_fallback(function_list)
+  return constructor_bindings.create_fallback_with_options(
+      function_list, mode, hedge_delay_ms
+  )
 
 
 def create_conditional(condition, positive_branch, negative_branch):
@@ -375,16 +400,28 @@ def create_repeated_conditional_chain(num_steps, function_list):
   )
 
 
-def create_parallel_map(map_fn):
+def create_parallel_map(
+    map_fn, max_in_flight=0, ordered=True, fail_fast=True
+):
   """Constructs a parallel map expression.
 
   Args:
     map_fn: The map function to be applied to all input values.
+    max_in_flight: The maximum number of calls to `map_fn` in progress at a
+      time, or 0 for no limit.
+    ordered: Whether the results are in the order of the input values, rather
+      than in the order in which the calls complete.
+    fail_fast: Whether a failed call fails the map, rather than being reported
+      in its result as a string labeled "error".
 
   Returns:
     A computation that represents a parallel map expression.
   """
-  return constructor_bindings.create_parallel_map(map_fn)
+  if max_in_flight == 0 and ordered and fail_fast:
+    return constructor_bindings.create_parallel_map(map_fn)
+  return constructor_bindings.create_parallel_map_with_options(
+      map_fn, max_in_flight, ordered, fail_fast
+  )
 
 
 def create_model_config(config_map):
@@ -49,6 +49,21 @@ class ConstructorsTest(absltest.TestCase):
           constructors.create_model(model_name).intrinsic,
       )
 
+  def test_fallback_hedged(self):
+    comp_pb = constructors.create_fallback(
+        [constructors.create_model('a'), constructors.create_model('b')],
+        mode='hedged',
+        hedge_delay_ms=100,
+    )
+    self.assertEqual(comp_pb.intrinsic.uri, 'fallback')
+    elements = comp_pb.intrinsic.static_parameter.struct.element
+    self.assertEqual(
+        [element.label for element in elements],
+        ['candidate_fn', 'candidate_fn', 'mode', 'hedge_delay_ms'],
+    )
+    self.assertEqual(elements[2].str, 'hedged')
+    self.assertEqual(elements[3].int_32, 100)
+
   def test_conditional(self):
     condition = constructors.create_reference('some_bool_condition')
     comp_pb = constructors.create_conditional(
@@ -113,6 +128,13 @@ class ConstructorsTest(absltest.TestCase):
     self.assertEqual(comp_pb.intrinsic.uri, 'regex_partial_match')
     self.assertEqual(comp_pb.intrinsic.static_parameter.str, 'A: True')
 
+  def test_regex_set_match(self):
+    comp_pb = constructors.create_regex_set_match(['Finish', 'Math'])
+    self.assertEqual(comp_pb.WhichOneof('value'), 'intrinsic')
+    self.assertEqual(comp_pb.intrinsic.uri, 'regex_set_match')
+    patterns = comp_pb.intrinsic.static_parameter.struct.element
+    self.assertEqual([p.str for p in patterns], ['Finish', 'Math'])
+
   def test_while(self):
     test_condition_fn = constructors.create_regex_partial_match(
         'stop_keyword: Finish'